@@ -0,0 +1,50 @@
+#pragma once
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace Charcoal::Bench {
+struct Result {
+    double min_ms;
+    double mean_ms;
+};
+
+/**
+ * @brief Runs fn once to warm up, then the given number of times, and logs
+ * the fastest and average wall time.
+ *
+ * @param name Label printed with the results
+ * @param iterations Number of timed runs
+ * @param fn The code to time
+ * @return The timings, in milliseconds
+ */
+template <typename Fn>
+Result measure(const char *name, int iterations, Fn &&fn) {
+    fn();
+    double freq = static_cast<double>(SDL_GetPerformanceFrequency());
+    double min_ms = 0.0;
+    double total_ms = 0.0;
+    for (int i = 0; i < iterations; ++i) {
+        uint64_t start = SDL_GetPerformanceCounter();
+        fn();
+        uint64_t end = SDL_GetPerformanceCounter();
+        double ms = static_cast<double>(end - start) * 1000.0 / freq;
+        min_ms = i == 0 ? ms : std::min(min_ms, ms);
+        total_ms += ms;
+    }
+    Result result{min_ms, total_ms / static_cast<double>(iterations)};
+    SDL_Log("%-48s min %9.3f ms   mean %9.3f ms", name, result.min_ms,
+            result.mean_ms);
+    return result;
+}
+
+// Each benchmark suite lives in its own file
+void run_bvh();
+void run_ecs();
+void run_level_streaming();
+void run_mesh_import();
+void run_pixel_convert();
+void run_scene_file();
+void run_shader_startup();
+} // namespace Charcoal::Bench
@@ -0,0 +1,146 @@
+#include "bench.h"
+#include "engine/bvh.h"
+#include "engine/frustum.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr int ITERATIONS = 10;
+constexpr int QUERIES = 1000;
+// objects per unit volume, so every scene size has the same local density
+constexpr float DENSITY = 0.5f;
+
+struct Scene {
+    float size;
+    std::vector<Aabb> boxes;
+};
+
+Aabb random_box(std::mt19937 &rng, float size) {
+    std::uniform_real_distribution<float> position{0.0f, size};
+    std::uniform_real_distribution<float> extent{0.1f, 1.0f};
+    glm::vec3 center{position(rng), position(rng), position(rng)};
+    glm::vec3 half{extent(rng), extent(rng), extent(rng)};
+    return Aabb{center - half, center + half};
+}
+
+Scene make_scene(std::size_t count) {
+    Scene scene;
+    scene.size = std::cbrt(static_cast<float>(count) / DENSITY);
+    std::mt19937 rng{1234};
+    scene.boxes.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        scene.boxes.push_back(random_box(rng, scene.size));
+    }
+    return scene;
+}
+
+void run_size(std::size_t count) {
+    Scene scene = make_scene(count);
+    char name[64];
+
+    Bvh bvh;
+    std::vector<Bvh::ProxyId> proxies;
+    proxies.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        proxies.push_back(bvh.insert(scene.boxes[i], static_cast<uint32_t>(i)));
+    }
+    SDL_Log("%zu objects, incremental SAH cost %.1f", count, bvh.get_cost());
+
+    SDL_snprintf(name, sizeof(name), "%zu: build", count);
+    measure(name, ITERATIONS, [&] { bvh.build(); });
+    SDL_Log("%zu objects, built SAH cost %.1f", count, bvh.get_cost());
+
+    // nudge a tenth of the objects, then refit
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> nudge{-0.5f, 0.5f};
+    std::vector<Aabb> moved = scene.boxes;
+    for (std::size_t i = 0; i < count; i += 10) {
+        glm::vec3 offset{nudge(rng), nudge(rng), nudge(rng)};
+        moved[i].min += offset;
+        moved[i].max += offset;
+    }
+    bool flip = false;
+    SDL_snprintf(name, sizeof(name), "%zu: move 10%% + refit", count);
+    measure(name, ITERATIONS, [&] {
+        const std::vector<Aabb> &boxes = flip ? scene.boxes : moved;
+        for (std::size_t i = 0; i < count; i += 10) {
+            bvh.move(proxies[i], boxes[i]);
+        }
+        bvh.refit();
+        flip = !flip;
+    });
+    bvh.build();
+
+    // a camera in the middle looking along +x, seeing a fixed distance, so
+    // the number of visible objects doesn't grow with the scene
+    glm::vec3 eye{scene.size * 0.5f};
+    glm::mat4 view_projection =
+            glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 20.0f) *
+            glm::lookAt(eye, eye + glm::vec3{1.0f, 0.0f, 0.0f},
+                    glm::vec3{0.0f, 1.0f, 0.0f});
+    Frustum frustum = Frustum::from_matrix(view_projection);
+
+    std::vector<uint32_t> visible;
+    SDL_snprintf(name, sizeof(name), "%zu: frustum (Bvh)", count);
+    measure(name, ITERATIONS, [&] {
+        visible.clear();
+        bvh.query_frustum(frustum, visible);
+    });
+    std::size_t bvh_visible = visible.size();
+
+    FrustumCuller culler;
+    for (const Aabb &box : scene.boxes) {
+        culler.add(box);
+    }
+    SDL_snprintf(name, sizeof(name), "%zu: frustum (FrustumCuller)", count);
+    measure(name, ITERATIONS, [&] { culler.cull(frustum, visible); });
+    SDL_Log("%zu objects, %zu visible (Bvh), %zu visible (FrustumCuller)",
+            count, bvh_visible, visible.size());
+
+    std::uniform_real_distribution<float> position{0.0f, scene.size};
+    std::uniform_real_distribution<float> direction{-1.0f, 1.0f};
+    std::vector<Bvh::Ray> rays(QUERIES);
+    for (Bvh::Ray &ray : rays) {
+        ray.origin = glm::vec3{position(rng), position(rng), position(rng)};
+        ray.direction = glm::vec3{direction(rng), direction(rng),
+                direction(rng)};
+    }
+    std::size_t hits = 0;
+    SDL_snprintf(name, sizeof(name), "%zu: %d raycasts", count, QUERIES);
+    measure(name, ITERATIONS, [&] {
+        hits = 0;
+        Bvh::RayHit hit;
+        for (const Bvh::Ray &ray : rays) {
+            hits += bvh.raycast(ray, scene.size, hit) ? 1 : 0;
+        }
+    });
+
+    std::vector<glm::vec3> centers(QUERIES);
+    for (glm::vec3 &center : centers) {
+        center = glm::vec3{position(rng), position(rng), position(rng)};
+    }
+    std::vector<uint32_t> found;
+    SDL_snprintf(name, sizeof(name), "%zu: %d sphere queries", count, QUERIES);
+    measure(name, ITERATIONS, [&] {
+        found.clear();
+        for (const glm::vec3 &center : centers) {
+            bvh.query_sphere(center, 2.0f, found);
+        }
+    });
+    SDL_Log("%zu objects, %zu ray hits, %zu sphere results", count, hits,
+            found.size());
+}
+} // namespace
+
+void run_bvh() {
+    for (std::size_t count : {1000, 10000, 100000, 1000000}) {
+        run_size(count);
+    }
+}
+} // namespace Charcoal::Bench
@@ -0,0 +1,99 @@
+#include "bench.h"
+#include "engine/ecs.h"
+#include "engine/scene.h"
+#include "engine/thread_pool.h"
+#include <SDL3/SDL_stdinc.h>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr int ITERATIONS = 20;
+
+// what Scene's systems do, with the scene's components
+void animate(World &world, ThreadPool *pool, float time) {
+    world.parallel_each<const Animation, Transform>(pool,
+            [time](Entity, const Animation &animation, Transform &transform) {
+                float t = time * animation.frequency + animation.phase;
+                transform.translation = animation.origin +
+                                        animation.axis * std::sin(t) *
+                                                animation.amplitude;
+                transform.rotation = glm::quat{glm::vec3{0.0f, 0.0f,
+                        time * animation.spin + animation.phase}};
+            });
+}
+
+void update_world_transforms(World &world, ThreadPool *pool) {
+    world.parallel_each<const Transform, WorldTransform>(pool,
+            [](Entity, const Transform &transform,
+                    WorldTransform &world_transform) {
+                world_transform.matrix =
+                        glm::translate(glm::mat4{1.0f},
+                                transform.translation) *
+                        glm::mat4_cast(transform.rotation) *
+                        glm::mat4{transform.scale};
+            });
+}
+
+void run_count(ThreadPool &pool, std::size_t count) {
+    std::mt19937 rng{1234};
+    std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+    std::uniform_real_distribution<float> phase{0.0f, 6.28f};
+
+    World world;
+    char name[96];
+    SDL_snprintf(name, sizeof(name), "%zu entities: create", count);
+    measure(name, 1, [&] {
+        world = World{};
+        for (std::size_t i = 0; i < count; ++i) {
+            Transform transform;
+            transform.translation = {position(rng), position(rng),
+                    position(rng)};
+            Animation animation;
+            animation.origin = transform.translation;
+            animation.amplitude = 0.5f;
+            animation.spin = 1.0f;
+            animation.phase = phase(rng);
+            world.create(transform, WorldTransform{}, animation);
+        }
+    });
+
+    SystemScheduler systems;
+    float time = 0.0f;
+    systems.add("animate", component_mask<Animation>(),
+            component_mask<Transform>(),
+            [&](World &world, ThreadPool *pool) {
+                animate(world, pool, time);
+            });
+    systems.add("world_transforms", component_mask<Transform>(),
+            component_mask<WorldTransform>(), update_world_transforms);
+
+    SDL_snprintf(name, sizeof(name), "%zu entities: update, 1 thread", count);
+    measure(name, ITERATIONS, [&] {
+        time += 0.016f;
+        systems.run(world, nullptr);
+    });
+    SDL_snprintf(name, sizeof(name), "%zu entities: update, %zu threads",
+            count, pool.get_thread_count() + 1);
+    measure(name, ITERATIONS, [&] {
+        time += 0.016f;
+        systems.run(world, &pool);
+    });
+
+    World::Stats stats = world.get_stats();
+    SDL_Log("%zu archetypes, %zu chunks", stats.archetype_count,
+            stats.chunk_count);
+}
+} // namespace
+
+void run_ecs() {
+    ThreadPool pool;
+    for (std::size_t count : {10'000, 100'000, 1'000'000}) {
+        run_count(pool, count);
+    }
+}
+} // namespace Charcoal::Bench
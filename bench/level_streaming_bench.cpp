@@ -0,0 +1,130 @@
+#include "bench.h"
+#include "engine/level_streamer.h"
+#include "engine/scene.h"
+#include "engine/thread_pool.h"
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr const char *DIRECTORY = "level_streaming_bench/";
+constexpr int GRID = 16;
+constexpr float CHUNK_SIZE = 64.0f;
+constexpr std::size_t OBJECTS_PER_CHUNK = 2'000;
+constexpr int FRAMES = 600;
+
+// a GRID x GRID level of chunk files and its manifest
+bool write_level(std::string &manifest_path) {
+    SDL_CreateDirectory(DIRECTORY);
+    std::string manifest = "{\"format\": \"charcoal-level\", \"version\": 1, "
+                           "\"chunk_size\": 64, \"chunks\": [";
+    char name[64];
+    for (int x = 0; x < GRID; ++x) {
+        for (int z = 0; z < GRID; ++z) {
+            Scene scene;
+            for (std::size_t i = 1; i < OBJECTS_PER_CHUNK; ++i) {
+                Transform transform;
+                transform.translation = {
+                        x * CHUNK_SIZE + static_cast<float>(i % 64),
+                        static_cast<float>(i / 64),
+                        z * CHUNK_SIZE + static_cast<float>(i % 61)};
+                scene.spawn(0, transform);
+            }
+            SDL_snprintf(name, sizeof(name), "%d_%d.cscn", x, z);
+            if (!scene.save((std::string{DIRECTORY} + name).c_str())) {
+                return false;
+            }
+            manifest += x + z > 0 ? ", " : "";
+            SDL_snprintf(name, sizeof(name),
+                    "{\"cell\": [%d, %d], \"scene\": \"%d_%d.cscn\"}", x, z, x,
+                    z);
+            manifest += name;
+        }
+    }
+    manifest += "]}";
+    manifest_path = std::string{DIRECTORY} + "bench.level";
+    SDL_IOStream *file = SDL_IOFromFile(manifest_path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    SDL_WriteIO(file, manifest.data(), manifest.size());
+    return SDL_CloseIO(file);
+}
+
+// flies diagonally across the level, timing update() every frame
+void fly(ThreadPool &pool, const char *path, float upload_budget_ms) {
+    Scene scene;
+    LevelStreamer::Config config;
+    config.upload_budget_ms = upload_budget_ms;
+    LevelStreamer streamer{&pool, &scene, nullptr, config};
+    if (!streamer.open(path)) {
+        return;
+    }
+    uint64_t freq = SDL_GetPerformanceFrequency();
+    double worst_ms = 0.0;
+    double total_ms = 0.0;
+    std::size_t peak_objects = 0;
+    float extent = GRID * CHUNK_SIZE;
+    for (int frame = 0; frame < FRAMES; ++frame) {
+        float t = static_cast<float>(frame) / FRAMES;
+        glm::vec3 focus{t * extent, 0.0f, t * extent};
+        uint64_t start = SDL_GetPerformanceCounter();
+        streamer.update(focus);
+        double ms = static_cast<double>(SDL_GetPerformanceCounter() - start) *
+                    1000.0 / static_cast<double>(freq);
+        worst_ms = std::max(worst_ms, ms);
+        total_ms += ms;
+        peak_objects =
+                std::max(peak_objects, streamer.get_stats().object_count);
+        // leave the workers a frame's worth of time
+        SDL_DelayNS(4'000'000);
+    }
+    SDL_Log("budget %4.1f ms: update mean %7.3f ms   worst %7.3f ms   peak "
+            "%zu objects",
+            upload_budget_ms, total_ms / FRAMES, worst_ms, peak_objects);
+}
+} // namespace
+
+// Files are written to the working directory and removed afterwards.
+void run_level_streaming() {
+    ThreadPool pool;
+    std::string path;
+    if (!write_level(path)) {
+        SDL_Log("Unable to write the level, skipping");
+        return;
+    }
+
+    // what the streamer replaces: every chunk loaded up front
+    measure("everything up front", 1, [&] {
+        Scene scene;
+        LevelStreamer::Config config;
+        config.load_radius = GRID * CHUNK_SIZE * 2.0f;
+        config.unload_radius = config.load_radius;
+        config.upload_budget_ms = 1'000'000.0f;
+        config.max_loads_in_flight = GRID * GRID;
+        LevelStreamer streamer{&pool, &scene, nullptr, config};
+        streamer.open(path.c_str());
+        while (streamer.get_stats().resident_chunks < GRID * GRID) {
+            streamer.update({});
+        }
+    });
+    for (float budget : {0.5f, 2.0f, 8.0f}) {
+        fly(pool, path.c_str(), budget);
+    }
+
+    for (int x = 0; x < GRID; ++x) {
+        for (int z = 0; z < GRID; ++z) {
+            char name[64];
+            SDL_snprintf(name, sizeof(name), "%s%d_%d.cscn", DIRECTORY, x, z);
+            SDL_RemovePath(name);
+        }
+    }
+    SDL_RemovePath(path.c_str());
+    SDL_RemovePath(DIRECTORY);
+}
+} // namespace Charcoal::Bench
@@ -0,0 +1,45 @@
+#include "bench.h"
+#include <SDL3/SDL_init.h>
+#include <SDL3/SDL_log.h>
+#include <cstring>
+
+namespace {
+struct Suite {
+    const char *name;
+    void (*run)();
+};
+
+const Suite SUITES[] = {
+        {"bvh", Charcoal::Bench::run_bvh},
+        {"ecs", Charcoal::Bench::run_ecs},
+        {"level_streaming", Charcoal::Bench::run_level_streaming},
+        {"mesh_import", Charcoal::Bench::run_mesh_import},
+        {"pixel_convert", Charcoal::Bench::run_pixel_convert},
+        {"scene_file", Charcoal::Bench::run_scene_file},
+        {"shader_startup", Charcoal::Bench::run_shader_startup},
+};
+} // namespace
+
+// Usage: CharcoalBench [suite...]
+// Runs every suite when none are named.
+int main(int argc, char **argv) {
+    if (!SDL_Init(0)) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_ASSERT, "SDL failed to init: %s",
+                SDL_GetError());
+        return 1;
+    }
+
+    for (const Suite &suite : SUITES) {
+        bool selected = argc <= 1;
+        for (int i = 1; i < argc; ++i) {
+            selected = selected || std::strcmp(argv[i], suite.name) == 0;
+        }
+        if (selected) {
+            SDL_Log("== %s ==", suite.name);
+            suite.run();
+        }
+    }
+
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "bench.h"
+#include "engine/mesh_import.h"
+#include "engine/thread_pool.h"
+#include <SDL3/SDL_stdinc.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr int ITERATIONS = 3;
+
+// a wavy grid with UVs, roughly what a scanned or sculpted asset looks like
+std::string make_obj(int size) {
+    std::string text;
+    char line[96];
+    for (int y = 0; y <= size; ++y) {
+        for (int x = 0; x <= size; ++x) {
+            float height = std::sin(x * 0.1f) * std::cos(y * 0.1f);
+            SDL_snprintf(line, sizeof(line), "v %d %d %.6f\n", x, y, height);
+            text += line;
+            SDL_snprintf(line, sizeof(line), "vt %.6f %.6f\n",
+                    static_cast<float>(x) / size,
+                    static_cast<float>(y) / size);
+            text += line;
+        }
+    }
+    int row = size + 1;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            int a = y * row + x + 1;
+            SDL_snprintf(line, sizeof(line), "f %d/%d %d/%d %d/%d %d/%d\n", a,
+                    a, a + 1, a + 1, a + row + 1, a + row + 1, a + row,
+                    a + row);
+            text += line;
+        }
+    }
+    return text;
+}
+
+void run_obj(ThreadPool &pool, int size) {
+    std::string text = make_obj(size);
+    char name[96];
+    std::size_t triangles = 0;
+    SDL_snprintf(name, sizeof(name), "%d^2 grid OBJ (%zu MB): 1 thread",
+            size, text.size() >> 20);
+    measure(name, ITERATIONS, [&] {
+        triangles = MeshImport::import_obj(text, nullptr).mesh.indices.size() /
+                    3;
+    });
+    SDL_snprintf(name, sizeof(name), "%d^2 grid OBJ (%zu MB): %zu threads",
+            size, text.size() >> 20, pool.get_thread_count() + 1);
+    measure(name, ITERATIONS, [&] {
+        triangles = MeshImport::import_obj(text, &pool).mesh.indices.size() /
+                    3;
+    });
+    SDL_Log("%zu triangles", triangles);
+}
+} // namespace
+
+// Set CHARCOAL_BENCH_MESH to an .obj, .gltf or .glb to also time a real
+// asset.
+void run_mesh_import() {
+    ThreadPool pool;
+    for (int size : {256, 1024}) {
+        run_obj(pool, size);
+    }
+
+    const char *path = std::getenv("CHARCOAL_BENCH_MESH");
+    if (path == nullptr) {
+        return;
+    }
+    MeshImport::Result result;
+    measure(path, ITERATIONS,
+            [&] { result = MeshImport::import_file(path, &pool); });
+    SDL_Log("%zu vertices, %zu triangles", result.mesh.verts.size(),
+            result.mesh.indices.size() / 3);
+}
+} // namespace Charcoal::Bench
@@ -0,0 +1,89 @@
+#include "bench.h"
+#include "engine/pixel_convert.h"
+#include <SDL3/SDL_pixels.h>
+#include <SDL3/SDL_surface.h>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr int SIZE = 2048;
+constexpr int ITERATIONS = 20;
+
+SDL_Surface *make_noise_surface(SDL_PixelFormat format) {
+    SDL_Surface *surface = SDL_CreateSurface(SIZE, SIZE, format);
+    if (surface == nullptr) {
+        return nullptr;
+    }
+    std::mt19937 rng{1234};
+    uint8_t *pixels = static_cast<uint8_t *>(surface->pixels);
+    std::size_t bytes = static_cast<std::size_t>(surface->pitch) * SIZE;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        pixels[i] = static_cast<uint8_t>(rng());
+    }
+    if (format == SDL_PIXELFORMAT_INDEX8) {
+        SDL_Palette *palette = SDL_CreateSurfacePalette(surface);
+        for (int i = 0; palette != nullptr && i < palette->ncolors; ++i) {
+            palette->colors[i] = SDL_Color{static_cast<uint8_t>(i),
+                    static_cast<uint8_t>(255 - i), static_cast<uint8_t>(i / 2),
+                    255};
+        }
+    }
+    return surface;
+}
+
+void compare(const char *label, SDL_PixelFormat format) {
+    SDL_Surface *source = make_noise_surface(format);
+    if (source == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_TEST, "Unable to create %s surface: %s",
+                label, SDL_GetError());
+        return;
+    }
+
+    char name[64];
+    SDL_snprintf(name, sizeof(name), "%s -> RGBA32 (SDL_ConvertSurface)", label);
+    measure(name, ITERATIONS, [&] {
+        SDL_DestroySurface(SDL_ConvertSurface(source, SDL_PIXELFORMAT_RGBA32));
+    });
+    SDL_snprintf(name, sizeof(name), "%s -> RGBA32 (PixelConvert)", label);
+    measure(name, ITERATIONS, [&] {
+        SDL_DestroySurface(PixelConvert::convert_to_rgba32(source));
+    });
+
+    SDL_DestroySurface(source);
+}
+} // namespace
+
+void run_pixel_convert() {
+    compare("RGB24", SDL_PIXELFORMAT_RGB24);
+    compare("BGR24", SDL_PIXELFORMAT_BGR24);
+    compare("BGRA32", SDL_PIXELFORMAT_BGRA32);
+    compare("INDEX8", SDL_PIXELFORMAT_INDEX8);
+
+    SDL_Surface *rgba = make_noise_surface(SDL_PIXELFORMAT_RGBA32);
+    if (rgba == nullptr) {
+        return;
+    }
+    std::size_t count = static_cast<std::size_t>(SIZE) * SIZE;
+    SDL_Surface *premultiplied =
+            SDL_CreateSurface(SIZE, SIZE, SDL_PIXELFORMAT_RGBA32);
+    if (premultiplied != nullptr) {
+        measure("RGBA32 premultiply (SDL_PremultiplyAlpha)", ITERATIONS, [&] {
+            SDL_PremultiplyAlpha(SIZE, SIZE, SDL_PIXELFORMAT_RGBA32,
+                    rgba->pixels, rgba->pitch, SDL_PIXELFORMAT_RGBA32,
+                    premultiplied->pixels, premultiplied->pitch, false);
+        });
+        SDL_DestroySurface(premultiplied);
+    }
+    measure("RGBA32 premultiply (PixelConvert)", ITERATIONS, [&] {
+        PixelConvert::premultiply_alpha(
+                static_cast<uint8_t *>(rgba->pixels), count);
+    });
+    measure("RGBA32 sRGB -> linear (PixelConvert)", ITERATIONS, [&] {
+        PixelConvert::srgb_to_linear8(
+                static_cast<uint8_t *>(rgba->pixels), count);
+    });
+    SDL_DestroySurface(rgba);
+}
+} // namespace Charcoal::Bench
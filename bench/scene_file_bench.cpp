@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "engine/scene.h"
+#include "engine/scene_file.h"
+#include "engine/thread_pool.h"
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_stdinc.h>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr int ITERATIONS = 5;
+
+void run_format(
+        ThreadPool &pool, Scene &scene, std::size_t count, bool json) {
+    const char *path =
+            json ? "scene_file_bench.json" : "scene_file_bench.cscn";
+    const char *format = json ? "json" : "binary";
+    char name[96];
+    SDL_snprintf(name, sizeof(name), "%zu objects, %s: save", count, format);
+    measure(name, ITERATIONS, [&] { scene.save(path); });
+
+    // just the file into a world, then everything a level load does
+    std::vector<std::string> meshes;
+    SDL_snprintf(name, sizeof(name), "%zu objects, %s: read", count, format);
+    measure(name, ITERATIONS, [&] {
+        World world;
+        Scene::register_components(world);
+        if (json) {
+            SceneFile::read_json(path, world, meshes);
+        } else {
+            SceneFile::read(path, world, meshes);
+        }
+    });
+    SDL_snprintf(name, sizeof(name), "%zu objects, %s: Scene::load", count,
+            format);
+    measure(name, ITERATIONS, [&] { scene.load(path, &pool); });
+
+    SDL_PathInfo info;
+    if (SDL_GetPathInfo(path, &info)) {
+        SDL_Log("%s file: %.1f MB", format,
+                static_cast<double>(info.size) / (1024.0 * 1024.0));
+    }
+    SDL_RemovePath(path);
+}
+} // namespace
+
+// Files are written to the working directory and removed afterwards.
+void run_scene_file() {
+    constexpr std::size_t COUNT = 100'000;
+    ThreadPool pool;
+    Scene scene;
+    std::mt19937 rng{1234};
+    std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+    std::uniform_real_distribution<float> phase{0.0f, 6.28f};
+    for (std::size_t i = 1; i < COUNT; ++i) {
+        Transform transform;
+        transform.translation = {position(rng), position(rng), position(rng)};
+        Entity entity = scene.spawn(0, transform);
+        // half of them move, so there are two archetypes
+        if (i % 2 == 0) {
+            Animation animation;
+            animation.origin = transform.translation;
+            animation.amplitude = 0.5f;
+            animation.phase = phase(rng);
+            scene.get_world().add(entity, animation);
+        }
+    }
+
+    run_format(pool, scene, COUNT, false);
+    run_format(pool, scene, COUNT, true);
+}
+} // namespace Charcoal::Bench
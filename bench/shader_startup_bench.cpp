@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "engine/gl_extensions.h"
+#include "engine/program_cache.h"
+#include "engine/shader.h"
+#include <SDL3/SDL_init.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_stdinc.h>
+#include <SDL3/SDL_video.h>
+#include <glad/glad.h>
+#include <string>
+
+namespace Charcoal::Bench {
+namespace {
+constexpr int ITERATIONS = 20;
+constexpr const char *CACHE_DIRECTORY = "bench_shader_cache";
+constexpr int BATCH_SIZE = 8;
+
+void compare_startup(const char *vert_src, const char *frag_src) {
+    // Drivers may keep their own shader cache, so the source compile numbers
+    // are a best case. Disable it (e.g. __GL_SHADER_DISK_CACHE=0,
+    // MESA_SHADER_CACHE_DISABLE=true) to see a true cold start.
+    measure("basic shader, compile from source", ITERATIONS, [&] {
+        Shader shader = ShaderLoader::from_strings(vert_src, frag_src);
+        glFinish();
+    });
+
+    ProgramCache cache{CACHE_DIRECTORY};
+    if (!cache.is_enabled()) {
+        SDL_Log("Program binaries unsupported by this driver, skipping");
+        return;
+    }
+    // the warm-up run inside measure() fills the cache
+    measure("basic shader, program binary cache", ITERATIONS, [&] {
+        Shader shader = ShaderLoader::from_strings(vert_src, frag_src, &cache);
+        glFinish();
+    });
+    SDL_Log("cache hits %zu, misses %zu, rejected %zu",
+            cache.get_stats().hits, cache.get_stats().misses,
+            cache.get_stats().rejected);
+}
+
+void compare_batch(const char *vert_src, const char *frag_src) {
+    // a trailing comment makes every copy in every round unique, so the
+    // driver can't reuse an earlier compile
+    int round = 0;
+    auto unique = [&](int i) {
+        return std::string{frag_src} + "\n// variant " + std::to_string(i) +
+               " round " + std::to_string(round);
+    };
+
+    measure("8 shaders, one at a time", ITERATIONS, [&] {
+        ++round;
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            std::string frag = unique(i);
+            Shader shader = ShaderLoader::from_strings(vert_src, frag.c_str());
+        }
+        glFinish();
+    });
+    measure("8 shaders, batched", ITERATIONS, [&] {
+        ++round;
+        ShaderBatch batch;
+        for (int i = 0; i < BATCH_SIZE; ++i) {
+            std::string frag = unique(i);
+            batch.add(vert_src, frag.c_str());
+        }
+        for (ShaderBatch::Id id = 0; id < batch.get_count(); ++id) {
+            Shader shader = batch.take(id);
+        }
+        glFinish();
+    });
+}
+} // namespace
+
+void run_shader_startup() {
+    if (!SDL_InitSubSystem(SDL_INIT_VIDEO)) {
+        SDL_LogError(SDL_LOG_CATEGORY_TEST, "Unable to init video: %s",
+                SDL_GetError());
+        return;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(
+            SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_Window *window = SDL_CreateWindow(
+            "CharcoalBench", 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext context =
+            window != nullptr ? SDL_GL_CreateContext(window) : nullptr;
+    if (context == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_TEST,
+                "Unable to create an OpenGL context: %s", SDL_GetError());
+    } else if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress)) {
+        SDL_LogError(SDL_LOG_CATEGORY_TEST, "Failed to initialize GLAD");
+    } else {
+        GlExtensions::load();
+        char *vert_src = static_cast<char *>(
+                SDL_LoadFile(ShaderLoader::DEFAULT_VERT_PATH, nullptr));
+        char *frag_src = static_cast<char *>(
+                SDL_LoadFile(ShaderLoader::DEFAULT_FRAG_PATH, nullptr));
+        if (vert_src == nullptr || frag_src == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_TEST,
+                    "Unable to load the basic shader, run from the directory "
+                    "containing resources/: %s",
+                    SDL_GetError());
+        } else {
+            compare_startup(vert_src, frag_src);
+            compare_batch(vert_src, frag_src);
+        }
+        SDL_free(vert_src);
+        SDL_free(frag_src);
+    }
+
+    if (context != nullptr) {
+        SDL_GL_DestroyContext(context);
+    }
+    if (window != nullptr) {
+        SDL_DestroyWindow(window);
+    }
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
+} // namespace Charcoal::Bench
@@ -1,18 +1,34 @@
 #version 330 core
+// Optional features are switched on by ShaderPermutations, which adds
+// FEATURE_* defines after the #version line
 in vec4 vertex_color;
 in vec2 vertex_uv;
 
+#ifdef FEATURE_TEXTURED
 uniform sampler2D obj_texture;
 uniform sampler2D glass_texture;
 uniform float blend;
+#endif
+#ifdef FEATURE_ALPHA_TEST
+uniform float alpha_cutoff;
+#endif
 
 out vec4 FragColor;
 
 void main() {
     // FragColor = vertex_color;
+#ifdef FEATURE_TEXTURED
     vec4 base = texture(obj_texture, vertex_uv);
     vec4 overlay = texture(glass_texture, vertex_uv);
     // vec4 overlay = vec4((int(2 * vertex_uv.x) + int(2 * vertex_uv.y)) % 2, 0.0, (int(2 * vertex_uv.x) + int(2 * vertex_uv.y)) % 2, 1.0);
-    FragColor = mix(base, overlay, overlay.a * blend);
+    FragColor = mix(base, overlay, overlay.a * blend) * vertex_color;
+#else
+    FragColor = vertex_color;
+#endif
+#ifdef FEATURE_ALPHA_TEST
+    if (FragColor.a < alpha_cutoff) {
+        discard;
+    }
+#endif
     // FragColor = vec4(blend, 0.0, 0.0, 1.0);
 }
@@ -1,19 +1,45 @@
 #version 330 core
+// Optional features are switched on by ShaderPermutations, which adds
+// FEATURE_* defines after the #version line
+#include "include/camera.glsl"
+#include "include/packing.glsl"
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in uint color;
 layout (location = 2) in vec2 uv;
+#ifdef FEATURE_INSTANCED
+// a mat4 attribute takes up four locations, 3 through 6
+layout (location = 3) in mat4 instance_transform;
+#endif
+#ifdef FEATURE_SKINNED
+#define MAX_BONES 64
+layout (location = 7) in uvec4 bone_indices;
+layout (location = 8) in vec4 bone_weights;
+uniform mat4 bones[MAX_BONES];
+#endif
+// object to world
 uniform mat4 transform;
 out vec4 vertex_color;
 out vec2 vertex_uv;
 
 void main() {
-    gl_Position = transform * vec4(position, 1.0f);
-    vertex_color = vec4(
-        ((color & 0xFF0000u) >> 16) / 255.0,
-        ((color & 0x00FF00u) >> 8) / 255.0,
-        ((color & 0x0000FFu) >> 0) / 255.0,
-        1.0
-    );
+    vec4 local_position = vec4(position, 1.0f);
+#ifdef FEATURE_SKINNED
+    mat4 skin = bones[bone_indices.x] * bone_weights.x +
+                bones[bone_indices.y] * bone_weights.y +
+                bones[bone_indices.z] * bone_weights.z +
+                bones[bone_indices.w] * bone_weights.w;
+    local_position = skin * local_position;
+#endif
+#ifdef FEATURE_INSTANCED
+    local_position = instance_transform * local_position;
+#endif
+    gl_Position = camera.view_projection * transform * local_position;
+#ifdef FEATURE_VERTEX_COLOR
+    vertex_color = unpack_rgb24(color);
+#else
+    vertex_color = vec4(1.0);
+#endif
     vertex_uv = uv;
     // vertex_color = vec4(1.0, 0.0, 1.0, 1.0);
 }
@@ -0,0 +1,8 @@
+// Per-frame camera data, filled in from Camera::Uniforms. Bound to uniform
+// buffer binding Camera::UNIFORM_BINDING with Shader::set_uniform_block
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 position;
+} camera;
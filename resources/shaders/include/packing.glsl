@@ -0,0 +1,12 @@
+// Helpers for unpacking compact vertex attributes. Included with
+// #include "include/packing.glsl", see ShaderPreprocessor
+
+// Unpacks the low 24 bits of a packed color, most significant byte first
+vec4 unpack_rgb24(uint color) {
+    return vec4(
+        ((color & 0xFF0000u) >> 16) / 255.0,
+        ((color & 0x00FF00u) >> 8) / 255.0,
+        ((color & 0x0000FFu) >> 0) / 255.0,
+        1.0
+    );
+}
@@ -1,23 +1,61 @@
 #pragma once
+#include "asset_manager.h"
+#include "camera.h"
 #include "config.h"
+#include "file_watcher.h"
+#include "frame_arena.h"
+#include "frame_graph.h"
 #include "glad/glad.h"
 #include "gui/debug_gui.h"
+#include "level_streamer.h"
+#include "material.h"
 #include "scene.h"
 #include "time.h"
 #include "mesh.h"
+#include "occlusion_culler.h"
+#include "program_cache.h"
+#include "sampler.h"
 #include "shader.h"
+#include "shader_permutations.h"
 #include "texture.h"
+#include "texture_streamer.h"
+#include "thread_pool.h"
+#include "uniform_buffer.h"
+#include <future>
 #include <memory>
 #include <vector>
 
 namespace Charcoal {
 struct AppState {
+    ThreadPool jobs;
     Time time;
+    // scratch memory that only lives for a frame
+    FrameArena frame_arena;
     Config config;
     Gui::DebugGui debug_gui;
     std::unique_ptr<Scene> scene;
-    std::unique_ptr<GpuMesh> gpu_mesh;
-    std::vector<GpuTexture> gpu_texture;
-    std::unique_ptr<Shader> shader;
+    AssetManager assets{&jobs};
+    // scene mesh 0, the quad, with LODs once they're built
+    MeshHandle gpu_mesh;
+    // GPU copies of the scene's other meshes, by scene mesh. Null for the
+    // ones the level streamer owns, it uploads those itself
+    std::vector<MeshHandle> scene_gpu_meshes;
+    // the scene mesh with LODs, while it's being built and optimized
+    std::future<Mesh> lod_job;
+    std::unique_ptr<TextureStreamer> texture_streamer;
+    std::vector<TextureStreamer::Id> streamed_texture;
+    // after the scene and assets it streams into
+    std::unique_ptr<LevelStreamer> level_streamer;
+    SamplerCache samplers;
+    Material material;
+    std::unique_ptr<ProgramCache> program_cache;
+    std::unique_ptr<ShaderPermutations> basic_shader;
+    FileWatcher file_watcher;
+    FrameGraph frame_graph;
+    // scene objects that passed culling, as BVH user data
+    std::vector<uint32_t> visible_meshes;
+    OcclusionCuller occlusion;
+    Camera camera;
+    std::unique_ptr<UniformBuffer> camera_buffer;
 };
 } // namespace Charcoal
@@ -0,0 +1,303 @@
+#include "asset_manager.h"
+#include "hash.h"
+#include "mesh_file.h"
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Charcoal {
+namespace {
+// Only the manager holds a reference, so nothing is currently using it
+template <typename Entry>
+bool is_unreferenced(const Entry &entry) {
+    return entry.asset.use_count() == 1;
+}
+
+template <typename Map>
+void touch_referenced(Map &entries, int64_t frame) {
+    for (auto &[key, entry] : entries) {
+        if (!is_unreferenced(entry)) {
+            entry.last_used_frame = frame;
+        }
+    }
+}
+
+// whether a file's bytes match the file a texture was first read from
+bool same_contents(const std::string &source, std::size_t source_size,
+        const char *path, const void *data, std::size_t size) {
+    if (source_size != size) {
+        return false;
+    }
+    if (source == path) {
+        return true;
+    }
+    std::size_t other_size = 0;
+    void *other = SDL_LoadFile(source.c_str(), &other_size);
+    if (other == nullptr) {
+        return false;
+    }
+    bool same = other_size == size && std::memcmp(other, data, size) == 0;
+    SDL_free(other);
+    return same;
+}
+
+template <typename Map>
+typename Map::iterator find_lru(Map &entries) {
+    auto oldest = entries.end();
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (!is_unreferenced(it->second)) {
+            continue;
+        }
+        if (oldest == entries.end() ||
+                it->second.last_used_frame < oldest->second.last_used_frame) {
+            oldest = it;
+        }
+    }
+    return oldest;
+}
+} // namespace
+
+AssetManager::AssetManager(ThreadPool *pool, std::size_t vram_budget_bytes) :
+        pool{pool} {
+    stats.budget_bytes = vram_budget_bytes;
+}
+
+TextureHandle AssetManager::load_texture(const char *path) {
+    // fast path: this exact path has been loaded before
+    auto path_it = texture_paths.find(path);
+    if (path_it != texture_paths.end()) {
+        auto it = textures.find(path_it->second);
+        if (it != textures.end()) {
+            it->second.last_used_frame = frame;
+            return it->second.asset;
+        }
+    }
+
+    std::size_t file_size = 0;
+    void *file_data = SDL_LoadFile(path, &file_size);
+    if (file_data == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Unable to read \"%s\": %s",
+                path, SDL_GetError());
+        // the path isn't cached, so a later call can retry
+        return get_missing_texture();
+    }
+
+    // slow path: same contents under a different path. Textures of other
+    // files with the same hash are skipped
+    uint64_t hash = Hash::fnv1a64(file_data, file_size);
+    auto [first, last] = texture_hashes.equal_range(hash);
+    for (auto bucket = first; bucket != last; ++bucket) {
+        const TextureSource &source = texture_sources[bucket->second];
+        if (!same_contents(
+                    source.path, source.size, path, file_data, file_size)) {
+            continue;
+        }
+        texture_paths[path] = bucket->second;
+        SDL_free(file_data);
+        ++stats.dedup_hits;
+        Entry<GpuTexture> &entry = textures.at(bucket->second);
+        entry.last_used_frame = frame;
+        return entry.asset;
+    }
+
+    Texture texture =
+            TextureLoader::load_from_png_mem(file_data, file_size, path);
+    SDL_free(file_data);
+    if (texture.is_missing()) {
+        // not cached either, the decoder already logged why
+        return get_missing_texture();
+    }
+    // filter the mip chain here so the render thread only copies it
+    texture.generate_mips(Mipmap::Options{}, pool);
+
+    TextureHandle handle = std::make_shared<GpuTexture>();
+    handle->upload(texture);
+
+    uint64_t id = next_texture_id++;
+    texture_paths[path] = id;
+    texture_hashes.emplace(hash, id);
+    texture_sources[id] = TextureSource{path, file_size, hash};
+    textures.emplace(
+            id, Entry<GpuTexture>{handle, handle->get_size_bytes(), frame});
+    stats.resident_bytes += handle->get_size_bytes();
+    ++stats.texture_count;
+    collect();
+    return handle;
+}
+
+const TextureHandle &AssetManager::get_missing_texture() {
+    if (missing_texture == nullptr) {
+        missing_texture = std::make_shared<GpuTexture>();
+        missing_texture->upload(Texture());
+    }
+    return missing_texture;
+}
+
+MeshHandle AssetManager::load_mesh(const char *name, const MeshView &mesh) {
+    auto name_it = mesh_names.find(name);
+    if (name_it != mesh_names.end()) {
+        auto it = meshes.find(name_it->second);
+        if (it != meshes.end()) {
+            it->second.last_used_frame = frame;
+            return it->second.asset;
+        }
+    }
+
+    // same contents under a different name. Meshes that only share the
+    // hash are skipped
+    uint64_t hash = mesh.compute_hash();
+    auto [first, last] = mesh_hashes.equal_range(hash);
+    for (auto bucket = first; bucket != last; ++bucket) {
+        Entry<GpuMesh> &entry = meshes.at(bucket->second);
+        if (!entry.asset->has_contents(mesh)) {
+            continue;
+        }
+        mesh_names[name] = bucket->second;
+        ++stats.dedup_hits;
+        entry.last_used_frame = frame;
+        return entry.asset;
+    }
+
+    MeshHandle handle = std::make_shared<GpuMesh>();
+    handle->upload(mesh);
+    if (!handle->is_valid()) {
+        // don't cache failed uploads so a later call can retry
+        return handle;
+    }
+
+    uint64_t id = next_mesh_id++;
+    mesh_names[name] = id;
+    mesh_hashes.emplace(hash, id);
+    meshes.emplace(id, Entry<GpuMesh>{handle, handle->get_size_bytes(), frame});
+    stats.resident_bytes += handle->get_size_bytes();
+    ++stats.mesh_count;
+    collect();
+    return handle;
+}
+
+MeshHandle AssetManager::load_mesh(
+        const char *name, const MeshFile::View &view) {
+    auto name_it = mesh_names.find(name);
+    if (name_it != mesh_names.end()) {
+        auto it = meshes.find(name_it->second);
+        if (it != meshes.end()) {
+            it->second.last_used_frame = frame;
+            return it->second.asset;
+        }
+    }
+
+    // hashing the contents would read every page of the file, so files are
+    // only deduplicated by what they were built from
+    uint64_t hash = view.source_hash != 0
+                            ? Hash::combine(view.source_hash, view.index_count)
+                            : Hash::fnv1a64(std::string_view{name});
+    auto file_it = mesh_file_hashes.find(hash);
+    if (file_it != mesh_file_hashes.end()) {
+        Entry<GpuMesh> &entry = meshes.at(file_it->second);
+        mesh_names[name] = file_it->second;
+        ++stats.dedup_hits;
+        entry.last_used_frame = frame;
+        return entry.asset;
+    }
+
+    MeshHandle handle = std::make_shared<GpuMesh>();
+    handle->upload(view);
+    if (!handle->is_valid()) {
+        // don't cache failed uploads so a later call can retry
+        return handle;
+    }
+
+    uint64_t id = next_mesh_id++;
+    mesh_names[name] = id;
+    mesh_file_hashes[hash] = id;
+    meshes.emplace(id, Entry<GpuMesh>{handle, handle->get_size_bytes(), frame});
+    stats.resident_bytes += handle->get_size_bytes();
+    ++stats.mesh_count;
+    collect();
+    return handle;
+}
+
+void AssetManager::update(int64_t frame_count) {
+    frame = frame_count;
+    touch_referenced(textures, frame);
+    touch_referenced(meshes, frame);
+    collect();
+}
+
+void AssetManager::collect() {
+    if (!make_room(0)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_GPU,
+                "Resident assets (%zu bytes) exceed the VRAM budget (%zu "
+                "bytes) but are all in use",
+                stats.resident_bytes, stats.budget_bytes);
+    }
+}
+
+bool AssetManager::reserve_bytes(std::size_t bytes, bool required) {
+    bool fits = make_room(bytes);
+    if (fits || required) {
+        stats.resident_bytes += bytes;
+        stats.reserved_bytes += bytes;
+    }
+    return fits;
+}
+
+void AssetManager::release_bytes(std::size_t bytes) {
+    stats.resident_bytes -= bytes;
+    stats.reserved_bytes -= bytes;
+}
+
+bool AssetManager::make_room(std::size_t incoming_bytes) {
+    if (stats.budget_bytes == 0) {
+        return true;
+    }
+    while (stats.resident_bytes + incoming_bytes > stats.budget_bytes) {
+        auto tex_it = find_lru(textures);
+        auto mesh_it = find_lru(meshes);
+        bool has_tex = tex_it != textures.end();
+        bool has_mesh = mesh_it != meshes.end();
+        if (!has_tex && !has_mesh) {
+            return false;
+        }
+
+        // evict whichever of the two candidates was used longest ago
+        if (has_tex && (!has_mesh || tex_it->second.last_used_frame <=
+                                             mesh_it->second.last_used_frame)) {
+            stats.resident_bytes -= tex_it->second.size_bytes;
+            --stats.texture_count;
+            uint64_t id = tex_it->first;
+            std::erase_if(texture_paths,
+                    [&](const auto &path) { return path.second == id; });
+            auto source = texture_sources.find(id);
+            auto [first, last] =
+                    texture_hashes.equal_range(source->second.hash);
+            texture_hashes.erase(std::find_if(first, last,
+                    [&](const auto &bucket) { return bucket.second == id; }));
+            texture_sources.erase(source);
+            textures.erase(tex_it);
+        } else {
+            stats.resident_bytes -= mesh_it->second.size_bytes;
+            --stats.mesh_count;
+            uint64_t id = mesh_it->first;
+            auto is_evicted = [&](const auto &key) { return key.second == id; };
+            std::erase_if(mesh_names, is_evicted);
+            std::erase_if(mesh_hashes, is_evicted);
+            std::erase_if(mesh_file_hashes, is_evicted);
+            meshes.erase(mesh_it);
+        }
+        ++stats.evictions;
+    }
+    return true;
+}
+
+void AssetManager::set_vram_budget(std::size_t bytes) {
+    stats.budget_bytes = bytes;
+    collect();
+}
+
+const AssetManager::Stats &AssetManager::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
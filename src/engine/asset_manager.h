@@ -0,0 +1,168 @@
+#pragma once
+#include "mesh.h"
+#include "texture.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Charcoal {
+class ThreadPool;
+
+using TextureHandle = std::shared_ptr<GpuTexture>;
+using MeshHandle = std::shared_ptr<GpuMesh>;
+
+/**
+ * @class AssetManager
+ * @brief Owns every GPU-resident texture and mesh. Assets are looked up by
+ * path (or name), and deduplicated by a hash of their contents, so loading
+ * the same data twice under different names only uploads it once. Textures
+ * whose hashes collide are compared byte for byte, so they never alias.
+ *
+ * Handles are reference counted. An asset stays resident while any handle to
+ * it is alive. Once only the manager holds it, it becomes a candidate for
+ * eviction, and the least recently used candidates are released whenever the
+ * total resident size goes over the VRAM budget.
+ */
+class AssetManager {
+public:
+    struct Stats {
+        std::size_t resident_bytes = 0;
+        std::size_t budget_bytes = 0;
+        std::size_t texture_count = 0;
+        std::size_t mesh_count = 0;
+        // part of resident_bytes managed elsewhere, see reserve_bytes()
+        std::size_t reserved_bytes = 0;
+        std::size_t dedup_hits = 0;
+        std::size_t evictions = 0;
+    };
+
+private:
+    template <typename T>
+    struct Entry {
+        std::shared_ptr<T> asset;
+        std::size_t size_bytes;
+        int64_t last_used_frame;
+    };
+
+    // where a texture was first read from, to tell hash collisions apart
+    struct TextureSource {
+        std::string path;
+        std::size_t size;
+        uint64_t hash;
+    };
+
+    // path -> texture id
+    std::unordered_map<std::string, uint64_t> texture_paths;
+    // mesh name -> mesh id
+    std::unordered_map<std::string, uint64_t> mesh_names;
+
+    // content hash -> ids of the textures with it. Different files with the
+    // same hash share the bucket
+    std::unordered_multimap<uint64_t, uint64_t> texture_hashes;
+    // texture id -> resident texture
+    std::unordered_map<uint64_t, Entry<GpuTexture>> textures;
+    std::unordered_map<uint64_t, TextureSource> texture_sources;
+    uint64_t next_texture_id = 0;
+    // content hash -> ids of the meshes uploaded from a MeshView with it
+    std::unordered_multimap<uint64_t, uint64_t> mesh_hashes;
+    // what a mesh file was built from -> its mesh id
+    std::unordered_map<uint64_t, uint64_t> mesh_file_hashes;
+    // mesh id -> resident mesh
+    std::unordered_map<uint64_t, Entry<GpuMesh>> meshes;
+    uint64_t next_mesh_id = 0;
+    // handed out for every texture that fails to load, created on first use
+    TextureHandle missing_texture;
+
+    ThreadPool *pool;
+    int64_t frame = 0;
+    Stats stats;
+
+    const TextureHandle &get_missing_texture();
+    // evicts until incoming_bytes more would fit in the budget
+    bool make_room(std::size_t incoming_bytes);
+
+public:
+    /**
+     * @param pool Worker threads used to prepare assets (e.g. mip chains)
+     * before upload. May be null.
+     * @param vram_budget_bytes Resident size above which unreferenced assets
+     * are evicted. 0 disables eviction.
+     */
+    explicit AssetManager(
+            ThreadPool *pool = nullptr, std::size_t vram_budget_bytes = 0);
+
+    // copying would duplicate the residency bookkeeping
+    AssetManager(const AssetManager &other) = delete;
+    AssetManager &operator=(const AssetManager &other) = delete;
+
+    /**
+     * @brief Returns a handle to the texture at the given path, loading and
+     * uploading it only if neither the path nor an identical file is already
+     * resident.
+     *
+     * @param path Path to a PNG file
+     * @return A shared handle. If the file can't be read, the handle points
+     * to the missing texture.
+     */
+    TextureHandle load_texture(const char *path);
+
+    /**
+     * @brief Returns a handle to a GPU copy of the given mesh, uploading it
+     * only if neither the name nor identical geometry is already resident.
+     *
+     * @param name Unique name to cache the mesh under
+     * @param mesh The CPU-side mesh data
+     * @return A shared handle. Check GpuMesh::is_valid() for upload errors.
+     */
+    MeshHandle load_mesh(const char *name, const MeshView &mesh);
+
+    /**
+     * @brief Returns a handle to a GPU copy of a mapped mesh file, uploading
+     * it straight from the mapping. Files are deduplicated by name and
+     * MeshFile::View::source_hash rather than by their contents.
+     *
+     * @param name Unique name to cache the mesh under
+     * @param view A valid view. The file only needs to stay mapped until
+     * this returns.
+     * @return A shared handle. Check GpuMesh::is_valid() for upload errors.
+     */
+    MeshHandle load_mesh(const char *name, const MeshFile::View &view);
+
+    /**
+     * @brief Marks all referenced assets as used this frame, then evicts
+     * unreferenced assets until the resident size fits in the budget.
+     * Call once per frame.
+     *
+     * @param frame_count The current frame number
+     */
+    void update(int64_t frame_count);
+
+    /**
+     * @brief Evicts least recently used unreferenced assets until the resident
+     * size fits in the budget, or there is nothing left to evict.
+     */
+    void collect();
+
+    /**
+     * @brief Counts GPU memory another system manages, like streamed texture
+     * levels, against the VRAM budget. Unreferenced assets are evicted to
+     * make room.
+     *
+     * @param bytes Size of the allocation about to be made
+     * @param required Counts the bytes even if they don't fit
+     * @return True if the bytes fit in the budget. If not, and required is
+     * false, nothing is counted and the caller should free something first.
+     */
+    bool reserve_bytes(std::size_t bytes, bool required = false);
+
+    /**
+     * @brief Gives back bytes counted by reserve_bytes().
+     */
+    void release_bytes(std::size_t bytes);
+
+    void set_vram_budget(std::size_t bytes);
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
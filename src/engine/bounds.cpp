@@ -0,0 +1,64 @@
+#include "bounds.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace Charcoal {
+glm::vec3 Aabb::get_center() const {
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 Aabb::get_extents() const {
+    return (max - min) * 0.5f;
+}
+
+Bounds Bounds::from_vertices(std::span<const Vertex> verts) {
+    Bounds bounds;
+    if (verts.empty()) {
+        return bounds;
+    }
+
+    bounds.box.min = verts[0].position;
+    bounds.box.max = verts[0].position;
+    for (const Vertex &vert : verts) {
+        bounds.box.min = glm::min(bounds.box.min, vert.position);
+        bounds.box.max = glm::max(bounds.box.max, vert.position);
+    }
+
+    // centering on the box doesn't give the smallest sphere, but it's close
+    // and only needs one more pass
+    bounds.sphere.center = bounds.box.get_center();
+    float radius2 = 0.0f;
+    for (const Vertex &vert : verts) {
+        glm::vec3 offset = vert.position - bounds.sphere.center;
+        radius2 = std::max(radius2, glm::dot(offset, offset));
+    }
+    bounds.sphere.radius = std::sqrt(radius2);
+    return bounds;
+}
+
+Bounds Bounds::transformed(const glm::mat4 &world) const {
+    // Arvo's method: the new extents are the old ones projected onto the
+    // absolute value of each basis vector
+    glm::vec3 center = box.get_center();
+    glm::vec3 extents = box.get_extents();
+    glm::vec3 x{world[0]};
+    glm::vec3 y{world[1]};
+    glm::vec3 z{world[2]};
+    glm::vec3 new_center = glm::vec3{world * glm::vec4{center, 1.0f}};
+    glm::vec3 new_extents = glm::abs(x) * extents.x +
+                            glm::abs(y) * extents.y +
+                            glm::abs(z) * extents.z;
+
+    Bounds result;
+    result.box.min = new_center - new_extents;
+    result.box.max = new_center + new_extents;
+    result.sphere.center =
+            glm::vec3{world * glm::vec4{sphere.center, 1.0f}};
+    // non-uniform scale stretches the sphere by the largest axis scale
+    float scale = std::max({glm::length(x), glm::length(y), glm::length(z)});
+    result.sphere.radius = sphere.radius * scale;
+    return result;
+}
+} // namespace Charcoal
@@ -0,0 +1,53 @@
+#pragma once
+#include "vertex.h"
+#include <span>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+namespace Charcoal {
+/**
+ * @class Aabb
+ * @brief An axis-aligned bounding box.
+ */
+struct Aabb {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    glm::vec3 get_center() const;
+    // half the size along each axis
+    glm::vec3 get_extents() const;
+};
+
+/**
+ * @class BoundingSphere
+ * @brief A sphere that contains every point of a mesh.
+ */
+struct BoundingSphere {
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+};
+
+/**
+ * @class Bounds
+ * @brief Both bounding volumes of a mesh. The box is tighter for culling, the
+ * sphere is cheaper to transform and measure.
+ */
+struct Bounds {
+    Aabb box;
+    BoundingSphere sphere;
+
+    /**
+     * @brief Computes bounds that contain every vertex. Empty input gives
+     * zero-sized bounds at the origin.
+     */
+    static Bounds from_vertices(std::span<const Vertex> verts);
+
+    /**
+     * @brief Returns bounds that contain these bounds after a transform. The
+     * box stays axis-aligned, so it grows under rotation.
+     *
+     * @param world An affine transform, usually the object's world matrix
+     */
+    Bounds transformed(const glm::mat4 &world) const;
+};
+} // namespace Charcoal
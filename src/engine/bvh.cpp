@@ -0,0 +1,556 @@
+#include "bvh.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <glm/common.hpp>
+
+namespace Charcoal {
+namespace {
+// centroid bins per axis when building. More bins find slightly better splits
+// but cost more to evaluate.
+constexpr int SAH_BINS = 16;
+
+Aabb merge(const Aabb &a, const Aabb &b) {
+    return Aabb{glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+// half the surface area, which is all the SAH needs for comparisons
+float area(const Aabb &box) {
+    glm::vec3 size = box.max - box.min;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+bool same(const Aabb &a, const Aabb &b) {
+    return a.min == b.min && a.max == b.max;
+}
+
+bool overlaps(const Aabb &a, const Aabb &b) {
+    return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+           a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+float distance2(const Aabb &box, const glm::vec3 &point) {
+    glm::vec3 closest = glm::clamp(point, box.min, box.max);
+    glm::vec3 offset = point - closest;
+    return offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+}
+
+// slab test. Returns the entry distance, or infinity on a miss.
+float intersect(const Aabb &box, const glm::vec3 &origin,
+        const glm::vec3 &inverse_direction, float max_distance) {
+    float t_min = 0.0f;
+    float t_max = max_distance;
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (box.min[axis] - origin[axis]) * inverse_direction[axis];
+        float t1 = (box.max[axis] - origin[axis]) * inverse_direction[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        // NaN from 0 * inf (a ray lying in a slab's plane) fails both
+        // comparisons and leaves the range unchanged
+        t_min = t0 > t_min ? t0 : t_min;
+        t_max = t1 < t_max ? t1 : t_max;
+        if (t_min > t_max) {
+            return std::numeric_limits<float>::infinity();
+        }
+    }
+    return t_min;
+}
+} // namespace
+
+uint32_t Bvh::allocate_node() {
+    if (!free_nodes.empty()) {
+        uint32_t node = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[node] = Node{};
+        return node;
+    }
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void Bvh::free_node(uint32_t node) {
+    free_nodes.push_back(node);
+}
+
+bool Bvh::is_leaf(uint32_t node) const {
+    return nodes[node].proxy != NONE;
+}
+
+void Bvh::insert_leaf(uint32_t leaf) {
+    if (root == NONE) {
+        root = leaf;
+        nodes[leaf].parent = NONE;
+        return;
+    }
+
+    // Walk down towards the sibling that adds the least area. Making a new
+    // parent at a node costs its merged area, and every node above pays for
+    // growing to fit the leaf.
+    const Aabb box = nodes[leaf].box;
+    uint32_t index = root;
+    while (!is_leaf(index)) {
+        const Node &node = nodes[index];
+        float merged_area = area(merge(node.box, box));
+        float cost = 2.0f * merged_area;
+        float inherited = 2.0f * (merged_area - area(node.box));
+
+        auto descend_cost = [&](uint32_t child) {
+            float grown = area(merge(nodes[child].box, box));
+            if (is_leaf(child)) {
+                return grown + inherited;
+            }
+            return grown - area(nodes[child].box) + inherited;
+        };
+        float cost_left = descend_cost(node.left);
+        float cost_right = descend_cost(node.right);
+        if (cost < cost_left && cost < cost_right) {
+            break;
+        }
+        index = cost_left < cost_right ? node.left : node.right;
+    }
+
+    uint32_t sibling = index;
+    uint32_t old_parent = nodes[sibling].parent;
+    uint32_t new_parent = allocate_node();
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].box = merge(box, nodes[sibling].box);
+    nodes[new_parent].left = sibling;
+    nodes[new_parent].right = leaf;
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if (old_parent == NONE) {
+        root = new_parent;
+    } else {
+        Node &parent = nodes[old_parent];
+        (parent.left == sibling ? parent.left : parent.right) = new_parent;
+        refit_from(old_parent);
+    }
+}
+
+void Bvh::remove_leaf(uint32_t leaf) {
+    if (leaf == root) {
+        root = NONE;
+        return;
+    }
+
+    uint32_t parent = nodes[leaf].parent;
+    uint32_t grandparent = nodes[parent].parent;
+    uint32_t sibling =
+            nodes[parent].left == leaf ? nodes[parent].right
+                                       : nodes[parent].left;
+    // the sibling takes the parent's place
+    nodes[sibling].parent = grandparent;
+    free_node(parent);
+    if (grandparent == NONE) {
+        root = sibling;
+    } else {
+        Node &node = nodes[grandparent];
+        (node.left == parent ? node.left : node.right) = sibling;
+        refit_from(grandparent);
+    }
+}
+
+void Bvh::refit_from(uint32_t node) {
+    while (node != NONE) {
+        Node &current = nodes[node];
+        Aabb box = merge(nodes[current.left].box, nodes[current.right].box);
+        if (same(box, current.box)) {
+            // nothing above can change either
+            return;
+        }
+        current.box = box;
+        node = current.parent;
+    }
+}
+
+Bvh::ProxyId Bvh::insert(const Aabb &box, uint32_t user_data) {
+    ProxyId proxy;
+    if (!free_proxies.empty()) {
+        proxy = free_proxies.back();
+        free_proxies.pop_back();
+    } else {
+        proxies.emplace_back();
+        proxy = static_cast<ProxyId>(proxies.size() - 1);
+    }
+
+    uint32_t leaf = allocate_node();
+    nodes[leaf].box = box;
+    nodes[leaf].proxy = proxy;
+    proxies[proxy] = Proxy{user_data, leaf, false};
+    insert_leaf(leaf);
+    ++count;
+    return proxy;
+}
+
+void Bvh::remove(ProxyId proxy) {
+    uint32_t leaf = proxies[proxy].leaf;
+    remove_leaf(leaf);
+    free_node(leaf);
+    proxies[proxy].leaf = NONE;
+    free_proxies.push_back(proxy);
+    --count;
+}
+
+void Bvh::move(ProxyId proxy, const Aabb &box) {
+    Proxy &entry = proxies[proxy];
+    nodes[entry.leaf].box = box;
+    if (!entry.moved) {
+        entry.moved = true;
+        moved.push_back(proxy);
+    }
+}
+
+void Bvh::refit() {
+    for (ProxyId proxy : moved) {
+        Proxy &entry = proxies[proxy];
+        // removed since it moved
+        if (!entry.moved || entry.leaf == NONE) {
+            continue;
+        }
+        entry.moved = false;
+        refit_from(nodes[entry.leaf].parent);
+    }
+    moved.clear();
+}
+
+uint32_t Bvh::build_range(std::vector<BuildItem> &items, std::size_t begin,
+        std::size_t end, uint32_t parent) {
+    uint32_t index = allocate_node();
+    nodes[index].parent = parent;
+    if (end - begin == 1) {
+        const BuildItem &item = items[begin];
+        nodes[index].box = item.box;
+        nodes[index].proxy = item.proxy;
+        proxies[item.proxy].leaf = index;
+        return index;
+    }
+
+    Aabb centroids{items[begin].centroid, items[begin].centroid};
+    for (std::size_t i = begin + 1; i < end; ++i) {
+        centroids.min = glm::min(centroids.min, items[i].centroid);
+        centroids.max = glm::max(centroids.max, items[i].centroid);
+    }
+
+    // bin the centroids along each axis and sweep for the cheapest split
+    int best_axis = -1;
+    int best_split = 0;
+    float best_cost = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = centroids.max[axis] - centroids.min[axis];
+        if (extent <= 0.0f) {
+            continue;
+        }
+        float scale = static_cast<float>(SAH_BINS) / extent;
+
+        struct Bin {
+            Aabb box{glm::vec3{std::numeric_limits<float>::max()},
+                    glm::vec3{std::numeric_limits<float>::lowest()}};
+            std::size_t count = 0;
+        };
+        std::array<Bin, SAH_BINS> bins;
+        for (std::size_t i = begin; i < end; ++i) {
+            int bin = std::min(SAH_BINS - 1,
+                    static_cast<int>((items[i].centroid[axis] -
+                                             centroids.min[axis]) *
+                                     scale));
+            bins[bin].box = merge(bins[bin].box, items[i].box);
+            ++bins[bin].count;
+        }
+
+        // costs of everything right of each split, swept from the right
+        std::array<float, SAH_BINS - 1> right_cost;
+        Bin right;
+        for (int split = SAH_BINS - 1; split > 0; --split) {
+            right.box = merge(right.box, bins[split].box);
+            right.count += bins[split].count;
+            right_cost[split - 1] =
+                    right.count == 0 ? 0.0f
+                                     : area(right.box) *
+                                               static_cast<float>(right.count);
+        }
+        Bin left;
+        for (int split = 0; split < SAH_BINS - 1; ++split) {
+            left.box = merge(left.box, bins[split].box);
+            left.count += bins[split].count;
+            if (left.count == 0 || left.count == end - begin) {
+                continue;
+            }
+            float cost = area(left.box) * static_cast<float>(left.count) +
+                         right_cost[split];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+            }
+        }
+    }
+
+    std::size_t middle = begin + (end - begin) / 2;
+    if (best_axis >= 0) {
+        float extent = centroids.max[best_axis] - centroids.min[best_axis];
+        float scale = static_cast<float>(SAH_BINS) / extent;
+        auto split = std::partition(items.begin() + static_cast<long>(begin),
+                items.begin() + static_cast<long>(end),
+                [&](const BuildItem &item) {
+                    int bin = std::min(SAH_BINS - 1,
+                            static_cast<int>((item.centroid[best_axis] -
+                                                     centroids.min[best_axis]) *
+                                             scale));
+                    return bin <= best_split;
+                });
+        middle = static_cast<std::size_t>(split - items.begin());
+    }
+    // every centroid in the same spot, any split is as good as another
+
+    uint32_t left = build_range(items, begin, middle, index);
+    uint32_t right = build_range(items, middle, end, index);
+    // nodes may have been reallocated by the recursive calls
+    nodes[index].left = left;
+    nodes[index].right = right;
+    nodes[index].box = merge(nodes[left].box, nodes[right].box);
+    return index;
+}
+
+void Bvh::build() {
+    std::vector<BuildItem> items;
+    items.reserve(count);
+    for (ProxyId proxy = 0; proxy < proxies.size(); ++proxy) {
+        Proxy &entry = proxies[proxy];
+        if (entry.leaf == NONE) {
+            continue;
+        }
+        const Aabb &box = nodes[entry.leaf].box;
+        items.push_back({box, box.get_center(), proxy});
+        entry.moved = false;
+    }
+    moved.clear();
+
+    nodes.clear();
+    free_nodes.clear();
+    root = NONE;
+    if (items.empty()) {
+        return;
+    }
+    nodes.reserve(items.size() * 2 - 1);
+    root = build_range(items, 0, items.size(), NONE);
+}
+
+void Bvh::build(
+        std::span<const Aabb> boxes, std::span<const uint32_t> user_data) {
+    nodes.clear();
+    free_nodes.clear();
+    proxies.clear();
+    free_proxies.clear();
+    moved.clear();
+    root = NONE;
+    // unlinked leaves, build() collects them into a tree
+    nodes.reserve(boxes.size());
+    proxies.reserve(boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); ++i) {
+        Node leaf;
+        leaf.box = boxes[i];
+        leaf.proxy = static_cast<ProxyId>(i);
+        nodes.push_back(leaf);
+        proxies.push_back(Proxy{user_data[i], static_cast<uint32_t>(i), false});
+    }
+    count = boxes.size();
+    build();
+}
+
+void Bvh::collect_leaves(uint32_t node, std::vector<uint32_t> &out,
+        std::vector<uint32_t> &stack) const {
+    std::size_t base = stack.size();
+    stack.push_back(node);
+    while (stack.size() > base) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+        const Node &current = nodes[index];
+        if (current.proxy != NONE) {
+            out.push_back(proxies[current.proxy].user_data);
+        } else {
+            stack.push_back(current.left);
+            stack.push_back(current.right);
+        }
+    }
+}
+
+void Bvh::query_frustum(
+        const Frustum &frustum, std::vector<uint32_t> &out) const {
+    if (root == NONE) {
+        return;
+    }
+    constexpr uint32_t ALL_PLANES = (1u << 6) - 1;
+    // node, planes it still needs testing against
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    std::vector<uint32_t> collect_stack;
+    stack.emplace_back(root, ALL_PLANES);
+    while (!stack.empty()) {
+        auto [index, planes] = stack.back();
+        stack.pop_back();
+        const Node &node = nodes[index];
+
+        glm::vec3 center = node.box.get_center();
+        glm::vec3 extents = node.box.get_extents();
+        bool outside = false;
+        for (uint32_t p = 0; p < 6 && !outside; ++p) {
+            if ((planes & (1u << p)) == 0) {
+                continue;
+            }
+            const glm::vec4 &plane = frustum.planes[p];
+            float distance = plane.x * center.x + plane.y * center.y +
+                             plane.z * center.z + plane.w;
+            float radius = std::abs(plane.x) * extents.x +
+                           std::abs(plane.y) * extents.y +
+                           std::abs(plane.z) * extents.z;
+            if (distance + radius < 0.0f) {
+                outside = true;
+            } else if (distance - radius >= 0.0f) {
+                // children are inside this plane too
+                planes &= ~(1u << p);
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        if (planes == 0) {
+            collect_leaves(index, out, collect_stack);
+        } else if (node.proxy != NONE) {
+            out.push_back(proxies[node.proxy].user_data);
+        } else {
+            stack.emplace_back(node.left, planes);
+            stack.emplace_back(node.right, planes);
+        }
+    }
+}
+
+void Bvh::query_box(const Aabb &box, std::vector<uint32_t> &out) const {
+    if (root == NONE) {
+        return;
+    }
+    std::vector<uint32_t> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (!overlaps(node.box, box)) {
+            continue;
+        }
+        if (node.proxy != NONE) {
+            out.push_back(proxies[node.proxy].user_data);
+        } else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+void Bvh::query_sphere(const glm::vec3 &center, float radius,
+        std::vector<uint32_t> &out) const {
+    if (root == NONE) {
+        return;
+    }
+    float radius2 = radius * radius;
+    std::vector<uint32_t> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (distance2(node.box, center) > radius2) {
+            continue;
+        }
+        if (node.proxy != NONE) {
+            out.push_back(proxies[node.proxy].user_data);
+        } else {
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+}
+
+bool Bvh::raycast(const Ray &ray, float max_distance, RayHit &hit) const {
+    if (root == NONE) {
+        return false;
+    }
+    // division by zero gives infinity, which the slab test handles
+    glm::vec3 inverse_direction{1.0f / ray.direction.x,
+            1.0f / ray.direction.y, 1.0f / ray.direction.z};
+    float best = max_distance;
+    bool found = false;
+
+    // node, entry distance
+    std::vector<std::pair<uint32_t, float>> stack;
+    float root_distance =
+            intersect(nodes[root].box, ray.origin, inverse_direction, best);
+    if (std::isinf(root_distance)) {
+        return false;
+    }
+    stack.emplace_back(root, root_distance);
+    while (!stack.empty()) {
+        auto [index, entry] = stack.back();
+        stack.pop_back();
+        // a closer hit was found after this node was pushed
+        if (entry > best) {
+            continue;
+        }
+        const Node &node = nodes[index];
+        if (node.proxy != NONE) {
+            best = entry;
+            hit.user_data = proxies[node.proxy].user_data;
+            hit.distance = entry;
+            found = true;
+            continue;
+        }
+
+        float left = intersect(
+                nodes[node.left].box, ray.origin, inverse_direction, best);
+        float right = intersect(
+                nodes[node.right].box, ray.origin, inverse_direction, best);
+        uint32_t closer = node.left;
+        uint32_t further = node.right;
+        if (right < left) {
+            std::swap(left, right);
+            std::swap(closer, further);
+        }
+        // push the further child first so the closer one is visited first
+        if (!std::isinf(right)) {
+            stack.emplace_back(further, right);
+        }
+        if (!std::isinf(left)) {
+            stack.emplace_back(closer, left);
+        }
+    }
+    return found;
+}
+
+std::size_t Bvh::get_count() const {
+    return count;
+}
+
+std::size_t Bvh::get_node_count() const {
+    return nodes.size() - free_nodes.size();
+}
+
+float Bvh::get_cost() const {
+    if (root == NONE || is_leaf(root)) {
+        return 0.0f;
+    }
+    float total = 0.0f;
+    std::vector<uint32_t> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node &node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.proxy == NONE) {
+            total += area(node.box);
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+    float root_area = area(nodes[root].box);
+    return root_area > 0.0f ? total / root_area : 0.0f;
+}
+} // namespace Charcoal
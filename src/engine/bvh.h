@@ -0,0 +1,175 @@
+#pragma once
+#include "bounds.h"
+#include "frustum.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <glm/vec3.hpp>
+
+namespace Charcoal {
+/**
+ * @class Bvh
+ * @brief A dynamic bounding volume hierarchy over world-space boxes, for
+ * culling, picking, and proximity queries that only touch the part of the
+ * scene they need.
+ *
+ * Every leaf holds one object. build() rebuilds the whole tree with a binned
+ * surface area heuristic (SAH), which gives the fastest queries. insert()
+ * adds single objects by walking down to the sibling that grows the tree's
+ * surface area the least. Objects that move only update their leaf in
+ * move(); refit() then resizes the ancestors of every moved leaf, so
+ * animating objects costs O(moved * depth) per frame instead of a rebuild.
+ * Refitting keeps the tree correct but lets its quality drift, so call
+ * build() again after large changes, such as loading a level.
+ *
+ * Call refit() after moving objects and before querying.
+ */
+class Bvh {
+public:
+    using ProxyId = uint32_t;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Ray {
+        glm::vec3 origin{0.0f};
+        // doesn't need to be normalized. Hit distances are in multiples of it.
+        glm::vec3 direction{0.0f, 0.0f, -1.0f};
+    };
+
+    struct RayHit {
+        uint32_t user_data = NONE;
+        float distance = 0.0f;
+    };
+
+private:
+    struct Node {
+        Aabb box;
+        uint32_t parent = NONE;
+        uint32_t left = NONE;
+        uint32_t right = NONE;
+        // NONE for internal nodes
+        ProxyId proxy = NONE;
+    };
+
+    struct Proxy {
+        uint32_t user_data = 0;
+        // NONE once removed
+        uint32_t leaf = NONE;
+        bool moved = false;
+    };
+
+    // used while building
+    struct BuildItem {
+        Aabb box;
+        glm::vec3 centroid;
+        ProxyId proxy;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    std::vector<Proxy> proxies;
+    std::vector<ProxyId> free_proxies;
+    std::vector<ProxyId> moved;
+    uint32_t root = NONE;
+    std::size_t count = 0;
+
+    uint32_t allocate_node();
+    void free_node(uint32_t node);
+    bool is_leaf(uint32_t node) const;
+    void insert_leaf(uint32_t leaf);
+    void remove_leaf(uint32_t leaf);
+    // recomputes boxes from node up to the root, stopping once one doesn't
+    // change
+    void refit_from(uint32_t node);
+    uint32_t build_range(std::vector<BuildItem> &items, std::size_t begin,
+            std::size_t end, uint32_t parent);
+    void collect_leaves(uint32_t node, std::vector<uint32_t> &out,
+            std::vector<uint32_t> &stack) const;
+
+public:
+    /**
+     * @brief Adds an object.
+     *
+     * @param box The object's world-space bounds
+     * @param user_data Returned by queries for this object, usually an index
+     * into the caller's own object list
+     * @return A handle for move() and remove()
+     */
+    ProxyId insert(const Aabb &box, uint32_t user_data);
+
+    void remove(ProxyId proxy);
+
+    /**
+     * @brief Updates an object's bounds. Takes effect in queries after the
+     * next refit().
+     */
+    void move(ProxyId proxy, const Aabb &box);
+
+    /**
+     * @brief Resizes the ancestors of every object moved since the last call.
+     */
+    void refit();
+
+    /**
+     * @brief Rebuilds the tree from scratch with the surface area heuristic.
+     * Proxy handles stay valid.
+     */
+    void build();
+
+    /**
+     * @brief Replaces every object with new ones and builds the tree once,
+     * which is much faster than inserting them one at a time. Object i gets
+     * ProxyId i.
+     *
+     * @param boxes Each object's world-space bounds
+     * @param user_data Returned by queries, one per box
+     */
+    void build(std::span<const Aabb> boxes,
+            std::span<const uint32_t> user_data);
+
+    /**
+     * @brief Finds every object at least partly inside a frustum. Subtrees
+     * entirely inside are added without testing their objects.
+     *
+     * @param frustum World-space frustum
+     * @param out Receives the user data of each visible object. Not cleared.
+     */
+    void query_frustum(
+            const Frustum &frustum, std::vector<uint32_t> &out) const;
+
+    /**
+     * @brief Finds every object whose bounds overlap a box.
+     * @param out Receives user data. Not cleared.
+     */
+    void query_box(const Aabb &box, std::vector<uint32_t> &out) const;
+
+    /**
+     * @brief Finds every object whose bounds come within a radius of a point.
+     * @param out Receives user data. Not cleared.
+     */
+    void query_sphere(const glm::vec3 &center, float radius,
+            std::vector<uint32_t> &out) const;
+
+    /**
+     * @brief Finds the closest object whose bounds a ray hits, visiting
+     * nearer subtrees first and skipping ones behind the best hit so far.
+     *
+     * @param ray The ray
+     * @param max_distance Ignore hits further than this
+     * @param hit Receives the closest hit. A ray starting inside a box hits
+     * it at distance 0.
+     * @return false if nothing was hit
+     */
+    bool raycast(const Ray &ray, float max_distance, RayHit &hit) const;
+
+    std::size_t get_count() const;
+    std::size_t get_node_count() const;
+
+    /**
+     * @brief Returns the summed surface area of the internal nodes relative
+     * to the root's, which is proportional to the expected cost of a random
+     * query. Rises as refitting degrades the tree. Walks the whole tree.
+     */
+    float get_cost() const;
+};
+} // namespace Charcoal
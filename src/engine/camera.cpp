@@ -0,0 +1,92 @@
+#include "camera.h"
+#include <cmath>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/scalar_constants.hpp>
+
+namespace Charcoal {
+Camera::Camera() :
+        fov_y{glm::pi<float>() / 3.0f}, aspect{16.0f / 9.0f},
+        near_plane{0.1f}, reverse_z{false} {
+}
+
+void Camera::set_position(const glm::vec3 &position) {
+    this->position = position;
+}
+
+void Camera::look_at(const glm::vec3 &target, const glm::vec3 &up) {
+    this->target = target;
+    this->up = up;
+}
+
+void Camera::set_perspective(float fov_y, float aspect, float near_plane) {
+    this->fov_y = fov_y;
+    this->aspect = aspect;
+    this->near_plane = near_plane;
+}
+
+void Camera::set_aspect(float aspect) {
+    this->aspect = aspect;
+}
+
+void Camera::set_reverse_z(bool reverse_z) {
+    this->reverse_z = reverse_z;
+}
+
+bool Camera::is_reverse_z() const {
+    return reverse_z;
+}
+
+float Camera::get_far_depth() const {
+    return reverse_z ? 0.0f : 1.0f;
+}
+
+const glm::vec3 &Camera::get_position() const {
+    return position;
+}
+
+glm::mat4 Camera::get_view() const {
+    return glm::lookAt(position, target, up);
+}
+
+glm::mat4 Camera::get_projection() const {
+    return infinite_perspective(fov_y, aspect, near_plane, reverse_z);
+}
+
+glm::mat4 Camera::get_view_projection() const {
+    return get_projection() * get_view();
+}
+
+Frustum Camera::get_frustum() const {
+    return Frustum::from_matrix(get_view_projection(),
+            reverse_z ? Frustum::ClipDepth::zero_to_one
+                      : Frustum::ClipDepth::negative_one_to_one);
+}
+
+Camera::Uniforms Camera::get_uniforms() const {
+    Uniforms uniforms;
+    uniforms.view = get_view();
+    uniforms.projection = get_projection();
+    uniforms.view_projection = uniforms.projection * uniforms.view;
+    uniforms.position = glm::vec4{position, 1.0f};
+    return uniforms;
+}
+
+glm::mat4 Camera::infinite_perspective(
+        float fov_y, float aspect, float near_plane, bool reverse_z) {
+    float focal = 1.0f / std::tan(fov_y * 0.5f);
+    glm::mat4 projection{0.0f};
+    projection[0][0] = focal / aspect;
+    projection[1][1] = focal;
+    // w = -z, the distance in front of the camera
+    projection[2][3] = -1.0f;
+    if (reverse_z) {
+        // z = near, so depth = near / distance
+        projection[3][2] = near_plane;
+    } else {
+        // the limit of the usual projection as far goes to infinity
+        projection[2][2] = -1.0f;
+        projection[3][2] = -2.0f * near_plane;
+    }
+    return projection;
+}
+} // namespace Charcoal
@@ -0,0 +1,96 @@
+#pragma once
+#include "frustum.h"
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace Charcoal {
+/**
+ * @class Camera
+ * @brief A perspective camera with an infinite far plane.
+ *
+ * With reversed depth, the near plane maps to depth 1 and infinity to 0.
+ * Float precision is densest near 0, which cancels out the perspective
+ * divide bunching depth values up near the camera, so distant surfaces stop
+ * z-fighting. Reversed depth needs a 0 to 1 clip space depth range, see
+ * GlExtensions::clip_control; without it, depth runs the usual way.
+ */
+class Camera {
+public:
+    // std140 layout of the Camera block in shaders/include/camera.glsl
+    struct Uniforms {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 view_projection;
+        // w is unused
+        glm::vec4 position;
+    };
+
+    // uniform buffer binding the Camera block reads from
+    static constexpr GLuint UNIFORM_BINDING = 0;
+
+private:
+    glm::vec3 position{0.0f, 0.0f, 0.0f};
+    glm::vec3 target{0.0f, 0.0f, -1.0f};
+    glm::vec3 up{0.0f, 1.0f, 0.0f};
+    // vertical, in radians
+    float fov_y;
+    float aspect;
+    float near_plane;
+    bool reverse_z;
+
+public:
+    explicit Camera();
+
+    void set_position(const glm::vec3 &position);
+    void look_at(const glm::vec3 &target,
+            const glm::vec3 &up = glm::vec3{0.0f, 1.0f, 0.0f});
+
+    /**
+     * @param fov_y Vertical field of view in radians
+     * @param aspect Width divided by height
+     * @param near_plane Distance to the near plane. There is no far plane.
+     */
+    void set_perspective(float fov_y, float aspect, float near_plane);
+    void set_aspect(float aspect);
+
+    /**
+     * @brief Switches between reversed and regular depth. Only reverse depth
+     * once glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE) is in effect.
+     */
+    void set_reverse_z(bool reverse_z);
+    bool is_reverse_z() const;
+
+    /**
+     * @brief Returns the depth of a point infinitely far away, which is what
+     * the depth buffer should be cleared to. Depth tests should pass for
+     * values closer to the other end: GL_GREATER when reversed, GL_LESS
+     * otherwise.
+     */
+    float get_far_depth() const;
+
+    const glm::vec3 &get_position() const;
+    glm::mat4 get_view() const;
+    glm::mat4 get_projection() const;
+    glm::mat4 get_view_projection() const;
+
+    // world space planes, for culling
+    Frustum get_frustum() const;
+
+    Uniforms get_uniforms() const;
+
+    /**
+     * @brief Builds a perspective projection with the far plane at infinity.
+     *
+     * @param fov_y Vertical field of view in radians
+     * @param aspect Width divided by height
+     * @param near_plane Distance to the near plane
+     * @param reverse_z If true, maps depth from 1 at the near plane to 0 at
+     * infinity, for a 0 to 1 clip space depth range. Otherwise maps it from
+     * -1 to 1 like glm::infinitePerspective.
+     */
+    static glm::mat4 infinite_perspective(
+            float fov_y, float aspect, float near_plane, bool reverse_z);
+};
+} // namespace Charcoal
@@ -12,5 +12,17 @@ struct Config {
             32.0f / 255.0f, 32.0f / 255.0f, 32.0f / 255.0f, 1.0f};
     glm::uvec2 resolution{1280, 720};
     float dpi_scaling = 1.0f;
+    int vram_budget_mb = 512;
+    int texture_upload_kb_per_frame = 4096;
+    float texture_anisotropy = 8.0f;
+    // how far a mesh LOD may stray from the full mesh on screen
+    float lod_error_pixels = 1.0f;
+    // level chunks load within this distance of the camera, and unload
+    // beyond the second
+    float level_load_radius = 256.0f;
+    float level_unload_radius = 320.0f;
+    float level_upload_ms_per_frame = 2.0f;
+    bool shader_cache_enabled = true;
+    bool shader_hot_reload = true;
 };
 } // namespace Charcoal
@@ -0,0 +1,461 @@
+#include "ecs.h"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace Charcoal {
+ComponentId allocate_component_id() {
+    static std::atomic<ComponentId> next{0};
+    ComponentId id = next.fetch_add(1);
+    if (id >= MAX_COMPONENTS) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                "More than %u component types", MAX_COMPONENTS);
+        assert(false);
+    }
+    return id;
+}
+
+World::World() {
+    // entities without components live in archetype 0
+    get_archetype(0);
+}
+
+void World::register_type(
+        ComponentId id, std::size_t size, std::size_t alignment) {
+    if (id >= components.size()) {
+        components.resize(id + 1);
+    }
+    components[id].size = size;
+    components[id].alignment = alignment;
+}
+
+uint32_t World::get_archetype(ComponentMask mask) {
+    auto found = archetype_of_mask.find(mask);
+    if (found != archetype_of_mask.end()) {
+        return found->second;
+    }
+
+    Archetype archetype;
+    archetype.mask = mask;
+    archetype.column_of.fill(NO_COLUMN);
+    std::size_t row_bytes = sizeof(Entity);
+    for (ComponentMask bits = mask; bits != 0; bits &= bits - 1) {
+        ComponentId id = static_cast<ComponentId>(std::countr_zero(bits));
+        assert(id < components.size() && components[id].alignment != 0);
+        archetype.column_of[id] =
+                static_cast<uint8_t>(archetype.columns.size());
+        archetype.columns.push_back({id, 0, components[id].size});
+        row_bytes += components[id].size;
+    }
+
+    // lays the columns out for a capacity, returns the bytes used
+    auto layout = [&](std::size_t capacity) {
+        std::size_t offset = sizeof(Entity) * capacity;
+        for (Column &column : archetype.columns) {
+            std::size_t alignment = components[column.component].alignment;
+            offset = (offset + alignment - 1) & ~(alignment - 1);
+            column.offset = offset;
+            offset += column.size * capacity;
+        }
+        return offset;
+    };
+    std::size_t capacity = CHUNK_BYTES / row_bytes;
+    // alignment padding can push the last column past the end
+    while (capacity > 1 && layout(capacity) > CHUNK_BYTES) {
+        --capacity;
+    }
+    if (capacity == 0 || layout(capacity) > CHUNK_BYTES) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION,
+                "Archetype rows of %zu bytes don't fit in a %zu byte chunk",
+                row_bytes, CHUNK_BYTES);
+        assert(false);
+        capacity = 1;
+    }
+    archetype.chunk_capacity = static_cast<uint32_t>(capacity);
+
+    uint32_t index = static_cast<uint32_t>(archetypes.size());
+    archetypes.push_back(std::move(archetype));
+    archetype_of_mask.emplace(mask, index);
+    return index;
+}
+
+std::pair<uint32_t, uint32_t> World::push_row(
+        Archetype &archetype, Entity entity) {
+    if (archetype.chunks.empty() ||
+            archetype.chunks.back().count == archetype.chunk_capacity) {
+        archetype.chunks.push_back(
+                {std::make_unique_for_overwrite<ChunkStorage>(), 0});
+    }
+    Chunk &chunk = archetype.chunks.back();
+    uint32_t row = chunk.count++;
+    entities_of(chunk)[row] = entity;
+    for (const Column &column : archetype.columns) {
+        std::memset(chunk.storage->bytes + column.offset + column.size * row,
+                0, column.size);
+    }
+    return {static_cast<uint32_t>(archetype.chunks.size() - 1), row};
+}
+
+void World::remove_row(Archetype &archetype, uint32_t chunk, uint32_t row) {
+    Chunk &last = archetype.chunks.back();
+    uint32_t last_row = last.count - 1;
+    Chunk &target = archetype.chunks[chunk];
+    // fill the hole with the last row, so chunks stay packed
+    if (&target != &last || row != last_row) {
+        Entity moved = entities_of(last)[last_row];
+        entities_of(target)[row] = moved;
+        for (const Column &column : archetype.columns) {
+            std::memcpy(target.storage->bytes + column.offset +
+                                column.size * row,
+                    last.storage->bytes + column.offset +
+                            column.size * last_row,
+                    column.size);
+        }
+        EntityRecord &record = records[moved.index];
+        record.chunk = chunk;
+        record.row = row;
+    }
+    if (--last.count == 0) {
+        archetype.chunks.pop_back();
+    }
+}
+
+uint32_t World::allocate_index() {
+    // restoring entities can take indices that are still in the list
+    while (!free_indices.empty() && records[free_indices.back()].alive) {
+        free_indices.pop_back();
+    }
+    if (free_indices.empty()) {
+        records.emplace_back();
+        return static_cast<uint32_t>(records.size() - 1);
+    }
+    uint32_t index = free_indices.back();
+    free_indices.pop_back();
+    return index;
+}
+
+bool World::restore_index(Entity entity, std::size_t limit) {
+    if (entity.index == Entity::NONE || entity.index >= limit) {
+        return false;
+    }
+    if (entity.index >= records.size()) {
+        records.resize(static_cast<std::size_t>(entity.index) + 1);
+    } else if (records[entity.index].alive) {
+        return false;
+    }
+    records[entity.index].generation = entity.generation;
+    return true;
+}
+
+Entity World::create_with_mask(ComponentMask mask) {
+    uint32_t archetype = get_archetype(mask);
+    Entity entity;
+    entity.index = allocate_index();
+    EntityRecord &record = records[entity.index];
+    entity.generation = record.generation;
+    auto [chunk, row] = push_row(archetypes[archetype], entity);
+    record.archetype = archetype;
+    record.chunk = chunk;
+    record.row = row;
+    record.alive = true;
+    ++entity_count;
+    return entity;
+}
+
+void World::move_entity(Entity entity, ComponentMask mask) {
+    // may add an archetype, so look it up before taking references
+    uint32_t target = get_archetype(mask);
+    EntityRecord &record = records[entity.index];
+    Archetype &from = archetypes[record.archetype];
+    Archetype &to = archetypes[target];
+    auto [chunk, row] = push_row(to, entity);
+
+    // components in both archetypes carry over, new ones stay zeroed
+    const Chunk &source = from.chunks[record.chunk];
+    const Chunk &destination = to.chunks[chunk];
+    for (const Column &column : to.columns) {
+        uint8_t index = from.column_of[column.component];
+        if (index == NO_COLUMN) {
+            continue;
+        }
+        std::memcpy(destination.storage->bytes + column.offset +
+                            column.size * row,
+                source.storage->bytes + from.columns[index].offset +
+                        column.size * record.row,
+                column.size);
+    }
+    remove_row(from, record.chunk, record.row);
+    record.archetype = target;
+    record.chunk = chunk;
+    record.row = row;
+}
+
+void World::create_many(ComponentMask mask, std::size_t count,
+        std::span<const ColumnSource> columns,
+        std::span<const Entity> entities, std::vector<Entity> *created,
+        std::size_t restore_total) {
+    uint32_t index = get_archetype(mask);
+    Archetype &archetype = archetypes[index];
+    bool restoring = !entities.empty();
+    // restored indices may leave gaps, but no more than the load restores
+    std::size_t index_limit = records.size() + std::max(count, restore_total);
+    if (restoring) {
+        assert(entities.size() == count);
+    } else {
+        records.reserve(records.size() + count);
+    }
+
+    // source of each of the archetype's columns, null to zero-fill
+    std::vector<const std::byte *> sources(archetype.columns.size(), nullptr);
+    for (const ColumnSource &source : columns) {
+        uint8_t column = archetype.column_of[source.component];
+        if (column != NO_COLUMN) {
+            sources[column] = static_cast<const std::byte *>(source.data);
+        }
+    }
+
+    std::size_t done = 0;
+    while (done < count) {
+        if (archetype.chunks.empty() ||
+                archetype.chunks.back().count == archetype.chunk_capacity) {
+            archetype.chunks.push_back(
+                    {std::make_unique_for_overwrite<ChunkStorage>(), 0});
+        }
+        Chunk &chunk = archetype.chunks.back();
+        uint32_t first_row = chunk.count;
+        std::size_t batch = std::min<std::size_t>(
+                archetype.chunk_capacity - first_row, count - done);
+        uint32_t chunk_index =
+                static_cast<uint32_t>(archetype.chunks.size() - 1);
+
+        Entity *handles = entities_of(chunk) + first_row;
+        for (std::size_t i = 0; i < batch; ++i) {
+            Entity entity;
+            if (restoring && restore_index(entities[done + i], index_limit)) {
+                entity = entities[done + i];
+            } else {
+                if (restoring) {
+                    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                            "Entity %u is in use or out of range, giving it "
+                            "a new index",
+                            entities[done + i].index);
+                }
+                entity.index = allocate_index();
+                entity.generation = records[entity.index].generation;
+            }
+            handles[i] = entity;
+            EntityRecord &record = records[entity.index];
+            record.archetype = index;
+            record.chunk = chunk_index;
+            record.row = first_row + static_cast<uint32_t>(i);
+            record.alive = true;
+        }
+        for (std::size_t c = 0; c < archetype.columns.size(); ++c) {
+            const Column &column = archetype.columns[c];
+            std::byte *destination = chunk.storage->bytes + column.offset +
+                                     column.size * first_row;
+            if (sources[c] != nullptr) {
+                std::memcpy(destination, sources[c] + column.size * done,
+                        column.size * batch);
+            } else {
+                std::memset(destination, 0, column.size * batch);
+            }
+        }
+        if (created != nullptr) {
+            created->insert(created->end(), handles, handles + batch);
+        }
+        chunk.count += static_cast<uint32_t>(batch);
+        done += batch;
+    }
+    entity_count += count;
+
+    if (restoring) {
+        // restored indices can leave gaps, and can't be handed out again.
+        // Lowest indices are reused first
+        free_indices.clear();
+        for (std::size_t i = records.size(); i > 0; --i) {
+            if (!records[i - 1].alive) {
+                free_indices.push_back(static_cast<uint32_t>(i - 1));
+            }
+        }
+    }
+}
+
+void World::destroy(Entity entity) {
+    if (!is_alive(entity)) {
+        return;
+    }
+    EntityRecord &record = records[entity.index];
+    remove_row(archetypes[record.archetype], record.chunk, record.row);
+    record.alive = false;
+    ++record.generation;
+    free_indices.push_back(entity.index);
+    --entity_count;
+}
+
+void World::clear() {
+    for (Archetype &archetype : archetypes) {
+        archetype.chunks.clear();
+    }
+    free_indices.clear();
+    for (std::size_t i = records.size(); i > 0; --i) {
+        EntityRecord &record = records[i - 1];
+        if (record.alive) {
+            record.alive = false;
+            ++record.generation;
+        }
+        free_indices.push_back(static_cast<uint32_t>(i - 1));
+    }
+    entity_count = 0;
+}
+
+bool World::is_alive(Entity entity) const {
+    return entity.index < records.size() &&
+           records[entity.index].alive &&
+           records[entity.index].generation == entity.generation;
+}
+
+Entity World::get_entity(uint32_t index) const {
+    if (index >= records.size() || !records[index].alive) {
+        return Entity{};
+    }
+    return Entity{index, records[index].generation};
+}
+
+void *World::get_component(Entity entity, ComponentId id) {
+    return const_cast<void *>(
+            static_cast<const World *>(this)->get_component(entity, id));
+}
+
+const void *World::get_component(Entity entity, ComponentId id) const {
+    if (!is_alive(entity)) {
+        return nullptr;
+    }
+    const EntityRecord &record = records[entity.index];
+    const Archetype &archetype = archetypes[record.archetype];
+    uint8_t index = archetype.column_of[id];
+    if (index == NO_COLUMN) {
+        return nullptr;
+    }
+    const Column &column = archetype.columns[index];
+    return archetype.chunks[record.chunk].storage->bytes + column.offset +
+           column.size * record.row;
+}
+
+void World::collect_chunks(ComponentMask mask,
+        std::vector<std::pair<const Archetype *, const Chunk *>> &out) const {
+    for (const Archetype &archetype : archetypes) {
+        if ((archetype.mask & mask) != mask) {
+            continue;
+        }
+        for (const Chunk &chunk : archetype.chunks) {
+            out.emplace_back(&archetype, &chunk);
+        }
+    }
+}
+
+ComponentId World::find_component(std::string_view name) const {
+    for (std::size_t id = 0; id < components.size(); ++id) {
+        if (!components[id].name.empty() && components[id].name == name) {
+            return static_cast<ComponentId>(id);
+        }
+    }
+    return MAX_COMPONENTS;
+}
+
+std::size_t World::get_archetype_count() const {
+    return archetypes.size();
+}
+
+ComponentMask World::get_archetype_mask(std::size_t archetype) const {
+    return archetypes[archetype].mask;
+}
+
+std::size_t World::get_archetype_size(std::size_t archetype) const {
+    const std::vector<Chunk> &chunks = archetypes[archetype].chunks;
+    if (chunks.empty()) {
+        return 0;
+    }
+    // every chunk but the last is full
+    return (chunks.size() - 1) * archetypes[archetype].chunk_capacity +
+           chunks.back().count;
+}
+
+std::size_t World::get_chunk_count(std::size_t archetype) const {
+    return archetypes[archetype].chunks.size();
+}
+
+std::span<const Entity> World::get_chunk_entities(
+        std::size_t archetype, std::size_t chunk) const {
+    const Chunk &storage = archetypes[archetype].chunks[chunk];
+    return {entities_of(storage), storage.count};
+}
+
+const std::byte *World::get_chunk_column(std::size_t archetype,
+        std::size_t chunk, ComponentId component) const {
+    const Archetype &storage = archetypes[archetype];
+    uint8_t column = storage.column_of[component];
+    assert(column != NO_COLUMN);
+    return storage.chunks[chunk].storage->bytes +
+           storage.columns[column].offset;
+}
+
+const std::vector<World::ComponentInfo> &World::get_components() const {
+    return components;
+}
+
+World::Stats World::get_stats() const {
+    Stats stats;
+    stats.entity_count = entity_count;
+    stats.archetype_count = archetypes.size();
+    for (const Archetype &archetype : archetypes) {
+        stats.chunk_count += archetype.chunks.size();
+    }
+    return stats;
+}
+
+void SystemScheduler::add(std::string name, ComponentMask reads,
+        ComponentMask writes, Run run) {
+    // after the last stage holding a system this one conflicts with
+    std::size_t stage = 0;
+    for (std::size_t s = stages.size(); s > 0; --s) {
+        bool conflicts = std::any_of(stages[s - 1].begin(),
+                stages[s - 1].end(), [&](std::size_t index) {
+                    const System &other = systems[index];
+                    return (other.writes & (reads | writes)) != 0 ||
+                           (writes & other.reads) != 0;
+                });
+        if (conflicts) {
+            stage = s;
+            break;
+        }
+    }
+    if (stage == stages.size()) {
+        stages.emplace_back();
+    }
+    stages[stage].push_back(systems.size());
+    systems.push_back({std::move(name), reads, writes, std::move(run)});
+}
+
+void SystemScheduler::run(World &world, ThreadPool *pool) {
+    for (const std::vector<std::size_t> &stage : stages) {
+        auto run_systems = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                systems[stage[i]].run(world, pool);
+            }
+        };
+        if (pool != nullptr && stage.size() > 1) {
+            pool->parallel_for(stage.size(), 1, run_systems);
+        } else {
+            run_systems(0, stage.size());
+        }
+    }
+}
+
+std::size_t SystemScheduler::get_stage_count() const {
+    return stages.size();
+}
+} // namespace Charcoal
@@ -0,0 +1,469 @@
+#pragma once
+#include "thread_pool.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Charcoal {
+struct Entity {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t index = NONE;
+    // bumped every time the index is reused, so stale handles don't match
+    uint32_t generation = 0;
+
+    bool operator==(const Entity &other) const = default;
+};
+
+using ComponentId = uint32_t;
+// bit n set means the component with id n
+using ComponentMask = uint64_t;
+constexpr ComponentId MAX_COMPONENTS = 64;
+
+/**
+ * @brief Hands out the next component id. Use component_id() instead.
+ */
+ComponentId allocate_component_id();
+
+/**
+ * @brief Returns the id of a component type, assigned the first time it's
+ * asked for. Ids are only stable within one run. const T is the same
+ * component as T.
+ */
+template <typename T>
+ComponentId component_id() {
+    if constexpr (!std::is_same_v<T, std::remove_cvref_t<T>>) {
+        return component_id<std::remove_cvref_t<T>>();
+    } else {
+        static const ComponentId id = allocate_component_id();
+        return id;
+    }
+}
+
+template <typename... Ts>
+ComponentMask component_mask() {
+    return (ComponentMask{0} | ... | (ComponentMask{1} << component_id<Ts>()));
+}
+
+/**
+ * @class World
+ * @brief Stores entities and their components, grouped by archetype: the
+ * set of component types an entity has.
+ *
+ * Each archetype keeps its entities in fixed-size chunks, with one
+ * contiguous column per component (structure of arrays), so a query only
+ * touches the components it asks for and walks memory linearly. Removing an
+ * entity moves the archetype's last one into its place, which keeps chunks
+ * packed but means rows aren't stable: hold on to Entity handles, not
+ * pointers.
+ *
+ * Components must be trivially copyable, since entities changing archetype
+ * are moved with memcpy, and new components start zero-filled before being
+ * assigned. At most MAX_COMPONENTS types can exist.
+ *
+ * Creating, destroying, adding or removing components while iterating is
+ * not allowed. Queries running at the same time are fine as long as they
+ * don't write the same components.
+ */
+class World {
+public:
+    static constexpr std::size_t CHUNK_BYTES = 16 * 1024;
+    static constexpr std::size_t MAX_ALIGNMENT = 64;
+
+    // what a component field holds, for text formats
+    enum class FieldType : uint8_t { f32, u32, i32 };
+
+    struct ComponentField {
+        std::string name;
+        FieldType type = FieldType::f32;
+        // values in a row, 3 for a glm::vec3
+        uint32_t count = 1;
+        // from the start of the component, offsetof()
+        uint32_t offset = 0;
+    };
+
+    struct ComponentInfo {
+        // set by register_component(), empty otherwise
+        std::string name;
+        std::size_t size = 0;
+        std::size_t alignment = 0;
+        // empty unless registered with a field list
+        std::vector<ComponentField> fields;
+    };
+
+    // packed values for one component of a create_many() batch
+    struct ColumnSource {
+        ComponentId component;
+        const void *data;
+    };
+
+    struct Stats {
+        std::size_t entity_count = 0;
+        std::size_t archetype_count = 0;
+        std::size_t chunk_count = 0;
+    };
+
+private:
+    struct alignas(MAX_ALIGNMENT) ChunkStorage {
+        std::byte bytes[CHUNK_BYTES];
+    };
+
+    struct Chunk {
+        std::unique_ptr<ChunkStorage> storage;
+        uint32_t count = 0;
+    };
+
+    struct Column {
+        ComponentId component;
+        // from the start of the chunk
+        std::size_t offset;
+        std::size_t size;
+    };
+
+    struct Archetype {
+        ComponentMask mask = 0;
+        // ascending component ids. The entity handles come first, at offset
+        // 0, and aren't a column.
+        std::vector<Column> columns;
+        // component id -> index into columns, NO_COLUMN if missing
+        std::array<uint8_t, MAX_COMPONENTS> column_of;
+        uint32_t chunk_capacity = 0;
+        // only the last chunk can be partly filled, and none are empty
+        std::vector<Chunk> chunks;
+    };
+
+    static constexpr uint8_t NO_COLUMN = 0xFF;
+
+    struct EntityRecord {
+        uint32_t generation = 0;
+        uint32_t archetype = 0;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+        bool alive = false;
+    };
+
+    // indexed by ComponentId
+    std::vector<ComponentInfo> components;
+    std::vector<Archetype> archetypes;
+    std::unordered_map<ComponentMask, uint32_t> archetype_of_mask;
+    // indexed by Entity::index
+    std::vector<EntityRecord> records;
+    std::vector<uint32_t> free_indices;
+    std::size_t entity_count = 0;
+
+    void register_type(ComponentId id, std::size_t size, std::size_t alignment);
+    uint32_t get_archetype(ComponentMask mask);
+    // appends a zero-filled row, returns its chunk and row
+    std::pair<uint32_t, uint32_t> push_row(Archetype &archetype, Entity entity);
+    void remove_row(Archetype &archetype, uint32_t chunk, uint32_t row);
+    void move_entity(Entity entity, ComponentMask mask);
+    Entity create_with_mask(ComponentMask mask);
+    // an unused index, or a new one
+    uint32_t allocate_index();
+    // false if the index is in use or not below limit
+    bool restore_index(Entity entity, std::size_t limit);
+
+    template <typename T>
+    void register_type() {
+        using U = std::remove_cvref_t<T>;
+        static_assert(std::is_trivially_copyable_v<U>,
+                "components are moved with memcpy");
+        static_assert(alignof(U) <= MAX_ALIGNMENT);
+        register_type(component_id<U>(), sizeof(U), alignof(U));
+    }
+
+    static Entity *entities_of(const Chunk &chunk) {
+        return reinterpret_cast<Entity *>(chunk.storage->bytes);
+    }
+
+    template <typename T>
+    static T *column_of(const Archetype &archetype, const Chunk &chunk) {
+        const Column &column =
+                archetype.columns[archetype.column_of[component_id<T>()]];
+        return reinterpret_cast<T *>(chunk.storage->bytes + column.offset);
+    }
+
+    // chunks of every archetype that has all of mask
+    void collect_chunks(ComponentMask mask,
+            std::vector<std::pair<const Archetype *, const Chunk *>> &out)
+            const;
+
+public:
+    explicit World();
+
+    World(World &&other) noexcept = default;
+    World &operator=(World &&other) noexcept = default;
+
+    World(const World &other) = delete;
+    World &operator=(const World &other) = delete;
+
+    /**
+     * @brief Names a component type, for serialization and debugging.
+     * Unnamed types work too, they're registered on first use, but aren't
+     * saved.
+     *
+     * @param name Stored in scene files. Change it when the component's
+     * layout changes, so old files don't load garbage.
+     * @param fields Lets text formats write the component field by field.
+     * Without them it's written as raw bytes.
+     */
+    template <typename T>
+    void register_component(
+            std::string name, std::vector<ComponentField> fields = {}) {
+        register_type<T>();
+        ComponentInfo &info = components[component_id<T>()];
+        info.name = std::move(name);
+        info.fields = std::move(fields);
+    }
+
+    /**
+     * @brief Finds a named component.
+     * @return Its id, or MAX_COMPONENTS if nothing has that name
+     */
+    ComponentId find_component(std::string_view name) const;
+
+    /**
+     * @brief Creates an entity with the given components.
+     */
+    template <typename... Ts>
+    Entity create(const Ts &...values) {
+        (register_type<Ts>(), ...);
+        Entity entity = create_with_mask(component_mask<Ts...>());
+        ((*get<Ts>(entity) = values), ...);
+        return entity;
+    }
+
+    /**
+     * @brief Creates entities in bulk, straight into chunks, so nothing is
+     * allocated per entity. Components without a source are zero-filled.
+     *
+     * @param mask Components of every new entity. Must all be registered.
+     * @param count Number of entities
+     * @param columns count packed values for some of the components
+     * @param entities Handles to restore, such as ones loaded from a file,
+     * or empty for new ones. Handles whose index is in use, or further past
+     * the world's indices than the entities being restored, get a new one,
+     * so a corrupt handle can't make the world allocate records for it.
+     * @param created If not null, the new handles are appended to it
+     * @param restore_total Entities restored over every call of one load,
+     * since a batch's handles can be spread over all of their indices. At
+     * least count is assumed.
+     */
+    void create_many(ComponentMask mask, std::size_t count,
+            std::span<const ColumnSource> columns,
+            std::span<const Entity> entities = {},
+            std::vector<Entity> *created = nullptr,
+            std::size_t restore_total = 0);
+
+    /**
+     * @brief Destroys an entity and its components. Does nothing if it's
+     * already gone.
+     */
+    void destroy(Entity entity);
+
+    /**
+     * @brief Destroys every entity. Registered components and archetypes are
+     * kept.
+     */
+    void clear();
+
+    bool is_alive(Entity entity) const;
+
+    /**
+     * @brief Returns the live entity using an index, such as one stored as
+     * BVH user data, or an invalid handle.
+     */
+    Entity get_entity(uint32_t index) const;
+
+    /**
+     * @brief Returns an entity's component, or null if it doesn't have one
+     * or is gone. Valid until the next structural change.
+     */
+    template <typename T>
+    T *get(Entity entity) {
+        return static_cast<T *>(get_component(entity, component_id<T>()));
+    }
+
+    template <typename T>
+    const T *get(Entity entity) const {
+        return static_cast<const T *>(
+                get_component(entity, component_id<T>()));
+    }
+
+    template <typename T>
+    bool has(Entity entity) const {
+        return get<T>(entity) != nullptr;
+    }
+
+    /**
+     * @brief get() for a component only known by id.
+     */
+    void *get_component(Entity entity, ComponentId id);
+    const void *get_component(Entity entity, ComponentId id) const;
+
+    /**
+     * @brief Adds a component, or overwrites it if the entity already has
+     * one. Moves the entity to another archetype.
+     */
+    template <typename T>
+    void add(Entity entity, const T &value) {
+        if (!is_alive(entity)) {
+            return;
+        }
+        register_type<T>();
+        if (!has<T>(entity)) {
+            const EntityRecord &record = records[entity.index];
+            move_entity(entity, archetypes[record.archetype].mask |
+                                        component_mask<T>());
+        }
+        *get<T>(entity) = value;
+    }
+
+    template <typename T>
+    void remove(Entity entity) {
+        if (!has<T>(entity)) {
+            return;
+        }
+        const EntityRecord &record = records[entity.index];
+        move_entity(entity,
+                archetypes[record.archetype].mask & ~component_mask<T>());
+    }
+
+    /**
+     * @brief Calls fn(std::span<const Entity>, std::span<Ts>...) for every
+     * chunk whose entities have all of Ts. The spans are the chunk's
+     * columns, which makes this the fastest way to iterate.
+     */
+    template <typename... Ts, typename F>
+    void each_chunk(F &&fn) {
+        ComponentMask mask = component_mask<Ts...>();
+        for (const Archetype &archetype : archetypes) {
+            if ((archetype.mask & mask) != mask) {
+                continue;
+            }
+            for (const Chunk &chunk : archetype.chunks) {
+                fn(std::span<const Entity>{entities_of(chunk),
+                           chunk.count},
+                        std::span<Ts>{column_of<Ts>(archetype, chunk),
+                                chunk.count}...);
+            }
+        }
+    }
+
+    /**
+     * @brief Calls fn(Entity, Ts &...) for every entity that has all of Ts.
+     */
+    template <typename... Ts, typename F>
+    void each(F &&fn) {
+        each_chunk<Ts...>([&](std::span<const Entity> entities,
+                                  std::span<Ts>... columns) {
+            for (std::size_t i = 0; i < entities.size(); ++i) {
+                fn(entities[i], columns[i]...);
+            }
+        });
+    }
+
+    /**
+     * @brief Like each(), but spreads chunks across the pool. fn is called
+     * from several threads at once.
+     *
+     * @param pool May be null, which runs on the calling thread
+     */
+    template <typename... Ts, typename F>
+    void parallel_each(ThreadPool *pool, F &&fn) {
+        std::vector<std::pair<const Archetype *, const Chunk *>> chunks;
+        collect_chunks(component_mask<Ts...>(), chunks);
+        auto run = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; ++c) {
+                const auto &[archetype, chunk] = chunks[c];
+                const Entity *entities = entities_of(*chunk);
+                std::tuple<Ts *...> columns{
+                        column_of<Ts>(*archetype, *chunk)...};
+                for (uint32_t i = 0; i < chunk->count; ++i) {
+                    std::apply([&](Ts *...column) {
+                        fn(entities[i], column[i]...);
+                    }, columns);
+                }
+            }
+        };
+        if (pool != nullptr) {
+            // a chunk is a few hundred entities, enough work per job
+            pool->parallel_for(chunks.size(), 1, run);
+        } else {
+            run(0, chunks.size());
+        }
+    }
+
+    // raw access to the storage, for serialization. Archetypes and chunks
+    // are indexed from 0, and some archetypes may have no entities.
+
+    std::size_t get_archetype_count() const;
+    ComponentMask get_archetype_mask(std::size_t archetype) const;
+    std::size_t get_archetype_size(std::size_t archetype) const;
+    std::size_t get_chunk_count(std::size_t archetype) const;
+    std::span<const Entity> get_chunk_entities(
+            std::size_t archetype, std::size_t chunk) const;
+    // the chunk's packed values of a component the archetype has
+    const std::byte *get_chunk_column(std::size_t archetype, std::size_t chunk,
+            ComponentId component) const;
+
+    const std::vector<ComponentInfo> &get_components() const;
+    Stats get_stats() const;
+};
+
+/**
+ * @class SystemScheduler
+ * @brief Runs systems, functions that update the world, in stages.
+ *
+ * Each system declares which components it reads and writes. A system is
+ * put in the stage after the last earlier system it conflicts with (one
+ * writes what the other reads or writes), so systems run in declaration
+ * order wherever it matters, and systems in the same stage run at the same
+ * time on the pool. State outside the world must be touched by at most one
+ * system, or be thread-safe.
+ */
+class SystemScheduler {
+public:
+    using Run = std::function<void(World &world, ThreadPool *pool)>;
+
+private:
+    struct System {
+        std::string name;
+        ComponentMask reads;
+        ComponentMask writes;
+        Run run;
+    };
+
+    std::vector<System> systems;
+    // indices into systems
+    std::vector<std::vector<std::size_t>> stages;
+
+public:
+    /**
+     * @param reads Components the system only reads, from component_mask()
+     * @param writes Components the system writes
+     * @param run Called once per run(). Can use the pool itself.
+     */
+    void add(std::string name, ComponentMask reads, ComponentMask writes,
+            Run run);
+
+    /**
+     * @brief Runs every system once, stage by stage.
+     *
+     * @param pool Runs systems of a stage in parallel. May be null.
+     */
+    void run(World &world, ThreadPool *pool);
+
+    std::size_t get_stage_count() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,136 @@
+#include "file_watcher.h"
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <utility>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Charcoal {
+namespace {
+#ifndef __linux__
+// how often modification times are checked without inotify
+constexpr Uint64 POLL_INTERVAL_MS = 500;
+#endif
+
+std::string directory_of(const std::string &path) {
+    std::size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return path.substr(0, slash);
+}
+} // namespace
+
+#ifdef __linux__
+FileWatcher::FileWatcher() :
+        inotify_fd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)} {
+    if (inotify_fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM,
+                "Unable to start watching files: %s", std::strerror(errno));
+    }
+}
+
+FileWatcher::~FileWatcher() noexcept {
+    if (inotify_fd >= 0) {
+        // closing the descriptor removes every watch
+        close(inotify_fd);
+    }
+}
+
+bool FileWatcher::watch(const std::string &path) {
+    if (inotify_fd < 0) {
+        return false;
+    }
+    std::string directory = directory_of(path);
+    // adding the same directory again returns the existing descriptor
+    int wd = inotify_add_watch(inotify_fd, directory.c_str(),
+            IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Unable to watch \"%s\": %s",
+                directory.c_str(), std::strerror(errno));
+        return false;
+    }
+    directories[wd] = directory;
+    files.insert(path);
+    return true;
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+    if (inotify_fd < 0) {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            // EAGAIN, nothing left to read
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event *event =
+                    reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+            auto directory = directories.find(event->wd);
+            if (event->len == 0 || directory == directories.end()) {
+                continue;
+            }
+            std::string path = directory->second + "/" + event->name;
+            if (files.contains(path) &&
+                    std::find(changed.begin(), changed.end(), path) ==
+                            changed.end()) {
+                changed.push_back(std::move(path));
+            }
+        }
+    }
+    return changed;
+}
+#else
+FileWatcher::FileWatcher() {
+}
+
+FileWatcher::~FileWatcher() noexcept {
+}
+
+bool FileWatcher::watch(const std::string &path) {
+    SDL_PathInfo info;
+    if (!SDL_GetPathInfo(path.c_str(), &info)) {
+        SDL_LogError(SDL_LOG_CATEGORY_SYSTEM, "Unable to watch \"%s\": %s",
+                path.c_str(), SDL_GetError());
+        return false;
+    }
+    modified_times[path] = info.modify_time;
+    files.insert(path);
+    return true;
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+    Uint64 now = SDL_GetTicks();
+    if (now < next_check_ms) {
+        return changed;
+    }
+    next_check_ms = now + POLL_INTERVAL_MS;
+
+    for (auto &[path, modified] : modified_times) {
+        SDL_PathInfo info;
+        // missing files are usually mid-save, check again next time
+        if (SDL_GetPathInfo(path.c_str(), &info) &&
+                info.modify_time != modified) {
+            modified = info.modify_time;
+            changed.push_back(path);
+        }
+    }
+    return changed;
+}
+#endif
+} // namespace Charcoal
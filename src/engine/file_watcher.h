@@ -0,0 +1,51 @@
+#pragma once
+#include <SDL3/SDL_stdinc.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class FileWatcher
+ * @brief Reports when watched files change on disk. Uses inotify on Linux
+ * and falls back to checking modification times elsewhere.
+ *
+ * Directories are watched rather than the files themselves, so editors that
+ * save by writing a temporary file and renaming it over the original are
+ * still picked up.
+ */
+class FileWatcher {
+#ifdef __linux__
+    int inotify_fd;
+    // inotify watch descriptor -> directory it watches
+    std::unordered_map<int, std::string> directories;
+#else
+    // path -> last seen modification time
+    std::unordered_map<std::string, SDL_Time> modified_times;
+    Uint64 next_check_ms = 0;
+#endif
+    std::unordered_set<std::string> files;
+
+public:
+    explicit FileWatcher();
+    ~FileWatcher() noexcept;
+
+    FileWatcher(const FileWatcher &other) = delete;
+    FileWatcher &operator=(const FileWatcher &other) = delete;
+
+    /**
+     * @brief Starts watching a file. Watching the same file twice is fine.
+     *
+     * @param path Path to the file, as it should be reported by poll()
+     * @return false if the file's directory can't be watched
+     */
+    bool watch(const std::string &path);
+
+    /**
+     * @brief Returns every watched file that changed since the last call,
+     * each listed once. Never blocks.
+     */
+    std::vector<std::string> poll();
+};
+} // namespace Charcoal
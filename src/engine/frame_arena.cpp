@@ -0,0 +1,85 @@
+#include "frame_arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace Charcoal {
+FrameArena::Resource::Resource(FrameArena &arena) : arena{arena} {
+}
+
+void *FrameArena::Resource::do_allocate(
+        std::size_t bytes, std::size_t alignment) {
+    return arena.allocate(bytes, alignment);
+}
+
+void FrameArena::Resource::do_deallocate(void *, std::size_t, std::size_t) {
+}
+
+bool FrameArena::Resource::do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
+
+FrameArena::FrameArena(std::size_t capacity) : resource{*this} {
+    for (Buffer &buffer : buffers) {
+        buffer.data = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        buffer.size = capacity;
+    }
+    stats.capacity_bytes = 2 * capacity;
+}
+
+void FrameArena::begin_frame() {
+    Buffer &finished = buffers[current];
+    stats.frame_bytes = finished.used + finished.overflow_bytes;
+    stats.overflow_bytes = finished.overflow_bytes;
+    stats.high_water_bytes = std::max(stats.high_water_bytes,
+            stats.frame_bytes);
+
+    current ^= 1;
+    Buffer &buffer = buffers[current];
+    buffer.overflow.clear();
+    buffer.overflow_bytes = 0;
+    buffer.used = 0;
+    if (buffer.size < stats.high_water_bytes) {
+        // half again, so a frame that keeps growing doesn't reallocate
+        // every time
+        std::size_t size = stats.high_water_bytes +
+                           stats.high_water_bytes / 2;
+        stats.capacity_bytes += size - buffer.size;
+        buffer.data = std::make_unique_for_overwrite<std::byte[]>(size);
+        buffer.size = size;
+    }
+}
+
+void *FrameArena::allocate(std::size_t size, std::size_t alignment) {
+    Buffer &buffer = buffers[current];
+    // aligned by address, pmr containers may ask for more than new[] gives
+    auto base = reinterpret_cast<std::uintptr_t>(buffer.data.get());
+    std::size_t offset =
+            ((base + buffer.used + alignment - 1) & ~(alignment - 1)) - base;
+    if (offset <= buffer.size && size <= buffer.size - offset) {
+        buffer.used = offset + size;
+        return buffer.data.get() + offset;
+    }
+    return allocate_overflow(size, alignment);
+}
+
+void *FrameArena::allocate_overflow(std::size_t size, std::size_t alignment) {
+    Buffer &buffer = buffers[current];
+    std::size_t padded = size + alignment - 1;
+    buffer.overflow.push_back(
+            std::make_unique_for_overwrite<std::byte[]>(padded));
+    buffer.overflow_bytes += padded;
+    auto address = reinterpret_cast<std::uintptr_t>(
+            buffer.overflow.back().get());
+    address = (address + alignment - 1) & ~(alignment - 1);
+    return reinterpret_cast<void *>(address);
+}
+
+std::pmr::memory_resource *FrameArena::get_resource() {
+    return &resource;
+}
+
+const FrameArena::Stats &FrameArena::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
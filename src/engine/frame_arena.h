@@ -0,0 +1,116 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class FrameArena
+ * @brief A linear allocator for scratch memory that only lives for a frame,
+ * such as per-frame lists and temporary buffers.
+ *
+ * Allocations are bumped out of one of two buffers and never freed one at a
+ * time. begin_frame() switches to the other buffer and releases everything
+ * allocated from it two frames ago, so memory handed out during a frame stays
+ * valid through the whole next one. That lets objects built in one frame,
+ * like the frame graph, be torn down at the start of the next.
+ *
+ * Allocations that don't fit go to the heap and are freed with the rest of
+ * the buffer. Buffers grow to the biggest frame seen so far, so a steady
+ * frame stops touching the heap after the first few.
+ *
+ * Not thread-safe. Only the thread calling begin_frame() should allocate.
+ */
+class FrameArena {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+    struct Stats {
+        // handed out during the last finished frame, including padding
+        std::size_t frame_bytes = 0;
+        // part of frame_bytes that didn't fit in the buffer
+        std::size_t overflow_bytes = 0;
+        // the biggest frame_bytes so far
+        std::size_t high_water_bytes = 0;
+        // of both buffers
+        std::size_t capacity_bytes = 0;
+    };
+
+private:
+    // hands out arena memory to std::pmr containers. Deallocation does
+    // nothing, the memory comes back when the buffer is reset.
+    class Resource : public std::pmr::memory_resource {
+        FrameArena &arena;
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(
+                void *p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(
+                const std::pmr::memory_resource &other) const noexcept override;
+
+    public:
+        explicit Resource(FrameArena &arena);
+    };
+
+    struct Buffer {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size = 0;
+        std::size_t used = 0;
+        // allocations that didn't fit
+        std::vector<std::unique_ptr<std::byte[]>> overflow;
+        std::size_t overflow_bytes = 0;
+    };
+
+    std::array<Buffer, 2> buffers;
+    std::size_t current = 0;
+    Resource resource;
+    Stats stats;
+
+    void *allocate_overflow(std::size_t size, std::size_t alignment);
+
+public:
+    /**
+     * @param capacity Initial size of each buffer
+     */
+    explicit FrameArena(std::size_t capacity = DEFAULT_CAPACITY);
+
+    // the memory resource points back at the arena
+    FrameArena(const FrameArena &other) = delete;
+    FrameArena &operator=(const FrameArena &other) = delete;
+
+    /**
+     * @brief Starts a new frame. Everything allocated two frames ago is
+     * released, and the buffer grows if the last frames didn't fit.
+     */
+    void begin_frame();
+
+    /**
+     * @param alignment A power of two
+     */
+    void *allocate(std::size_t size, std::size_t alignment);
+
+    /**
+     * @brief Allocates value-initialized storage for count objects.
+     */
+    template <typename T>
+    std::span<T> allocate(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                "the arena never runs destructors");
+        T *data = static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+        std::uninitialized_value_construct_n(data, count);
+        return {data, count};
+    }
+
+    /**
+     * @brief Returns a memory resource backed by the arena, for std::pmr
+     * containers that don't outlive the next frame.
+     */
+    std::pmr::memory_resource *get_resource();
+
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,535 @@
+#include "frame_graph.h"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+namespace Charcoal {
+namespace {
+struct FormatInfo {
+    // format and type passed to glTexImage2D, no data is uploaded
+    GLenum format;
+    GLenum type;
+    std::size_t bytes_per_pixel;
+    // GL_COLOR_ATTACHMENT0 for color formats
+    GLenum attachment;
+};
+
+FormatInfo format_info(GLenum internal_format) {
+    switch (internal_format) {
+        case GL_R8:
+            return {GL_RED, GL_UNSIGNED_BYTE, 1, GL_COLOR_ATTACHMENT0};
+        case GL_R16F:
+            return {GL_RED, GL_HALF_FLOAT, 2, GL_COLOR_ATTACHMENT0};
+        case GL_R32F:
+            return {GL_RED, GL_FLOAT, 4, GL_COLOR_ATTACHMENT0};
+        case GL_RG16F:
+            return {GL_RG, GL_HALF_FLOAT, 4, GL_COLOR_ATTACHMENT0};
+        case GL_R11F_G11F_B10F:
+            return {GL_RGB, GL_FLOAT, 4, GL_COLOR_ATTACHMENT0};
+        case GL_RGBA16F:
+            return {GL_RGBA, GL_HALF_FLOAT, 8, GL_COLOR_ATTACHMENT0};
+        case GL_RGBA32F:
+            return {GL_RGBA, GL_FLOAT, 16, GL_COLOR_ATTACHMENT0};
+        case GL_DEPTH_COMPONENT16:
+            return {GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, 2,
+                    GL_DEPTH_ATTACHMENT};
+        case GL_DEPTH_COMPONENT24:
+            return {GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4,
+                    GL_DEPTH_ATTACHMENT};
+        case GL_DEPTH_COMPONENT32F:
+            return {GL_DEPTH_COMPONENT, GL_FLOAT, 4, GL_DEPTH_ATTACHMENT};
+        case GL_DEPTH24_STENCIL8:
+            return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4,
+                    GL_DEPTH_STENCIL_ATTACHMENT};
+        case GL_DEPTH32F_STENCIL8:
+            return {GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, 8,
+                    GL_DEPTH_STENCIL_ATTACHMENT};
+        default:
+            // GL_RGBA8, GL_SRGB8_ALPHA8, and other 8-bit color formats
+            return {GL_RGBA, GL_UNSIGNED_BYTE, 4, GL_COLOR_ATTACHMENT0};
+    }
+}
+
+// how many of a resource's sorted writers were declared before a pass
+std::size_t count_before(
+        const std::pmr::vector<std::size_t> &writers, std::size_t pass) {
+    return static_cast<std::size_t>(
+            std::lower_bound(writers.begin(), writers.end(), pass) -
+            writers.begin());
+}
+} // namespace
+
+FrameGraph::Resource::Resource(std::pmr::memory_resource *memory) :
+        writers{memory} {
+}
+
+FrameGraph::Pass::Pass(std::pmr::memory_resource *memory) :
+        reads{memory}, writes{memory} {
+}
+
+FrameGraph::FrameGraph() {
+}
+
+FrameGraph::~FrameGraph() noexcept {
+    for (const auto &[attachments, framebuffer] : framebuffers) {
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+    for (const PhysicalTexture &texture : textures) {
+        glDeleteTextures(1, &texture.id);
+    }
+}
+
+void FrameGraph::reset(std::pmr::memory_resource *memory) {
+    resources.clear();
+    passes.clear();
+    this->memory = memory;
+    order.clear();
+    compiled = false;
+}
+
+FrameGraph::ResourceId FrameGraph::create_texture(
+        std::string name, const TextureDesc &desc) {
+    Resource resource{memory};
+    resource.name = std::move(name);
+    resource.desc = desc;
+    resources.push_back(std::move(resource));
+    return resources.size() - 1;
+}
+
+FrameGraph::ResourceId FrameGraph::import_backbuffer(int width, int height) {
+    Resource resource{memory};
+    resource.name = "backbuffer";
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.backbuffer = true;
+    resources.push_back(std::move(resource));
+    return resources.size() - 1;
+}
+
+FrameGraph::PassId FrameGraph::add_pass(std::string name, Execute execute) {
+    Pass pass{memory};
+    pass.name = std::move(name);
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    return passes.size() - 1;
+}
+
+void FrameGraph::read(PassId pass, ResourceId resource) {
+    passes[pass].reads.push_back(resource);
+}
+
+void FrameGraph::write(
+        PassId pass, ResourceId resource, const Attachment &attachment) {
+    Pass &target = passes[pass];
+    bool mixes_backbuffer = std::any_of(target.writes.begin(),
+            target.writes.end(), [&](const Write &write) {
+                return resources[write.resource].backbuffer !=
+                       resources[resource].backbuffer;
+            });
+    if (mixes_backbuffer) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                "Pass \"%s\" can't write \"%s\" together with the backbuffer",
+                target.name.c_str(), resources[resource].name.c_str());
+        return;
+    }
+    target.writes.push_back({resource, attachment});
+    resources[resource].writers.push_back(pass);
+}
+
+void FrameGraph::write(PassId pass, ResourceId resource) {
+    write(pass, resource, Attachment{});
+}
+
+void FrameGraph::set_side_effects(PassId pass) {
+    passes[pass].side_effects = true;
+}
+
+void FrameGraph::mark_writers(
+        ResourceId id, std::size_t end, std::vector<PassId> &needed) {
+    const Resource &resource = resources[id];
+    // walk back until a write that doesn't keep what came before it
+    for (std::size_t i = end; i-- > 0;) {
+        PassId writer = resource.writers[i];
+        needed.push_back(writer);
+        const std::pmr::vector<Write> &writes = passes[writer].writes;
+        auto write = std::find_if(writes.begin(), writes.end(),
+                [&](const Write &w) { return w.resource == id; });
+        if (write->attachment.load != LoadOp::load) {
+            break;
+        }
+    }
+}
+
+void FrameGraph::cull() {
+    std::vector<PassId> needed;
+    for (Pass &pass : passes) {
+        pass.culled = true;
+        if (pass.side_effects) {
+            needed.push_back(&pass - passes.data());
+        }
+    }
+    // the backbuffer's final contents are the only thing the frame outputs
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        if (resources[id].backbuffer) {
+            mark_writers(id, resources[id].writers.size(), needed);
+        }
+    }
+
+    while (!needed.empty()) {
+        PassId id = needed.back();
+        needed.pop_back();
+        Pass &pass = passes[id];
+        if (!pass.culled) {
+            continue;
+        }
+        pass.culled = false;
+
+        // a pass sees what the passes declared before it wrote. Later
+        // writes don't feed it
+        for (ResourceId read : pass.reads) {
+            mark_writers(read, count_before(resources[read].writers, id),
+                    needed);
+        }
+        for (const Write &write : pass.writes) {
+            if (write.attachment.load == LoadOp::load) {
+                mark_writers(write.resource,
+                        count_before(resources[write.resource].writers, id),
+                        needed);
+            }
+        }
+    }
+}
+
+bool FrameGraph::sort() {
+    std::vector<std::vector<PassId>> edges(passes.size());
+    std::vector<std::size_t> incoming(passes.size(), 0);
+    auto add_edge = [&](PassId from, PassId to) {
+        edges[from].push_back(to);
+        ++incoming[to];
+    };
+
+    for (const Resource &resource : resources) {
+        // writes happen in the order they were declared
+        PassId previous = NONE;
+        for (PassId writer : resource.writers) {
+            if (passes[writer].culled) {
+                continue;
+            }
+            if (previous != NONE) {
+                add_edge(previous, writer);
+            }
+            previous = writer;
+        }
+    }
+    for (PassId id = 0; id < passes.size(); ++id) {
+        const Pass &pass = passes[id];
+        if (pass.culled) {
+            continue;
+        }
+        for (ResourceId read : pass.reads) {
+            const Resource &resource = resources[read];
+            // the version it reads is the last live write declared before
+            // it. cull() kept that one alive
+            std::size_t before = count_before(resource.writers, id);
+            PassId source = NONE;
+            for (std::size_t i = before; i-- > 0 && source == NONE;) {
+                if (!passes[resource.writers[i]].culled) {
+                    source = resource.writers[i];
+                }
+            }
+            if (source == NONE) {
+                SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                        "Pass \"%s\" reads \"%s\", which no pass before it "
+                        "writes",
+                        pass.name.c_str(), resource.name.c_str());
+                return false;
+            }
+            add_edge(source, id);
+            // and the next version waits until it's been read
+            for (std::size_t i = before; i < resource.writers.size(); ++i) {
+                PassId next = resource.writers[i];
+                if (next != id && !passes[next].culled) {
+                    add_edge(id, next);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Kahn's algorithm, preferring declaration order among ready passes
+    std::priority_queue<PassId, std::vector<PassId>, std::greater<PassId>>
+            ready;
+    std::size_t live = 0;
+    for (PassId id = 0; id < passes.size(); ++id) {
+        if (!passes[id].culled) {
+            ++live;
+            if (incoming[id] == 0) {
+                ready.push(id);
+            }
+        }
+    }
+    while (!ready.empty()) {
+        PassId id = ready.top();
+        ready.pop();
+        order.push_back(id);
+        for (PassId next : edges[id]) {
+            if (--incoming[next] == 0) {
+                ready.push(next);
+            }
+        }
+    }
+
+    if (order.size() != live) {
+        for (PassId id = 0; id < passes.size(); ++id) {
+            if (!passes[id].culled && incoming[id] > 0) {
+                SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                        "Pass \"%s\" is in or waits on a dependency cycle",
+                        passes[id].name.c_str());
+            }
+        }
+        order.clear();
+        return false;
+    }
+    return true;
+}
+
+void FrameGraph::allocate() {
+    for (std::size_t position = 0; position < order.size(); ++position) {
+        const Pass &pass = passes[order[position]];
+        auto use = [&](ResourceId id) {
+            Resource &resource = resources[id];
+            resource.first_use = std::min(resource.first_use, position);
+            resource.last_use = std::max(resource.last_use, position);
+        };
+        std::for_each(pass.reads.begin(), pass.reads.end(), use);
+        for (const Write &write : pass.writes) {
+            use(write.resource);
+        }
+    }
+
+    std::vector<ResourceId> transient;
+    for (ResourceId id = 0; id < resources.size(); ++id) {
+        if (!resources[id].backbuffer && resources[id].first_use != NONE) {
+            transient.push_back(id);
+        }
+    }
+    std::sort(transient.begin(), transient.end(),
+            [&](ResourceId a, ResourceId b) {
+                return resources[a].first_use < resources[b].first_use;
+            });
+
+    for (PhysicalTexture &texture : textures) {
+        texture.busy_until = NONE;
+    }
+    // greedy interval assignment. Textures from earlier frames come first in
+    // the list, so an unchanged graph gets the same textures every frame.
+    for (ResourceId id : transient) {
+        Resource &resource = resources[id];
+        auto free = std::find_if(textures.begin(), textures.end(),
+                [&](const PhysicalTexture &texture) {
+                    return texture.desc == resource.desc &&
+                           (texture.busy_until == NONE ||
+                                   texture.busy_until < resource.first_use);
+                });
+        if (free == textures.end()) {
+            FormatInfo info = format_info(resource.desc.format);
+            PhysicalTexture texture;
+            texture.desc = resource.desc;
+            texture.bytes = static_cast<std::size_t>(resource.desc.width) *
+                            static_cast<std::size_t>(resource.desc.height) *
+                            info.bytes_per_pixel;
+            glGenTextures(1, &texture.id);
+            glBindTexture(GL_TEXTURE_2D, texture.id);
+            glTexImage2D(GL_TEXTURE_2D, 0,
+                    static_cast<GLint>(resource.desc.format),
+                    resource.desc.width, resource.desc.height, 0, info.format,
+                    info.type, nullptr);
+            // single level, so the texture is complete without mips
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(
+                    GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(
+                    GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            textures.push_back(texture);
+            free = textures.end() - 1;
+        }
+        free->busy_until = resource.last_use;
+        resource.texture = free->id;
+    }
+    stats.transient_textures = transient.size();
+}
+
+void FrameGraph::release_unused() {
+    std::vector<GLuint> released;
+    std::erase_if(textures, [&](const PhysicalTexture &texture) {
+        if (texture.busy_until != NONE) {
+            return false;
+        }
+        glDeleteTextures(1, &texture.id);
+        released.push_back(texture.id);
+        return true;
+    });
+    if (released.empty()) {
+        return;
+    }
+    // GL may hand out the same names again, so drop every framebuffer that
+    // refers to a deleted texture
+    std::erase_if(framebuffers, [&](const auto &entry) {
+        bool stale = std::any_of(entry.first.begin(), entry.first.end(),
+                [&](GLuint id) {
+                    return std::find(released.begin(), released.end(), id) !=
+                           released.end();
+                });
+        if (stale) {
+            glDeleteFramebuffers(1, &entry.second);
+        }
+        return stale;
+    });
+}
+
+bool FrameGraph::compile() {
+    order.clear();
+    for (Resource &resource : resources) {
+        // versions follow pass declaration order, whatever order write()
+        // was called in
+        std::sort(resource.writers.begin(), resource.writers.end());
+        resource.texture = 0;
+        resource.first_use = NONE;
+        resource.last_use = 0;
+    }
+    cull();
+    compiled = sort();
+    if (!compiled) {
+        return false;
+    }
+    allocate();
+    release_unused();
+
+    stats.passes = order.size();
+    stats.culled_passes = passes.size() - order.size();
+    stats.physical_textures = textures.size();
+    stats.physical_bytes = 0;
+    for (const PhysicalTexture &texture : textures) {
+        stats.physical_bytes += texture.bytes;
+    }
+    return true;
+}
+
+void FrameGraph::bind_attachments(const Pass &pass) {
+    if (pass.writes.empty()) {
+        return;
+    }
+
+    const Resource &first = resources[pass.writes.front().resource];
+    if (first.backbuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, first.desc.width, first.desc.height);
+        const Attachment &attachment = pass.writes.front().attachment;
+        if (attachment.load == LoadOp::clear) {
+            glClearColor(attachment.clear_color.r, attachment.clear_color.g,
+                    attachment.clear_color.b, attachment.clear_color.a);
+            glClearDepth(attachment.clear_depth);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+        return;
+    }
+
+    // color attachments first, in write order, then depth
+    std::vector<GLuint> key;
+    const Write *depth = nullptr;
+    for (const Write &write : pass.writes) {
+        const Resource &resource = resources[write.resource];
+        if (format_info(resource.desc.format).attachment ==
+                GL_COLOR_ATTACHMENT0) {
+            key.push_back(resource.texture);
+        } else {
+            depth = &write;
+        }
+    }
+    GLsizei color_count = static_cast<GLsizei>(key.size());
+    if (depth != nullptr) {
+        key.push_back(resources[depth->resource].texture);
+    }
+
+    auto it = framebuffers.find(key);
+    if (it == framebuffers.end()) {
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        std::vector<GLenum> draw_buffers;
+        for (GLsizei i = 0; i < color_count; ++i) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+                    GL_TEXTURE_2D, key[i], 0);
+            draw_buffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+        }
+        if (depth != nullptr) {
+            glFramebufferTexture2D(GL_FRAMEBUFFER,
+                    format_info(resources[depth->resource].desc.format)
+                            .attachment,
+                    GL_TEXTURE_2D, key.back(), 0);
+        }
+        if (draw_buffers.empty()) {
+            glDrawBuffer(GL_NONE);
+        } else {
+            glDrawBuffers(color_count, draw_buffers.data());
+        }
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        if (status != GL_FRAMEBUFFER_COMPLETE) {
+            SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                    "Framebuffer for pass \"%s\" is incomplete: 0x%04X",
+                    pass.name.c_str(), status);
+        }
+        it = framebuffers.emplace(std::move(key), framebuffer).first;
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, it->second);
+    }
+    glViewport(0, 0, first.desc.width, first.desc.height);
+
+    GLint color_index = 0;
+    for (const Write &write : pass.writes) {
+        const Attachment &attachment = write.attachment;
+        const Resource &resource = resources[write.resource];
+        GLenum point = format_info(resource.desc.format).attachment;
+        if (point == GL_COLOR_ATTACHMENT0) {
+            if (attachment.load == LoadOp::clear) {
+                GLfloat color[4] = {attachment.clear_color.r,
+                        attachment.clear_color.g, attachment.clear_color.b,
+                        attachment.clear_color.a};
+                glClearBufferfv(GL_COLOR, color_index, color);
+            }
+            ++color_index;
+        } else if (attachment.load == LoadOp::clear) {
+            if (point == GL_DEPTH_STENCIL_ATTACHMENT) {
+                glClearBufferfi(
+                        GL_DEPTH_STENCIL, 0, attachment.clear_depth, 0);
+            } else {
+                glClearBufferfv(GL_DEPTH, 0, &attachment.clear_depth);
+            }
+        }
+    }
+}
+
+void FrameGraph::execute() {
+    if (!compiled) {
+        return;
+    }
+    for (PassId id : order) {
+        const Pass &pass = passes[id];
+        bind_attachments(pass);
+        pass.execute(*this);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint FrameGraph::get_texture(ResourceId resource) const {
+    return resources[resource].texture;
+}
+
+const FrameGraph::Stats &FrameGraph::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
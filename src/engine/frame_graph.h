@@ -0,0 +1,223 @@
+#pragma once
+#include <SDL3/SDL_pixels.h>
+#include <cstddef>
+#include <functional>
+#include <glad/glad.h>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class FrameGraph
+ * @brief Describes a frame as passes that read and write attachments, then
+ * works out what actually needs to run and which textures it needs.
+ *
+ * The graph is rebuilt every frame: reset(), declare resources and passes,
+ * compile(), execute(). Each write makes a new version of a resource, and a
+ * pass sees the version written by the last pass declared before it.
+ * compile() culls passes whose results never reach the backbuffer, orders
+ * the rest so every pass runs after the write it reads and before the next
+ * write replaces it, and lets transient textures with non-overlapping
+ * lifetimes share the same GL texture. Textures and framebuffers are kept
+ * between frames, so a graph that doesn't change doesn't allocate anything.
+ *
+ * Transient textures are aliased, so their contents are undefined until the
+ * first pass writing them clears or fully overwrites them.
+ */
+class FrameGraph {
+public:
+    using ResourceId = std::size_t;
+    using PassId = std::size_t;
+    // runs the pass. The right framebuffer is already bound and cleared.
+    using Execute = std::function<void(const FrameGraph &graph)>;
+
+    struct TextureDesc {
+        int width = 0;
+        int height = 0;
+        // sized internal format. Depth formats become the depth attachment.
+        GLenum format = GL_RGBA8;
+
+        bool operator==(const TextureDesc &other) const = default;
+    };
+
+    // what happens to an attachment's contents when a pass starts writing it
+    enum class LoadOp {
+        // keep what earlier passes wrote
+        load,
+        clear,
+        // the pass overwrites everything, so earlier writes don't matter
+        dont_care,
+    };
+
+    struct Attachment {
+        LoadOp load = LoadOp::load;
+        SDL_FColor clear_color{0.0f, 0.0f, 0.0f, 0.0f};
+        float clear_depth = 1.0f;
+    };
+
+    struct Stats {
+        std::size_t passes = 0;
+        std::size_t culled_passes = 0;
+        std::size_t transient_textures = 0;
+        // GL textures backing the transient ones after aliasing
+        std::size_t physical_textures = 0;
+        std::size_t physical_bytes = 0;
+    };
+
+private:
+    static constexpr std::size_t NONE = static_cast<std::size_t>(-1);
+
+    struct Resource {
+        std::string name;
+        TextureDesc desc;
+        // the default framebuffer, which always counts as an output
+        bool backbuffer = false;
+        // passes writing the resource, sorted by id (declaration order) in
+        // compile()
+        std::pmr::vector<PassId> writers;
+        // set by compile(). first_use and last_use are positions in order.
+        GLuint texture = 0;
+        std::size_t first_use = NONE;
+        std::size_t last_use = 0;
+
+        explicit Resource(std::pmr::memory_resource *memory);
+    };
+
+    struct Write {
+        ResourceId resource;
+        Attachment attachment;
+    };
+
+    struct Pass {
+        std::string name;
+        Execute execute;
+        std::pmr::vector<ResourceId> reads;
+        std::pmr::vector<Write> writes;
+        bool side_effects = false;
+        bool culled = true;
+
+        explicit Pass(std::pmr::memory_resource *memory);
+    };
+
+    struct PhysicalTexture {
+        GLuint id = 0;
+        TextureDesc desc;
+        std::size_t bytes = 0;
+        // last pass position that uses it this frame, NONE while unassigned
+        std::size_t busy_until = NONE;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    // backs the per-pass and per-resource lists until the next reset()
+    std::pmr::memory_resource *memory = std::pmr::get_default_resource();
+    // non-culled passes in execution order
+    std::vector<PassId> order;
+    std::vector<PhysicalTexture> textures;
+    // attached textures, color first then depth -> framebuffer object
+    std::map<std::vector<GLuint>, GLuint> framebuffers;
+    bool compiled = false;
+    Stats stats;
+
+    void cull();
+    bool sort();
+    void allocate();
+    void release_unused();
+    void bind_attachments(const Pass &pass);
+
+    // marks every pass whose writes are still visible right before
+    // writers[end] as needed
+    void mark_writers(
+            ResourceId id, std::size_t end, std::vector<PassId> &needed);
+
+public:
+    explicit FrameGraph();
+    ~FrameGraph() noexcept;
+
+    FrameGraph(const FrameGraph &other) = delete;
+    FrameGraph &operator=(const FrameGraph &other) = delete;
+
+    /**
+     * @brief Forgets the previous frame's passes and resources. Textures and
+     * framebuffers are kept for reuse.
+     *
+     * @param memory Where this frame's pass and resource lists are
+     * allocated. It must outlive them, which is until the next reset(). A
+     * FrameArena's resource keeps graph building off the heap.
+     */
+    void reset(std::pmr::memory_resource *memory =
+                    std::pmr::get_default_resource());
+
+    /**
+     * @brief Declares a texture that only lives for this frame.
+     *
+     * @param name Name used in error messages
+     * @param desc Size and format
+     * @return The resource, valid until the next reset()
+     */
+    ResourceId create_texture(std::string name, const TextureDesc &desc);
+
+    /**
+     * @brief Declares the window's default framebuffer. Passes that write it
+     * are what keep the rest of the graph from being culled.
+     *
+     * @param width Width in pixels
+     * @param height Height in pixels
+     */
+    ResourceId import_backbuffer(int width, int height);
+
+    /**
+     * @brief Declares a pass. It only runs if something it writes is needed,
+     * or it's marked with set_side_effects().
+     *
+     * @param name Name used in error messages
+     * @param execute Issues the pass's draw calls
+     */
+    PassId add_pass(std::string name, Execute execute);
+
+    /**
+     * @brief Declares that a pass samples a texture written by another pass.
+     */
+    void read(PassId pass, ResourceId resource);
+
+    /**
+     * @brief Declares that a pass renders into a resource. Color attachments
+     * are numbered in the order they're written. A pass writing the
+     * backbuffer can't write anything else.
+     */
+    void write(PassId pass, ResourceId resource, const Attachment &attachment);
+    // keeps the resource's contents, see LoadOp::load
+    void write(PassId pass, ResourceId resource);
+
+    /**
+     * @brief Keeps a pass even if nothing reads what it writes, for passes
+     * that do work outside the graph.
+     */
+    void set_side_effects(PassId pass);
+
+    /**
+     * @brief Culls, orders, and assigns textures to this frame's passes.
+     *
+     * @return false if the passes depend on each other in a cycle, or a
+     * pass reads a texture no pass declared before it writes
+     */
+    bool compile();
+
+    /**
+     * @brief Runs every pass that survived compile(), in order. Leaves the
+     * default framebuffer bound.
+     */
+    void execute();
+
+    /**
+     * @brief Returns the GL texture backing a transient texture. Only
+     * meaningful while the graph is executing, since the texture is shared
+     * with other resources.
+     */
+    GLuint get_texture(ResourceId resource) const;
+
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,326 @@
+#include "frustum.h"
+#include "simd.h"
+#include <SDL3/SDL_cpuinfo.h>
+#include <bit>
+#include <cmath>
+#include <glm/geometric.hpp>
+
+namespace Charcoal {
+namespace {
+struct BoxArrays {
+    const float *center_x;
+    const float *center_y;
+    const float *center_z;
+    const float *extent_x;
+    const float *extent_y;
+    const float *extent_z;
+};
+
+glm::vec4 row(const glm::mat4 &m, int i) {
+    return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]};
+}
+
+// the box is outside if even its corner furthest along the plane normal is
+// behind the plane
+bool outside_plane(const glm::vec4 &plane, float cx, float cy, float cz,
+        float ex, float ey, float ez) {
+    float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+    float radius = std::abs(plane.x) * ex + std::abs(plane.y) * ey +
+                   std::abs(plane.z) * ez;
+    return distance + radius < 0.0f;
+}
+
+// Each kernel fills in one byte per block of 8 boxes, with a bit set for
+// every box that is outside the frustum
+
+void outside_masks_scalar(const BoxArrays &boxes, const Frustum &frustum,
+        std::size_t blocks, uint8_t *masks) {
+    for (std::size_t block = 0; block < blocks; ++block) {
+        uint8_t mask = 0;
+        for (std::size_t lane = 0; lane < FrustumCuller::BLOCK_SIZE; ++lane) {
+            std::size_t i = block * FrustumCuller::BLOCK_SIZE + lane;
+            for (const glm::vec4 &plane : frustum.planes) {
+                if (outside_plane(plane, boxes.center_x[i], boxes.center_y[i],
+                            boxes.center_z[i], boxes.extent_x[i],
+                            boxes.extent_y[i], boxes.extent_z[i])) {
+                    mask |= static_cast<uint8_t>(1u << lane);
+                    break;
+                }
+            }
+        }
+        masks[block] = mask;
+    }
+}
+
+#if defined(CHARCOAL_SIMD_X86)
+bool has_avx() {
+    static const bool supported = SDL_HasAVX();
+    return supported;
+}
+
+CHARCOAL_TARGET("avx")
+void outside_masks_avx(const BoxArrays &boxes, const Frustum &frustum,
+        std::size_t blocks, uint8_t *masks) {
+    __m256 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p) {
+        const glm::vec4 &plane = frustum.planes[p];
+        nx[p] = _mm256_set1_ps(plane.x);
+        ny[p] = _mm256_set1_ps(plane.y);
+        nz[p] = _mm256_set1_ps(plane.z);
+        nw[p] = _mm256_set1_ps(plane.w);
+        ax[p] = _mm256_set1_ps(std::abs(plane.x));
+        ay[p] = _mm256_set1_ps(std::abs(plane.y));
+        az[p] = _mm256_set1_ps(std::abs(plane.z));
+    }
+    __m256 zero = _mm256_setzero_ps();
+
+    for (std::size_t block = 0; block < blocks; ++block) {
+        std::size_t i = block * FrustumCuller::BLOCK_SIZE;
+        __m256 cx = _mm256_loadu_ps(boxes.center_x + i);
+        __m256 cy = _mm256_loadu_ps(boxes.center_y + i);
+        __m256 cz = _mm256_loadu_ps(boxes.center_z + i);
+        __m256 ex = _mm256_loadu_ps(boxes.extent_x + i);
+        __m256 ey = _mm256_loadu_ps(boxes.extent_y + i);
+        __m256 ez = _mm256_loadu_ps(boxes.extent_z + i);
+
+        __m256 outside = zero;
+        for (int p = 0; p < 6; ++p) {
+            __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx[p], cx),
+                                          _mm256_mul_ps(ny[p], cy)),
+                            _mm256_mul_ps(nz[p], cz)),
+                    nw[p]);
+            __m256 radius = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(ax[p], ex),
+                            _mm256_mul_ps(ay[p], ey)),
+                    _mm256_mul_ps(az[p], ez));
+            outside = _mm256_or_ps(outside,
+                    _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero,
+                            _CMP_LT_OQ));
+        }
+        masks[block] = static_cast<uint8_t>(_mm256_movemask_ps(outside));
+    }
+}
+#endif
+
+#if defined(CHARCOAL_SIMD_SSE2)
+void outside_masks_sse2(const BoxArrays &boxes, const Frustum &frustum,
+        std::size_t blocks, uint8_t *masks) {
+    __m128 nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p) {
+        const glm::vec4 &plane = frustum.planes[p];
+        nx[p] = _mm_set1_ps(plane.x);
+        ny[p] = _mm_set1_ps(plane.y);
+        nz[p] = _mm_set1_ps(plane.z);
+        nw[p] = _mm_set1_ps(plane.w);
+        ax[p] = _mm_set1_ps(std::abs(plane.x));
+        ay[p] = _mm_set1_ps(std::abs(plane.y));
+        az[p] = _mm_set1_ps(std::abs(plane.z));
+    }
+    __m128 zero = _mm_setzero_ps();
+
+    for (std::size_t block = 0; block < blocks; ++block) {
+        int mask = 0;
+        // two halves of 4 boxes
+        for (std::size_t half = 0; half < 2; ++half) {
+            std::size_t i = block * FrustumCuller::BLOCK_SIZE + half * 4;
+            __m128 cx = _mm_loadu_ps(boxes.center_x + i);
+            __m128 cy = _mm_loadu_ps(boxes.center_y + i);
+            __m128 cz = _mm_loadu_ps(boxes.center_z + i);
+            __m128 ex = _mm_loadu_ps(boxes.extent_x + i);
+            __m128 ey = _mm_loadu_ps(boxes.extent_y + i);
+            __m128 ez = _mm_loadu_ps(boxes.extent_z + i);
+
+            __m128 outside = zero;
+            for (int p = 0; p < 6; ++p) {
+                __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx),
+                                           _mm_mul_ps(ny[p], cy)),
+                                _mm_mul_ps(nz[p], cz)),
+                        nw[p]);
+                __m128 radius = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(ax[p], ex),
+                                _mm_mul_ps(ay[p], ey)),
+                        _mm_mul_ps(az[p], ez));
+                outside = _mm_or_ps(outside,
+                        _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+            }
+            mask |= _mm_movemask_ps(outside) << (half * 4);
+        }
+        masks[block] = static_cast<uint8_t>(mask);
+    }
+}
+#elif defined(CHARCOAL_SIMD_NEON)
+void outside_masks_neon(const BoxArrays &boxes, const Frustum &frustum,
+        std::size_t blocks, uint8_t *masks) {
+    float32x4_t nx[6], ny[6], nz[6], nw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; ++p) {
+        const glm::vec4 &plane = frustum.planes[p];
+        nx[p] = vdupq_n_f32(plane.x);
+        ny[p] = vdupq_n_f32(plane.y);
+        nz[p] = vdupq_n_f32(plane.z);
+        nw[p] = vdupq_n_f32(plane.w);
+        ax[p] = vdupq_n_f32(std::abs(plane.x));
+        ay[p] = vdupq_n_f32(std::abs(plane.y));
+        az[p] = vdupq_n_f32(std::abs(plane.z));
+    }
+    float32x4_t zero = vdupq_n_f32(0.0f);
+
+    for (std::size_t block = 0; block < blocks; ++block) {
+        unsigned mask = 0;
+        // two halves of 4 boxes
+        for (std::size_t half = 0; half < 2; ++half) {
+            std::size_t i = block * FrustumCuller::BLOCK_SIZE + half * 4;
+            float32x4_t cx = vld1q_f32(boxes.center_x + i);
+            float32x4_t cy = vld1q_f32(boxes.center_y + i);
+            float32x4_t cz = vld1q_f32(boxes.center_z + i);
+            float32x4_t ex = vld1q_f32(boxes.extent_x + i);
+            float32x4_t ey = vld1q_f32(boxes.extent_y + i);
+            float32x4_t ez = vld1q_f32(boxes.extent_z + i);
+
+            uint32x4_t outside = vdupq_n_u32(0);
+            for (int p = 0; p < 6; ++p) {
+                float32x4_t distance = vaddq_f32(
+                        vaddq_f32(vaddq_f32(vmulq_f32(nx[p], cx),
+                                          vmulq_f32(ny[p], cy)),
+                                vmulq_f32(nz[p], cz)),
+                        nw[p]);
+                float32x4_t radius = vaddq_f32(
+                        vaddq_f32(vmulq_f32(ax[p], ex), vmulq_f32(ay[p], ey)),
+                        vmulq_f32(az[p], ez));
+                outside = vorrq_u32(outside,
+                        vcltq_f32(vaddq_f32(distance, radius), zero));
+            }
+            mask |= ((vgetq_lane_u32(outside, 0) & 1u) |
+                            (vgetq_lane_u32(outside, 1) & 2u) |
+                            (vgetq_lane_u32(outside, 2) & 4u) |
+                            (vgetq_lane_u32(outside, 3) & 8u))
+                    << (half * 4);
+        }
+        masks[block] = static_cast<uint8_t>(mask);
+    }
+}
+#endif
+} // namespace
+
+Frustum Frustum::from_matrix(
+        const glm::mat4 &clip_from_world, ClipDepth depth) {
+    // Gribb and Hartmann: each plane is the w row plus or minus another row
+    glm::vec4 x = row(clip_from_world, 0);
+    glm::vec4 y = row(clip_from_world, 1);
+    glm::vec4 z = row(clip_from_world, 2);
+    glm::vec4 w = row(clip_from_world, 3);
+
+    Frustum frustum;
+    // -w <= z <= w, or 0 <= z <= w
+    glm::vec4 z_min = depth == ClipDepth::zero_to_one ? z : w + z;
+    frustum.planes = {w + x, w - x, w + y, w - y, z_min, w - z};
+    for (glm::vec4 &plane : frustum.planes) {
+        float length = glm::length(glm::vec3{plane});
+        // an infinite far plane has no normal, and never culls anything
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::intersects(const Aabb &box) const {
+    glm::vec3 center = box.get_center();
+    glm::vec3 extents = box.get_extents();
+    for (const glm::vec4 &plane : planes) {
+        if (outside_plane(plane, center.x, center.y, center.z, extents.x,
+                    extents.y, extents.z)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const {
+    for (const glm::vec4 &plane : planes) {
+        if (glm::dot(glm::vec3{plane}, sphere.center) + plane.w <
+                -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrustumCuller::clear() {
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    extent_x.clear();
+    extent_y.clear();
+    extent_z.clear();
+    count = 0;
+}
+
+uint32_t FrustumCuller::add(const Aabb &world_box) {
+    if (count % BLOCK_SIZE == 0) {
+        // start a new block. Padding boxes are tested but never reported.
+        std::size_t padded = count + BLOCK_SIZE;
+        for (std::vector<float> *values : {&center_x, &center_y, &center_z,
+                     &extent_x, &extent_y, &extent_z}) {
+            values->resize(padded, 0.0f);
+        }
+    }
+    glm::vec3 center = world_box.get_center();
+    glm::vec3 extents = world_box.get_extents();
+    center_x[count] = center.x;
+    center_y[count] = center.y;
+    center_z[count] = center.z;
+    extent_x[count] = extents.x;
+    extent_y[count] = extents.y;
+    extent_z[count] = extents.z;
+    return static_cast<uint32_t>(count++);
+}
+
+void FrustumCuller::cull(
+        const Frustum &frustum, std::vector<uint32_t> &visible) {
+    visible.clear();
+    std::size_t blocks = (count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    outside.resize(blocks);
+    BoxArrays boxes{center_x.data(), center_y.data(), center_z.data(),
+            extent_x.data(), extent_y.data(), extent_z.data()};
+
+#if defined(CHARCOAL_SIMD_X86)
+    if (has_avx()) {
+        outside_masks_avx(boxes, frustum, blocks, outside.data());
+    } else {
+#if defined(CHARCOAL_SIMD_SSE2)
+        outside_masks_sse2(boxes, frustum, blocks, outside.data());
+#else
+        outside_masks_scalar(boxes, frustum, blocks, outside.data());
+#endif
+    }
+#elif defined(CHARCOAL_SIMD_NEON)
+    outside_masks_neon(boxes, frustum, blocks, outside.data());
+#else
+    outside_masks_scalar(boxes, frustum, blocks, outside.data());
+#endif
+
+    for (std::size_t block = 0; block < blocks; ++block) {
+        unsigned inside = ~static_cast<unsigned>(outside[block]) & 0xFFu;
+        while (inside != 0) {
+            std::size_t i = block * BLOCK_SIZE +
+                            static_cast<std::size_t>(std::countr_zero(inside));
+            inside &= inside - 1;
+            if (i < count) {
+                visible.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+    stats.visible = visible.size();
+    stats.culled = count - visible.size();
+}
+
+std::size_t FrustumCuller::get_count() const {
+    return count;
+}
+
+const FrustumCuller::Stats &FrustumCuller::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
@@ -0,0 +1,100 @@
+#pragma once
+#include "bounds.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+namespace Charcoal {
+/**
+ * @class Frustum
+ * @brief The six planes of a view volume, facing inwards. A point p is inside
+ * a plane when dot(plane.xyz, p) + plane.w >= 0.
+ */
+struct Frustum {
+    // depth range of clip space, see GlExtensions::clip_control
+    enum class ClipDepth { negative_one_to_one, zero_to_one };
+
+    // left, right, bottom, top, then near and far (far and near with
+    // reversed depth). xyz is unit length, except for the far plane of an
+    // infinite projection, which is all zero but w.
+    std::array<glm::vec4, 6> planes;
+
+    /**
+     * @brief Extracts the planes of a projection (or projection * view)
+     * matrix. Works for reversed depth too, the near and far planes just
+     * trade places.
+     *
+     * @param clip_from_world The matrix taking points into clip space. Planes
+     * come out in the space the matrix takes points from.
+     * @param depth The clip space depth range the matrix was made for
+     */
+    static Frustum from_matrix(const glm::mat4 &clip_from_world,
+            ClipDepth depth = ClipDepth::negative_one_to_one);
+
+    bool intersects(const Aabb &box) const;
+    bool intersects(const BoundingSphere &sphere) const;
+};
+
+/**
+ * @class FrustumCuller
+ * @brief Tests many world-space boxes against a frustum at once.
+ *
+ * Boxes are stored as separate arrays of centers and extents so the test
+ * runs on 8 boxes per step: one AVX register on x86 CPUs that have it, two
+ * SSE2 or NEON registers otherwise. It's the same test as
+ * Frustum::intersects().
+ */
+class FrustumCuller {
+public:
+    struct Stats {
+        std::size_t visible = 0;
+        std::size_t culled = 0;
+    };
+
+    // boxes tested per step
+    static constexpr std::size_t BLOCK_SIZE = 8;
+
+private:
+    // padded to a multiple of BLOCK_SIZE
+    std::vector<float> center_x;
+    std::vector<float> center_y;
+    std::vector<float> center_z;
+    std::vector<float> extent_x;
+    std::vector<float> extent_y;
+    std::vector<float> extent_z;
+    std::size_t count = 0;
+    // per block, a bit for every box outside the frustum
+    std::vector<uint8_t> outside;
+    Stats stats;
+
+public:
+    /**
+     * @brief Removes every box, keeping the memory for the next frame.
+     */
+    void clear();
+
+    /**
+     * @brief Adds a box to test.
+     *
+     * @param world_box The box in world space, see Bounds::transformed()
+     * @return The box's index, as written by cull()
+     */
+    uint32_t add(const Aabb &world_box);
+
+    /**
+     * @brief Finds every box at least partly inside the frustum.
+     *
+     * @param frustum Frustum planes in world space
+     * @param visible Receives the indices of visible boxes, in increasing
+     * order. Cleared first.
+     */
+    void cull(const Frustum &frustum, std::vector<uint32_t> &visible);
+
+    std::size_t get_count() const;
+    // results of the last cull()
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,102 @@
+#include "geometry_arena.h"
+#include "mesh_file.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace Charcoal {
+GeometryArena::GeometryArena(std::size_t block_size) :
+        block_size{std::max<std::size_t>(block_size, 1)} {
+}
+
+void GeometryArena::add_block(std::size_t min_size) {
+    std::size_t size = std::max(block_size, min_size);
+    // new[] only guarantees fundamental alignment, which covers every type
+    // geometry is made of
+    blocks.push_back({std::make_unique_for_overwrite<std::byte[]>(size), size,
+            0});
+    stats.capacity_bytes += size;
+    ++stats.block_count;
+}
+
+void *GeometryArena::allocate_bytes(std::size_t size, std::size_t alignment) {
+    assert(alignment <= alignof(std::max_align_t));
+    // only the last block is bumped. Leftovers in earlier ones are wasted,
+    // which is why loads should reserve()
+    if (!blocks.empty()) {
+        Block &block = blocks.back();
+        std::size_t offset = (block.used + alignment - 1) & ~(alignment - 1);
+        if (offset <= block.size && size <= block.size - offset) {
+            stats.used_bytes += offset + size - block.used;
+            ++stats.allocation_count;
+            block.used = offset + size;
+            return block.data.get() + offset;
+        }
+    }
+    add_block(size);
+    Block &block = blocks.back();
+    block.used = size;
+    stats.used_bytes += size;
+    ++stats.allocation_count;
+    return block.data.get();
+}
+
+void GeometryArena::reserve(std::size_t bytes) {
+    if (!blocks.empty() &&
+            blocks.back().size - blocks.back().used >= bytes) {
+        return;
+    }
+    add_block(bytes);
+}
+
+MeshView GeometryArena::store(const MeshView &mesh) {
+    reserve(mesh.verts.size_bytes() + mesh.indices.size_bytes() +
+            mesh.lods.size_bytes() + 2 * alignof(std::max_align_t));
+    MeshView view;
+    view.verts = copy(mesh.verts);
+    view.indices = copy(mesh.indices);
+    view.lods = copy(mesh.lods);
+    view.bounds = mesh.bounds;
+    return view;
+}
+
+MeshView GeometryArena::store(const MeshFile::View &view) {
+    assert(MeshFile::has_vertex_layout(view));
+    reserve(view.vertex_bytes + view.index_count * sizeof(int) +
+            view.lods.size_bytes() + 2 * alignof(std::max_align_t));
+    MeshView mesh;
+    mesh.verts = copy(std::span<const Vertex>{
+            static_cast<const Vertex *>(view.vertices), view.vertex_count});
+    std::span<int> indices = allocate<int>(view.index_count);
+    if (view.index_size == sizeof(uint16_t)) {
+        std::copy_n(static_cast<const uint16_t *>(view.indices),
+                view.index_count, indices.begin());
+    } else {
+        std::copy_n(static_cast<const uint32_t *>(view.indices),
+                view.index_count, indices.begin());
+    }
+    mesh.indices = indices;
+    mesh.lods = copy(view.lods);
+    mesh.bounds = view.bounds;
+    return mesh;
+}
+
+void GeometryArena::reset() {
+    if (blocks.empty()) {
+        return;
+    }
+    auto largest = std::ranges::max_element(
+            blocks, {}, [](const Block &block) { return block.size; });
+    Block kept = std::move(*largest);
+    kept.used = 0;
+    blocks.clear();
+    stats = Stats{};
+    stats.capacity_bytes = kept.size;
+    stats.block_count = 1;
+    blocks.push_back(std::move(kept));
+}
+
+const GeometryArena::Stats &GeometryArena::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
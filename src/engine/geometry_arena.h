@@ -0,0 +1,124 @@
+#pragma once
+#include "mesh.h"
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class GeometryArena
+ * @brief A linear allocator for CPU-side geometry that lives and dies
+ * together, such as everything a level loads.
+ *
+ * Allocations are bumped out of large blocks and never freed one at a time:
+ * reset() releases everything at once. Reserve the whole load up front to
+ * keep it in a single contiguous block. Only trivially destructible types
+ * can be stored, since nothing is destroyed.
+ *
+ * Spans handed out stay valid until reset() or the arena is destroyed.
+ * Moving the arena doesn't move its blocks, so they stay valid then too.
+ */
+class GeometryArena {
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+
+    struct Stats {
+        // handed out, including alignment padding
+        std::size_t used_bytes = 0;
+        // held in blocks
+        std::size_t capacity_bytes = 0;
+        std::size_t block_count = 0;
+        std::size_t allocation_count = 0;
+    };
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t block_size;
+    Stats stats;
+
+    void *allocate_bytes(std::size_t size, std::size_t alignment);
+    void add_block(std::size_t min_size);
+
+public:
+    /**
+     * @param block_size Size of each block. Allocations bigger than this get
+     * a block of their own.
+     */
+    explicit GeometryArena(std::size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    GeometryArena(GeometryArena &&other) noexcept = default;
+    GeometryArena &operator=(GeometryArena &&other) noexcept = default;
+
+    // copies would alias the spans handed out
+    GeometryArena(const GeometryArena &other) = delete;
+    GeometryArena &operator=(const GeometryArena &other) = delete;
+
+    /**
+     * @brief Makes sure the next allocations, up to the given total, come
+     * from one contiguous block.
+     *
+     * @param bytes Total size of the upcoming allocations, including up to
+     * alignof(T) - 1 bytes of padding for each
+     */
+    void reserve(std::size_t bytes);
+
+    /**
+     * @brief Allocates value-initialized storage for count objects.
+     */
+    template <typename T>
+    std::span<T> allocate(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                "the arena never runs destructors");
+        T *data = static_cast<T *>(
+                allocate_bytes(sizeof(T) * count, alignof(T)));
+        std::uninitialized_value_construct_n(data, count);
+        return {data, count};
+    }
+
+    /**
+     * @brief Copies objects into the arena.
+     */
+    template <typename T>
+    std::span<T> copy(std::span<const T> source) {
+        static_assert(std::is_trivially_destructible_v<T>,
+                "the arena never runs destructors");
+        T *data = static_cast<T *>(
+                allocate_bytes(source.size_bytes(), alignof(T)));
+        std::uninitialized_copy(source.begin(), source.end(), data);
+        return {data, source.size()};
+    }
+
+    /**
+     * @brief Copies a mesh's vertices, indices and levels of detail into the
+     * arena, next to each other.
+     *
+     * @return A view of the copy
+     */
+    MeshView store(const MeshView &mesh);
+
+    /**
+     * @brief Copies a mapped mesh file into the arena, widening 16-bit
+     * indices, so it outlives the mapping.
+     *
+     * @param view A valid view that passes MeshFile::has_vertex_layout()
+     * @return A view of the copy
+     */
+    MeshView store(const MeshFile::View &view);
+
+    /**
+     * @brief Releases every allocation at once. The largest block is kept for
+     * the next load, the rest are freed.
+     */
+    void reset();
+
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
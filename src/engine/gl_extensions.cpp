@@ -0,0 +1,88 @@
+#include "gl_extensions.h"
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_video.h>
+
+namespace Charcoal::GlExtensions {
+PFNGLGETPROGRAMBINARYPROC get_program_binary = nullptr;
+PFNGLPROGRAMBINARYPROC program_binary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC program_parameteri = nullptr;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC max_shader_compiler_threads = nullptr;
+PFNGLCLIPCONTROLPROC clip_control = nullptr;
+
+namespace {
+Support support;
+
+template <typename Fn>
+Fn load_proc(const char *name) {
+    return reinterpret_cast<Fn>(SDL_GL_GetProcAddress(name));
+}
+} // namespace
+
+void load() {
+    support = Support{};
+
+    if (SDL_GL_ExtensionSupported("GL_EXT_texture_filter_anisotropic") ||
+            SDL_GL_ExtensionSupported("GL_ARB_texture_filter_anisotropic")) {
+        support.anisotropic_filtering = true;
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &support.max_anisotropy);
+    }
+
+    // core since 4.1, but glad only loaded 3.3 so fetch the entry points here
+    get_program_binary = nullptr;
+    program_binary = nullptr;
+    program_parameteri = nullptr;
+    if (SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+        get_program_binary =
+                load_proc<PFNGLGETPROGRAMBINARYPROC>("glGetProgramBinary");
+        program_binary = load_proc<PFNGLPROGRAMBINARYPROC>("glProgramBinary");
+        program_parameteri =
+                load_proc<PFNGLPROGRAMPARAMETERIPROC>("glProgramParameteri");
+        // some drivers expose the extension but no formats to go with it
+        GLint format_count = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        support.program_binaries = get_program_binary != nullptr &&
+                                 program_binary != nullptr &&
+                                 program_parameteri != nullptr &&
+                                 format_count > 0;
+    }
+
+    // the ARB version has the same enums, only the function name differs
+    max_shader_compiler_threads = nullptr;
+    if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        max_shader_compiler_threads =
+                load_proc<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+                        "glMaxShaderCompilerThreadsKHR");
+    } else if (SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        max_shader_compiler_threads =
+                load_proc<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(
+                        "glMaxShaderCompilerThreadsARB");
+    }
+    if (max_shader_compiler_threads != nullptr) {
+        support.parallel_shader_compile = true;
+        // let the driver pick how many threads to use
+        max_shader_compiler_threads(0xFFFFFFFF);
+    }
+
+    // core since 4.5
+    clip_control = nullptr;
+    if (SDL_GL_ExtensionSupported("GL_ARB_clip_control")) {
+        clip_control = load_proc<PFNGLCLIPCONTROLPROC>("glClipControl");
+        support.clip_control = clip_control != nullptr;
+    }
+
+    SDL_LogDebug(SDL_LOG_CATEGORY_RENDER,
+            "Anisotropic filtering: %s (max %.0fx)",
+            support.anisotropic_filtering ? "yes" : "no",
+            support.max_anisotropy);
+    SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "Program binaries: %s",
+            support.program_binaries ? "yes" : "no");
+    SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "Parallel shader compile: %s",
+            support.parallel_shader_compile ? "yes" : "no");
+    SDL_LogDebug(SDL_LOG_CATEGORY_RENDER, "Clip control: %s",
+            support.clip_control ? "yes" : "no");
+}
+
+const Support &get() {
+    return support;
+}
+} // namespace Charcoal::GlExtensions
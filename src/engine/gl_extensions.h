@@ -0,0 +1,73 @@
+#pragma once
+#include <glad/glad.h>
+
+// glad was generated for plain 3.3 core, so extension enums are defined here
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#endif
+#ifndef GL_MAX_TEXTURE_MAX_ANISOTROPY
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_NEGATIVE_ONE_TO_ONE
+#define GL_NEGATIVE_ONE_TO_ONE 0x935E
+#endif
+#ifndef GL_ZERO_TO_ONE
+#define GL_ZERO_TO_ONE 0x935F
+#endif
+
+namespace Charcoal::GlExtensions {
+/**
+ * @brief Optional driver features found by load(). Everything is false until
+ * load() has been called.
+ */
+struct Support {
+    // GL_EXT_texture_filter_anisotropic, GL_ARB_texture_filter_anisotropic
+    bool anisotropic_filtering = false;
+    float max_anisotropy = 1.0f;
+    // GL_ARB_get_program_binary, with at least one binary format
+    bool program_binaries = false;
+    // GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile
+    bool parallel_shader_compile = false;
+    // GL_ARB_clip_control, needed for a 0 to 1 clip space depth range
+    bool clip_control = false;
+};
+
+// GL_ARB_get_program_binary entry points, null when unsupported
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program,
+        GLsizei buf_size, GLsizei *length, GLenum *binary_format, void *binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program,
+        GLenum binary_format, const void *binary, GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(
+        GLuint program, GLenum pname, GLint value);
+extern PFNGLGETPROGRAMBINARYPROC get_program_binary;
+extern PFNGLPROGRAMBINARYPROC program_binary;
+extern PFNGLPROGRAMPARAMETERIPROC program_parameteri;
+
+// GL_KHR_parallel_shader_compile entry point, null when unsupported
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC max_shader_compiler_threads;
+
+// GL_ARB_clip_control entry point, null when unsupported
+typedef void(APIENTRYP PFNGLCLIPCONTROLPROC)(GLenum origin, GLenum depth);
+extern PFNGLCLIPCONTROLPROC clip_control;
+
+/**
+ * @brief Queries the current context for optional extensions and loads their
+ * entry points. Call once after gladLoadGLLoader().
+ */
+void load();
+
+const Support &get();
+} // namespace Charcoal::GlExtensions
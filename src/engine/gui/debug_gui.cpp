@@ -1,5 +1,6 @@
 #include "debug_gui.h"
 #include "../app_state.h"
+#include "../memory_tracker.h"
 #include <imgui.h>
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_sdl3.h>
@@ -12,30 +13,81 @@ void DebugGui::draw(AppState *app_state) {
     ImGui::NewFrame();
 
     // draw stuff
-    draw_fps(&app_state->config.show_fps);
+    draw_fps(app_state);
 
 
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-void DebugGui::draw_fps(bool *show) {
+void DebugGui::draw_fps(AppState *app_state) {
     ImGuiWindowFlags flags =
             ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_NoBackground |
             ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoMove |
             ImGuiWindowFlags_NoDecoration;
     ImGui::SetNextWindowPos(ImVec2{ImGui::GetMainViewport()->WorkSize.x, 0.0f},
             ImGuiCond_None, ImVec2{1.0f, 0.0f});
-    if (ImGui::Begin("debug_fps", show, flags)) {
+    if (ImGui::Begin("debug_fps", &app_state->config.show_fps, flags)) {
         ImGuiIO &io = ImGui::GetIO();
 
         // Basic info
         ImGui::Text("FPS: %.0f (avg %.3f ms/frame)", io.Framerate,
                 1000.0f / io.Framerate);
+
+        std::size_t visible = app_state->visible_meshes.size();
+        ImGui::Text("Meshes: %zu visible, %zu culled", visible,
+                app_state->scene->get_bvh().get_count() - visible);
+        const OcclusionCuller::Stats &occlusion =
+                app_state->occlusion.get_stats();
+        ImGui::Text("Occlusion: %zu of %zu hidden, %zu occluder triangles",
+                occlusion.occluded, occlusion.tested,
+                occlusion.occluder_triangles);
+        const LevelStreamer::Stats &level =
+                app_state->level_streamer->get_stats();
+        if (level.chunk_count > 0) {
+            ImGui::Text("Level: %zu of %zu chunks, %zu loading, %zu staged, "
+                        "%.2f ms uploads",
+                    level.resident_chunks, level.chunk_count,
+                    level.loads_in_flight, level.staged_chunks,
+                    level.upload_ms_this_frame);
+        }
+        const FrameArena::Stats &arena = app_state->frame_arena.get_stats();
+        ImGui::Text("Frame arena: %.1f KB/frame, %.1f KB peak, %.1f KB "
+                    "overflow",
+                static_cast<float>(arena.frame_bytes) / 1024.0f,
+                static_cast<float>(arena.high_water_bytes) / 1024.0f,
+                static_cast<float>(arena.overflow_bytes) / 1024.0f);
+        draw_memory();
     }
     ImGui::End();
 }
 
+void DebugGui::draw_memory() {
+    constexpr float MB = 1024.0f * 1024.0f;
+    namespace Tracker = MemoryTracker;
+    ImGui::Text("GPU: %.1f MB mesh buffers, %.1f MB textures",
+            static_cast<float>(Tracker::get_gpu_bytes(
+                    Tracker::GpuCategory::mesh_buffers)) /
+                    MB,
+            static_cast<float>(
+                    Tracker::get_gpu_bytes(Tracker::GpuCategory::textures)) /
+                    MB);
+    if (!Tracker::is_heap_tracked()) {
+        return;
+    }
+    const Tracker::FrameStats &frame = Tracker::get_frame_stats();
+    ImGui::Text("Heap: %zu allocations/frame (%.1f KB)", frame.allocations,
+            static_cast<float>(frame.bytes) / 1024.0f);
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Tracker::Tag::count);
+            ++i) {
+        Tracker::Tag tag = static_cast<Tracker::Tag>(i);
+        Tracker::Totals totals = Tracker::get_totals(tag);
+        ImGui::Text("  %s: %.1f MB in %zu allocations", Tracker::get_name(tag),
+                static_cast<float>(totals.live_bytes) / MB,
+                totals.live_count);
+    }
+}
+
 ImGuiStyle DebugGui::default_style() {
     ImGuiStyle style = ImGuiStyle();
     return style;
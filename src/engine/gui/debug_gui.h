@@ -7,7 +7,8 @@ struct AppState;
 
 namespace Charcoal::Gui {
 class DebugGui {
-    void draw_fps(bool *show);
+    void draw_fps(AppState *app_state);
+    void draw_memory();
 public:
     void draw(AppState* app_state);
     static ImGuiStyle default_style();
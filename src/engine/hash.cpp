@@ -0,0 +1,22 @@
+#include "hash.h"
+
+namespace Charcoal::Hash {
+uint64_t fnv1a64(const void *data, std::size_t size, uint64_t seed) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t fnv1a64(std::string_view str, uint64_t seed) {
+    return fnv1a64(str.data(), str.size(), seed);
+}
+
+uint64_t combine(uint64_t a, uint64_t b) {
+    // boost::hash_combine, widened to 64 bits
+    return a ^ (b + 0x9e3779b97f4a7c15ULL + (a << 12) + (a >> 4));
+}
+} // namespace Charcoal::Hash
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Charcoal::Hash {
+static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+static constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash of a block of memory.
+ *
+ * @param data Pointer to the bytes to hash
+ * @param size Number of bytes to hash
+ * @param seed Starting hash value. Pass a previous result to continue hashing
+ * across multiple blocks.
+ * @return The 64-bit hash
+ */
+uint64_t fnv1a64(const void *data, std::size_t size,
+        uint64_t seed = FNV_OFFSET_BASIS);
+
+/**
+ * @brief Computes the 64-bit FNV-1a hash of a string.
+ *
+ * @param str The string to hash
+ * @param seed Starting hash value
+ * @return The 64-bit hash
+ */
+uint64_t fnv1a64(std::string_view str, uint64_t seed = FNV_OFFSET_BASIS);
+
+/**
+ * @brief Mixes two hashes into one. Order matters.
+ *
+ * @param a The first hash
+ * @param b The second hash
+ * @return The combined hash
+ */
+uint64_t combine(uint64_t a, uint64_t b);
+} // namespace Charcoal::Hash
@@ -0,0 +1,415 @@
+#include "json.h"
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+namespace Charcoal::Json {
+namespace {
+// deeper documents are rejected rather than overflowing the stack
+constexpr int MAX_DEPTH = 256;
+
+const Value NULL_VALUE{};
+
+void append_utf8(std::string &out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+template <typename T>
+void append_floating(std::string &out, T value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+} // namespace
+
+class Parser {
+    std::string_view text;
+    std::size_t pos = 0;
+    std::string message;
+
+    bool fail(const char *what) {
+        if (message.empty()) {
+            int line = 1;
+            for (std::size_t i = 0; i < pos && i < text.size(); ++i) {
+                line += text[i] == '\n';
+            }
+            char buffer[128];
+            std::snprintf(buffer, sizeof(buffer), "line %d: %s", line, what);
+            message = buffer;
+        }
+        return false;
+    }
+
+    void skip_whitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' ||
+                                            text[pos] == '\n' ||
+                                            text[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    bool consume(std::string_view literal) {
+        if (text.substr(pos, literal.size()) != literal) {
+            return false;
+        }
+        pos += literal.size();
+        return true;
+    }
+
+    bool parse_hex4(uint32_t &out) {
+        if (text.size() - pos < 4) {
+            return fail("truncated \\u escape");
+        }
+        auto [end, ec] = std::from_chars(
+                text.data() + pos, text.data() + pos + 4, out, 16);
+        if (ec != std::errc{} || end != text.data() + pos + 4) {
+            return fail("invalid \\u escape");
+        }
+        pos += 4;
+        return true;
+    }
+
+    bool parse_string(std::string &out) {
+        // the opening quote has been checked by the caller
+        ++pos;
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return fail("control character in string");
+            }
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos >= text.size()) {
+                break;
+            }
+            switch (text[pos++]) {
+            case '"':
+                out.push_back('"');
+                break;
+            case '\\':
+                out.push_back('\\');
+                break;
+            case '/':
+                out.push_back('/');
+                break;
+            case 'b':
+                out.push_back('\b');
+                break;
+            case 'f':
+                out.push_back('\f');
+                break;
+            case 'n':
+                out.push_back('\n');
+                break;
+            case 'r':
+                out.push_back('\r');
+                break;
+            case 't':
+                out.push_back('\t');
+                break;
+            case 'u': {
+                uint32_t code_point = 0;
+                if (!parse_hex4(code_point)) {
+                    return false;
+                }
+                // characters outside the BMP come as a surrogate pair
+                if (code_point >= 0xD800 && code_point < 0xDC00 &&
+                        consume("\\u")) {
+                    uint32_t low = 0;
+                    if (!parse_hex4(low)) {
+                        return false;
+                    }
+                    if (low < 0xDC00 || low >= 0xE000) {
+                        return fail("invalid surrogate pair");
+                    }
+                    code_point =
+                            0x10000 + ((code_point - 0xD800) << 10) +
+                            (low - 0xDC00);
+                }
+                append_utf8(out, code_point);
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parse_number(double &out) {
+        // from_chars doesn't take a leading '+', and neither does JSON
+        const char *begin = text.data() + pos;
+        auto [end, ec] = std::from_chars(begin, text.data() + text.size(), out);
+        if (ec != std::errc{} || end == begin) {
+            return fail("invalid number");
+        }
+        pos += static_cast<std::size_t>(end - begin);
+        return true;
+    }
+
+    bool parse_value(Value &out, int depth) {
+        if (depth > MAX_DEPTH) {
+            return fail("nested too deeply");
+        }
+        skip_whitespace();
+        if (pos >= text.size()) {
+            return fail("unexpected end of input");
+        }
+        char c = text[pos];
+        if (c == '{') {
+            ++pos;
+            out.type = Value::Type::object;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                ++pos;
+                return true;
+            }
+            while (true) {
+                skip_whitespace();
+                if (pos >= text.size() || text[pos] != '"') {
+                    return fail("expected a member name");
+                }
+                std::pair<std::string, Value> &member =
+                        out.object.emplace_back();
+                if (!parse_string(member.first)) {
+                    return false;
+                }
+                skip_whitespace();
+                if (!consume(":")) {
+                    return fail("expected ':'");
+                }
+                if (!parse_value(member.second, depth + 1)) {
+                    return false;
+                }
+                skip_whitespace();
+                if (consume("}")) {
+                    return true;
+                }
+                if (!consume(",")) {
+                    return fail("expected ',' or '}'");
+                }
+            }
+        }
+        if (c == '[') {
+            ++pos;
+            out.type = Value::Type::array;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                ++pos;
+                return true;
+            }
+            while (true) {
+                if (!parse_value(out.array.emplace_back(), depth + 1)) {
+                    return false;
+                }
+                skip_whitespace();
+                if (consume("]")) {
+                    return true;
+                }
+                if (!consume(",")) {
+                    return fail("expected ',' or ']'");
+                }
+            }
+        }
+        if (c == '"') {
+            out.type = Value::Type::string;
+            return parse_string(out.string);
+        }
+        if (consume("true")) {
+            out.type = Value::Type::boolean;
+            out.boolean = true;
+            return true;
+        }
+        if (consume("false")) {
+            out.type = Value::Type::boolean;
+            out.boolean = false;
+            return true;
+        }
+        if (consume("null")) {
+            out.type = Value::Type::null;
+            return true;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            out.type = Value::Type::number;
+            return parse_number(out.number);
+        }
+        return fail("unexpected character");
+    }
+
+public:
+    explicit Parser(std::string_view text) : text{text} {
+    }
+
+    bool parse(Value &out) {
+        if (!parse_value(out, 0)) {
+            return false;
+        }
+        skip_whitespace();
+        if (pos != text.size()) {
+            return fail("trailing characters after the document");
+        }
+        return true;
+    }
+
+    const std::string &get_message() const {
+        return message;
+    }
+};
+
+Value::Type Value::get_type() const {
+    return type;
+}
+
+bool Value::is_null() const {
+    return type == Type::null;
+}
+
+bool Value::is_number() const {
+    return type == Type::number;
+}
+
+bool Value::is_string() const {
+    return type == Type::string;
+}
+
+bool Value::is_array() const {
+    return type == Type::array;
+}
+
+bool Value::is_object() const {
+    return type == Type::object;
+}
+
+bool Value::as_bool(bool fallback) const {
+    return type == Type::boolean ? boolean : fallback;
+}
+
+double Value::as_number(double fallback) const {
+    return type == Type::number ? number : fallback;
+}
+
+int64_t Value::as_int(int64_t fallback) const {
+    return type == Type::number ? static_cast<int64_t>(number) : fallback;
+}
+
+std::string_view Value::as_string(std::string_view fallback) const {
+    return type == Type::string ? std::string_view{string} : fallback;
+}
+
+std::size_t Value::size() const {
+    switch (type) {
+    case Type::array:
+        return array.size();
+    case Type::object:
+        return object.size();
+    default:
+        return 0;
+    }
+}
+
+const Value &Value::operator[](std::size_t index) const {
+    if (type != Type::array || index >= array.size()) {
+        return NULL_VALUE;
+    }
+    return array[index];
+}
+
+const Value &Value::operator[](std::string_view key) const {
+    for (const auto &[name, value] : object) {
+        if (name == key) {
+            return value;
+        }
+    }
+    return NULL_VALUE;
+}
+
+bool Value::contains(std::string_view key) const {
+    for (const auto &[name, value] : object) {
+        if (name == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<std::pair<std::string, Value>> &Value::get_members() const {
+    return object;
+}
+
+bool parse(std::string_view text, Value &out, std::string *error) {
+    out = Value{};
+    Parser parser{text};
+    if (!parser.parse(out)) {
+        out = Value{};
+        if (error != nullptr) {
+            *error = parser.get_message();
+        }
+        return false;
+    }
+    return true;
+}
+
+void append_string(std::string &out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "\\u%04x",
+                        static_cast<unsigned int>(c));
+                out += escape;
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+void append_number(std::string &out, double value) {
+    append_floating(out, value);
+}
+
+void append_number(std::string &out, float value) {
+    append_floating(out, value);
+}
+} // namespace Charcoal::Json
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Charcoal::Json {
+/**
+ * @class Value
+ * @brief A parsed JSON document or one of its parts.
+ *
+ * Lookups never fail: asking an object for a missing key, an array for an
+ * index past its end, or a value for the wrong type gives null (or the
+ * fallback), so optional fields can be read without checking each step.
+ */
+class Value {
+public:
+    enum class Type { null, boolean, number, string, array, object };
+
+private:
+    Type type = Type::null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<Value> array;
+    // in document order. Objects in the files we read are small, so lookups
+    // scan instead of hashing
+    std::vector<std::pair<std::string, Value>> object;
+
+    friend class Parser;
+
+public:
+    Type get_type() const;
+    bool is_null() const;
+    bool is_number() const;
+    bool is_string() const;
+    bool is_array() const;
+    bool is_object() const;
+
+    bool as_bool(bool fallback = false) const;
+    double as_number(double fallback = 0.0) const;
+    // truncates towards zero
+    int64_t as_int(int64_t fallback = 0) const;
+    std::string_view as_string(std::string_view fallback = {}) const;
+
+    /**
+     * @brief Returns the number of elements of an array or members of an
+     * object, 0 for anything else.
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief Returns an array element, or null if out of range.
+     */
+    const Value &operator[](std::size_t index) const;
+
+    /**
+     * @brief Returns an object member, or null if missing.
+     */
+    const Value &operator[](std::string_view key) const;
+
+    bool contains(std::string_view key) const;
+
+    /**
+     * @brief Returns an object's members in document order.
+     */
+    const std::vector<std::pair<std::string, Value>> &get_members() const;
+};
+
+/**
+ * @brief Parses a complete JSON document (RFC 8259).
+ *
+ * @param text The document
+ * @param out Receives the parsed value. Null on failure.
+ * @param error If not null, receives a description of the first problem,
+ * with its line number
+ * @return True on success
+ */
+bool parse(std::string_view text, Value &out, std::string *error = nullptr);
+
+/**
+ * @brief Appends text as a JSON string, quoted and escaped.
+ */
+void append_string(std::string &out, std::string_view text);
+
+/**
+ * @brief Appends a number in its shortest form that parses back to the same
+ * value. Infinities and NaN aren't valid JSON and become null.
+ */
+void append_number(std::string &out, double value);
+void append_number(std::string &out, float value);
+} // namespace Charcoal::Json
@@ -0,0 +1,403 @@
+#include "level_streamer.h"
+#include "json.h"
+#include "mapped_file.h"
+#include "memory_tracker.h"
+#include "scene.h"
+#include "scene_file.h"
+#include "thread_pool.h"
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+#include <algorithm>
+#include <chrono>
+#include <string_view>
+#include <utility>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace Charcoal {
+namespace {
+template <typename T>
+bool is_ready(const std::future<T> &future) {
+    return future.wait_for(std::chrono::seconds{0}) ==
+           std::future_status::ready;
+}
+
+// distance from a point to a rectangle, 0 inside it
+float distance_to(
+        const glm::vec2 &point, const glm::vec2 &min, const glm::vec2 &max) {
+    return glm::length(point - glm::clamp(point, min, max));
+}
+
+// a path from a level file, relative to the directory it's in unless it's
+// absolute
+std::string resolve(const std::string &directory, const std::string &path) {
+    if (path.starts_with('/') || path.starts_with('\\')) {
+        return path;
+    }
+    return directory + path;
+}
+
+// frees memory on a worker, so large frees don't land on the frame
+template <typename T>
+void free_on(ThreadPool *pool, T value) {
+    pool->submit([value = std::move(value)] {});
+}
+} // namespace
+
+LevelStreamer::LevelStreamer(ThreadPool *pool, Scene *scene,
+        AssetManager *assets, Config config) :
+        config{config}, pool{pool}, scene{scene}, assets{assets} {
+}
+
+LevelStreamer::~LevelStreamer() noexcept {
+    close();
+}
+
+bool LevelStreamer::open(const char *path) {
+    MappedFile file{path};
+    if (!file.is_valid()) {
+        return false;
+    }
+    Json::Value json;
+    std::string message;
+    if (!Json::parse({reinterpret_cast<const char *>(file.get_data()),
+                             file.get_size()},
+                json, &message)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to parse level \"%s\": %s", path, message.c_str());
+        return false;
+    }
+    if (json["format"].as_string() != FORMAT) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is not a level",
+                path);
+        return false;
+    }
+    if (json["version"].as_int() != VERSION) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Level \"%s\" has version %lld, expected %u", path,
+                static_cast<long long>(json["version"].as_int()), VERSION);
+        return false;
+    }
+    auto chunk_size = static_cast<float>(json["chunk_size"].as_number());
+    if (!(chunk_size > 0.0f)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Level \"%s\" has no chunk size", path);
+        return false;
+    }
+
+    std::vector<Chunk> level;
+    const Json::Value &entries = json["chunks"];
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+        const Json::Value &entry = entries[i];
+        const Json::Value &cell = entry["cell"];
+        if (cell.size() != 2 || !entry["scene"].is_string()) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Chunk %zu of level \"%s\" needs a cell and a scene", i,
+                    path);
+            return false;
+        }
+        Chunk &chunk = level.emplace_back();
+        chunk.scene_path = entry["scene"].as_string();
+        chunk.min = glm::vec2{static_cast<float>(cell[0].as_int()),
+                            static_cast<float>(cell[1].as_int())} *
+                    chunk_size;
+        chunk.max = chunk.min + glm::vec2{chunk_size};
+    }
+
+    close();
+    std::string_view full_path{path};
+    std::size_t slash = full_path.find_last_of("/\\");
+    directory = slash == std::string_view::npos
+                        ? std::string{}
+                        : std::string{full_path.substr(0, slash + 1)};
+    chunks = std::move(level);
+    stats.chunk_count = chunks.size();
+    return true;
+}
+
+LevelStreamer::LoadResult LevelStreamer::load_chunk(
+        std::string path, std::string directory) {
+    MemoryTracker::TagScope tag{MemoryTracker::Tag::scene};
+    LoadResult result;
+    Scene::register_components(result.world);
+    if (SceneFile::read(path.c_str(), result.world, result.mesh_names) !=
+            SceneFile::Error::none) {
+        return result;
+    }
+
+    // mesh files are copied here rather than on the render thread. Meshes
+    // other chunks already loaded are read again and dropped on arrival,
+    // since workers can't see what's resident
+    MemoryTracker::TagScope mesh_tag{MemoryTracker::Tag::mesh};
+    result.meshes.resize(result.mesh_names.size());
+    for (std::size_t i = 0; i < result.mesh_names.size(); ++i) {
+        std::string &name = result.mesh_names[i];
+        if (name.starts_with(Scene::BUILTIN_MESH_PREFIX)) {
+            continue;
+        }
+        // like the chunk's own path. The resolved path names the mesh from
+        // here on, so chunks in different directories can't mix up theirs
+        name = resolve(directory, name);
+        auto file = std::make_unique<MeshFile::Reader>(name.c_str());
+        if (!file->is_valid()) {
+            continue;
+        }
+        if (!MeshFile::has_vertex_layout(file->get_view())) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Mesh \"%s\" isn't in the engine's vertex layout",
+                    name.c_str());
+            continue;
+        }
+        LoadedMesh &mesh = result.meshes[i];
+        mesh.view = mesh.geometry.store(file->get_view());
+        mesh.file = std::move(file);
+    }
+    result.valid = true;
+    return result;
+}
+
+void LevelStreamer::update(const glm::vec3 &focus) {
+    glm::vec2 focus_xz{focus.x, focus.z};
+    // unload first, so loads this frame have the memory
+    for (Chunk &chunk : chunks) {
+        if (chunk.state != State::unloaded &&
+                distance_to(focus_xz, chunk.min, chunk.max) >
+                        config.unload_radius) {
+            unload(chunk);
+        }
+    }
+    std::erase_if(abandoned, [this](std::future<LoadResult> &load) {
+        if (!is_ready(load)) {
+            return false;
+        }
+        // a whole chunk's world and mapped mesh files
+        free_on(pool, load.get());
+        return true;
+    });
+
+    receive_loads();
+    start_loads(focus_xz);
+    upload_staged();
+
+    stats.resident_chunks = 0;
+    stats.staged_chunks = 0;
+    for (const Chunk &chunk : chunks) {
+        if (chunk.state == State::staged) {
+            ++stats.staged_chunks;
+        } else if (chunk.state == State::resident) {
+            ++stats.resident_chunks;
+        }
+    }
+    stats.resident_meshes = meshes.size();
+}
+
+void LevelStreamer::start_loads(const glm::vec2 &focus) {
+    if (stats.loads_in_flight >= config.max_loads_in_flight) {
+        return;
+    }
+    // nearest first
+    std::vector<std::pair<float, std::size_t>> wanted;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        const Chunk &chunk = chunks[i];
+        float distance = distance_to(focus, chunk.min, chunk.max);
+        if (chunk.state == State::unloaded &&
+                distance <= config.load_radius) {
+            wanted.emplace_back(distance, i);
+        }
+    }
+    std::size_t count = std::min(wanted.size(),
+            config.max_loads_in_flight - stats.loads_in_flight);
+    std::partial_sort(wanted.begin(), wanted.begin() + count, wanted.end());
+    for (std::size_t i = 0; i < count; ++i) {
+        Chunk &chunk = chunks[wanted[i].second];
+        chunk.pending = pool->submit(
+                [path = resolve(directory, chunk.scene_path),
+                        directory = directory] {
+                    return load_chunk(path, directory);
+                });
+        chunk.state = State::loading;
+        ++stats.loads_in_flight;
+    }
+}
+
+void LevelStreamer::receive_loads() {
+    for (Chunk &chunk : chunks) {
+        if (chunk.state != State::loading || !is_ready(chunk.pending)) {
+            continue;
+        }
+        --stats.loads_in_flight;
+        stage(chunk, chunk.pending.get());
+    }
+}
+
+void LevelStreamer::stage(Chunk &chunk, LoadResult result) {
+    if (!result.valid) {
+        // counted as resident so it isn't retried every frame. It's tried
+        // again once it goes out of range and back
+        chunk.state = State::resident;
+        return;
+    }
+
+    for (std::size_t i = 0; i < result.mesh_names.size(); ++i) {
+        const std::string &name = result.mesh_names[i];
+        auto it = meshes.find(name);
+        if (it != meshes.end()) {
+            ++it->second.references;
+            chunk.meshes.push_back(name);
+            chunk.mesh_of_name.push_back(it->second.scene_mesh);
+            continue;
+        }
+        // builtin meshes, and ones the scene loaded itself
+        uint32_t existing = scene->get_mesh_index(name);
+        if (existing != Scene::NO_MESH) {
+            chunk.mesh_of_name.push_back(existing);
+            continue;
+        }
+        LoadedMesh &loaded = result.meshes[i];
+        if (loaded.file == nullptr) {
+            // the worker logged why
+            chunk.mesh_of_name.push_back(0);
+            continue;
+        }
+        Mesh &mesh = meshes[name];
+        mesh.references = 1;
+        mesh.geometry = std::move(loaded.geometry);
+        mesh.scene_mesh = scene->add_mesh(name, loaded.view);
+        if (assets != nullptr) {
+            mesh.file = std::move(loaded.file);
+            upload_queue.push_back(name);
+        }
+        chunk.meshes.push_back(name);
+        chunk.mesh_of_name.push_back(mesh.scene_mesh);
+    }
+    // duplicates of meshes that were already resident
+    free_on(pool, std::move(result.meshes));
+    chunk.staged = std::make_unique<LoadResult>(std::move(result));
+    chunk.state = State::staged;
+}
+
+void LevelStreamer::upload_staged() {
+    uint64_t start = SDL_GetTicksNS();
+    auto budget_ns = static_cast<uint64_t>(
+            std::max(config.upload_budget_ms, 0.0f) * 1'000'000.0f);
+    stats.uploads_this_frame = 0;
+    // meshes go first, since chunks wait for theirs before spawning
+    do {
+        if (!upload_next_mesh() && !spawn_next_chunk()) {
+            break;
+        }
+    } while (SDL_GetTicksNS() - start < budget_ns);
+    stats.upload_ms_this_frame =
+            static_cast<float>(SDL_GetTicksNS() - start) / 1'000'000.0f;
+}
+
+bool LevelStreamer::upload_next_mesh() {
+    while (!upload_queue.empty()) {
+        std::string name = std::move(upload_queue.front());
+        upload_queue.pop_front();
+        auto it = meshes.find(name);
+        if (it == meshes.end() || it->second.file == nullptr) {
+            // unloaded before its turn came
+            continue;
+        }
+        Mesh &mesh = it->second;
+        mesh.gpu = assets->load_mesh(name.c_str(), mesh.file->get_view());
+        // the upload copied it, so the file can be unmapped
+        mesh.file.reset();
+        if (gpu_meshes.size() <= mesh.scene_mesh) {
+            gpu_meshes.resize(mesh.scene_mesh + 1);
+        }
+        gpu_meshes[mesh.scene_mesh] = mesh.gpu;
+        ++stats.uploads_this_frame;
+        return true;
+    }
+    return false;
+}
+
+bool LevelStreamer::spawn_next_chunk() {
+    for (Chunk &chunk : chunks) {
+        if (chunk.state != State::staged ||
+                std::ranges::any_of(chunk.meshes, [&](const std::string &name) {
+                    return meshes.at(name).file != nullptr;
+                })) {
+            continue;
+        }
+        scene->spawn_world(
+                chunk.staged->world, chunk.mesh_of_name, chunk.entities);
+        free_on(pool, std::move(chunk.staged));
+        stats.object_count += chunk.entities.size();
+        chunk.state = State::resident;
+        return true;
+    }
+    return false;
+}
+
+void LevelStreamer::unload(Chunk &chunk) {
+    switch (chunk.state) {
+    case State::unloaded:
+        return;
+    case State::loading:
+        // waiting would stall the frame on the read
+        abandoned.push_back(std::move(chunk.pending));
+        --stats.loads_in_flight;
+        break;
+    case State::staged:
+        free_on(pool, std::move(chunk.staged));
+        break;
+    case State::resident:
+        for (Entity entity : chunk.entities) {
+            scene->despawn(entity);
+        }
+        stats.object_count -= chunk.entities.size();
+        break;
+    }
+    // objects go before the meshes they use
+    for (const std::string &name : chunk.meshes) {
+        release_mesh(name);
+    }
+    chunk.mesh_of_name.clear();
+    chunk.meshes.clear();
+    chunk.entities.clear();
+    chunk.state = State::unloaded;
+}
+
+void LevelStreamer::release_mesh(const std::string &name) {
+    auto it = meshes.find(name);
+    if (it == meshes.end() || --it->second.references > 0) {
+        return;
+    }
+    Mesh &mesh = it->second;
+    scene->remove_mesh(mesh.scene_mesh);
+    if (mesh.scene_mesh < gpu_meshes.size()) {
+        // the asset manager evicts it once it's over budget
+        gpu_meshes[mesh.scene_mesh].reset();
+    }
+    free_on(pool, std::move(mesh.geometry));
+    meshes.erase(it);
+}
+
+void LevelStreamer::close() {
+    for (Chunk &chunk : chunks) {
+        unload(chunk);
+    }
+    for (std::future<LoadResult> &load : abandoned) {
+        free_on(pool, load.get());
+    }
+    abandoned.clear();
+    chunks.clear();
+    upload_queue.clear();
+    stats = Stats{};
+}
+
+GpuMesh *LevelStreamer::get_gpu_mesh(uint32_t scene_mesh) const {
+    if (scene_mesh >= gpu_meshes.size() || gpu_meshes[scene_mesh] == nullptr ||
+            !gpu_meshes[scene_mesh]->is_valid()) {
+        return nullptr;
+    }
+    return gpu_meshes[scene_mesh].get();
+}
+
+const LevelStreamer::Stats &LevelStreamer::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
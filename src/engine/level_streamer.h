@@ -0,0 +1,192 @@
+#pragma once
+#include "asset_manager.h"
+#include "ecs.h"
+#include "geometry_arena.h"
+#include "mesh_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace Charcoal {
+class Scene;
+class ThreadPool;
+
+/**
+ * @class LevelStreamer
+ * @brief Streams a level too big to load at once into a Scene, a chunk at a
+ * time, as the camera moves.
+ *
+ * A level is a JSON manifest that splits the world into square cells on the
+ * xz plane, each with a scene file:
+ *
+ *   {"format": "charcoal-level", "version": 1, "chunk_size": 64,
+ *    "chunks": [{"cell": [0, 0], "scene": "chunks/0_0.cscn"}]}
+ *
+ * Paths are relative to the manifest, both the chunks' scene files and the
+ * mesh files those name. Chunks within the load radius of the focus are read
+ * on worker threads, scene file and mesh files both, and chunks beyond the
+ * unload radius are dropped. On the render thread, update()
+ * uploads the meshes of arrived chunks and then adds their objects to the
+ * scene, spending at most the upload budget per frame so a load never stalls
+ * the frame. Objects have no materials of their own yet, so chunks don't
+ * name textures.
+ *
+ * Meshes shared by several chunks are uploaded once and freed with the last
+ * chunk that uses them. The scene's other objects are left alone, but
+ * Scene::load() must not be used while a level is open.
+ */
+class LevelStreamer {
+public:
+    static constexpr uint32_t VERSION = 1;
+    // names the manifest's "format" member
+    static constexpr const char *FORMAT = "charcoal-level";
+
+    struct Config {
+        // chunks closer than this to the focus are loaded
+        float load_radius = 256.0f;
+        // and farther than this unloaded. Larger than load_radius, so chunks
+        // on the edge don't flicker in and out
+        float unload_radius = 320.0f;
+        // render thread time spent uploading and spawning per frame. At
+        // least one upload or chunk happens every frame, so loads always
+        // make progress
+        float upload_budget_ms = 2.0f;
+        // chunks read on workers at once
+        std::size_t max_loads_in_flight = 4;
+    };
+
+    struct Stats {
+        std::size_t chunk_count = 0;
+        std::size_t resident_chunks = 0;
+        std::size_t loads_in_flight = 0;
+        // arrived chunks waiting on uploads or to be spawned
+        std::size_t staged_chunks = 0;
+        std::size_t resident_meshes = 0;
+        std::size_t object_count = 0;
+        std::size_t uploads_this_frame = 0;
+        float upload_ms_this_frame = 0.0f;
+    };
+
+private:
+    // a mesh file read on a worker
+    struct LoadedMesh {
+        // copied here for culling and bounds. store() reserves the exact
+        // size, so no block size is needed
+        GeometryArena geometry{1};
+        MeshView view;
+        // kept mapped until it's uploaded, null if the mesh is builtin or
+        // failed to load
+        std::unique_ptr<MeshFile::Reader> file;
+    };
+
+    // a chunk read on a worker
+    struct LoadResult {
+        bool valid = false;
+        World world;
+        std::vector<std::string> mesh_names;
+        // parallel to mesh_names
+        std::vector<LoadedMesh> meshes;
+    };
+
+    enum class State { unloaded, loading, staged, resident };
+
+    struct Chunk {
+        std::string scene_path;
+        // the cell, on the xz plane
+        glm::vec2 min{0.0f};
+        glm::vec2 max{0.0f};
+        State state = State::unloaded;
+        std::future<LoadResult> pending;
+        // arrived, until its objects are spawned
+        std::unique_ptr<LoadResult> staged;
+        // scene mesh of each of the chunk's mesh names
+        std::vector<uint32_t> mesh_of_name;
+        // names of the meshes this chunk holds a reference on
+        std::vector<std::string> meshes;
+        std::vector<Entity> entities;
+    };
+
+    // a mesh owned by the streamer, shared by the chunks that use it
+    struct Mesh {
+        uint32_t scene_mesh = 0;
+        uint32_t references = 0;
+        GeometryArena geometry{1};
+        // waiting for upload while not null
+        std::unique_ptr<MeshFile::Reader> file;
+        MeshHandle gpu;
+    };
+
+    std::vector<Chunk> chunks;
+    std::unordered_map<std::string, Mesh> meshes;
+    // scene mesh -> GPU mesh, null until uploaded
+    std::vector<MeshHandle> gpu_meshes;
+    // names of meshes waiting for upload, oldest first
+    std::deque<std::string> upload_queue;
+    // loads of chunks unloaded before they arrived, dropped once they finish
+    std::vector<std::future<LoadResult>> abandoned;
+    std::string directory;
+    Config config;
+    ThreadPool *pool;
+    Scene *scene;
+    AssetManager *assets;
+    Stats stats;
+
+    // mesh paths in the chunk are resolved against directory
+    static LoadResult load_chunk(std::string path, std::string directory);
+
+    void start_loads(const glm::vec2 &focus);
+    void receive_loads();
+    void stage(Chunk &chunk, LoadResult result);
+    // uploads staged meshes and spawns chunks until the budget runs out
+    void upload_staged();
+    bool upload_next_mesh();
+    bool spawn_next_chunk();
+    void unload(Chunk &chunk);
+    void release_mesh(const std::string &name);
+    void close();
+
+public:
+    /**
+     * @param pool Worker threads that read chunks
+     * @param scene Objects are spawned into it
+     * @param assets Uploads meshes. May be null to only stream the CPU side.
+     */
+    LevelStreamer(ThreadPool *pool, Scene *scene, AssetManager *assets,
+            Config config);
+    ~LevelStreamer() noexcept;
+
+    LevelStreamer(const LevelStreamer &other) = delete;
+    LevelStreamer &operator=(const LevelStreamer &other) = delete;
+
+    /**
+     * @brief Opens a level manifest, unloading the previous level. Nothing is
+     * loaded until update().
+     *
+     * @return True on success. Failures are logged.
+     */
+    bool open(const char *path);
+
+    /**
+     * @brief Loads and unloads chunks around the focus, then spends the
+     * frame's upload budget. Call once per frame on the render thread.
+     *
+     * @param focus Usually the camera position
+     */
+    void update(const glm::vec3 &focus);
+
+    /**
+     * @brief Returns the GPU copy of a scene mesh the streamer owns, or null
+     * if it isn't uploaded or the streamer doesn't own it.
+     */
+    GpuMesh *get_gpu_mesh(uint32_t scene_mesh) const;
+
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,162 @@
+#include "mapped_file.h"
+#include <SDL3/SDL_log.h>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Charcoal {
+MappedFile::MappedFile() :
+        data{nullptr}, size{0}
+#ifdef _WIN32
+        ,
+        file{nullptr}, mapping{nullptr}
+#endif
+{
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const char *path) : MappedFile{} {
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to open \"%s\" for mapping: error %lu", path,
+                GetLastError());
+        return;
+    }
+    file = handle;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to map \"%s\": empty or unreadable", path);
+        close();
+        return;
+    }
+
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to map \"%s\": error %lu", path, GetLastError());
+        close();
+        return;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to map \"%s\": error %lu", path, GetLastError());
+        close();
+        return;
+    }
+    data = static_cast<const std::byte *>(view);
+    size = static_cast<std::size_t>(file_size.QuadPart);
+}
+
+void MappedFile::close() {
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != nullptr) {
+        CloseHandle(mapping);
+    }
+    if (file != nullptr) {
+        CloseHandle(file);
+    }
+    data = nullptr;
+    size = 0;
+    mapping = nullptr;
+    file = nullptr;
+}
+#else
+MappedFile::MappedFile(const char *path) : MappedFile{} {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to open \"%s\" for mapping: %s", path,
+                std::strerror(errno));
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to map \"%s\": empty or unreadable", path);
+        ::close(fd);
+        return;
+    }
+
+    void *view = mmap(nullptr, static_cast<std::size_t>(info.st_size),
+            PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to map \"%s\": %s",
+                path, std::strerror(errno));
+        return;
+    }
+    data = static_cast<const std::byte *>(view);
+    size = static_cast<std::size_t>(info.st_size);
+    // it'll mostly be read front to back, straight into GL buffers
+    madvise(view, size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::close() {
+    if (data != nullptr) {
+        munmap(const_cast<std::byte *>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+}
+#endif
+
+MappedFile::MappedFile(MappedFile &&other) noexcept :
+        data{std::exchange(other.data, nullptr)},
+        size{std::exchange(other.size, 0)}
+#ifdef _WIN32
+        ,
+        file{std::exchange(other.file, nullptr)},
+        mapping{std::exchange(other.mapping, nullptr)}
+#endif
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+#ifdef _WIN32
+        file = std::exchange(other.file, nullptr);
+        mapping = std::exchange(other.mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() noexcept {
+    close();
+}
+
+bool MappedFile::is_valid() const {
+    return data != nullptr;
+}
+
+const std::byte *MappedFile::get_data() const {
+    return data;
+}
+
+std::size_t MappedFile::get_size() const {
+    return size;
+}
+} // namespace Charcoal
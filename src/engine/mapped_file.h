@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+
+namespace Charcoal {
+/**
+ * @class MappedFile
+ * @brief A read-only memory mapping of a whole file. Pages are read from disk
+ * the first time they're touched, so nothing is copied up front.
+ *
+ * The mapping is private: writes to the file by other processes while it's
+ * mapped may or may not show up.
+ */
+class MappedFile {
+    const std::byte *data;
+    std::size_t size;
+#ifdef _WIN32
+    // HANDLEs, kept as void * to keep windows.h out of the header
+    void *file;
+    void *mapping;
+#endif
+
+    void close();
+
+public:
+    MappedFile();
+
+    /**
+     * @brief Maps the file at the given path. Logs and leaves the mapping
+     * invalid if the file can't be opened or is empty.
+     *
+     * @param path Path to the file
+     */
+    explicit MappedFile(const char *path);
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // the mapping has a single owner
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    ~MappedFile() noexcept;
+
+    bool is_valid() const;
+    const std::byte *get_data() const;
+    std::size_t get_size() const;
+};
+} // namespace Charcoal
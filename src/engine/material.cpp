@@ -0,0 +1,12 @@
+#include "material.h"
+
+namespace Charcoal {
+void Material::bind(SamplerCache &samplers) const {
+    for (std::size_t i = 0; i < textures.size(); ++i) {
+        GLuint unit = static_cast<GLuint>(i);
+        glActiveTexture(GL_TEXTURE0 + unit);
+        textures[i].texture->bind();
+        samplers.bind(unit, textures[i].sampler);
+    }
+}
+} // namespace Charcoal
@@ -0,0 +1,32 @@
+#pragma once
+#include "asset_manager.h"
+#include "sampler.h"
+#include "shader_permutations.h"
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class Material
+ * @brief The textures an object is drawn with, how each one is filtered, and
+ * which shader features it needs.
+ * Filtering lives here rather than on the texture, so the same texture can be
+ * sampled differently by different materials.
+ */
+struct Material {
+    struct TextureSlot {
+        TextureHandle texture;
+        SamplerDesc sampler;
+    };
+
+    // bound to consecutive texture units, starting at GL_TEXTURE0
+    std::vector<TextureSlot> textures;
+    // shader variant to draw with, see ShaderPermutations
+    ShaderFeatures shader_features = ShaderFeature::none;
+
+    /**
+     * @brief Binds every texture and its sampler to its texture unit.
+     * @param samplers Cache the sampler objects are taken from
+     */
+    void bind(SamplerCache &samplers) const;
+};
+} // namespace Charcoal
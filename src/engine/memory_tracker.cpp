@@ -0,0 +1,311 @@
+#include "memory_tracker.h"
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace Charcoal::MemoryTracker {
+namespace {
+struct Counters {
+    std::atomic<std::size_t> live_bytes{0};
+    std::atomic<std::size_t> live_count{0};
+    std::atomic<std::size_t> total_bytes{0};
+    std::atomic<std::size_t> total_count{0};
+};
+
+// constant-initialized, so they work for allocations made before main()
+constinit std::array<Counters, static_cast<std::size_t>(Tag::count)> heap;
+constinit std::array<std::atomic<std::ptrdiff_t>,
+        static_cast<std::size_t>(GpuCategory::count)>
+        gpu{};
+constinit thread_local Tag current_tag = Tag::untagged;
+
+FrameStats frame_stats;
+std::size_t last_total_count = 0;
+std::size_t last_total_bytes = 0;
+
+constexpr const char *TAG_NAMES[] = {
+        "untagged", "scene", "mesh", "texture", "shader"};
+static_assert(std::size(TAG_NAMES) == static_cast<std::size_t>(Tag::count));
+
+constexpr const char *GPU_NAMES[] = {"mesh buffers", "textures"};
+static_assert(std::size(GPU_NAMES) ==
+              static_cast<std::size_t>(GpuCategory::count));
+
+#ifdef CHARCOAL_TRACK_MEMORY
+// sits right before every pointer handed out
+struct alignas(16) AllocationHeader {
+    std::size_t size;
+    // from the start of the underlying allocation to the returned pointer
+    uint32_t offset;
+    Tag tag;
+    bool over_aligned;
+};
+static_assert(sizeof(AllocationHeader) == 16);
+
+void *allocate_aligned(std::size_t size, std::size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    // aligned_alloc wants a multiple of the alignment
+    return std::aligned_alloc(
+            alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+void free_aligned(void *p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void *tracked_allocate(std::size_t size, std::size_t alignment) noexcept {
+    // the offset is a multiple of the alignment, so the pointer after the
+    // header stays aligned
+    std::size_t offset = alignment > sizeof(AllocationHeader)
+                                 ? alignment
+                                 : sizeof(AllocationHeader);
+    bool over_aligned = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+    void *base = over_aligned ? allocate_aligned(offset + size, alignment)
+                              : std::malloc(offset + size);
+    if (base == nullptr) {
+        return nullptr;
+    }
+    std::byte *user = static_cast<std::byte *>(base) + offset;
+    AllocationHeader *header = reinterpret_cast<AllocationHeader *>(user) - 1;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(offset);
+    header->tag = current_tag;
+    header->over_aligned = over_aligned;
+
+    Counters &counters = heap[static_cast<std::size_t>(header->tag)];
+    counters.live_bytes.fetch_add(size, std::memory_order_relaxed);
+    counters.live_count.fetch_add(1, std::memory_order_relaxed);
+    counters.total_bytes.fetch_add(size, std::memory_order_relaxed);
+    counters.total_count.fetch_add(1, std::memory_order_relaxed);
+    return user;
+}
+
+void *tracked_allocate_or_throw(std::size_t size, std::size_t alignment) {
+    // what the standard operator new does when memory runs out
+    while (true) {
+        if (void *p = tracked_allocate(size, alignment)) {
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+void tracked_free(void *p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+    const AllocationHeader *header =
+            static_cast<const AllocationHeader *>(p) - 1;
+    Counters &counters = heap[static_cast<std::size_t>(header->tag)];
+    counters.live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+    counters.live_count.fetch_sub(1, std::memory_order_relaxed);
+    void *base = static_cast<std::byte *>(p) - header->offset;
+    if (header->over_aligned) {
+        free_aligned(base);
+    } else {
+        std::free(base);
+    }
+}
+#endif
+} // namespace
+
+TagScope::TagScope(Tag tag) : previous{current_tag} {
+    current_tag = tag;
+}
+
+TagScope::~TagScope() noexcept {
+    current_tag = previous;
+}
+
+bool is_heap_tracked() {
+#ifdef CHARCOAL_TRACK_MEMORY
+    return true;
+#else
+    return false;
+#endif
+}
+
+Totals get_totals(Tag tag) {
+    const Counters &counters = heap[static_cast<std::size_t>(tag)];
+    Totals totals;
+    totals.live_bytes = counters.live_bytes.load(std::memory_order_relaxed);
+    totals.live_count = counters.live_count.load(std::memory_order_relaxed);
+    totals.total_bytes = counters.total_bytes.load(std::memory_order_relaxed);
+    totals.total_count = counters.total_count.load(std::memory_order_relaxed);
+    return totals;
+}
+
+void add_gpu_bytes(GpuCategory category, std::ptrdiff_t bytes) {
+    gpu[static_cast<std::size_t>(category)].fetch_add(
+            bytes, std::memory_order_relaxed);
+}
+
+std::size_t get_gpu_bytes(GpuCategory category) {
+    return static_cast<std::size_t>(gpu[static_cast<std::size_t>(category)]
+                    .load(std::memory_order_relaxed));
+}
+
+void begin_frame() {
+    std::size_t total_count = 0;
+    std::size_t total_bytes = 0;
+    for (const Counters &counters : heap) {
+        total_count += counters.total_count.load(std::memory_order_relaxed);
+        total_bytes += counters.total_bytes.load(std::memory_order_relaxed);
+    }
+    frame_stats.allocations = total_count - last_total_count;
+    frame_stats.bytes = total_bytes - last_total_bytes;
+    last_total_count = total_count;
+    last_total_bytes = total_bytes;
+}
+
+const FrameStats &get_frame_stats() {
+    return frame_stats;
+}
+
+const char *get_name(Tag tag) {
+    return TAG_NAMES[static_cast<std::size_t>(tag)];
+}
+
+const char *get_name(GpuCategory category) {
+    return GPU_NAMES[static_cast<std::size_t>(category)];
+}
+
+void report_leaks() {
+    for (std::size_t i = 0; i < gpu.size(); ++i) {
+        std::ptrdiff_t bytes = gpu[i].load(std::memory_order_relaxed);
+        if (bytes != 0) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Leaked %td bytes of GPU %s", bytes, GPU_NAMES[i]);
+        }
+    }
+    if (is_heap_tracked()) {
+        for (std::size_t i = 0; i < heap.size(); ++i) {
+            Totals totals = get_totals(static_cast<Tag>(i));
+            if (totals.live_count == 0) {
+                continue;
+            }
+            if (static_cast<Tag>(i) == Tag::untagged) {
+                // statics and libraries free theirs after this
+                SDL_Log("%zu untagged allocations (%zu bytes) still live",
+                        totals.live_count, totals.live_bytes);
+            } else {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "Leaked %zu %s allocations (%zu bytes)",
+                        totals.live_count, TAG_NAMES[i], totals.live_bytes);
+            }
+        }
+    }
+    // SDL_Quit() hasn't run yet, so some are expected
+    int sdl_allocations = SDL_GetNumAllocations();
+    if (sdl_allocations > 0) {
+        SDL_Log("%d SDL allocations still live", sdl_allocations);
+    }
+}
+} // namespace Charcoal::MemoryTracker
+
+#ifdef CHARCOAL_TRACK_MEMORY
+using Charcoal::MemoryTracker::tracked_allocate;
+using Charcoal::MemoryTracker::tracked_allocate_or_throw;
+using Charcoal::MemoryTracker::tracked_free;
+
+void *operator new(std::size_t size) {
+    return tracked_allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new[](std::size_t size) {
+    return tracked_allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return tracked_allocate_or_throw(
+            size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return tracked_allocate_or_throw(
+            size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return tracked_allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return tracked_allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+        const std::nothrow_t &) noexcept {
+    return tracked_allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+        const std::nothrow_t &) noexcept {
+    return tracked_allocate(size, static_cast<std::size_t>(alignment));
+}
+
+// the header knows the size and alignment, so every delete is the same
+void operator delete(void *p) noexcept {
+    tracked_free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    tracked_free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    tracked_free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    tracked_free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    tracked_free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    tracked_free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    tracked_free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    tracked_free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    tracked_free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    tracked_free(p);
+}
+
+void operator delete(
+        void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    tracked_free(p);
+}
+
+void operator delete[](
+        void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    tracked_free(p);
+}
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Charcoal {
+/**
+ * Counts where the engine's memory goes.
+ *
+ * GPU memory is always counted, from the sizes GpuMesh and GpuTexture
+ * upload. Heap tracking is opt-in: configure with CHARCOAL_TRACK_MEMORY=ON
+ * and the global operator new and delete are replaced with versions that
+ * record every allocation's size and tag. Tags are per thread, set with a
+ * TagScope around the code whose allocations should be counted together.
+ * Without the option, heap totals stay at zero and tagging costs a thread
+ * local store.
+ *
+ * SDL and Dear ImGui allocate through malloc, so only SDL's outstanding
+ * allocation count is known.
+ */
+namespace MemoryTracker {
+enum class Tag : uint8_t {
+    untagged,
+    scene,
+    mesh,
+    texture,
+    shader,
+    count
+};
+
+enum class GpuCategory : uint8_t {
+    mesh_buffers,
+    textures,
+    count
+};
+
+struct Totals {
+    std::size_t live_bytes = 0;
+    std::size_t live_count = 0;
+    // since startup
+    std::size_t total_bytes = 0;
+    std::size_t total_count = 0;
+};
+
+struct FrameStats {
+    // heap allocations made between the last two begin_frame() calls
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+};
+
+/**
+ * @class TagScope
+ * @brief Tags the current thread's allocations until it goes out of scope.
+ * Scopes nest, jobs handed to other threads need their own.
+ */
+class TagScope {
+    Tag previous;
+
+public:
+    explicit TagScope(Tag tag);
+    ~TagScope() noexcept;
+
+    TagScope(const TagScope &other) = delete;
+    TagScope &operator=(const TagScope &other) = delete;
+};
+
+/**
+ * @brief Whether the heap is being tracked in this build.
+ */
+bool is_heap_tracked();
+
+Totals get_totals(Tag tag);
+
+/**
+ * @brief Records a change in GPU memory.
+ *
+ * @param bytes Positive when allocating, negative when freeing
+ */
+void add_gpu_bytes(GpuCategory category, std::ptrdiff_t bytes);
+
+std::size_t get_gpu_bytes(GpuCategory category);
+
+/**
+ * @brief Starts a new frame, making the last one's allocation rate
+ * available from get_frame_stats(). Call from the main thread once per
+ * frame.
+ */
+void begin_frame();
+
+const FrameStats &get_frame_stats();
+
+const char *get_name(Tag tag);
+const char *get_name(GpuCategory category);
+
+/**
+ * @brief Logs GPU memory and tagged allocations that are still live. Call
+ * once everything the engine owns has been destroyed.
+ */
+void report_leaks();
+} // namespace MemoryTracker
+} // namespace Charcoal
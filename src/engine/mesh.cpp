@@ -1,107 +1,210 @@
 #include "mesh.h"
+#include "hash.h"
+#include "memory_tracker.h"
+#include "mesh_file.h"
 #include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
+#include <utility>
 
 namespace Charcoal {
+Mesh::Mesh() {
+}
+
+Mesh::Mesh(std::vector<Vertex> verts, std::vector<int> indices) :
+        verts{std::move(verts)}, indices{std::move(indices)},
+        bounds{Bounds::from_vertices(this->verts)} {
+}
+
+Mesh::Mesh(const MeshView &view) :
+        verts{view.verts.begin(), view.verts.end()},
+        indices{view.indices.begin(), view.indices.end()}, bounds{view.bounds},
+        lods{view.lods.begin(), view.lods.end()} {
+}
+
+void Mesh::compute_bounds() {
+    bounds = Bounds::from_vertices(verts);
+}
+
+uint64_t Mesh::compute_hash() const {
+    return MeshView{*this}.compute_hash();
+}
+
+MeshView::MeshView(const Mesh &mesh) :
+        verts{mesh.verts}, indices{mesh.indices}, bounds{mesh.bounds},
+        lods{mesh.lods} {
+}
+
+uint64_t MeshView::compute_hash() const {
+    uint64_t hash = Hash::fnv1a64(verts.data(), verts.size_bytes());
+    // keep [a, b] + [c] distinct from [a] + [b, c]
+    hash = Hash::combine(hash, verts.size());
+    hash = Hash::fnv1a64(indices.data(), indices.size_bytes(), hash);
+    return Hash::fnv1a64(lods.data(), lods.size_bytes(), hash);
+}
+
+namespace {
+// compares a buffer's contents with memory, a piece at a time
+bool buffer_matches(GLuint buffer, const void *data, std::size_t size) {
+    constexpr std::size_t PIECE_BYTES = 64 * 1024;
+    std::vector<std::byte> piece(std::min(size, PIECE_BYTES));
+    // not the element array target, which would change the bound VAO
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    for (std::size_t offset = 0; offset < size; offset += PIECE_BYTES) {
+        std::size_t bytes = std::min(PIECE_BYTES, size - offset);
+        glGetBufferSubData(GL_COPY_READ_BUFFER,
+                static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(bytes),
+                piece.data());
+        if (std::memcmp(piece.data(),
+                    static_cast<const std::byte *>(data) + offset,
+                    bytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
 
 GpuMesh::GpuMesh() :
         vbo{0}, vao{0}, ebo{0},
-        element_count{0}, error{Error::none} {
+        element_count{0}, index_type{GL_UNSIGNED_INT}, size_bytes{0},
+        error{Error::none} {
     glGenBuffers(1, &vbo);
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &ebo);
 }
 
-void GpuMesh::init_attribute_layout() {
-    // attrib index, attrib element count, attrib element type,
-    // normalized, size of vertex (stride), attrib offset within vertex
-    glVertexAttribPointer(ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE,
-            sizeof(Vertex),
-            reinterpret_cast<GLvoid *>(offsetof(Vertex, position)));
-    glEnableVertexAttribArray(ATTRIB_POSITION);
-
-    glVertexAttribIPointer(ATTRIB_COLOR, 1, GL_UNSIGNED_INT, sizeof(Vertex),
-            reinterpret_cast<GLvoid *>(offsetof(Vertex, color)));
-    glEnableVertexAttribArray(ATTRIB_COLOR);
+void GpuMesh::init_attribute_layout(
+        std::span<const VertexAttribute> attributes, GLsizei stride) {
+    for (const VertexAttribute &attribute : attributes) {
+        // attrib index, attrib element count, attrib element type,
+        // normalized, size of vertex (stride), attrib offset within vertex
+        const GLvoid *offset = reinterpret_cast<const GLvoid *>(
+                static_cast<std::uintptr_t>(attribute.offset));
+        if (attribute.integer != 0) {
+            glVertexAttribIPointer(attribute.location, attribute.components,
+                    attribute.type, stride, offset);
+        } else {
+            glVertexAttribPointer(attribute.location, attribute.components,
+                    attribute.type,
+                    attribute.normalized != 0 ? GL_TRUE : GL_FALSE, stride,
+                    offset);
+        }
+        glEnableVertexAttribArray(attribute.location);
+    }
+}
 
-    glVertexAttribPointer(ATTRIB_UV, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-            reinterpret_cast<GLvoid *>(offsetof(Vertex, uv)));
-    glEnableVertexAttribArray(ATTRIB_UV);
+std::span<const VertexAttribute> GpuMesh::get_vertex_layout() {
+    static constexpr std::array<VertexAttribute, 3> LAYOUT = {{
+            {ATTRIB_POSITION, 3, GL_FLOAT, offsetof(Vertex, position), 0, 0},
+            {ATTRIB_COLOR, 1, GL_UNSIGNED_INT, offsetof(Vertex, color), 1, 0},
+            {ATTRIB_UV, 2, GL_FLOAT, offsetof(Vertex, uv), 0, 0},
+    }};
+    return LAYOUT;
 }
 
 GpuMesh::GpuMesh(GpuMesh &&other) noexcept :
         vbo{other.vbo}, vao{other.vao}, ebo{other.ebo},
-        element_count{other.element_count}, error{Error::none} {
+        element_count{other.element_count}, index_type{other.index_type},
+        size_bytes{other.size_bytes}, lods{std::move(other.lods)},
+        error{Error::none} {
     other.vbo = 0;
     other.vao = 0;
     other.ebo = 0;
     other.element_count = 0;
+    other.size_bytes = 0;
     other.error = Error::destroyed;
 }
 
 GpuMesh &GpuMesh::operator=(GpuMesh &&other) noexcept {
     if (this != &other) {
+        release();
         this->vbo = other.vbo;
         this->vao = other.vao;
         this->ebo = other.ebo;
         this->element_count = other.element_count;
+        this->index_type = other.index_type;
+        this->size_bytes = other.size_bytes;
+        this->lods = std::move(other.lods);
+        this->error = other.error;
         other.vbo = 0;
         other.vao = 0;
         other.ebo = 0;
         other.element_count = 0;
+        other.size_bytes = 0;
+        other.error = Error::destroyed;
     }
     return *this;
 }
 
 GpuMesh::~GpuMesh() noexcept {
+    release();
+}
+
+void GpuMesh::release() noexcept {
+    MemoryTracker::add_gpu_bytes(MemoryTracker::GpuCategory::mesh_buffers,
+            -static_cast<std::ptrdiff_t>(size_bytes));
+    size_bytes = 0;
     if (vbo != 0) {
         glDeleteBuffers(1, &vbo);
     }
     if (vao != 0) {
-        glDeleteBuffers(1, &vao);    
+        glDeleteVertexArrays(1, &vao);
     }
     if (ebo != 0) {
         glDeleteBuffers(1, &ebo);
     }
 }
 
-void GpuMesh::upload(const Mesh &mesh) {
+bool GpuMesh::upload_buffers(const void *vertices, std::size_t vertex_bytes,
+        const void *indices, std::size_t index_bytes) {
     bind_vao();
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh.verts.size() * sizeof(Vertex),
-            mesh.verts.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertices, GL_STATIC_DRAW);
 
     // check if the data was uploaded correctly
     GLint buf_size = 0;
-    std::size_t expected_size = mesh.verts.size() * sizeof(Vertex);
     glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &buf_size);
-    if (static_cast<std::size_t>(buf_size) != expected_size) {
+    if (static_cast<std::size_t>(buf_size) != vertex_bytes) {
         SDL_LogError(SDL_LOG_CATEGORY_GPU,
                 "VBO buffer size %d was expected to be size %zu", buf_size,
-                expected_size);
+                vertex_bytes);
         error = Error::invalid_vbo;
-        return;
+        return false;
     }
 
     // copy the indices to the ebo
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(int),
-            mesh.indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, indices, GL_STATIC_DRAW);
 
     // check if the data was uploaded correctly
     buf_size = 0;
-    expected_size = mesh.indices.size() * sizeof(int);
     glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &buf_size);
-    if (static_cast<std::size_t>(buf_size) != expected_size) {
+    if (static_cast<std::size_t>(buf_size) != index_bytes) {
         SDL_LogError(SDL_LOG_CATEGORY_GPU,
                 "EBO buffer size %d was expected to be size %zu", buf_size,
-                expected_size);
+                index_bytes);
         error = Error::invalid_ebo;
+        return false;
+    }
+    return true;
+}
+
+void GpuMesh::upload(const MeshView &mesh) {
+    if (!upload_buffers(mesh.verts.data(), mesh.verts.size() * sizeof(Vertex),
+                mesh.indices.data(), mesh.indices.size() * sizeof(int))) {
         return;
+    }
+    element_count = mesh.indices.size();
+    index_type = GL_UNSIGNED_INT;
+    if (mesh.lods.empty()) {
+        lods = {MeshLod{0, element_count, 0.0f}};
     } else {
-        element_count = mesh.indices.size();
+        lods.assign(mesh.lods.begin(), mesh.lods.end());
     }
-    init_attribute_layout();
+    init_attribute_layout(get_vertex_layout(), sizeof(Vertex));
     GLenum err = glGetError();
     if (err != GL_NO_ERROR) {
         error = Error::unknown;
@@ -109,9 +212,60 @@ void GpuMesh::upload(const Mesh &mesh) {
                 "OpenGL error while uploading to GpuMesh: %u", err);
         return;
     }
+    set_size_bytes(mesh.verts.size() * sizeof(Vertex) +
+                   mesh.indices.size() * sizeof(int));
     error = Error::none;
 }
 
+void GpuMesh::upload(const MeshFile::View &view) {
+    // the mapped pages are the source of the copy into the buffers
+    if (!upload_buffers(view.vertices, view.vertex_bytes, view.indices,
+                view.index_bytes)) {
+        return;
+    }
+    element_count = view.index_count;
+    index_type = view.index_size == sizeof(uint16_t) ? GL_UNSIGNED_SHORT
+                                                     : GL_UNSIGNED_INT;
+    if (view.lods.empty()) {
+        lods = {MeshLod{0, element_count, 0.0f}};
+    } else {
+        lods.assign(view.lods.begin(), view.lods.end());
+    }
+    init_attribute_layout(view.attributes, view.vertex_stride);
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        error = Error::unknown;
+        SDL_LogError(SDL_LOG_CATEGORY_GPU,
+                "OpenGL error while uploading to GpuMesh: %u", err);
+        return;
+    }
+    set_size_bytes(view.vertex_bytes + view.index_bytes);
+    error = Error::none;
+}
+
+bool GpuMesh::has_contents(const MeshView &mesh) const {
+    if (!is_valid() || index_type != GL_UNSIGNED_INT ||
+            element_count != mesh.indices.size() ||
+            size_bytes != mesh.verts.size_bytes() + mesh.indices.size_bytes()) {
+        return false;
+    }
+    if (mesh.lods.empty() ? lods.size() != 1
+                          : lods.size() != mesh.lods.size() ||
+                                    std::memcmp(lods.data(), mesh.lods.data(),
+                                            mesh.lods.size_bytes()) != 0) {
+        return false;
+    }
+    return buffer_matches(vbo, mesh.verts.data(), mesh.verts.size_bytes()) &&
+           buffer_matches(ebo, mesh.indices.data(), mesh.indices.size_bytes());
+}
+
+void GpuMesh::set_size_bytes(std::size_t bytes) {
+    MemoryTracker::add_gpu_bytes(MemoryTracker::GpuCategory::mesh_buffers,
+            static_cast<std::ptrdiff_t>(bytes) -
+                    static_cast<std::ptrdiff_t>(size_bytes));
+    size_bytes = bytes;
+}
+
 void GpuMesh::bind_vao() {
     assert(is_valid());
     glBindVertexArray(vao);
@@ -129,4 +283,38 @@ GLuint GpuMesh::get_element_count() const {
     return element_count;
 }
 
+GLenum GpuMesh::get_index_type() const {
+    return index_type;
+}
+
+std::size_t GpuMesh::get_index_size() const {
+    return index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t)
+                                           : sizeof(uint32_t);
+}
+
+std::size_t GpuMesh::get_lod_count() const {
+    return lods.size();
+}
+
+const MeshLod &GpuMesh::get_lod(std::size_t level) const {
+    return lods[level];
+}
+
+std::size_t GpuMesh::select_lod(
+        float screen_size, float max_error_pixels) const {
+    // errors are relative to the bounding sphere radius, roughly half the
+    // size on screen
+    float radius_pixels = screen_size * 0.5f;
+    for (std::size_t level = lods.size(); level > 1; --level) {
+        if (lods[level - 1].error * radius_pixels <= max_error_pixels) {
+            return level - 1;
+        }
+    }
+    return 0;
+}
+
+std::size_t GpuMesh::get_size_bytes() const {
+    return size_bytes;
+}
+
 }
\ No newline at end of file
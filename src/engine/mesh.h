@@ -1,18 +1,111 @@
 #pragma once
+#include "bounds.h"
 #include "vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <vector>
 #include <glad/glad.h>
 
 namespace Charcoal {
+namespace MeshFile {
+struct View;
+}
+struct MeshView;
+
+/**
+ * @class MeshLod
+ * @brief One level of detail of a mesh: a range of its indices, drawn with
+ * the same vertices as every other level.
+ */
+struct MeshLod {
+    uint32_t index_offset = 0;
+    uint32_t index_count = 0;
+    // how far the level's surface strays from the full mesh, relative to the
+    // mesh's bounding sphere radius
+    float error = 0.0f;
+};
+
+/**
+ * @class VertexAttribute
+ * @brief Where one vertex shader input is stored within a vertex, as passed
+ * to glVertexAttribPointer(). Every field is 32 bits so it can be stored in
+ * mesh files as is.
+ */
+struct VertexAttribute {
+    uint32_t location = 0;
+    // 1 to 4
+    uint32_t components = 0;
+    // GL_FLOAT, GL_UNSIGNED_INT, ...
+    uint32_t type = 0;
+    // in bytes, from the start of the vertex
+    uint32_t offset = 0;
+    // nonzero to read integers with glVertexAttribIPointer()
+    uint32_t integer = 0;
+    // nonzero to map fixed-point values to [0, 1] or [-1, 1]
+    uint32_t normalized = 0;
+};
+
 /**
  * @class Mesh
  * @brief Defines a Mesh, which is a collection of triangles defined by their
  * vertices and the indices which dictate their usage.
  *
+ * Bounds are computed when the mesh is created. Call compute_bounds() again
+ * after moving its vertices.
+ *
+ * A mesh may hold several levels of detail, see MeshSimplify::build_lods().
+ *
+ * Mesh owns its data so it can be built and edited. Geometry that's only
+ * read once loaded should live in a GeometryArena and be passed around as a
+ * MeshView instead.
  */
 struct Mesh {
     std::vector<Vertex> verts;
     std::vector<int> indices;
+    // in the mesh's local space
+    Bounds bounds;
+    // most detailed first. Empty means indices hold a single level.
+    std::vector<MeshLod> lods;
+
+    Mesh();
+    Mesh(std::vector<Vertex> verts, std::vector<int> indices);
+
+    /**
+     * @brief Copies a view's data, e.g. to edit it.
+     */
+    explicit Mesh(const MeshView &view);
+
+    void compute_bounds();
+
+    /**
+     * @brief Hashes the vertices, indices and levels of detail. Equal meshes
+     * hash the same.
+     */
+    uint64_t compute_hash() const;
+};
+
+/**
+ * @class MeshView
+ * @brief A mesh whose data is owned elsewhere, usually by a GeometryArena.
+ * A Mesh converts to a view of itself, the way a std::vector converts to a
+ * std::span.
+ */
+struct MeshView {
+    std::span<const Vertex> verts;
+    std::span<const int> indices;
+    Bounds bounds;
+    // most detailed first. Empty means indices hold a single level.
+    std::span<const MeshLod> lods;
+
+    MeshView() = default;
+    MeshView(const Mesh &mesh);
+
+    /**
+     * @brief Hashes the vertices, indices and levels of detail. Gives the
+     * same result as Mesh::compute_hash() for the same data.
+     */
+    uint64_t compute_hash() const;
 };
 
 /**
@@ -36,9 +129,21 @@ private:
     GLuint ebo;
     GLuint vao;
     GLuint element_count;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum index_type;
+    std::size_t size_bytes;
+    // always at least one level once uploaded
+    std::vector<MeshLod> lods;
     Error error;
 
-    void init_attribute_layout();
+    void init_attribute_layout(
+            std::span<const VertexAttribute> attributes, GLsizei stride);
+    bool upload_buffers(const void *vertices, std::size_t vertex_bytes,
+            const void *indices, std::size_t index_bytes);
+    // keeps the GPU memory totals up to date
+    void set_size_bytes(std::size_t bytes);
+    // deletes the GL objects and stops tracking their memory
+    void release() noexcept;
 
     static constexpr int ATTRIB_POSITION = 0;
     static constexpr int ATTRIB_COLOR = 1;
@@ -65,13 +170,29 @@ public:
      * error type.
      * @param mesh The mesh from the CPU to upload
      */
-    void upload(const Mesh &mesh);
+    void upload(const MeshView &mesh);
+
+    /**
+     * @brief Upload a mesh straight from a mapped mesh file, in whatever
+     * vertex layout and index size it was stored with. The file's pages go
+     * directly to the driver without being parsed or copied first.
+     * Errors are handled like upload(const MeshView &).
+     * @param view A valid view, see MeshFile::Reader
+     */
+    void upload(const MeshFile::View &view);
 
     /**
      * @brief Binds the GpuMesh's VAO to the current OpenGL context
      */
     void bind_vao();
 
+    /**
+     * @brief Reads the buffers back to check they hold a mesh, as
+     * upload(const MeshView &) would have left them. Waits for the GPU, so
+     * it's only meant for telling hash collisions apart.
+     */
+    bool has_contents(const MeshView &mesh) const;
+
     /**
      * @brief Checks if the GpuMesh is in a valid state.
      * @return True only if the last GpuMesh operation did not result in an error.
@@ -89,6 +210,43 @@ public:
      * @return The number of elements in the EBO
      */
     GLuint get_element_count() const;
+
+    /**
+     * @brief Returns the type to pass to glDrawElements().
+     * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    GLenum get_index_type() const;
+
+    /**
+     * @brief Returns the size of one index, to turn MeshLod::index_offset
+     * into a byte offset.
+     */
+    std::size_t get_index_size() const;
+
+    std::size_t get_lod_count() const;
+    const MeshLod &get_lod(std::size_t level) const;
+
+    /**
+     * @brief Picks the least detailed level whose error would stay under a
+     * pixel limit on screen.
+     *
+     * @param screen_size The mesh's size on screen in pixels, e.g. from
+     * TextureStreamer::screen_extent()
+     * @param max_error_pixels How far the surface may stray, in pixels
+     * @return A level for get_lod()
+     */
+    std::size_t select_lod(float screen_size, float max_error_pixels) const;
+
+    /**
+     * @brief Returns the amount of video memory used by the VBO and EBO.
+     * @return The size in bytes, or 0 if nothing has been uploaded
+     */
+    std::size_t get_size_bytes() const;
+
+    /**
+     * @brief Returns where each field of Vertex goes in the vertex shader.
+     */
+    static std::span<const VertexAttribute> get_vertex_layout();
 };
 
 } // namespace Charcoal
@@ -0,0 +1,306 @@
+#include "mesh_file.h"
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Charcoal::MeshFile {
+namespace {
+static_assert(std::is_trivially_copyable_v<Header>);
+static_assert(std::is_trivially_copyable_v<VertexAttribute>);
+static_assert(std::is_trivially_copyable_v<MeshLod>);
+static_assert(sizeof(Header) == 112 && sizeof(VertexAttribute) == 24 &&
+                      sizeof(MeshLod) == 12,
+        "changing these changes the file format, bump VERSION");
+// the mapping is page-aligned, so blobs at aligned offsets are too
+static_assert(alignof(Header) <= ALIGNMENT &&
+              alignof(VertexAttribute) <= ALIGNMENT &&
+              alignof(MeshLod) <= ALIGNMENT);
+
+// vertex attributes can't have more than 16 locations in GL 3.3
+constexpr uint32_t MAX_ATTRIBUTES = 16;
+// indices are narrowed this many at a time while writing
+constexpr std::size_t INDEX_CHUNK = 16384;
+
+uint64_t align_up(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+std::size_t type_size(uint32_t type) {
+    switch (type) {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        return 1;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        return 2;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+    case GL_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// count elements of the given size at offset fit in the file, and start
+// where the reader can cast to them
+bool fits(uint64_t offset, uint64_t count, uint64_t element_size,
+        std::size_t file_size) {
+    if (offset % ALIGNMENT != 0 || offset > file_size) {
+        return false;
+    }
+    // counts are 32-bit and sizes small, so this can't overflow
+    return count * element_size <= file_size - offset;
+}
+
+bool attributes_fit(
+        std::span<const VertexAttribute> attributes, uint32_t stride) {
+    for (const VertexAttribute &attribute : attributes) {
+        std::size_t size = type_size(attribute.type);
+        if (size == 0 || attribute.components < 1 ||
+                attribute.components > 4 ||
+                attribute.location >= MAX_ATTRIBUTES) {
+            return false;
+        }
+        // packed types hold every component in one value
+        if (attribute.type != GL_INT_2_10_10_10_REV &&
+                attribute.type != GL_UNSIGNED_INT_2_10_10_10_REV) {
+            size *= attribute.components;
+        }
+        if (static_cast<uint64_t>(attribute.offset) + size > stride) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool lods_fit(std::span<const MeshLod> lods, uint32_t index_count) {
+    return std::ranges::all_of(lods, [&](const MeshLod &lod) {
+        return lod.index_count % 3 == 0 &&
+               static_cast<uint64_t>(lod.index_offset) + lod.index_count <=
+                       index_count;
+    });
+}
+
+bool write_bytes(SDL_IOStream *io, const void *data, std::size_t size) {
+    return size == 0 || SDL_WriteIO(io, data, size) == size;
+}
+
+// zeroes from the current position up to offset
+bool pad_to(SDL_IOStream *io, uint64_t offset) {
+    static constexpr std::array<std::byte, ALIGNMENT> ZEROES{};
+    Sint64 position = SDL_TellIO(io);
+    if (position < 0 || static_cast<uint64_t>(position) > offset) {
+        return false;
+    }
+    return write_bytes(io, ZEROES.data(),
+            static_cast<std::size_t>(offset - static_cast<uint64_t>(position)));
+}
+
+bool write_indices(
+        SDL_IOStream *io, std::span<const int> indices, uint32_t size) {
+    if (size == sizeof(uint32_t)) {
+        static_assert(sizeof(int) == sizeof(uint32_t));
+        return write_bytes(io, indices.data(), indices.size() * sizeof(int));
+    }
+    std::vector<uint16_t> narrow(std::min(indices.size(), INDEX_CHUNK));
+    for (std::size_t first = 0; first < indices.size(); first += INDEX_CHUNK) {
+        std::size_t count = std::min(INDEX_CHUNK, indices.size() - first);
+        for (std::size_t i = 0; i < count; ++i) {
+            narrow[i] = static_cast<uint16_t>(indices[first + i]);
+        }
+        if (!write_bytes(io, narrow.data(), count * sizeof(uint16_t))) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+Reader::Reader(const char *path) :
+        file{path}, error{Error::none} {
+    if (!file.is_valid()) {
+        error = Error::unreadable;
+        return;
+    }
+    std::size_t file_size = file.get_size();
+    const std::byte *data = file.get_data();
+    if (file_size < sizeof(Header)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh file \"%s\" is too small to be a mesh", path);
+        error = Error::invalid_header;
+        return;
+    }
+    const Header &header = *reinterpret_cast<const Header *>(data);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "\"%s\" is not a mesh file", path);
+        error = Error::invalid_header;
+        return;
+    }
+    if (header.version != VERSION) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh file \"%s\" has version %u, expected %u", path,
+                header.version, VERSION);
+        error = Error::unsupported_version;
+        return;
+    }
+    if ((header.index_size != sizeof(uint16_t) &&
+                header.index_size != sizeof(uint32_t)) ||
+            header.vertex_stride == 0 || header.index_count % 3 != 0 ||
+            header.attribute_count > MAX_ATTRIBUTES) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh file \"%s\" has an invalid header", path);
+        error = Error::invalid_header;
+        return;
+    }
+    if (!fits(header.attributes_offset, header.attribute_count,
+                sizeof(VertexAttribute), file_size) ||
+            !fits(header.lods_offset, header.lod_count, sizeof(MeshLod),
+                    file_size) ||
+            !fits(header.vertices_offset, header.vertex_count,
+                    header.vertex_stride, file_size) ||
+            !fits(header.indices_offset, header.index_count,
+                    header.index_size, file_size)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh file \"%s\" is truncated", path);
+        error = Error::truncated;
+        return;
+    }
+
+    view.vertex_count = header.vertex_count;
+    view.vertex_stride = header.vertex_stride;
+    view.index_count = header.index_count;
+    view.index_size = header.index_size;
+    view.attributes = {reinterpret_cast<const VertexAttribute *>(
+                               data + header.attributes_offset),
+            header.attribute_count};
+    view.lods = {
+            reinterpret_cast<const MeshLod *>(data + header.lods_offset),
+            header.lod_count};
+    view.vertices = data + header.vertices_offset;
+    view.vertex_bytes = static_cast<std::size_t>(header.vertex_count) *
+                        header.vertex_stride;
+    view.indices = data + header.indices_offset;
+    view.index_bytes =
+            static_cast<std::size_t>(header.index_count) * header.index_size;
+    view.bounds.box.min = {
+            header.box_min[0], header.box_min[1], header.box_min[2]};
+    view.bounds.box.max = {
+            header.box_max[0], header.box_max[1], header.box_max[2]};
+    view.bounds.sphere.center = {header.sphere_center[0],
+            header.sphere_center[1], header.sphere_center[2]};
+    view.bounds.sphere.radius = header.sphere_radius;
+    view.source_hash = header.source_hash;
+
+    if (!attributes_fit(view.attributes, view.vertex_stride) ||
+            !lods_fit(view.lods, view.index_count)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh file \"%s\" has an invalid vertex layout or LOD table",
+                path);
+        view = {};
+        error = Error::invalid_header;
+    }
+}
+
+bool has_vertex_layout(const View &view) {
+    std::span<const VertexAttribute> layout = GpuMesh::get_vertex_layout();
+    return view.vertex_stride == sizeof(Vertex) &&
+           std::ranges::equal(view.attributes, layout,
+                   [](const VertexAttribute &a, const VertexAttribute &b) {
+                       return a.location == b.location &&
+                              a.components == b.components &&
+                              a.type == b.type && a.offset == b.offset &&
+                              a.integer == b.integer &&
+                              a.normalized == b.normalized;
+                   });
+}
+
+bool Reader::is_valid() const {
+    return error == Error::none;
+}
+
+Error Reader::get_error() const {
+    return error;
+}
+
+const View &Reader::get_view() const {
+    return view;
+}
+
+bool write(const char *path, const MeshView &mesh, uint64_t source_hash) {
+    if (mesh.verts.size() > std::numeric_limits<uint32_t>::max() ||
+            mesh.indices.size() > std::numeric_limits<uint32_t>::max()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh is too large for a mesh file \"%s\"", path);
+        return false;
+    }
+    std::span<const VertexAttribute> attributes = GpuMesh::get_vertex_layout();
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertex_count = static_cast<uint32_t>(mesh.verts.size());
+    header.vertex_stride = sizeof(Vertex);
+    header.index_count = static_cast<uint32_t>(mesh.indices.size());
+    header.index_size = mesh.verts.size() <= 0x10000 ? sizeof(uint16_t)
+                                                     : sizeof(uint32_t);
+    header.attribute_count = static_cast<uint32_t>(attributes.size());
+    header.lod_count = static_cast<uint32_t>(mesh.lods.size());
+    for (int axis = 0; axis < 3; ++axis) {
+        header.box_min[axis] = mesh.bounds.box.min[axis];
+        header.box_max[axis] = mesh.bounds.box.max[axis];
+        header.sphere_center[axis] = mesh.bounds.sphere.center[axis];
+    }
+    header.sphere_radius = mesh.bounds.sphere.radius;
+    header.source_hash = source_hash;
+    header.attributes_offset = align_up(sizeof(Header));
+    header.lods_offset = align_up(header.attributes_offset +
+                                  attributes.size() * sizeof(VertexAttribute));
+    header.vertices_offset =
+            align_up(header.lods_offset + mesh.lods.size() * sizeof(MeshLod));
+    header.indices_offset = align_up(
+            header.vertices_offset + mesh.verts.size() * sizeof(Vertex));
+
+    // write then rename, so a crash never leaves a half-written file behind.
+    // Blobs are streamed, so nothing the size of the mesh is allocated
+    std::string temp_path = std::string{path} + ".tmp";
+    SDL_IOStream *io = SDL_IOFromFile(temp_path.c_str(), "wb");
+    if (io == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to write mesh file \"%s\": %s", path, SDL_GetError());
+        return false;
+    }
+    bool written = write_bytes(io, &header, sizeof(header)) &&
+                   pad_to(io, header.attributes_offset) &&
+                   write_bytes(io, attributes.data(),
+                           attributes.size_bytes()) &&
+                   pad_to(io, header.lods_offset) &&
+                   write_bytes(io, mesh.lods.data(),
+                           mesh.lods.size() * sizeof(MeshLod)) &&
+                   pad_to(io, header.vertices_offset) &&
+                   write_bytes(io, mesh.verts.data(),
+                           mesh.verts.size() * sizeof(Vertex)) &&
+                   pad_to(io, header.indices_offset) &&
+                   write_indices(io, mesh.indices, header.index_size);
+    // closing flushes, which can fail too
+    written = SDL_CloseIO(io) && written;
+    if (!written || !SDL_RenamePath(temp_path.c_str(), path)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to write mesh file \"%s\": %s", path, SDL_GetError());
+        SDL_RemovePath(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+} // namespace Charcoal::MeshFile
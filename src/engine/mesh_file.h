@@ -0,0 +1,125 @@
+#pragma once
+#include "bounds.h"
+#include "mapped_file.h"
+#include "mesh.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Charcoal {
+/**
+ * The engine's binary mesh container. A file is a fixed header followed by
+ * blobs that can be handed to OpenGL without parsing:
+ *
+ *   Header | VertexAttribute[] | MeshLod[] | vertices | indices
+ *
+ * Every blob starts on an ALIGNMENT boundary. Values are stored in the
+ * machine's byte order, every platform the engine supports is little-endian.
+ */
+namespace MeshFile {
+constexpr uint32_t VERSION = 1;
+constexpr char MAGIC[4] = {'C', 'M', 'S', 'H'};
+constexpr std::size_t ALIGNMENT = 16;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertex_count;
+    // in bytes
+    uint32_t vertex_stride;
+    uint32_t index_count;
+    // 2 or 4 bytes
+    uint32_t index_size;
+    uint32_t attribute_count;
+    uint32_t lod_count;
+    float box_min[3];
+    float box_max[3];
+    float sphere_center[3];
+    float sphere_radius;
+    // whatever the mesh was built from, so caches can tell when it's stale.
+    // 0 if unknown
+    uint64_t source_hash;
+    // in bytes from the start of the file
+    uint64_t attributes_offset;
+    uint64_t lods_offset;
+    uint64_t vertices_offset;
+    uint64_t indices_offset;
+};
+
+enum class Error {
+    none,
+    unreadable,
+    invalid_header,
+    unsupported_version,
+    truncated
+};
+
+/**
+ * @class View
+ * @brief A mesh file's contents. Pointers refer to the file's memory and
+ * are only valid while it stays mapped.
+ */
+struct View {
+    uint32_t vertex_count = 0;
+    uint32_t vertex_stride = 0;
+    uint32_t index_count = 0;
+    uint32_t index_size = 0;
+    std::span<const VertexAttribute> attributes;
+    // empty means the indices hold a single level
+    std::span<const MeshLod> lods;
+    const void *vertices = nullptr;
+    std::size_t vertex_bytes = 0;
+    const void *indices = nullptr;
+    std::size_t index_bytes = 0;
+    Bounds bounds;
+    uint64_t source_hash = 0;
+};
+
+/**
+ * @class Reader
+ * @brief Maps a mesh file and checks that its header and blobs are
+ * consistent. Index values aren't checked against the vertex count, since
+ * that would mean reading every page of the file.
+ */
+class Reader {
+    MappedFile file;
+    View view;
+    Error error;
+
+public:
+    /**
+     * @param path Path to a file written by write()
+     */
+    explicit Reader(const char *path);
+
+    bool is_valid() const;
+    Error get_error() const;
+
+    /**
+     * @brief Returns the file's contents. Only meaningful if is_valid().
+     */
+    const View &get_view() const;
+};
+
+/**
+ * @brief Checks that a file's vertices are the engine's Vertex: same stride,
+ * and the same attributes as GpuMesh::get_vertex_layout(). Only then can
+ * they be copied into a MeshView.
+ */
+bool has_vertex_layout(const View &view);
+
+/**
+ * @brief Writes a mesh in the engine's Vertex layout. Indices are stored as
+ * 16-bit when every vertex can be addressed with them. The file is written
+ * next to the destination first, then renamed over it, so readers never see
+ * a half-written file.
+ *
+ * @param path Destination file
+ * @param mesh The mesh to write, with its bounds and levels of detail
+ * @param source_hash Stored as View::source_hash
+ * @return True on success. Failures are logged.
+ */
+bool write(
+        const char *path, const MeshView &mesh, uint64_t source_hash = 0);
+} // namespace MeshFile
+} // namespace Charcoal
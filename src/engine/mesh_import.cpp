@@ -0,0 +1,1053 @@
+#include "mesh_import.h"
+#include "color.h"
+#include "hash.h"
+#include "json.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
+
+namespace Charcoal::MeshImport {
+namespace {
+// OBJ text is split into chunks of about this many bytes, one job each
+constexpr std::size_t OBJ_CHUNK_BYTES = 1 << 20;
+// every vertex needs an index that fits in an int
+constexpr std::size_t MAX_VERTICES =
+        static_cast<std::size_t>(std::numeric_limits<int>::max());
+
+constexpr uint32_t GLB_MAGIC = 0x46546C67; // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+constexpr int GLTF_MODE_TRIANGLES = 4;
+
+glm::uint32 default_color() {
+    return Color::pack_rgba32(1.0f, 1.0f, 1.0f, 1.0f);
+}
+
+// only used to report errors, so lines aren't counted while parsing
+std::size_t line_number(std::string_view text, std::size_t offset) {
+    return 1 + static_cast<std::size_t>(
+                       std::count(text.begin(),
+                               text.begin() + std::min(offset, text.size()),
+                               '\n'));
+}
+
+void run_parallel(ThreadPool *pool, std::size_t count,
+        const std::function<void(std::size_t, std::size_t)> &fn) {
+    if (pool != nullptr) {
+        pool->parallel_for(count, 1, fn);
+    } else {
+        fn(0, count);
+    }
+}
+
+struct ObjCorner {
+    int32_t position = 0;
+    // -1 if the corner has no UV
+    int32_t uv = -1;
+    // Bits 0 and 1 are set when position or uv was given relative to the end
+    // of the list. Those are counted from the start of the chunk until the
+    // size of every chunk before it is known.
+    uint8_t relative = 0;
+};
+
+struct ObjChunk {
+    std::string_view text;
+    // byte offset of text in the whole file
+    std::size_t offset = 0;
+    std::vector<glm::vec3> positions;
+    // one per position
+    std::vector<glm::uint32> colors;
+    std::vector<glm::vec2> uvs;
+    // three per triangle
+    std::vector<ObjCorner> corners;
+    Error error = Error::none;
+    // byte offset of the line with the error, in the whole file
+    std::size_t error_offset = 0;
+};
+
+bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+void skip_blanks(const char *&p, const char *end) {
+    while (p < end && is_blank(*p)) {
+        ++p;
+    }
+}
+
+bool parse_float(const char *&p, const char *end, float &out) {
+    skip_blanks(p, end);
+    // from_chars doesn't take a leading '+', but exporters do write them
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    auto [next, ec] = std::from_chars(p, end, out);
+    if (ec != std::errc{}) {
+        return false;
+    }
+    p = next;
+    return true;
+}
+
+bool parse_index(const char *&p, const char *end, int64_t &out) {
+    auto [next, ec] = std::from_chars(p, end, out);
+    if (ec != std::errc{} || out == 0) {
+        return false;
+    }
+    p = next;
+    return true;
+}
+
+// turns a 1-based or negative OBJ index into a 0-based one
+bool to_corner_index(int64_t raw, std::size_t local_count, int32_t &index,
+        bool &relative) {
+    int64_t value = raw > 0 ? raw - 1
+                            : static_cast<int64_t>(local_count) + raw;
+    if (raw > static_cast<int64_t>(MAX_VERTICES) ||
+            value < std::numeric_limits<int32_t>::min()) {
+        return false;
+    }
+    index = static_cast<int32_t>(value);
+    relative = raw < 0;
+    return true;
+}
+
+bool parse_obj_face(const char *p, const char *end, ObjChunk &chunk,
+        std::vector<ObjCorner> &face) {
+    face.clear();
+    while (true) {
+        skip_blanks(p, end);
+        if (p >= end) {
+            break;
+        }
+        ObjCorner corner;
+        int64_t raw = 0;
+        bool relative = false;
+        if (!parse_index(p, end, raw) ||
+                !to_corner_index(raw, chunk.positions.size(),
+                        corner.position, relative)) {
+            return false;
+        }
+        corner.relative = relative ? 1 : 0;
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                if (!parse_index(p, end, raw) ||
+                        !to_corner_index(
+                                raw, chunk.uvs.size(), corner.uv, relative)) {
+                    return false;
+                }
+                corner.relative |= relative ? 2 : 0;
+            }
+            // normals aren't kept
+            if (p < end && *p == '/') {
+                ++p;
+                if (!parse_index(p, end, raw)) {
+                    return false;
+                }
+            }
+        }
+        if (p < end && !is_blank(*p)) {
+            return false;
+        }
+        face.push_back(corner);
+    }
+    // triangulate as a fan. Points and lines have no triangles
+    for (std::size_t i = 2; i < face.size(); ++i) {
+        chunk.corners.push_back(face[0]);
+        chunk.corners.push_back(face[i - 1]);
+        chunk.corners.push_back(face[i]);
+    }
+    return true;
+}
+
+bool parse_obj_line(const char *p, const char *end, ObjChunk &chunk,
+        std::vector<ObjCorner> &face) {
+    skip_blanks(p, end);
+    const char *keyword = p;
+    while (p < end && !is_blank(*p)) {
+        ++p;
+    }
+    std::string_view name{keyword, static_cast<std::size_t>(p - keyword)};
+    if (name == "v") {
+        glm::vec3 position;
+        if (!parse_float(p, end, position.x) ||
+                !parse_float(p, end, position.y) ||
+                !parse_float(p, end, position.z)) {
+            return false;
+        }
+        chunk.positions.push_back(position);
+        // optional "v x y z r g b" colors, from MeshLab and others
+        glm::vec3 color;
+        skip_blanks(p, end);
+        if (p < end && parse_float(p, end, color.r) &&
+                parse_float(p, end, color.g) && parse_float(p, end, color.b)) {
+            chunk.colors.push_back(
+                    Color::pack_rgba32(color.r, color.g, color.b, 1.0f));
+        } else {
+            chunk.colors.push_back(default_color());
+        }
+        return true;
+    }
+    if (name == "vt") {
+        glm::vec2 uv{0.0f};
+        if (!parse_float(p, end, uv.x)) {
+            return false;
+        }
+        // v is optional, and w is ignored
+        parse_float(p, end, uv.y);
+        // OBJ puts v = 0 at the bottom of the texture
+        chunk.uvs.emplace_back(uv.x, 1.0f - uv.y);
+        return true;
+    }
+    if (name == "f") {
+        return parse_obj_face(p, end, chunk, face);
+    }
+    // normals, groups, materials, smoothing, comments, ...
+    return true;
+}
+
+void parse_obj_chunk(ObjChunk &chunk) {
+    const char *p = chunk.text.data();
+    const char *end = p + chunk.text.size();
+    // reused across faces
+    std::vector<ObjCorner> face;
+    while (p < end) {
+        const char *line_end = static_cast<const char *>(
+                std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+        if (!parse_obj_line(p, line_end, chunk, face)) {
+            chunk.error = Error::parse_error;
+            chunk.error_offset = chunk.offset +
+                                 static_cast<std::size_t>(
+                                         p - chunk.text.data());
+            return;
+        }
+        p = line_end + 1;
+    }
+}
+
+std::vector<ObjChunk> split_obj(std::string_view text, ThreadPool *pool) {
+    std::size_t count = 1;
+    if (pool != nullptr) {
+        count = std::max<std::size_t>(1, text.size() / OBJ_CHUNK_BYTES);
+    }
+    std::vector<ObjChunk> chunks;
+    chunks.reserve(count);
+    std::size_t begin = 0;
+    for (std::size_t i = 1; i <= count && begin < text.size(); ++i) {
+        std::size_t end = i == count ? text.size() : text.size() / count * i;
+        // move the split to the start of the next line
+        end = std::max(end, begin);
+        std::size_t newline = text.find('\n', end);
+        end = newline == std::string_view::npos || i == count ? text.size()
+                                                              : newline + 1;
+        ObjChunk &chunk = chunks.emplace_back();
+        chunk.text = text.substr(begin, end - begin);
+        chunk.offset = begin;
+        begin = end;
+    }
+    return chunks;
+}
+} // namespace
+
+bool Result::is_valid() const {
+    return error == Error::none;
+}
+
+Result import_obj(std::string_view text, ThreadPool *pool) {
+    Result result;
+    std::vector<ObjChunk> chunks = split_obj(text, pool);
+    run_parallel(pool, chunks.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            parse_obj_chunk(chunks[i]);
+        }
+    });
+
+    // relative indices need the number of elements in every chunk before
+    // theirs
+    std::vector<std::size_t> position_base(chunks.size());
+    std::vector<std::size_t> uv_base(chunks.size());
+    std::size_t position_count = 0;
+    std::size_t uv_count = 0;
+    std::size_t corner_count = 0;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].error != Error::none) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "OBJ parse error on line %zu",
+                    line_number(text, chunks[i].error_offset));
+            result.error = chunks[i].error;
+            return result;
+        }
+        position_base[i] = position_count;
+        uv_base[i] = uv_count;
+        position_count += chunks[i].positions.size();
+        uv_count += chunks[i].uvs.size();
+        corner_count += chunks[i].corners.size();
+    }
+    if (position_count > MAX_VERTICES || uv_count > MAX_VERTICES ||
+            corner_count > MAX_VERTICES) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "OBJ is too large");
+        result.error = Error::out_of_range;
+        return result;
+    }
+    if (corner_count == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "OBJ has no faces");
+        result.error = Error::empty;
+        return result;
+    }
+
+    // make every index absolute
+    std::vector<uint8_t> in_range(chunks.size(), 1);
+    run_parallel(pool, chunks.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            for (ObjCorner &corner : chunks[i].corners) {
+                int64_t position = corner.position;
+                int64_t uv = corner.uv;
+                if ((corner.relative & 1) != 0) {
+                    position += static_cast<int64_t>(position_base[i]);
+                }
+                if ((corner.relative & 2) != 0) {
+                    uv += static_cast<int64_t>(uv_base[i]);
+                }
+                if (position < 0 ||
+                        position >= static_cast<int64_t>(position_count) ||
+                        uv < -1 || uv >= static_cast<int64_t>(uv_count)) {
+                    in_range[i] = 0;
+                    break;
+                }
+                corner.position = static_cast<int32_t>(position);
+                corner.uv = static_cast<int32_t>(uv);
+            }
+        }
+    });
+    if (std::ranges::find(in_range, 0) != in_range.end()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "OBJ face refers to a vertex that doesn't exist");
+        result.error = Error::out_of_range;
+        return result;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::uint32> colors;
+    std::vector<glm::vec2> uvs;
+    positions.reserve(position_count);
+    colors.reserve(position_count);
+    uvs.reserve(uv_count);
+    for (const ObjChunk &chunk : chunks) {
+        positions.insert(positions.end(), chunk.positions.begin(),
+                chunk.positions.end());
+        colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+        uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+    }
+
+    // OBJ indexes positions and UVs separately, GL needs one index per
+    // unique pair
+    std::unordered_map<uint64_t, int> unique;
+    unique.reserve(position_count);
+    std::vector<Vertex> &verts = result.mesh.verts;
+    std::vector<int> &indices = result.mesh.indices;
+    verts.reserve(position_count);
+    indices.reserve(corner_count);
+    for (const ObjChunk &chunk : chunks) {
+        for (const ObjCorner &corner : chunk.corners) {
+            uint64_t key = static_cast<uint64_t>(corner.position) << 32 |
+                           static_cast<uint32_t>(corner.uv + 1);
+            auto [it, inserted] =
+                    unique.try_emplace(key, static_cast<int>(verts.size()));
+            if (inserted) {
+                verts.emplace_back(positions[corner.position],
+                        colors[corner.position],
+                        corner.uv >= 0 ? uvs[corner.uv] : glm::vec2{0.0f});
+            }
+            indices.push_back(it->second);
+        }
+    }
+    result.mesh.compute_bounds();
+    return result;
+}
+
+namespace {
+struct GltfBuffer {
+    const std::byte *data = nullptr;
+    std::size_t size = 0;
+};
+
+struct GltfFile {
+    Json::Value json;
+    // keep buffer memory alive while primitives are decoded
+    std::vector<MappedFile> mappings;
+    std::vector<std::vector<std::byte>> decoded;
+    std::vector<GltfBuffer> buffers;
+};
+
+struct Accessor {
+    // null for accessors without a buffer view, which are all zeroes
+    const std::byte *data = nullptr;
+    std::size_t count = 0;
+    std::size_t stride = 0;
+    int64_t component_type = 0;
+    std::size_t components = 0;
+    bool normalized = false;
+};
+
+struct Instance {
+    glm::mat4 transform;
+    const Json::Value *primitive;
+};
+
+struct Primitive {
+    std::vector<Vertex> verts;
+    std::vector<int> indices;
+    Error error = Error::none;
+};
+
+std::size_t component_size(int64_t component_type) {
+    switch (component_type) {
+    case 5120: // BYTE
+    case 5121: // UNSIGNED_BYTE
+        return 1;
+    case 5122: // SHORT
+    case 5123: // UNSIGNED_SHORT
+        return 2;
+    case 5125: // UNSIGNED_INT
+    case 5126: // FLOAT
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+std::size_t component_count(std::string_view type) {
+    if (type == "SCALAR") {
+        return 1;
+    }
+    if (type == "VEC2") {
+        return 2;
+    }
+    if (type == "VEC3") {
+        return 3;
+    }
+    if (type == "VEC4") {
+        return 4;
+    }
+    // matrices never hold anything Vertex needs
+    return 0;
+}
+
+template <typename T>
+T load(const std::byte *p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+float read_component(const std::byte *p, int64_t type, bool normalized) {
+    switch (type) {
+    case 5120: {
+        float value = load<int8_t>(p);
+        return normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case 5121: {
+        float value = load<uint8_t>(p);
+        return normalized ? value / 255.0f : value;
+    }
+    case 5122: {
+        float value = load<int16_t>(p);
+        return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    case 5123: {
+        float value = load<uint16_t>(p);
+        return normalized ? value / 65535.0f : value;
+    }
+    case 5125:
+        return static_cast<float>(load<uint32_t>(p));
+    default:
+        return load<float>(p);
+    }
+}
+
+// reads up to 4 components of element i, leaving the rest of out alone
+void read_floats(const Accessor &accessor, std::size_t i, float *out) {
+    if (accessor.data == nullptr) {
+        std::fill_n(out, accessor.components, 0.0f);
+        return;
+    }
+    const std::byte *element = accessor.data + i * accessor.stride;
+    std::size_t size = component_size(accessor.component_type);
+    for (std::size_t c = 0; c < accessor.components; ++c) {
+        out[c] = read_component(
+                element + c * size, accessor.component_type,
+                accessor.normalized);
+    }
+}
+
+uint32_t read_index(const Accessor &accessor, std::size_t i) {
+    if (accessor.data == nullptr) {
+        return 0;
+    }
+    const std::byte *element = accessor.data + i * accessor.stride;
+    switch (accessor.component_type) {
+    case 5121:
+        return load<uint8_t>(element);
+    case 5123:
+        return load<uint16_t>(element);
+    default:
+        return load<uint32_t>(element);
+    }
+}
+
+bool resolve_accessor(
+        const GltfFile &file, const Json::Value &index, Accessor &out) {
+    const Json::Value &accessor =
+            file.json["accessors"][static_cast<std::size_t>(index.as_int(-1))];
+    if (!accessor.is_object()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "glTF refers to a missing accessor");
+        return false;
+    }
+    if (accessor.contains("sparse")) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Sparse glTF accessors are not supported");
+        return false;
+    }
+    out.count = static_cast<std::size_t>(accessor["count"].as_int());
+    out.component_type = accessor["componentType"].as_int();
+    out.components = component_count(accessor["type"].as_string());
+    out.normalized = accessor["normalized"].as_bool();
+    std::size_t size = component_size(out.component_type);
+    if (size == 0 || out.components == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "glTF accessor has an unsupported type");
+        return false;
+    }
+    std::size_t element_size = size * out.components;
+    if (!accessor.contains("bufferView")) {
+        out.data = nullptr;
+        out.stride = element_size;
+        return true;
+    }
+
+    const Json::Value &view = file.json["bufferViews"][static_cast<std::size_t>(
+            accessor["bufferView"].as_int(-1))];
+    std::size_t buffer_index =
+            static_cast<std::size_t>(view["buffer"].as_int(-1));
+    if (!view.is_object() || buffer_index >= file.buffers.size()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "glTF refers to a missing buffer view or buffer");
+        return false;
+    }
+    const GltfBuffer &buffer = file.buffers[buffer_index];
+    std::size_t view_offset =
+            static_cast<std::size_t>(view["byteOffset"].as_int());
+    std::size_t view_length =
+            static_cast<std::size_t>(view["byteLength"].as_int());
+    std::size_t accessor_offset =
+            static_cast<std::size_t>(accessor["byteOffset"].as_int());
+    out.stride = static_cast<std::size_t>(
+            view["byteStride"].as_int(static_cast<int64_t>(element_size)));
+    if (view_offset > buffer.size || view_length > buffer.size - view_offset ||
+            out.stride < element_size || out.count > view_length) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "glTF buffer view is out of range");
+        return false;
+    }
+    if (out.count > 0 && (accessor_offset > view_length ||
+                                 (out.count - 1) * out.stride + element_size >
+                                         view_length - accessor_offset)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "glTF accessor is out of range");
+        return false;
+    }
+    out.data = buffer.data + view_offset + accessor_offset;
+    return true;
+}
+
+glm::mat4 node_transform(const Json::Value &node) {
+    const Json::Value &matrix = node["matrix"];
+    if (matrix.size() == 16) {
+        float values[16];
+        for (std::size_t i = 0; i < 16; ++i) {
+            values[i] = static_cast<float>(matrix[i].as_number());
+        }
+        // glTF matrices are column-major, like glm's
+        return glm::make_mat4(values);
+    }
+    const Json::Value &t = node["translation"];
+    const Json::Value &r = node["rotation"];
+    const Json::Value &s = node["scale"];
+    glm::vec3 translation{static_cast<float>(t[0].as_number()),
+            static_cast<float>(t[1].as_number()),
+            static_cast<float>(t[2].as_number())};
+    // stored as x, y, z, w
+    glm::quat rotation{static_cast<float>(r[3].as_number(1.0)),
+            static_cast<float>(r[0].as_number()),
+            static_cast<float>(r[1].as_number()),
+            static_cast<float>(r[2].as_number())};
+    glm::vec3 scale{static_cast<float>(s[0].as_number(1.0)),
+            static_cast<float>(s[1].as_number(1.0)),
+            static_cast<float>(s[2].as_number(1.0))};
+    return glm::translate(glm::mat4{1.0f}, translation) *
+           glm::mat4_cast(rotation) * glm::scale(glm::mat4{1.0f}, scale);
+}
+
+bool collect_instances(const GltfFile &file, std::size_t node_index,
+        const glm::mat4 &parent, std::size_t depth,
+        std::vector<Instance> &instances) {
+    const Json::Value &nodes = file.json["nodes"];
+    const Json::Value &node = nodes[node_index];
+    // deeper than there are nodes means the hierarchy has a cycle
+    if (!node.is_object() || depth > nodes.size()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "glTF node hierarchy is invalid");
+        return false;
+    }
+    glm::mat4 transform = parent * node_transform(node);
+    if (node.contains("mesh")) {
+        const Json::Value &mesh = file.json["meshes"][static_cast<std::size_t>(
+                node["mesh"].as_int(-1))];
+        const Json::Value &primitives = mesh["primitives"];
+        for (std::size_t i = 0; i < primitives.size(); ++i) {
+            instances.push_back({transform, &primitives[i]});
+        }
+    }
+    const Json::Value &children = node["children"];
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        if (!collect_instances(file,
+                    static_cast<std::size_t>(children[i].as_int(-1)),
+                    transform, depth + 1, instances)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void decode_primitive(
+        const GltfFile &file, const Instance &instance, Primitive &out) {
+    const Json::Value &primitive = *instance.primitive;
+    if (primitive["mode"].as_int(GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES) {
+        // points, lines and strips are skipped rather than failing the file
+        return;
+    }
+    const Json::Value &attributes = primitive["attributes"];
+    Accessor positions;
+    if (!attributes.contains("POSITION") ||
+            !resolve_accessor(file, attributes["POSITION"], positions) ||
+            positions.components != 3) {
+        out.error = Error::parse_error;
+        return;
+    }
+    Accessor uvs;
+    Accessor colors;
+    bool has_uvs = attributes.contains("TEXCOORD_0");
+    bool has_colors = attributes.contains("COLOR_0");
+    if ((has_uvs && (!resolve_accessor(file, attributes["TEXCOORD_0"], uvs) ||
+                            uvs.count < positions.count)) ||
+            (has_colors &&
+                    (!resolve_accessor(file, attributes["COLOR_0"], colors) ||
+                            colors.count < positions.count))) {
+        out.error = Error::out_of_range;
+        return;
+    }
+    // read_floats() writes every component, so they have to fit the vertex:
+    // VEC2 UVs, VEC3 or VEC4 colors
+    if ((has_uvs && uvs.components != 2) ||
+            (has_colors && colors.components != 3 &&
+                    colors.components != 4)) {
+        out.error = Error::parse_error;
+        return;
+    }
+
+    out.verts.resize(positions.count);
+    for (std::size_t i = 0; i < positions.count; ++i) {
+        Vertex &vertex = out.verts[i];
+        float position[3];
+        read_floats(positions, i, position);
+        vertex.position = glm::vec3{instance.transform *
+                                    glm::vec4{position[0], position[1],
+                                            position[2], 1.0f}};
+        vertex.color = default_color();
+        if (has_colors) {
+            float color[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+            read_floats(colors, i, color);
+            vertex.color =
+                    Color::pack_rgba32(color[0], color[1], color[2], color[3]);
+        }
+        vertex.uv = glm::vec2{0.0f};
+        if (has_uvs) {
+            // glTF already puts (0, 0) at the top-left
+            read_floats(uvs, i, &vertex.uv.x);
+        }
+    }
+
+    if (primitive.contains("indices")) {
+        Accessor indices;
+        if (!resolve_accessor(file, primitive["indices"], indices) ||
+                indices.components != 1) {
+            out.error = Error::parse_error;
+            return;
+        }
+        out.indices.resize(indices.count);
+        for (std::size_t i = 0; i < indices.count; ++i) {
+            uint32_t index = read_index(indices, i);
+            if (index >= positions.count) {
+                out.error = Error::out_of_range;
+                return;
+            }
+            out.indices[i] = static_cast<int>(index);
+        }
+    } else {
+        out.indices.resize(positions.count);
+        for (std::size_t i = 0; i < positions.count; ++i) {
+            out.indices[i] = static_cast<int>(i);
+        }
+    }
+    out.indices.resize(out.indices.size() / 3 * 3);
+    // mirroring transforms turn triangles inside out
+    if (glm::determinant(instance.transform) < 0.0f) {
+        for (std::size_t i = 0; i < out.indices.size(); i += 3) {
+            std::swap(out.indices[i + 1], out.indices[i + 2]);
+        }
+    }
+}
+
+std::vector<std::byte> decode_base64(std::string_view text) {
+    std::vector<std::byte> out;
+    out.reserve(text.size() / 4 * 3);
+    uint32_t bits = 0;
+    int bit_count = 0;
+    for (char c : text) {
+        int value;
+        if (c >= 'A' && c <= 'Z') {
+            value = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            value = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            value = c - '0' + 52;
+        } else if (c == '+') {
+            value = 62;
+        } else if (c == '/') {
+            value = 63;
+        } else {
+            // padding
+            break;
+        }
+        bits = bits << 6 | static_cast<uint32_t>(value);
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            out.push_back(static_cast<std::byte>((bits >> bit_count) & 0xFF));
+        }
+    }
+    return out;
+}
+
+// URIs may escape spaces and other characters
+std::string decode_uri(std::string_view uri) {
+    std::string out;
+    for (std::size_t i = 0; i < uri.size(); ++i) {
+        unsigned value = 0;
+        if (uri[i] == '%' && i + 2 < uri.size() &&
+                std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value,
+                        16)
+                                .ptr == uri.data() + i + 3) {
+            out.push_back(static_cast<char>(value));
+            i += 2;
+        } else {
+            out.push_back(uri[i]);
+        }
+    }
+    return out;
+}
+
+bool load_gltf(const char *path, GltfFile &file, Error &error) {
+    const MappedFile &source = file.mappings.emplace_back(path);
+    if (!source.is_valid()) {
+        error = Error::unreadable;
+        return false;
+    }
+    // mapped memory doesn't move when mappings grows
+    const std::byte *data = source.get_data();
+    std::size_t size = source.get_size();
+    std::string_view json_text{reinterpret_cast<const char *>(data), size};
+    GltfBuffer glb_buffer;
+
+    if (size >= 12 && load<uint32_t>(data) == GLB_MAGIC) {
+        // 12 byte header, then chunks of {length, type, data}. JSON first,
+        // then an optional binary buffer
+        if (load<uint32_t>(data + 4) != 2) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "\"%s\" is not a glTF 2.0 binary", path);
+            error = Error::unsupported_format;
+            return false;
+        }
+        std::size_t offset = 12;
+        bool has_json = false;
+        while (offset + 8 <= size) {
+            std::size_t length = load<uint32_t>(data + offset);
+            uint32_t type = load<uint32_t>(data + offset + 4);
+            offset += 8;
+            if (length > size - offset) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                        "\"%s\" is truncated", path);
+                error = Error::out_of_range;
+                return false;
+            }
+            if (type == GLB_CHUNK_JSON && !has_json) {
+                json_text = {reinterpret_cast<const char *>(data + offset),
+                        length};
+                has_json = true;
+            } else if (type == GLB_CHUNK_BIN && glb_buffer.data == nullptr) {
+                glb_buffer = {data + offset, length};
+            }
+            offset += length;
+        }
+        if (!has_json) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "\"%s\" has no JSON chunk", path);
+            error = Error::parse_error;
+            return false;
+        }
+    }
+
+    std::string message;
+    if (!Json::parse(json_text, file.json, &message)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unable to parse \"%s\": %s",
+                path, message.c_str());
+        error = Error::parse_error;
+        return false;
+    }
+    const Json::Value &required = file.json["extensionsRequired"];
+    if (required.size() > 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "\"%s\" requires unsupported extension %.*s", path,
+                static_cast<int>(required[0].as_string().size()),
+                required[0].as_string().data());
+        error = Error::unsupported_feature;
+        return false;
+    }
+
+    std::string_view directory{path};
+    std::size_t slash = directory.find_last_of("/\\");
+    directory = slash == std::string_view::npos
+                        ? std::string_view{}
+                        : directory.substr(0, slash + 1);
+    const Json::Value &buffers = file.json["buffers"];
+    // each buffer's memory is owned by mappings or decoded
+    file.mappings.reserve(1 + buffers.size());
+    file.decoded.reserve(buffers.size());
+    for (std::size_t i = 0; i < buffers.size(); ++i) {
+        std::string_view uri = buffers[i]["uri"].as_string();
+        std::size_t length =
+                static_cast<std::size_t>(buffers[i]["byteLength"].as_int());
+        GltfBuffer buffer;
+        if (uri.empty()) {
+            buffer = glb_buffer;
+        } else if (uri.starts_with("data:")) {
+            std::size_t comma = uri.find(";base64,");
+            if (comma == std::string_view::npos) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                        "\"%s\" has a data URI that isn't base64", path);
+                error = Error::unsupported_feature;
+                return false;
+            }
+            std::vector<std::byte> &bytes = file.decoded.emplace_back(
+                    decode_base64(uri.substr(comma + 8)));
+            buffer = {bytes.data(), bytes.size()};
+        } else {
+            std::string buffer_path =
+                    std::string{directory} + decode_uri(uri);
+            MappedFile &mapping =
+                    file.mappings.emplace_back(buffer_path.c_str());
+            if (!mapping.is_valid()) {
+                error = Error::unreadable;
+                return false;
+            }
+            buffer = {mapping.get_data(), mapping.get_size()};
+        }
+        if (buffer.size < length) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Buffer %zu of \"%s\" is shorter than its byteLength", i,
+                    path);
+            error = Error::out_of_range;
+            return false;
+        }
+        file.buffers.push_back(buffer);
+    }
+    return true;
+}
+} // namespace
+
+Result import_gltf(const char *path, ThreadPool *pool) {
+    Result result;
+    GltfFile file;
+    if (!load_gltf(path, file, result.error)) {
+        return result;
+    }
+
+    // instance every mesh the default scene reaches. Files without scenes
+    // get every root node
+    std::vector<Instance> instances;
+    const Json::Value &nodes = file.json["nodes"];
+    const Json::Value &scene = file.json["scenes"][static_cast<std::size_t>(
+            file.json["scene"].as_int(0))];
+    std::vector<std::size_t> roots;
+    if (scene.is_object()) {
+        const Json::Value &scene_nodes = scene["nodes"];
+        for (std::size_t i = 0; i < scene_nodes.size(); ++i) {
+            roots.push_back(
+                    static_cast<std::size_t>(scene_nodes[i].as_int(-1)));
+        }
+    } else {
+        std::vector<bool> is_child(nodes.size(), false);
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            const Json::Value &children = nodes[i]["children"];
+            for (std::size_t c = 0; c < children.size(); ++c) {
+                std::size_t child =
+                        static_cast<std::size_t>(children[c].as_int(-1));
+                if (child < is_child.size()) {
+                    is_child[child] = true;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < nodes.size(); ++i) {
+            if (!is_child[i]) {
+                roots.push_back(i);
+            }
+        }
+    }
+    for (std::size_t root : roots) {
+        if (!collect_instances(file, root, glm::mat4{1.0f}, 0, instances)) {
+            result.error = Error::parse_error;
+            return result;
+        }
+    }
+
+    std::vector<Primitive> primitives(instances.size());
+    run_parallel(pool, instances.size(),
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    decode_primitive(file, instances[i], primitives[i]);
+                }
+            });
+
+    std::size_t vertex_count = 0;
+    std::size_t index_count = 0;
+    for (const Primitive &primitive : primitives) {
+        if (primitive.error != Error::none) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to decode a primitive of \"%s\"", path);
+            result.error = primitive.error;
+            return result;
+        }
+        vertex_count += primitive.verts.size();
+        index_count += primitive.indices.size();
+    }
+    if (vertex_count > MAX_VERTICES || index_count > MAX_VERTICES) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "\"%s\" is too large", path);
+        result.error = Error::out_of_range;
+        return result;
+    }
+    if (index_count == 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "\"%s\" has no triangles", path);
+        result.error = Error::empty;
+        return result;
+    }
+
+    std::vector<Vertex> &verts = result.mesh.verts;
+    std::vector<int> &indices = result.mesh.indices;
+    verts.reserve(vertex_count);
+    indices.reserve(index_count);
+    for (const Primitive &primitive : primitives) {
+        int base = static_cast<int>(verts.size());
+        verts.insert(verts.end(), primitive.verts.begin(),
+                primitive.verts.end());
+        for (int index : primitive.indices) {
+            indices.push_back(base + index);
+        }
+    }
+    // primitives split at material and UV seams, and instances of the same
+    // mesh, often land on identical vertices once baked
+    deduplicate(verts, indices);
+    result.mesh.compute_bounds();
+    return result;
+}
+
+Result import_file(const char *path, ThreadPool *pool) {
+    std::string_view name{path};
+    std::size_t dot = name.find_last_of('.');
+    std::string extension;
+    if (dot != std::string_view::npos) {
+        for (char c : name.substr(dot + 1)) {
+            extension.push_back(static_cast<char>(
+                    c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c));
+        }
+    }
+    if (extension == "obj") {
+        MappedFile file{path};
+        if (!file.is_valid()) {
+            return {Mesh{}, Error::unreadable};
+        }
+        return import_obj(
+                std::string_view{reinterpret_cast<const char *>(
+                                         file.get_data()),
+                        file.get_size()},
+                pool);
+    }
+    if (extension == "gltf" || extension == "glb") {
+        return import_gltf(path, pool);
+    }
+    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+            "Unable to import \"%s\": unknown format", path);
+    return {Mesh{}, Error::unsupported_format};
+}
+
+void deduplicate(std::vector<Vertex> &verts, std::vector<int> &indices) {
+    static_assert(sizeof(Vertex) == 24, "Vertex has padding, hash fields");
+    struct VertexHash {
+        std::size_t operator()(const Vertex &vertex) const {
+            return static_cast<std::size_t>(
+                    Hash::fnv1a64(&vertex, sizeof(Vertex)));
+        }
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex &a, const Vertex &b) const {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+    std::unordered_map<Vertex, int, VertexHash, VertexEqual> unique;
+    unique.reserve(verts.size());
+    std::vector<Vertex> result;
+    result.reserve(verts.size());
+    // each input vertex is only hashed once
+    std::vector<int> remap(verts.size(), -1);
+    for (int &index : indices) {
+        int &mapped = remap[index];
+        if (mapped < 0) {
+            auto [it, inserted] = unique.try_emplace(
+                    verts[index], static_cast<int>(result.size()));
+            if (inserted) {
+                result.push_back(verts[index]);
+            }
+            mapped = it->second;
+        }
+        index = mapped;
+    }
+    verts = std::move(result);
+}
+} // namespace Charcoal::MeshImport
@@ -0,0 +1,80 @@
+#pragma once
+#include "mesh.h"
+#include "vertex.h"
+#include <string_view>
+#include <vector>
+
+namespace Charcoal {
+class ThreadPool;
+
+/**
+ * Imports meshes from interchange formats into the engine's Vertex layout.
+ *
+ * Everything in a file is merged into one mesh, with node transforms baked
+ * into the positions. Only what Vertex can hold is kept: positions, the
+ * first UV set and the first vertex color set. Normals, materials, skins and
+ * animations are ignored.
+ *
+ * UVs are converted to the engine's convention, with (0, 0) at the top-left
+ * of the texture.
+ */
+namespace MeshImport {
+enum class Error {
+    none,
+    unreadable,
+    unsupported_format,
+    parse_error,
+    // valid, but uses something the importer doesn't handle
+    unsupported_feature,
+    // indices or offsets that point outside the data
+    out_of_range,
+    // no triangles at all
+    empty
+};
+
+struct Result {
+    Mesh mesh;
+    Error error = Error::none;
+
+    bool is_valid() const;
+};
+
+/**
+ * @brief Parses Wavefront OBJ text. Files bigger than a few megabytes are
+ * split at line boundaries and parsed in parallel. Polygons are
+ * triangulated as fans. "v x y z r g b" vertex colors are supported.
+ *
+ * @param text The file's contents
+ * @param pool Used to parse chunks in parallel. May be null.
+ */
+Result import_obj(std::string_view text, ThreadPool *pool);
+
+/**
+ * @brief Reads a glTF 2.0 file, either .gltf (JSON, with external or
+ * base64-embedded buffers) or binary .glb. Every mesh instanced by the
+ * default scene's node hierarchy is included, and primitives are decoded in
+ * parallel. Only triangle list primitives are supported, and sparse
+ * accessors are not.
+ *
+ * @param path Path to the file. External buffers are resolved relative to
+ * it.
+ * @param pool Used to decode primitives in parallel. May be null.
+ */
+Result import_gltf(const char *path, ThreadPool *pool);
+
+/**
+ * @brief Imports a file, picking the format from its extension (.obj,
+ * .gltf or .glb).
+ */
+Result import_file(const char *path, ThreadPool *pool);
+
+/**
+ * @brief Merges bitwise identical vertices and remaps the indices to match,
+ * keeping the order vertices are first used in.
+ *
+ * @param verts The vertices, replaced with the unique ones
+ * @param indices Triangle list indices into verts, rewritten in place
+ */
+void deduplicate(std::vector<Vertex> &verts, std::vector<int> &indices);
+} // namespace MeshImport
+} // namespace Charcoal
@@ -0,0 +1,403 @@
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <glm/geometric.hpp>
+
+namespace Charcoal::MeshOptimize {
+namespace {
+// Forsyth's scoring setup. The cache being optimized for is larger than the
+// one measured, since scores only need to fall off smoothly.
+constexpr std::size_t SCORE_CACHE_SIZE = 32;
+constexpr float CACHE_DECAY_POWER = 1.5f;
+constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+// valences above this share the last table entry
+constexpr std::size_t MAX_VALENCE = 32;
+
+constexpr uint32_t NONE = UINT32_MAX;
+
+struct ScoreTables {
+    std::array<float, SCORE_CACHE_SIZE> cache;
+    std::array<float, MAX_VALENCE + 1> valence;
+
+    ScoreTables() {
+        for (std::size_t i = 0; i < SCORE_CACHE_SIZE; ++i) {
+            if (i < 3) {
+                // the last triangle's vertices score the same, so its
+                // neighbours don't get picked in a fixed direction
+                cache[i] = LAST_TRIANGLE_SCORE;
+            } else {
+                float scaler = 1.0f / static_cast<float>(SCORE_CACHE_SIZE - 3);
+                cache[i] = std::pow(
+                        1.0f - static_cast<float>(i - 3) * scaler,
+                        CACHE_DECAY_POWER);
+            }
+        }
+        valence[0] = 0.0f;
+        for (std::size_t i = 1; i <= MAX_VALENCE; ++i) {
+            // favour vertices with few triangles left, to finish them off
+            valence[i] = VALENCE_BOOST_SCALE *
+                         std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    float score(uint32_t cache_position, uint32_t remaining) const {
+        if (remaining == 0) {
+            // no triangles left to help
+            return -1.0f;
+        }
+        float result = valence[std::min<std::size_t>(remaining, MAX_VALENCE)];
+        if (cache_position != NONE) {
+            result += cache[cache_position];
+        }
+        return result;
+    }
+};
+
+// Counts misses in a FIFO cache without storing it: a vertex is still
+// cached if fewer than cache_size misses happened since it was loaded
+class FifoCache {
+    std::vector<uint32_t> loaded;
+    uint32_t cache_size;
+    uint32_t timestamp;
+
+public:
+    FifoCache(std::size_t vertex_count, std::size_t cache_size) :
+            loaded(vertex_count, 0),
+            cache_size{static_cast<uint32_t>(cache_size)},
+            timestamp{static_cast<uint32_t>(cache_size) + 1} {
+    }
+
+    // returns true on a miss
+    bool access(std::size_t vertex) {
+        if (timestamp - loaded[vertex] > cache_size) {
+            loaded[vertex] = timestamp++;
+            return true;
+        }
+        return false;
+    }
+
+    void flush() {
+        timestamp += cache_size + 1;
+    }
+};
+
+struct Cluster {
+    std::size_t begin;
+    std::size_t end;
+    float sort_key;
+};
+} // namespace
+
+CacheStats analyze_vertex_cache(const int *indices, std::size_t index_count,
+        std::size_t vertex_count, std::size_t cache_size) {
+    CacheStats stats;
+    if (index_count < 3) {
+        return stats;
+    }
+    FifoCache cache{vertex_count, cache_size};
+    std::vector<bool> used(vertex_count, false);
+    std::size_t misses = 0;
+    std::size_t unique = 0;
+    for (std::size_t i = 0; i < index_count; ++i) {
+        std::size_t vertex = static_cast<std::size_t>(indices[i]);
+        misses += cache.access(vertex) ? 1 : 0;
+        if (!used[vertex]) {
+            used[vertex] = true;
+            ++unique;
+        }
+    }
+    stats.acmr = static_cast<float>(misses) /
+                 static_cast<float>(index_count / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+    return stats;
+}
+
+void optimize_vertex_cache(
+        int *indices, std::size_t index_count, std::size_t vertex_count) {
+    static const ScoreTables tables;
+    std::size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    // triangles around each vertex, as ranges of adjacency. Emitted
+    // triangles get swapped past the end of their vertex's live range.
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (std::size_t i = 0; i < triangle_count * 3; ++i) {
+        ++offsets[static_cast<std::size_t>(indices[i]) + 1];
+    }
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> live(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        live[v] = offsets[v + 1] - offsets[v];
+    }
+    std::vector<uint32_t> adjacency(triangle_count * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < triangle_count * 3; ++i) {
+            adjacency[fill[static_cast<std::size_t>(indices[i])]++] =
+                    static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint32_t> cache_position(vertex_count, NONE);
+    std::vector<float> vertex_score(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v) {
+        vertex_score[v] = tables.score(NONE, live[v]);
+    }
+    std::vector<bool> emitted(triangle_count, false);
+    auto triangle_score = [&](std::size_t triangle) {
+        const int *corners = indices + triangle * 3;
+        return vertex_score[static_cast<std::size_t>(corners[0])] +
+               vertex_score[static_cast<std::size_t>(corners[1])] +
+               vertex_score[static_cast<std::size_t>(corners[2])];
+    };
+    uint32_t best = 0;
+    float best_score = triangle_score(0);
+    for (std::size_t t = 1; t < triangle_count; ++t) {
+        float score = triangle_score(t);
+        if (score > best_score) {
+            best_score = score;
+            best = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> output;
+    output.reserve(triangle_count * 3);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> next_cache;
+    cache.reserve(SCORE_CACHE_SIZE + 3);
+    next_cache.reserve(SCORE_CACHE_SIZE + 3);
+    // where to resume looking when nothing in the cache has triangles left
+    std::size_t cursor = 0;
+
+    while (output.size() < triangle_count * 3) {
+        if (best == NONE) {
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = static_cast<uint32_t>(cursor);
+        }
+
+        const int *corners = indices + static_cast<std::size_t>(best) * 3;
+        emitted[best] = true;
+        next_cache.clear();
+        for (int corner = 0; corner < 3; ++corner) {
+            uint32_t vertex = static_cast<uint32_t>(corners[corner]);
+            output.push_back(corners[corner]);
+            next_cache.push_back(vertex);
+
+            // retire the triangle from the vertex's live range
+            uint32_t *begin = adjacency.data() + offsets[vertex];
+            uint32_t *end = begin + live[vertex];
+            std::iter_swap(std::find(begin, end, best), end - 1);
+            --live[vertex];
+        }
+
+        // the triangle's vertices move to the front, everything else shifts
+        // back and the oldest fall out
+        for (uint32_t vertex : cache) {
+            if (std::find(next_cache.begin(), next_cache.begin() + 3,
+                        vertex) == next_cache.begin() + 3) {
+                next_cache.push_back(vertex);
+            }
+        }
+        for (std::size_t i = 0; i < next_cache.size(); ++i) {
+            uint32_t vertex = next_cache[i];
+            cache_position[vertex] =
+                    i < SCORE_CACHE_SIZE ? static_cast<uint32_t>(i) : NONE;
+            vertex_score[vertex] =
+                    tables.score(cache_position[vertex], live[vertex]);
+        }
+        if (next_cache.size() > SCORE_CACHE_SIZE) {
+            next_cache.resize(SCORE_CACHE_SIZE);
+        }
+        std::swap(cache, next_cache);
+
+        // only triangles around cached vertices changed score, and the next
+        // one is picked from among them
+        best = NONE;
+        best_score = -1.0f;
+        for (uint32_t vertex : cache) {
+            const uint32_t *triangles = adjacency.data() + offsets[vertex];
+            for (uint32_t i = 0; i < live[vertex]; ++i) {
+                uint32_t triangle = triangles[i];
+                float score = triangle_score(triangle);
+                if (score > best_score) {
+                    best_score = score;
+                    best = triangle;
+                }
+            }
+        }
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimize_overdraw(int *indices, std::size_t index_count,
+        const std::vector<Vertex> &verts, float threshold) {
+    std::size_t triangle_count = index_count / 3;
+    if (triangle_count < 2) {
+        return;
+    }
+
+    // Hard boundaries are where the cache order starts over on its own: a
+    // triangle whose vertices all miss
+    std::vector<std::size_t> hard;
+    {
+        FifoCache cache{verts.size(), DEFAULT_CACHE_SIZE};
+        for (std::size_t t = 0; t < triangle_count; ++t) {
+            int misses = 0;
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                misses += cache.access(static_cast<std::size_t>(
+                                  indices[t * 3 + corner]))
+                                  ? 1
+                                  : 0;
+            }
+            if (t == 0 || misses == 3) {
+                hard.push_back(t);
+            }
+        }
+        hard.push_back(triangle_count);
+    }
+
+    // Split each hard cluster further wherever the part so far is within
+    // threshold of the whole cluster's ACMR. Every part starts from an empty
+    // cache, so drawing them in any order keeps that bound.
+    std::vector<Cluster> clusters;
+    for (std::size_t h = 0; h + 1 < hard.size(); ++h) {
+        std::size_t begin = hard[h];
+        std::size_t end = hard[h + 1];
+        float cluster_acmr = analyze_vertex_cache(indices + begin * 3,
+                (end - begin) * 3, verts.size())
+                                     .acmr;
+        FifoCache cache{verts.size(), DEFAULT_CACHE_SIZE};
+        std::size_t start = begin;
+        std::size_t misses = 0;
+        for (std::size_t t = begin; t < end; ++t) {
+            for (std::size_t corner = 0; corner < 3; ++corner) {
+                misses += cache.access(static_cast<std::size_t>(
+                                  indices[t * 3 + corner]))
+                                  ? 1
+                                  : 0;
+            }
+            float acmr = static_cast<float>(misses) /
+                         static_cast<float>(t - start + 1);
+            if (t + 1 < end && acmr <= threshold * cluster_acmr) {
+                clusters.push_back({start, t + 1, 0.0f});
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+        clusters.push_back({start, end, 0.0f});
+    }
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    // area weighted centroid and normal of each cluster, and of the mesh
+    std::vector<glm::vec3> centroids(clusters.size());
+    std::vector<glm::vec3> normals(clusters.size());
+    glm::vec3 mesh_centroid{0.0f};
+    float mesh_area = 0.0f;
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        glm::vec3 centroid{0.0f};
+        glm::vec3 normal{0.0f};
+        float area = 0.0f;
+        for (std::size_t t = clusters[c].begin; t < clusters[c].end; ++t) {
+            const glm::vec3 &a =
+                    verts[static_cast<std::size_t>(indices[t * 3])].position;
+            const glm::vec3 &b =
+                    verts[static_cast<std::size_t>(indices[t * 3 + 1])]
+                            .position;
+            const glm::vec3 &d =
+                    verts[static_cast<std::size_t>(indices[t * 3 + 2])]
+                            .position;
+            glm::vec3 scaled_normal = glm::cross(b - a, d - a);
+            float triangle_area = glm::length(scaled_normal);
+            centroid += (a + b + d) * (triangle_area / 3.0f);
+            normal += scaled_normal;
+            area += triangle_area;
+        }
+        mesh_centroid += centroid;
+        mesh_area += area;
+        centroids[c] = area > 0.0f ? centroid / area : centroid;
+        float length = glm::length(normal);
+        normals[c] = length > 0.0f ? normal / length : normal;
+    }
+    if (mesh_area > 0.0f) {
+        mesh_centroid /= mesh_area;
+    }
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        clusters[c].sort_key =
+                glm::dot(centroids[c] - mesh_centroid, normals[c]);
+    }
+
+    // clusters facing furthest out go first
+    std::stable_sort(clusters.begin(), clusters.end(),
+            [](const Cluster &a, const Cluster &b) {
+                return a.sort_key > b.sort_key;
+            });
+    std::vector<int> output;
+    output.reserve(triangle_count * 3);
+    for (const Cluster &cluster : clusters) {
+        output.insert(output.end(), indices + cluster.begin * 3,
+                indices + cluster.end * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimize_vertex_fetch(Mesh &mesh) {
+    constexpr int UNUSED = -1;
+    std::vector<int> remap(mesh.verts.size(), UNUSED);
+    int next = 0;
+    for (int &index : mesh.indices) {
+        int &target = remap[static_cast<std::size_t>(index)];
+        if (target == UNUSED) {
+            target = next++;
+        }
+        index = target;
+    }
+    for (int &target : remap) {
+        if (target == UNUSED) {
+            target = next++;
+        }
+    }
+
+    std::vector<Vertex> verts(mesh.verts.size());
+    for (std::size_t i = 0; i < mesh.verts.size(); ++i) {
+        verts[static_cast<std::size_t>(remap[i])] = mesh.verts[i];
+    }
+    mesh.verts = std::move(verts);
+}
+
+Report optimize(Mesh &mesh) {
+    Report report;
+    std::vector<MeshLod> lods = mesh.lods;
+    if (lods.empty()) {
+        lods.push_back(
+                MeshLod{0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+    }
+    report.before = analyze_vertex_cache(mesh.indices.data() +
+                                                 lods[0].index_offset,
+            lods[0].index_count, mesh.verts.size());
+
+    for (const MeshLod &lod : lods) {
+        int *indices = mesh.indices.data() + lod.index_offset;
+        optimize_vertex_cache(indices, lod.index_count, mesh.verts.size());
+        optimize_overdraw(indices, lod.index_count, mesh.verts);
+    }
+    optimize_vertex_fetch(mesh);
+
+    report.after = analyze_vertex_cache(mesh.indices.data() +
+                                                lods[0].index_offset,
+            lods[0].index_count, mesh.verts.size());
+    return report;
+}
+} // namespace Charcoal::MeshOptimize
@@ -0,0 +1,371 @@
+#include "mesh_simplify.h"
+#include "bounds.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_set>
+
+namespace Charcoal::MeshSimplify {
+namespace {
+// a level has to have at most this fraction of the previous level's indices
+// to be worth keeping
+constexpr float MIN_LEVEL_SAVING = 0.85f;
+// cosine of the largest turn a collapse may give a triangle's normal
+constexpr double MIN_NORMAL_COSINE = 0.25;
+
+struct Vec3d {
+    double x;
+    double y;
+    double z;
+};
+
+Vec3d to_double(const glm::vec3 &v) {
+    return {v.x, v.y, v.z};
+}
+
+Vec3d subtract(const Vec3d &a, const Vec3d &b) {
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+Vec3d cross(const Vec3d &a, const Vec3d &b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+            a.x * b.y - a.y * b.x};
+}
+
+double dot(const Vec3d &a, const Vec3d &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Sum of squared distances to a set of planes, as p^T A p + 2 b.p + c. A is
+// symmetric, so only its upper triangle is stored.
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+
+    // the plane dot(normal, p) + d = 0, with a unit normal
+    static Quadric from_plane(const Vec3d &normal, double d, double weight) {
+        Quadric q;
+        q.a00 = weight * normal.x * normal.x;
+        q.a01 = weight * normal.x * normal.y;
+        q.a02 = weight * normal.x * normal.z;
+        q.a11 = weight * normal.y * normal.y;
+        q.a12 = weight * normal.y * normal.z;
+        q.a22 = weight * normal.z * normal.z;
+        q.b0 = weight * normal.x * d;
+        q.b1 = weight * normal.y * d;
+        q.b2 = weight * normal.z * d;
+        q.c = weight * d * d;
+        return q;
+    }
+
+    void add(const Quadric &other) {
+        a00 += other.a00;
+        a01 += other.a01;
+        a02 += other.a02;
+        a11 += other.a11;
+        a12 += other.a12;
+        a22 += other.a22;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+    }
+
+    double error(const Vec3d &p) const {
+        double result = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                        2.0 * (a01 * p.x * p.y + a02 * p.x * p.z +
+                                      a12 * p.y * p.z) +
+                        2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        // rounding can take it slightly below zero
+        return std::max(result, 0.0);
+    }
+};
+
+// moving `from` onto `to`
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+};
+
+uint64_t edge_key(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+// whether moving `from` onto `to` flips or squashes any triangle that stays
+bool flips(const std::vector<Vec3d> &positions,
+        const std::vector<int> &indices, const std::vector<uint32_t> &triangles,
+        uint32_t from, uint32_t to) {
+    for (uint32_t triangle : triangles) {
+        const int *corners = &indices[static_cast<std::size_t>(triangle) * 3];
+        uint32_t a = static_cast<uint32_t>(corners[0]);
+        uint32_t b = static_cast<uint32_t>(corners[1]);
+        uint32_t c = static_cast<uint32_t>(corners[2]);
+        // triangles on the edge disappear
+        if (a == to || b == to || c == to) {
+            continue;
+        }
+        Vec3d before = cross(subtract(positions[b], positions[a]),
+                subtract(positions[c], positions[a]));
+        Vec3d pa = a == from ? positions[to] : positions[a];
+        Vec3d pb = b == from ? positions[to] : positions[b];
+        Vec3d pc = c == from ? positions[to] : positions[c];
+        Vec3d after = cross(subtract(pb, pa), subtract(pc, pa));
+        // also refuse to turn a triangle more than ~75 degrees, which keeps
+        // slivers from drifting over the course of several collapses
+        if (dot(before, after) <=
+                MIN_NORMAL_COSINE *
+                        std::sqrt(dot(before, before) * dot(after, after))) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+std::vector<int> simplify(const std::vector<Vertex> &verts,
+        const std::vector<int> &indices, std::size_t target_index_count,
+        float max_error, float *result_error) {
+    std::vector<int> result = indices;
+    if (result_error != nullptr) {
+        *result_error = 0.0f;
+    }
+    if (verts.empty() || result.size() <= target_index_count) {
+        return result;
+    }
+
+    // errors are relative to the mesh size, so the same setting works at any
+    // scale
+    double scale = Bounds::from_vertices(verts).sphere.radius;
+    if (scale <= 0.0) {
+        scale = 1.0;
+    }
+    double max_cost = static_cast<double>(max_error) * scale;
+    max_cost *= max_cost;
+
+    std::vector<Vec3d> positions(verts.size());
+    for (std::size_t i = 0; i < verts.size(); ++i) {
+        positions[i] = to_double(verts[i].position);
+    }
+
+    // every vertex starts with the planes of the triangles around it,
+    // weighted by area
+    std::vector<Quadric> quadrics(verts.size());
+    for (std::size_t i = 0; i + 2 < result.size(); i += 3) {
+        const Vec3d &a = positions[static_cast<std::size_t>(result[i])];
+        const Vec3d &b = positions[static_cast<std::size_t>(result[i + 1])];
+        const Vec3d &c = positions[static_cast<std::size_t>(result[i + 2])];
+        Vec3d normal = cross(subtract(b, a), subtract(c, a));
+        double length = std::sqrt(dot(normal, normal));
+        if (length == 0.0) {
+            continue;
+        }
+        normal = {normal.x / length, normal.y / length, normal.z / length};
+        Quadric plane =
+                Quadric::from_plane(normal, -dot(normal, a), length * 0.5);
+        for (std::size_t corner = 0; corner < 3; ++corner) {
+            quadrics[static_cast<std::size_t>(result[i + corner])].add(plane);
+        }
+    }
+
+    // An edge only one triangle uses is open: a border, or a seam between
+    // split vertices. Its vertices stay put.
+    std::vector<bool> locked(verts.size(), false);
+    {
+        std::unordered_set<uint64_t> edges;
+        edges.reserve(result.size());
+        for (std::size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (std::size_t e = 0; e < 3; ++e) {
+                edges.insert(edge_key(static_cast<uint32_t>(result[i + e]),
+                        static_cast<uint32_t>(result[i + (e + 1) % 3])));
+            }
+        }
+        for (std::size_t i = 0; i + 2 < result.size(); i += 3) {
+            for (std::size_t e = 0; e < 3; ++e) {
+                uint32_t a = static_cast<uint32_t>(result[i + e]);
+                uint32_t b = static_cast<uint32_t>(result[i + (e + 1) % 3]);
+                if (!edges.contains(edge_key(b, a))) {
+                    locked[a] = true;
+                    locked[b] = true;
+                }
+            }
+        }
+    }
+
+    // Each pass collapses the cheapest edges it can without two collapses
+    // touching the same triangles, then rebuilds the index list
+    double worst_cost = 0.0;
+    std::vector<uint32_t> remap(verts.size());
+    std::vector<bool> dirty(verts.size());
+    std::vector<uint32_t> triangle_offsets(verts.size() + 1);
+    std::vector<uint32_t> vertex_triangles;
+    std::vector<Collapse> collapses;
+    while (result.size() > target_index_count) {
+        std::size_t triangle_count = result.size() / 3;
+
+        // triangles around each vertex, as ranges of vertex_triangles
+        std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+        for (int index : result) {
+            ++triangle_offsets[static_cast<std::size_t>(index) + 1];
+        }
+        for (std::size_t v = 0; v < verts.size(); ++v) {
+            triangle_offsets[v + 1] += triangle_offsets[v];
+        }
+        vertex_triangles.resize(result.size());
+        {
+            std::vector<uint32_t> fill(
+                    triangle_offsets.begin(), triangle_offsets.end() - 1);
+            for (std::size_t i = 0; i < result.size(); ++i) {
+                vertex_triangles[fill[static_cast<std::size_t>(result[i])]++] =
+                        static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (std::size_t i = 0; i < result.size(); i += 3) {
+            for (std::size_t e = 0; e < 3; ++e) {
+                uint32_t a = static_cast<uint32_t>(result[i + e]);
+                uint32_t b = static_cast<uint32_t>(result[i + (e + 1) % 3]);
+                // each interior edge shows up once per direction, so only
+                // look at moving a onto b here
+                if (locked[a] || a == b) {
+                    continue;
+                }
+                Quadric combined = quadrics[a];
+                combined.add(quadrics[b]);
+                double cost = combined.error(positions[b]);
+                if (cost <= max_cost) {
+                    collapses.push_back({a, b, cost});
+                }
+            }
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                [](const Collapse &a, const Collapse &b) {
+                    return a.cost < b.cost;
+                });
+
+        for (std::size_t v = 0; v < verts.size(); ++v) {
+            remap[v] = static_cast<uint32_t>(v);
+        }
+        std::fill(dirty.begin(), dirty.end(), false);
+        std::size_t removed = 0;
+        std::size_t wanted = triangle_count - target_index_count / 3;
+        for (const Collapse &collapse : collapses) {
+            if (removed >= wanted) {
+                break;
+            }
+            if (dirty[collapse.from] || dirty[collapse.to]) {
+                continue;
+            }
+            std::vector<uint32_t> around(
+                    vertex_triangles.begin() +
+                            triangle_offsets[collapse.from],
+                    vertex_triangles.begin() +
+                            triangle_offsets[collapse.from + 1]);
+            if (flips(positions, result, around, collapse.from,
+                        collapse.to)) {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            worst_cost = std::max(worst_cost, collapse.cost);
+            // the triangles around `from` change shape, so nothing else
+            // touching them can collapse until the next pass
+            int to = static_cast<int>(collapse.to);
+            for (uint32_t triangle : around) {
+                const int *corners = &result[triangle * 3];
+                if (corners[0] == to || corners[1] == to || corners[2] == to) {
+                    ++removed;
+                }
+                for (std::size_t corner = 0; corner < 3; ++corner) {
+                    dirty[static_cast<std::size_t>(corners[corner])] = true;
+                }
+            }
+        }
+        if (removed == 0) {
+            break;
+        }
+
+        // apply the collapses and drop the triangles they squashed
+        std::size_t write = 0;
+        for (std::size_t i = 0; i < result.size(); i += 3) {
+            int a = static_cast<int>(
+                    remap[static_cast<std::size_t>(result[i])]);
+            int b = static_cast<int>(
+                    remap[static_cast<std::size_t>(result[i + 1])]);
+            int c = static_cast<int>(
+                    remap[static_cast<std::size_t>(result[i + 2])]);
+            if (a == b || b == c || c == a) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (result_error != nullptr) {
+        *result_error = static_cast<float>(std::sqrt(worst_cost) / scale);
+    }
+    return result;
+}
+
+void build_lods(Mesh &mesh, const Options &options, ThreadPool *pool) {
+    if (mesh.lods.size() > 1 || mesh.indices.empty()) {
+        return;
+    }
+    const std::size_t source_count = mesh.indices.size();
+    mesh.lods = {MeshLod{0, static_cast<uint32_t>(source_count), 0.0f}};
+
+    // targets for every level after the first
+    std::vector<std::size_t> targets;
+    float fraction = 1.0f;
+    for (std::size_t level = 1; level < options.max_levels; ++level) {
+        fraction *= options.reduction;
+        std::size_t triangles = static_cast<std::size_t>(
+                static_cast<float>(source_count / 3) * fraction);
+        if (triangles < options.min_triangles) {
+            break;
+        }
+        targets.push_back(triangles * 3);
+    }
+
+    // Levels don't depend on each other, so simplify them all at once
+    std::vector<std::vector<int>> levels(targets.size());
+    std::vector<float> errors(targets.size(), 0.0f);
+    auto run = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            levels[i] = simplify(mesh.verts, mesh.indices, targets[i],
+                    options.max_error, &errors[i]);
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallel_for(targets.size(), 1, run);
+    } else {
+        run(0, targets.size());
+    }
+
+    // Keep levels while they save a worthwhile amount over the one before.
+    // Once one doesn't, the error limit has been reached and later levels
+    // can't do better.
+    std::size_t previous_count = source_count;
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        const std::vector<int> &level = levels[i];
+        if (static_cast<float>(level.size()) >
+                static_cast<float>(previous_count) * MIN_LEVEL_SAVING) {
+            break;
+        }
+        mesh.lods.push_back(MeshLod{static_cast<uint32_t>(mesh.indices.size()),
+                static_cast<uint32_t>(level.size()), errors[i]});
+        mesh.indices.insert(mesh.indices.end(), level.begin(), level.end());
+        previous_count = level.size();
+    }
+}
+} // namespace Charcoal::MeshSimplify
@@ -0,0 +1,68 @@
+#pragma once
+#include "mesh.h"
+#include "vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Charcoal {
+class ThreadPool;
+
+/**
+ * Mesh simplification with quadric error metrics (Garland and Heckbert).
+ *
+ * Edges are collapsed into one of their existing vertices, so simplified
+ * levels only need new indices and can share the full mesh's vertex buffer.
+ * Vertices on open edges are never moved, which keeps mesh borders and UV or
+ * color seams (where vertices are split) intact.
+ */
+namespace MeshSimplify {
+// bump when build_lods() produces different levels, so cached results
+// rebuild
+constexpr uint32_t VERSION = 1;
+
+struct Options {
+    // each level aims for this fraction of the full mesh's triangles, times
+    // the level before it
+    float reduction = 0.5f;
+    // including the full mesh
+    std::size_t max_levels = 6;
+    // Stop collapsing once a collapse would move the surface further than
+    // this, relative to the bounding sphere radius. Levels that can't get
+    // under their triangle target without breaking this are dropped.
+    float max_error = 0.05f;
+    // don't make levels with fewer triangles than this
+    std::size_t min_triangles = 8;
+};
+
+/**
+ * @brief Simplifies a triangle list towards a target size.
+ *
+ * @param verts The mesh's vertices. Not modified, the result indexes them.
+ * @param indices Triangle list indices into verts
+ * @param target_index_count Stop once the result has at most this many
+ * indices
+ * @param max_error Never collapse an edge whose error is above this,
+ * relative to the bounding sphere radius. The result may stay above the
+ * target because of it.
+ * @param result_error If not null, receives the largest error of any
+ * collapse made, relative to the bounding sphere radius
+ * @return The simplified triangle list
+ */
+std::vector<int> simplify(const std::vector<Vertex> &verts,
+        const std::vector<int> &indices, std::size_t target_index_count,
+        float max_error, float *result_error = nullptr);
+
+/**
+ * @brief Builds a LOD chain for a mesh. Each level is simplified from the
+ * full mesh, and appended to its indices and lods. Does nothing if the mesh
+ * already has more than one level.
+ *
+ * @param mesh The mesh to extend. Its current indices become level 0.
+ * @param options Chain settings
+ * @param pool Levels are simplified in parallel on this pool. May be null to
+ * run on the calling thread only.
+ */
+void build_lods(Mesh &mesh, const Options &options, ThreadPool *pool);
+} // namespace MeshSimplify
+} // namespace Charcoal
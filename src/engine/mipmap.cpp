@@ -0,0 +1,334 @@
+#include "mipmap.h"
+#include "pixel_convert.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace Charcoal::Mipmap {
+namespace {
+// Kaiser filter setup. The kernel is defined in destination pixels, so with
+// a radius of 3 it spans 12 source pixels when halving. Because every level
+// is an exact 2x reduction, the tap weights are the same for every pixel.
+constexpr int KAISER_TAPS = 12;
+constexpr float KAISER_RADIUS = 3.0f;
+constexpr float KAISER_ALPHA = 4.0f;
+
+// rows per parallel_for chunk
+constexpr std::size_t ROW_GRAIN = 16;
+
+// One RGBA pixel in linear float space
+#if defined(CHARCOAL_SIMD_SSE2)
+struct Float4 {
+    __m128 v;
+};
+
+inline Float4 make4(float r, float g, float b, float a) {
+    return {_mm_setr_ps(r, g, b, a)};
+}
+inline Float4 load4(const float *p) {
+    return {_mm_loadu_ps(p)};
+}
+inline void store4(float *p, Float4 x) {
+    _mm_storeu_ps(p, x.v);
+}
+inline Float4 zero4() {
+    return {_mm_setzero_ps()};
+}
+inline Float4 add4(Float4 a, Float4 b) {
+    return {_mm_add_ps(a.v, b.v)};
+}
+// acc + x * w
+inline Float4 madd4(Float4 acc, Float4 x, float w) {
+    return {_mm_add_ps(acc.v, _mm_mul_ps(x.v, _mm_set1_ps(w)))};
+}
+inline Float4 scale4(Float4 x, float w) {
+    return {_mm_mul_ps(x.v, _mm_set1_ps(w))};
+}
+#elif defined(CHARCOAL_SIMD_NEON)
+struct Float4 {
+    float32x4_t v;
+};
+
+inline Float4 make4(float r, float g, float b, float a) {
+    const float values[4] = {r, g, b, a};
+    return {vld1q_f32(values)};
+}
+inline Float4 load4(const float *p) {
+    return {vld1q_f32(p)};
+}
+inline void store4(float *p, Float4 x) {
+    vst1q_f32(p, x.v);
+}
+inline Float4 zero4() {
+    return {vdupq_n_f32(0.0f)};
+}
+inline Float4 add4(Float4 a, Float4 b) {
+    return {vaddq_f32(a.v, b.v)};
+}
+inline Float4 madd4(Float4 acc, Float4 x, float w) {
+    // separate multiply and add to match the SSE2 rounding exactly
+    return {vaddq_f32(acc.v, vmulq_n_f32(x.v, w))};
+}
+inline Float4 scale4(Float4 x, float w) {
+    return {vmulq_n_f32(x.v, w)};
+}
+#else
+struct Float4 {
+    float v[4];
+};
+
+inline Float4 make4(float r, float g, float b, float a) {
+    return {{r, g, b, a}};
+}
+inline Float4 load4(const float *p) {
+    return {{p[0], p[1], p[2], p[3]}};
+}
+inline void store4(float *p, Float4 x) {
+    std::copy_n(x.v, 4, p);
+}
+inline Float4 zero4() {
+    return {{0.0f, 0.0f, 0.0f, 0.0f}};
+}
+inline Float4 add4(Float4 a, Float4 b) {
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2],
+            a.v[3] + b.v[3]}};
+}
+inline Float4 madd4(Float4 acc, Float4 x, float w) {
+    return {{acc.v[0] + x.v[0] * w, acc.v[1] + x.v[1] * w,
+            acc.v[2] + x.v[2] * w, acc.v[3] + x.v[3] * w}};
+}
+inline Float4 scale4(Float4 x, float w) {
+    return {{x.v[0] * w, x.v[1] * w, x.v[2] * w, x.v[3] * w}};
+}
+#endif
+
+// The base level is read straight from the 8-bit input, decoding sRGB through
+// a table. Every level after that is kept in float so rounding doesn't
+// accumulate down the chain.
+struct U8Source {
+    const uint8_t *pixels;
+    int width;
+    int height;
+    std::size_t pitch;
+    const float *color_lut;
+
+    Float4 fetch(int x, int y) const {
+        const uint8_t *p = pixels + static_cast<std::size_t>(y) * pitch +
+                           static_cast<std::size_t>(x) * 4;
+        return make4(color_lut[p[0]], color_lut[p[1]], color_lut[p[2]],
+                static_cast<float>(p[3]) * (1.0f / 255.0f));
+    }
+};
+
+struct FloatSource {
+    const float *pixels;
+    int width;
+    int height;
+
+    Float4 fetch(int x, int y) const {
+        return load4(pixels + (static_cast<std::size_t>(y) * width + x) * 4);
+    }
+};
+
+struct FloatImage {
+    int width;
+    int height;
+    std::vector<float> pixels;
+};
+
+const float *unorm_lut() {
+    static const std::array<float, 256> lut = [] {
+        std::array<float, 256> table{};
+        for (int i = 0; i < 256; ++i) {
+            table[i] = static_cast<float>(i) / 255.0f;
+        }
+        return table;
+    }();
+    return lut.data();
+}
+
+double bessel_i0(double x) {
+    // power series, converges quickly for the small arguments used here
+    double sum = 1.0;
+    double term = 1.0;
+    double half_x = x / 2.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (half_x / k) * (half_x / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+const std::array<float, KAISER_TAPS> &kaiser_weights() {
+    static const std::array<float, KAISER_TAPS> weights = [] {
+        std::array<double, KAISER_TAPS> raw{};
+        double total = 0.0;
+        for (int k = 0; k < KAISER_TAPS; ++k) {
+            // distance from the destination pixel center, in dest pixels
+            double t = (static_cast<double>(k) - (KAISER_TAPS - 1) / 2.0) / 2.0;
+            double pi_t = 3.14159265358979323846 * t;
+            double sinc = t == 0.0 ? 1.0 : std::sin(pi_t) / pi_t;
+            double x = t / KAISER_RADIUS;
+            double window = bessel_i0(KAISER_ALPHA * std::sqrt(1.0 - x * x)) /
+                            bessel_i0(KAISER_ALPHA);
+            raw[k] = sinc * window;
+            total += raw[k];
+        }
+        std::array<float, KAISER_TAPS> normalized{};
+        for (int k = 0; k < KAISER_TAPS; ++k) {
+            normalized[k] = static_cast<float>(raw[k] / total);
+        }
+        return normalized;
+    }();
+    return weights;
+}
+
+template <typename Source>
+void box_rows(const Source &src, FloatImage &dst, std::size_t row_begin,
+        std::size_t row_end) {
+    for (std::size_t y = row_begin; y < row_end; ++y) {
+        int y0 = std::min(static_cast<int>(y) * 2, src.height - 1);
+        int y1 = std::min(y0 + 1, src.height - 1);
+        float *out = dst.pixels.data() + y * dst.width * 4;
+        for (int x = 0; x < dst.width; ++x) {
+            int x0 = std::min(x * 2, src.width - 1);
+            int x1 = std::min(x0 + 1, src.width - 1);
+            Float4 sum = add4(add4(src.fetch(x0, y0), src.fetch(x1, y0)),
+                    add4(src.fetch(x0, y1), src.fetch(x1, y1)));
+            store4(out + x * 4, scale4(sum, 0.25f));
+        }
+    }
+}
+
+template <typename Source>
+void kaiser_rows(const Source &src, FloatImage &dst, std::size_t row_begin,
+        std::size_t row_end) {
+    const std::array<float, KAISER_TAPS> &w = kaiser_weights();
+    constexpr int first_tap = -(KAISER_TAPS / 2 - 1);
+
+    // vertically filtered source row, reused for each destination row
+    std::vector<float> column(static_cast<std::size_t>(src.width) * 4);
+    for (std::size_t y = row_begin; y < row_end; ++y) {
+        int src_y = static_cast<int>(y) * 2 + first_tap;
+        for (int x = 0; x < src.width; ++x) {
+            Float4 sum = zero4();
+            for (int k = 0; k < KAISER_TAPS; ++k) {
+                int sy = std::clamp(src_y + k, 0, src.height - 1);
+                sum = madd4(sum, src.fetch(x, sy), w[k]);
+            }
+            store4(column.data() + x * 4, sum);
+        }
+
+        float *out = dst.pixels.data() + y * dst.width * 4;
+        for (int x = 0; x < dst.width; ++x) {
+            int src_x = x * 2 + first_tap;
+            Float4 sum = zero4();
+            for (int k = 0; k < KAISER_TAPS; ++k) {
+                int sx = std::clamp(src_x + k, 0, src.width - 1);
+                sum = madd4(sum, load4(column.data() + sx * 4), w[k]);
+            }
+            store4(out + x * 4, sum);
+        }
+    }
+}
+
+template <typename Source>
+FloatImage downsample(const Source &src, const Options &options,
+        ThreadPool *pool) {
+    FloatImage dst;
+    dst.width = std::max(src.width / 2, 1);
+    dst.height = std::max(src.height / 2, 1);
+    dst.pixels.resize(static_cast<std::size_t>(dst.width) * dst.height * 4);
+
+    auto rows = [&](std::size_t begin, std::size_t end) {
+        if (options.filter == Filter::box) {
+            box_rows(src, dst, begin, end);
+        } else {
+            kaiser_rows(src, dst, begin, end);
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallel_for(dst.height, ROW_GRAIN, rows);
+    } else {
+        rows(0, dst.height);
+    }
+    return dst;
+}
+
+uint8_t quantize_unorm(float value) {
+    return static_cast<uint8_t>(
+            std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+}
+
+MipLevel quantize(const FloatImage &image, const Options &options,
+        ThreadPool *pool) {
+    MipLevel level;
+    level.width = image.width;
+    level.height = image.height;
+    level.pixels.resize(image.pixels.size());
+
+    auto rows = [&](std::size_t begin, std::size_t end) {
+        std::size_t first = begin * image.width * 4;
+        std::size_t last = end * image.width * 4;
+        for (std::size_t i = first; i < last; i += 4) {
+            for (std::size_t c = 0; c < 3; ++c) {
+                float value = image.pixels[i + c];
+                level.pixels[i + c] = options.srgb
+                                              ? PixelConvert::linear_to_srgb8(value)
+                                              : quantize_unorm(value);
+            }
+            level.pixels[i + 3] = quantize_unorm(image.pixels[i + 3]);
+        }
+    };
+    if (pool != nullptr) {
+        pool->parallel_for(image.height, ROW_GRAIN * 4, rows);
+    } else {
+        rows(0, image.height);
+    }
+    return level;
+}
+} // namespace
+
+int level_count(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        ++levels;
+    }
+    return levels;
+}
+
+std::vector<MipLevel> generate(const uint8_t *pixels, int width, int height,
+        int pitch, const Options &options, ThreadPool *pool) {
+    std::vector<MipLevel> levels;
+    if (pixels == nullptr || width <= 0 || height <= 0) {
+        return levels;
+    }
+    levels.reserve(level_count(width, height) - 1);
+
+    const float *color_lut =
+            options.srgb ? PixelConvert::srgb_to_linear_lut() : unorm_lut();
+    U8Source base{pixels, width, height, static_cast<std::size_t>(pitch),
+            color_lut};
+    if (width == 1 && height == 1) {
+        return levels;
+    }
+
+    FloatImage current = downsample(base, options, pool);
+    levels.push_back(quantize(current, options, pool));
+    while (current.width > 1 || current.height > 1) {
+        FloatSource src{current.pixels.data(), current.width, current.height};
+        FloatImage next = downsample(src, options, pool);
+        levels.push_back(quantize(next, options, pool));
+        current = std::move(next);
+    }
+    return levels;
+}
+} // namespace Charcoal::Mipmap
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Charcoal {
+class ThreadPool;
+
+/**
+ * @class MipLevel
+ * @brief One level of a mip chain, stored as tightly packed RGBA32 pixels.
+ */
+struct MipLevel {
+    int width;
+    int height;
+    std::vector<uint8_t> pixels;
+};
+
+namespace Mipmap {
+enum class Filter {
+    // 2x2 average. Cheap, slightly blurry
+    box,
+    // Kaiser-windowed sinc. Sharper, matches offline texture tools
+    kaiser
+};
+
+struct Options {
+    Filter filter = Filter::kaiser;
+    // Color channels are sRGB encoded and get filtered in linear space.
+    // Turn off for data textures such as normal maps.
+    bool srgb = true;
+};
+
+/**
+ * @brief Returns the number of levels in a full mip chain for the given size,
+ * including the base level.
+ */
+int level_count(int width, int height);
+
+/**
+ * @brief Generates every level below the base level, down to 1x1.
+ * Results only depend on the input and options, not on the driver or the
+ * number of threads.
+ *
+ * @param pixels Base level RGBA32 pixels
+ * @param width Base level width
+ * @param height Base level height
+ * @param pitch Bytes per row of the base level
+ * @param options Filter settings
+ * @param pool Rows are filtered in parallel on this pool. May be null to run
+ * on the calling thread only.
+ * @return Levels 1 through level_count() - 1, largest first
+ */
+std::vector<MipLevel> generate(const uint8_t *pixels, int width, int height,
+        int pitch, const Options &options, ThreadPool *pool);
+} // namespace Mipmap
+} // namespace Charcoal
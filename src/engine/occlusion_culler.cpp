@@ -0,0 +1,370 @@
+#include "occlusion_culler.h"
+#include "simd.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <glm/vec4.hpp>
+
+namespace Charcoal {
+namespace {
+// vertices closer to the camera plane than this are skipped or treated as
+// visible, instead of clipping them
+constexpr float MIN_W = 1.0e-4f;
+// an occluder has to be this much (relatively) closer than an object to hide
+// it, so flat objects aren't hidden by their own surface
+constexpr float DEPTH_BIAS = 1.0e-3f;
+// test() picks the level where the object covers at most this many texels
+// across
+constexpr int MAX_TEST_TEXELS = 4;
+
+// a triangle's edge functions and depth, each as a * x + b * y + c over
+// screen space. Every edge function is >= 0 inside.
+struct Triangle {
+    std::array<float, 3> edge_a;
+    std::array<float, 3> edge_b;
+    std::array<float, 3> edge_c;
+    float depth_a;
+    float depth_b;
+    float depth_c;
+    // inclusive pixel range
+    int min_x;
+    int max_x;
+    int min_y;
+    int max_y;
+};
+
+// Each kernel writes max(old, triangle depth) to every pixel whose center is
+// inside the triangle. Rows are padded to a multiple of 4, so the kernels
+// work on groups of 4 pixels starting at min_x rounded down.
+
+[[maybe_unused]] void rasterize_scalar(
+        const Triangle &triangle, float *depth, int stride) {
+    for (int y = triangle.min_y; y <= triangle.max_y; ++y) {
+        float py = static_cast<float>(y) + 0.5f;
+        float *row = depth + static_cast<std::size_t>(y) * stride;
+        for (int x = triangle.min_x; x <= triangle.max_x; ++x) {
+            float px = static_cast<float>(x) + 0.5f;
+            bool inside = true;
+            for (int e = 0; e < 3; ++e) {
+                inside = inside && triangle.edge_a[e] * px +
+                                                   triangle.edge_b[e] * py +
+                                                   triangle.edge_c[e] >=
+                                           0.0f;
+            }
+            if (inside) {
+                float z = triangle.depth_a * px + triangle.depth_b * py +
+                          triangle.depth_c;
+                row[x] = std::max(row[x], z);
+            }
+        }
+    }
+}
+
+#if defined(CHARCOAL_SIMD_SSE2)
+void rasterize_sse2(const Triangle &triangle, float *depth, int stride) {
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 edge_a[3];
+    for (int e = 0; e < 3; ++e) {
+        edge_a[e] = _mm_set1_ps(triangle.edge_a[e]);
+    }
+    __m128 depth_a = _mm_set1_ps(triangle.depth_a);
+
+    for (int y = triangle.min_y; y <= triangle.max_y; ++y) {
+        float py = static_cast<float>(y) + 0.5f;
+        float *row = depth + static_cast<std::size_t>(y) * stride;
+        // the b * y + c part is constant along the row
+        __m128 edge_row[3];
+        for (int e = 0; e < 3; ++e) {
+            edge_row[e] = _mm_set1_ps(
+                    triangle.edge_b[e] * py + triangle.edge_c[e]);
+        }
+        __m128 depth_row =
+                _mm_set1_ps(triangle.depth_b * py + triangle.depth_c);
+
+        for (int x = triangle.min_x & ~3; x <= triangle.max_x; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+            __m128 inside = _mm_cmpge_ps(
+                    _mm_add_ps(_mm_mul_ps(edge_a[0], px), edge_row[0]), zero);
+            for (int e = 1; e < 3; ++e) {
+                inside = _mm_and_ps(inside,
+                        _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edge_a[e], px),
+                                             edge_row[e]),
+                                zero));
+            }
+            if (_mm_movemask_ps(inside) == 0) {
+                continue;
+            }
+            __m128 z = _mm_add_ps(_mm_mul_ps(depth_a, px), depth_row);
+            __m128 old = _mm_loadu_ps(row + x);
+            __m128 merged = _mm_or_ps(_mm_and_ps(inside, _mm_max_ps(old, z)),
+                    _mm_andnot_ps(inside, old));
+            _mm_storeu_ps(row + x, merged);
+        }
+    }
+}
+#elif defined(CHARCOAL_SIMD_NEON)
+void rasterize_neon(const Triangle &triangle, float *depth, int stride) {
+    const float offset_values[4] = {0.5f, 1.5f, 2.5f, 3.5f};
+    const float32x4_t offsets = vld1q_f32(offset_values);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    float32x4_t edge_a[3];
+    for (int e = 0; e < 3; ++e) {
+        edge_a[e] = vdupq_n_f32(triangle.edge_a[e]);
+    }
+    float32x4_t depth_a = vdupq_n_f32(triangle.depth_a);
+
+    for (int y = triangle.min_y; y <= triangle.max_y; ++y) {
+        float py = static_cast<float>(y) + 0.5f;
+        float *row = depth + static_cast<std::size_t>(y) * stride;
+        // the b * y + c part is constant along the row
+        float32x4_t edge_row[3];
+        for (int e = 0; e < 3; ++e) {
+            edge_row[e] = vdupq_n_f32(
+                    triangle.edge_b[e] * py + triangle.edge_c[e]);
+        }
+        float32x4_t depth_row =
+                vdupq_n_f32(triangle.depth_b * py + triangle.depth_c);
+
+        for (int x = triangle.min_x & ~3; x <= triangle.max_x; x += 4) {
+            float32x4_t px =
+                    vaddq_f32(vdupq_n_f32(static_cast<float>(x)), offsets);
+            uint32x4_t inside = vcgeq_f32(
+                    vaddq_f32(vmulq_f32(edge_a[0], px), edge_row[0]), zero);
+            for (int e = 1; e < 3; ++e) {
+                inside = vandq_u32(inside,
+                        vcgeq_f32(vaddq_f32(vmulq_f32(edge_a[e], px),
+                                          edge_row[e]),
+                                zero));
+            }
+            if (vmaxvq_u32(inside) == 0) {
+                continue;
+            }
+            float32x4_t z = vaddq_f32(vmulq_f32(depth_a, px), depth_row);
+            float32x4_t old = vld1q_f32(row + x);
+            vst1q_f32(row + x, vbslq_f32(inside, vmaxq_f32(old, z), old));
+        }
+    }
+}
+#endif
+
+void rasterize(const Triangle &triangle, float *depth, int stride) {
+#if defined(CHARCOAL_SIMD_SSE2)
+    rasterize_sse2(triangle, depth, stride);
+#elif defined(CHARCOAL_SIMD_NEON)
+    rasterize_neon(triangle, depth, stride);
+#else
+    rasterize_scalar(triangle, depth, stride);
+#endif
+}
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height) :
+        width{(std::max(width, 1) + 3) & ~3}, height{std::max(height, 1)} {
+    // each level halves the one below, rounding up, down to 1x1
+    int level_width = this->width;
+    int level_height = this->height;
+    while (true) {
+        levels.push_back(Level{level_width, level_height,
+                std::vector<float>(static_cast<std::size_t>(level_width) *
+                                           level_height,
+                        0.0f)});
+        if (level_width == 1 && level_height == 1) {
+            break;
+        }
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    }
+}
+
+void OcclusionCuller::begin(const glm::mat4 &view_projection,
+        std::pmr::memory_resource *scratch) {
+    this->view_projection = view_projection;
+    this->scratch = scratch;
+    std::fill(levels[0].depth.begin(), levels[0].depth.end(), 0.0f);
+    stats = Stats{};
+}
+
+void OcclusionCuller::add_occluder(std::span<const Vertex> verts,
+        std::span<const int> indices, const glm::mat4 &transform) {
+    glm::mat4 clip_from_object = view_projection * transform;
+    // screen x, screen y, 1 / w. w is 0 for vertices too close to project.
+    std::pmr::vector<glm::vec3> screen(verts.size(), scratch);
+    float half_width = static_cast<float>(width) * 0.5f;
+    float half_height = static_cast<float>(height) * 0.5f;
+    for (std::size_t i = 0; i < verts.size(); ++i) {
+        glm::vec4 clip = clip_from_object * glm::vec4{verts[i].position, 1.0f};
+        if (clip.w < MIN_W) {
+            screen[i] = glm::vec3{0.0f};
+            continue;
+        }
+        float inverse_w = 1.0f / clip.w;
+        screen[i] = glm::vec3{(clip.x * inverse_w + 1.0f) * half_width,
+                (clip.y * inverse_w + 1.0f) * half_height, inverse_w};
+    }
+
+    float *depth = levels[0].depth.data();
+    for (std::size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::vec3 v0 = screen[static_cast<std::size_t>(indices[i])];
+        glm::vec3 v1 = screen[static_cast<std::size_t>(indices[i + 1])];
+        glm::vec3 v2 = screen[static_cast<std::size_t>(indices[i + 2])];
+        // skipping occluders only ever keeps more objects visible
+        if (v0.z == 0.0f || v1.z == 0.0f || v2.z == 0.0f) {
+            continue;
+        }
+        float area = (v1.x - v0.x) * (v2.y - v0.y) -
+                     (v1.y - v0.y) * (v2.x - v0.x);
+        if (area == 0.0f) {
+            continue;
+        }
+        // both sides occlude, so wind every triangle counter-clockwise
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        Triangle triangle;
+        triangle.min_x = std::max(0,
+                static_cast<int>(
+                        std::ceil(std::min({v0.x, v1.x, v2.x}) - 0.5f)));
+        triangle.max_x = std::min(width - 1,
+                static_cast<int>(
+                        std::floor(std::max({v0.x, v1.x, v2.x}) - 0.5f)));
+        triangle.min_y = std::max(0,
+                static_cast<int>(
+                        std::ceil(std::min({v0.y, v1.y, v2.y}) - 0.5f)));
+        triangle.max_y = std::min(height - 1,
+                static_cast<int>(
+                        std::floor(std::max({v0.y, v1.y, v2.y}) - 0.5f)));
+        if (triangle.min_x > triangle.max_x ||
+                triangle.min_y > triangle.max_y) {
+            continue;
+        }
+
+        // edge e runs from vertex e to the next, positive on its left
+        const glm::vec3 *corners[3] = {&v0, &v1, &v2};
+        for (int e = 0; e < 3; ++e) {
+            const glm::vec3 &from = *corners[e];
+            const glm::vec3 &to = *corners[(e + 1) % 3];
+            triangle.edge_a[e] = from.y - to.y;
+            triangle.edge_b[e] = to.x - from.x;
+            triangle.edge_c[e] = -(triangle.edge_a[e] * from.x +
+                                   triangle.edge_b[e] * from.y);
+        }
+        // Barycentric weights are edge functions over the area: v1's is the
+        // edge opposite it (2, from v2 to v0) and v2's is edge 0
+        float inverse_area = 1.0f / area;
+        float d1 = (v1.z - v0.z) * inverse_area;
+        float d2 = (v2.z - v0.z) * inverse_area;
+        triangle.depth_a = d1 * triangle.edge_a[2] + d2 * triangle.edge_a[0];
+        triangle.depth_b = d1 * triangle.edge_b[2] + d2 * triangle.edge_b[0];
+        triangle.depth_c =
+                v0.z + d1 * triangle.edge_c[2] + d2 * triangle.edge_c[0];
+
+        rasterize(triangle, depth, width);
+        ++stats.occluder_triangles;
+    }
+}
+
+void OcclusionCuller::build_pyramid() {
+    for (std::size_t i = 1; i < levels.size(); ++i) {
+        const Level &below = levels[i - 1];
+        Level &level = levels[i];
+        for (int y = 0; y < level.height; ++y) {
+            // odd sizes have a last row/column with no neighbour
+            int y0 = y * 2;
+            int y1 = std::min(y0 + 1, below.height - 1);
+            for (int x = 0; x < level.width; ++x) {
+                int x0 = x * 2;
+                int x1 = std::min(x0 + 1, below.width - 1);
+                const float *row0 = below.depth.data() +
+                                    static_cast<std::size_t>(y0) * below.width;
+                const float *row1 = below.depth.data() +
+                                    static_cast<std::size_t>(y1) * below.width;
+                level.depth[static_cast<std::size_t>(y) * level.width + x] =
+                        std::min({row0[x0], row0[x1], row1[x0], row1[x1]});
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::test(const Aabb &world_box) {
+    ++stats.tested;
+
+    // project the corners to find the screen rectangle and nearest depth
+    float min_x = static_cast<float>(width);
+    float max_x = 0.0f;
+    float min_y = static_cast<float>(height);
+    float max_y = 0.0f;
+    float nearest = 0.0f;
+    float half_width = static_cast<float>(width) * 0.5f;
+    float half_height = static_cast<float>(height) * 0.5f;
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec4 point{corner & 1 ? world_box.max.x : world_box.min.x,
+                corner & 2 ? world_box.max.y : world_box.min.y,
+                corner & 4 ? world_box.max.z : world_box.min.z, 1.0f};
+        glm::vec4 clip = view_projection * point;
+        // reaches behind the camera, so it could cover the whole screen
+        if (clip.w < MIN_W) {
+            return true;
+        }
+        float inverse_w = 1.0f / clip.w;
+        float x = (clip.x * inverse_w + 1.0f) * half_width;
+        float y = (clip.y * inverse_w + 1.0f) * half_height;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        nearest = std::max(nearest, inverse_w);
+    }
+
+    // every pixel the rectangle touches
+    int x0 = std::max(0, static_cast<int>(std::floor(min_x)));
+    int x1 = std::min(width - 1, static_cast<int>(std::floor(max_x)));
+    int y0 = std::max(0, static_cast<int>(std::floor(min_y)));
+    int y1 = std::min(height - 1, static_cast<int>(std::floor(max_y)));
+    if (x0 > x1 || y0 > y1) {
+        // off screen, which is for frustum culling to decide
+        return true;
+    }
+
+    std::size_t level_index = 0;
+    while (level_index + 1 < levels.size() &&
+            ((x1 >> level_index) - (x0 >> level_index) + 1 > MAX_TEST_TEXELS ||
+                    (y1 >> level_index) - (y0 >> level_index) + 1 >
+                            MAX_TEST_TEXELS)) {
+        ++level_index;
+    }
+
+    const Level &level = levels[level_index];
+    float threshold = nearest * (1.0f + DEPTH_BIAS);
+    for (int y = y0 >> level_index; y <= y1 >> level_index; ++y) {
+        const float *row =
+                level.depth.data() + static_cast<std::size_t>(y) * level.width;
+        for (int x = x0 >> level_index; x <= x1 >> level_index; ++x) {
+            // something in this texel is no closer than the box
+            if (row[x] <= threshold) {
+                return true;
+            }
+        }
+    }
+    ++stats.occluded;
+    return false;
+}
+
+int OcclusionCuller::get_width() const {
+    return width;
+}
+
+int OcclusionCuller::get_height() const {
+    return height;
+}
+
+const std::vector<float> &OcclusionCuller::get_depth() const {
+    return levels[0].depth;
+}
+
+const OcclusionCuller::Stats &OcclusionCuller::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
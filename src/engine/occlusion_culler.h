@@ -0,0 +1,110 @@
+#pragma once
+#include "bounds.h"
+#include "vertex.h"
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <vector>
+#include <glm/mat4x4.hpp>
+
+namespace Charcoal {
+/**
+ * @class OcclusionCuller
+ * @brief Finds objects hidden behind others by rasterizing occluders into a
+ * small software depth buffer on the CPU, then testing object bounds against
+ * a hierarchical-Z (Hi-Z) pyramid built from it.
+ *
+ * Each frame: begin() with the camera, add_occluder() for the meshes that
+ * hide things (large and simple ones work best), build_pyramid(), then test()
+ * each object that survived frustum culling.
+ *
+ * Depth is stored as 1 / w, the reciprocal of the distance in front of the
+ * camera, which is linear in screen space and doesn't depend on the
+ * projection's depth range, so the same buffer works with reversed and
+ * infinite depth. 0 means nothing was drawn there. Rows are rasterized 4
+ * pixels at a time with SSE2 or NEON.
+ *
+ * Results are conservative for objects, which are only reported hidden when
+ * every buffer pixel their screen rectangle touches is in front of them.
+ * Occluders cover a pixel when they cover its center, like the GPU does.
+ */
+class OcclusionCuller {
+public:
+    struct Stats {
+        std::size_t occluder_triangles = 0;
+        std::size_t tested = 0;
+        std::size_t occluded = 0;
+    };
+
+    static constexpr int DEFAULT_WIDTH = 320;
+    static constexpr int DEFAULT_HEIGHT = 192;
+
+private:
+    struct Level {
+        int width;
+        int height;
+        // each texel holds the furthest depth (smallest 1 / w) of the texels
+        // it covers in the level below
+        std::vector<float> depth;
+    };
+
+    int width;
+    int height;
+    glm::mat4 view_projection{1.0f};
+    // for buffers that only live during an add_occluder() call
+    std::pmr::memory_resource *scratch = std::pmr::get_default_resource();
+    // levels[0] is the depth buffer itself
+    std::vector<Level> levels;
+    Stats stats;
+
+public:
+    /**
+     * @param width Buffer width in pixels. Rounded up to a multiple of 4.
+     * @param height Buffer height in pixels
+     */
+    OcclusionCuller(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT);
+
+    /**
+     * @brief Clears the depth buffer and stats for a new frame.
+     * @param view_projection The camera's projection * view matrix
+     * @param scratch Where temporary buffers are allocated until the next
+     * begin(), such as a FrameArena's resource
+     */
+    void begin(const glm::mat4 &view_projection,
+            std::pmr::memory_resource *scratch =
+                    std::pmr::get_default_resource());
+
+    /**
+     * @brief Rasterizes a mesh's triangles into the depth buffer. Both sides
+     * of a triangle occlude. Triangles crossing the camera plane are skipped.
+     *
+     * @param verts The mesh's vertices
+     * @param indices Triangle list indices into verts
+     * @param transform Object to world matrix
+     */
+    void add_occluder(std::span<const Vertex> verts,
+            std::span<const int> indices, const glm::mat4 &transform);
+
+    /**
+     * @brief Builds the Hi-Z pyramid. Call after the last add_occluder() and
+     * before test().
+     */
+    void build_pyramid();
+
+    /**
+     * @brief Checks whether a box might be visible, using the pyramid level
+     * where its screen rectangle covers at most 4x4 texels.
+     *
+     * @param world_box The object's bounds in world space
+     * @return false only if the box is entirely behind occluders
+     */
+    bool test(const Aabb &world_box);
+
+    int get_width() const;
+    int get_height() const;
+    // the depth buffer, row-major with the bottom row first
+    const std::vector<float> &get_depth() const;
+    // since the last begin()
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,412 @@
+#include "pixel_convert.h"
+#include "simd.h"
+#include <SDL3/SDL_cpuinfo.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace Charcoal::PixelConvert {
+namespace {
+constexpr int LINEAR_TO_SRGB_LUT_SIZE = 4096;
+
+// Rounded division by 255, exact for any product of two bytes.
+// Every SIMD path below implements this same formula.
+uint8_t mul_div255(unsigned c, unsigned a) {
+    unsigned t = c * a + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+float srgb_to_linear_exact(float srgb) {
+    if (srgb <= 0.04045f) {
+        return srgb / 12.92f;
+    }
+    return std::pow((srgb + 0.055f) / 1.055f, 2.4f);
+}
+
+float linear_to_srgb_exact(float linear) {
+    if (linear <= 0.0031308f) {
+        return linear * 12.92f;
+    }
+    return 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+const std::array<uint8_t, 256> &srgb_to_linear8_lut() {
+    static const std::array<uint8_t, 256> lut = [] {
+        std::array<uint8_t, 256> table{};
+        for (int i = 0; i < 256; ++i) {
+            float linear = srgb_to_linear_exact(static_cast<float>(i) / 255.0f);
+            table[i] = static_cast<uint8_t>(std::lround(linear * 255.0f));
+        }
+        return table;
+    }();
+    return lut;
+}
+
+const std::array<uint8_t, LINEAR_TO_SRGB_LUT_SIZE> &linear_to_srgb8_lut() {
+    static const std::array<uint8_t, LINEAR_TO_SRGB_LUT_SIZE> lut = [] {
+        std::array<uint8_t, LINEAR_TO_SRGB_LUT_SIZE> table{};
+        for (int i = 0; i < LINEAR_TO_SRGB_LUT_SIZE; ++i) {
+            float linear = static_cast<float>(i) /
+                           static_cast<float>(LINEAR_TO_SRGB_LUT_SIZE - 1);
+            table[i] = static_cast<uint8_t>(
+                    std::lround(linear_to_srgb_exact(linear) * 255.0f));
+        }
+        return table;
+    }();
+    return lut;
+}
+
+#if defined(CHARCOAL_SIMD_X86)
+bool has_ssse3() {
+    static const bool supported = SDL_HasSSSE3();
+    return supported;
+}
+
+// Each kernel converts as many whole blocks as it can and returns the number
+// of pixels it handled. The scalar code finishes off the remainder.
+
+CHARCOAL_TARGET("ssse3")
+std::size_t rgb24_to_rgba32_ssse3(
+        const uint8_t *src, uint8_t *dst, std::size_t count, bool swap_rb) {
+    const __m128i shuffle =
+            swap_rb ? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11,
+                              10, 9, -1)
+                    : _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9,
+                              10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    std::size_t i = 0;
+    // 16 pixels per iteration: 48 bytes in, 64 bytes out
+    for (; i + 16 <= count; i += 16) {
+        const uint8_t *s = src + i * 3;
+        __m128i in0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+        __m128i in1 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16));
+        __m128i in2 =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 32));
+
+        // realign so each register starts on a pixel boundary
+        __m128i px0 = in0;
+        __m128i px1 = _mm_alignr_epi8(in1, in0, 12);
+        __m128i px2 = _mm_alignr_epi8(in2, in1, 8);
+        __m128i px3 = _mm_srli_si128(in2, 4);
+
+        __m128i *d = reinterpret_cast<__m128i *>(dst + i * 4);
+        _mm_storeu_si128(d + 0,
+                _mm_or_si128(_mm_shuffle_epi8(px0, shuffle), alpha));
+        _mm_storeu_si128(d + 1,
+                _mm_or_si128(_mm_shuffle_epi8(px1, shuffle), alpha));
+        _mm_storeu_si128(d + 2,
+                _mm_or_si128(_mm_shuffle_epi8(px2, shuffle), alpha));
+        _mm_storeu_si128(d + 3,
+                _mm_or_si128(_mm_shuffle_epi8(px3, shuffle), alpha));
+    }
+    return i;
+}
+
+CHARCOAL_TARGET("ssse3")
+std::size_t bgra32_to_rgba32_ssse3(
+        const uint8_t *src, uint8_t *dst, std::size_t count) {
+    const __m128i shuffle = _mm_setr_epi8(
+            2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+                _mm_shuffle_epi8(px, shuffle));
+    }
+    return i;
+}
+
+CHARCOAL_TARGET("ssse3")
+__m128i premultiply_half_ssse3(__m128i px16) {
+    // px16 holds two pixels widened to 16 bits per channel. Broadcast each
+    // pixel's alpha to its color lanes, and use 255 for the alpha lane so
+    // alpha comes out unchanged.
+    const __m128i alpha_shuffle = _mm_setr_epi8(
+            6, 7, 6, 7, 6, 7, -1, -1, 14, 15, 14, 15, 14, 15, -1, -1);
+    const __m128i alpha_lane = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+    __m128i mul = _mm_or_si128(
+            _mm_shuffle_epi8(px16, alpha_shuffle), alpha_lane);
+    __m128i t = _mm_add_epi16(
+            _mm_mullo_epi16(px16, mul), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+CHARCOAL_TARGET("ssse3")
+std::size_t premultiply_alpha_ssse3(uint8_t *pixels, std::size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i *p = reinterpret_cast<__m128i *>(pixels + i * 4);
+        __m128i px = _mm_loadu_si128(p);
+        __m128i lo = premultiply_half_ssse3(_mm_unpacklo_epi8(px, zero));
+        __m128i hi = premultiply_half_ssse3(_mm_unpackhi_epi8(px, zero));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+    return i;
+}
+#elif defined(CHARCOAL_SIMD_NEON)
+std::size_t rgb24_to_rgba32_neon(
+        const uint8_t *src, uint8_t *dst, std::size_t count, bool swap_rb) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t in = vld3q_u8(src + i * 3);
+        uint8x16x4_t out;
+        out.val[0] = swap_rb ? in.val[2] : in.val[0];
+        out.val[1] = in.val[1];
+        out.val[2] = swap_rb ? in.val[0] : in.val[2];
+        out.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + i * 4, out);
+    }
+    return i;
+}
+
+std::size_t bgra32_to_rgba32_neon(
+        const uint8_t *src, uint8_t *dst, std::size_t count) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t px = vld4q_u8(src + i * 4);
+        uint8x16_t blue = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = blue;
+        vst4q_u8(dst + i * 4, px);
+    }
+    return i;
+}
+
+uint8x8_t premultiply_neon(uint8x8_t c, uint8x8_t a) {
+    // vraddhn(t, (t + 128) >> 8) == (t + 128 + ((t + 128) >> 8)) >> 8
+    uint16x8_t t = vmull_u8(c, a);
+    return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+std::size_t premultiply_alpha_neon(uint8_t *pixels, std::size_t count) {
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t px = vld4q_u8(pixels + i * 4);
+        uint8x8_t a_lo = vget_low_u8(px.val[3]);
+        uint8x8_t a_hi = vget_high_u8(px.val[3]);
+        for (int c = 0; c < 3; ++c) {
+            px.val[c] = vcombine_u8(
+                    premultiply_neon(vget_low_u8(px.val[c]), a_lo),
+                    premultiply_neon(vget_high_u8(px.val[c]), a_hi));
+        }
+        vst4q_u8(pixels + i * 4, px);
+    }
+    return i;
+}
+#endif
+} // namespace
+
+void rgb24_to_rgba32(
+        const uint8_t *src, uint8_t *dst, std::size_t count, bool swap_rb) {
+    std::size_t i = 0;
+#if defined(CHARCOAL_SIMD_X86)
+    if (has_ssse3()) {
+        i = rgb24_to_rgba32_ssse3(src, dst, count, swap_rb);
+    }
+#elif defined(CHARCOAL_SIMD_NEON)
+    i = rgb24_to_rgba32_neon(src, dst, count, swap_rb);
+#endif
+    int r = swap_rb ? 2 : 0;
+    int b = swap_rb ? 0 : 2;
+    for (; i < count; ++i) {
+        const uint8_t *s = src + i * 3;
+        uint8_t *d = dst + i * 4;
+        d[0] = s[r];
+        d[1] = s[1];
+        d[2] = s[b];
+        d[3] = 255;
+    }
+}
+
+void bgra32_to_rgba32(const uint8_t *src, uint8_t *dst, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHARCOAL_SIMD_X86)
+    if (has_ssse3()) {
+        i = bgra32_to_rgba32_ssse3(src, dst, count);
+    }
+#elif defined(CHARCOAL_SIMD_NEON)
+    i = bgra32_to_rgba32_neon(src, dst, count);
+#endif
+    for (; i < count; ++i) {
+        const uint8_t *s = src + i * 4;
+        uint8_t *d = dst + i * 4;
+        // read everything first in case src == dst
+        uint8_t blue = s[0];
+        uint8_t green = s[1];
+        uint8_t red = s[2];
+        uint8_t alpha = s[3];
+        d[0] = red;
+        d[1] = green;
+        d[2] = blue;
+        d[3] = alpha;
+    }
+}
+
+void expand_palette8(const uint8_t *src, const SDL_Color *palette,
+        int palette_size, uint8_t *dst, std::size_t count) {
+    // Gathers don't beat a table lookup here, so build a packed table once
+    // and do one 32-bit store per pixel
+    std::array<uint32_t, 256> lut{};
+    int colors = std::clamp(palette_size, 0, 256);
+    for (int i = 0; i < 256; ++i) {
+        uint8_t rgba[4] = {0, 0, 0, 255};
+        if (i < colors) {
+            rgba[0] = palette[i].r;
+            rgba[1] = palette[i].g;
+            rgba[2] = palette[i].b;
+            rgba[3] = palette[i].a;
+        }
+        std::copy_n(rgba, 4, reinterpret_cast<uint8_t *>(&lut[i]));
+    }
+
+    uint32_t *out = reinterpret_cast<uint32_t *>(dst);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        out[i + 0] = lut[src[i + 0]];
+        out[i + 1] = lut[src[i + 1]];
+        out[i + 2] = lut[src[i + 2]];
+        out[i + 3] = lut[src[i + 3]];
+    }
+    for (; i < count; ++i) {
+        out[i] = lut[src[i]];
+    }
+}
+
+void premultiply_alpha(uint8_t *pixels, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHARCOAL_SIMD_X86)
+    if (has_ssse3()) {
+        i = premultiply_alpha_ssse3(pixels, count);
+    }
+#elif defined(CHARCOAL_SIMD_NEON)
+    i = premultiply_alpha_neon(pixels, count);
+#endif
+    for (; i < count; ++i) {
+        uint8_t *p = pixels + i * 4;
+        p[0] = mul_div255(p[0], p[3]);
+        p[1] = mul_div255(p[1], p[3]);
+        p[2] = mul_div255(p[2], p[3]);
+    }
+}
+
+void srgb_to_linear8(uint8_t *pixels, std::size_t count) {
+    const std::array<uint8_t, 256> &lut = srgb_to_linear8_lut();
+    for (std::size_t i = 0; i < count; ++i) {
+        uint8_t *p = pixels + i * 4;
+        p[0] = lut[p[0]];
+        p[1] = lut[p[1]];
+        p[2] = lut[p[2]];
+    }
+}
+
+const float *srgb_to_linear_lut() {
+    static const std::array<float, 256> lut = [] {
+        std::array<float, 256> table{};
+        for (int i = 0; i < 256; ++i) {
+            table[i] = srgb_to_linear_exact(static_cast<float>(i) / 255.0f);
+        }
+        return table;
+    }();
+    return lut.data();
+}
+
+uint8_t linear_to_srgb8(float linear) {
+    // the comparison is written so NaN also lands on 0
+    if (!(linear > 0.0f)) {
+        return 0;
+    }
+    if (linear >= 1.0f) {
+        return 255;
+    }
+    int index = static_cast<int>(
+            linear * static_cast<float>(LINEAR_TO_SRGB_LUT_SIZE - 1) + 0.5f);
+    return linear_to_srgb8_lut()[index];
+}
+
+bool is_supported(SDL_PixelFormat format) {
+    switch (format) {
+        case SDL_PIXELFORMAT_RGB24:
+        case SDL_PIXELFORMAT_BGR24:
+        case SDL_PIXELFORMAT_BGRA32:
+        case SDL_PIXELFORMAT_INDEX8:
+            return true;
+        default:
+            return false;
+    }
+}
+
+SDL_Surface *convert_to_rgba32(SDL_Surface *surface) {
+    if (surface == nullptr || !is_supported(surface->format)) {
+        return nullptr;
+    }
+    // the kernels copy alpha as-is, SDL turns the colour key into alpha
+    if (SDL_SurfaceHasColorKey(surface)) {
+        return nullptr;
+    }
+
+    SDL_Palette *palette = nullptr;
+    if (surface->format == SDL_PIXELFORMAT_INDEX8) {
+        palette = SDL_GetSurfacePalette(surface);
+        if (palette == nullptr) {
+            return nullptr;
+        }
+    }
+
+    SDL_Surface *converted =
+            SDL_CreateSurface(surface->w, surface->h, SDL_PIXELFORMAT_RGBA32);
+    if (converted == nullptr) {
+        return nullptr;
+    }
+
+    // RLE surfaces need to be locked before their pixels can be read
+    if (!SDL_LockSurface(surface)) {
+        SDL_DestroySurface(converted);
+        return nullptr;
+    }
+
+    std::size_t width = static_cast<std::size_t>(surface->w);
+    std::size_t height = static_cast<std::size_t>(surface->h);
+    std::size_t src_bpp = SDL_BYTESPERPIXEL(surface->format);
+
+    // convert the whole image in one go when neither side has row padding,
+    // which keeps the SIMD loops busy across row boundaries
+    std::size_t rows = height;
+    std::size_t row_pixels = width;
+    if (static_cast<std::size_t>(surface->pitch) == width * src_bpp &&
+            static_cast<std::size_t>(converted->pitch) == width * 4) {
+        rows = 1;
+        row_pixels = width * height;
+    }
+
+    for (std::size_t y = 0; y < rows; ++y) {
+        const uint8_t *src = static_cast<const uint8_t *>(surface->pixels) +
+                             y * static_cast<std::size_t>(surface->pitch);
+        uint8_t *dst = static_cast<uint8_t *>(converted->pixels) +
+                       y * static_cast<std::size_t>(converted->pitch);
+        switch (surface->format) {
+            case SDL_PIXELFORMAT_RGB24:
+                rgb24_to_rgba32(src, dst, row_pixels, false);
+                break;
+            case SDL_PIXELFORMAT_BGR24:
+                rgb24_to_rgba32(src, dst, row_pixels, true);
+                break;
+            case SDL_PIXELFORMAT_BGRA32:
+                bgra32_to_rgba32(src, dst, row_pixels);
+                break;
+            case SDL_PIXELFORMAT_INDEX8:
+                expand_palette8(src, palette->colors, palette->ncolors, dst,
+                        row_pixels);
+                break;
+            default:
+                break;
+        }
+    }
+
+    SDL_UnlockSurface(surface);
+    return converted;
+}
+} // namespace Charcoal::PixelConvert
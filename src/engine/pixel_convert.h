@@ -0,0 +1,95 @@
+#pragma once
+#include <SDL3/SDL_pixels.h>
+#include <SDL3/SDL_surface.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Pixel format conversion kernels used when loading textures.
+ *
+ * All kernels output SDL_PIXELFORMAT_RGBA32 (bytes R, G, B, A in memory),
+ * which is what GpuTexture uploads. They pick an SSSE3 or NEON path at
+ * runtime when one is available and produce identical results to the scalar
+ * fallback.
+ */
+namespace Charcoal::PixelConvert {
+/**
+ * @brief Expands packed 24-bit pixels to 32-bit RGBA with opaque alpha.
+ *
+ * @param src Source pixels, 3 bytes each
+ * @param dst Destination pixels, 4 bytes each. Must not overlap src.
+ * @param count Number of pixels
+ * @param swap_rb If true, the source is BGR24 instead of RGB24
+ */
+void rgb24_to_rgba32(
+        const uint8_t *src, uint8_t *dst, std::size_t count, bool swap_rb);
+
+/**
+ * @brief Swaps the red and blue channels of 32-bit pixels.
+ * Converts BGRA32 to RGBA32 and vice versa. src and dst may be the same.
+ *
+ * @param src Source pixels, 4 bytes each
+ * @param dst Destination pixels, 4 bytes each
+ * @param count Number of pixels
+ */
+void bgra32_to_rgba32(const uint8_t *src, uint8_t *dst, std::size_t count);
+
+/**
+ * @brief Expands 8-bit palette indices to 32-bit RGBA.
+ *
+ * @param src Palette indices, 1 byte each
+ * @param palette The palette colors
+ * @param palette_size Number of colors in the palette. Indices past the end
+ * expand to opaque black.
+ * @param dst Destination pixels, 4 bytes each
+ * @param count Number of pixels
+ */
+void expand_palette8(const uint8_t *src, const SDL_Color *palette,
+        int palette_size, uint8_t *dst, std::size_t count);
+
+/**
+ * @brief Multiplies the color channels of RGBA32 pixels by their alpha, in
+ * place. Results are rounded to the nearest integer.
+ *
+ * @param pixels RGBA32 pixels
+ * @param count Number of pixels
+ */
+void premultiply_alpha(uint8_t *pixels, std::size_t count);
+
+/**
+ * @brief Converts the color channels of RGBA32 pixels from sRGB to linear
+ * using a lookup table, in place. Alpha is left untouched.
+ *
+ * @param pixels RGBA32 pixels
+ * @param count Number of pixels
+ */
+void srgb_to_linear8(uint8_t *pixels, std::size_t count);
+
+/**
+ * @brief Returns a 256 entry table mapping 8-bit sRGB values to linear
+ * values in [0.0f, 1.0f].
+ */
+const float *srgb_to_linear_lut();
+
+/**
+ * @brief Converts a linear value in [0.0f, 1.0f] to 8-bit sRGB, rounding to
+ * the nearest value. Inputs outside the range are clamped.
+ */
+uint8_t linear_to_srgb8(float linear);
+
+/**
+ * @brief Checks whether convert_to_rgba32() has a fast path for the format.
+ */
+bool is_supported(SDL_PixelFormat format);
+
+/**
+ * @brief Converts a surface to a new SDL_PIXELFORMAT_RGBA32 surface using the
+ * kernels above. The source surface is not modified or freed.
+ *
+ * @param surface The surface to convert
+ * @return A new surface, or nullptr if the format isn't supported (see
+ * is_supported()), the surface has a colour key, or allocation failed. In
+ * that case the caller should fall back to SDL_ConvertSurface.
+ */
+SDL_Surface *convert_to_rgba32(SDL_Surface *surface);
+} // namespace Charcoal::PixelConvert
@@ -0,0 +1,185 @@
+#include "program_cache.h"
+#include "gl_extensions.h"
+#include "hash.h"
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Charcoal {
+namespace {
+// bump when the file layout changes
+constexpr uint32_t FILE_VERSION = 1;
+constexpr char FILE_MAGIC[4] = {'C', 'P', 'R', 'G'};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t driver_hash;
+    uint64_t source_hash;
+    uint32_t binary_format;
+    uint32_t binary_size;
+};
+
+uint64_t hash_gl_string(GLenum name, uint64_t seed) {
+    const GLubyte *value = glGetString(name);
+    if (value == nullptr) {
+        return seed;
+    }
+    return Hash::fnv1a64(reinterpret_cast<const char *>(value), seed);
+}
+} // namespace
+
+ProgramCache::ProgramCache(std::string directory) :
+        directory{std::move(directory)}, driver_hash{0},
+        enabled{GlExtensions::get().program_binaries} {
+    if (!enabled) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_RENDER,
+                "Program binaries unsupported, shaders will always be "
+                "compiled from source");
+        return;
+    }
+    if (!this->directory.empty() && this->directory.back() != '/') {
+        this->directory.push_back('/');
+    }
+    if (!SDL_CreateDirectory(this->directory.c_str())) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                "Unable to create program cache directory \"%s\": %s",
+                this->directory.c_str(), SDL_GetError());
+        enabled = false;
+        return;
+    }
+
+    driver_hash = hash_gl_string(GL_VENDOR, Hash::FNV_OFFSET_BASIS);
+    driver_hash = hash_gl_string(GL_RENDERER, driver_hash);
+    driver_hash = hash_gl_string(GL_VERSION, driver_hash);
+}
+
+uint64_t ProgramCache::source_hash(const char *vert_src, const char *frag_src) {
+    // hash the lengths too, so moving text between stages changes the key
+    std::string_view vert{vert_src};
+    std::string_view frag{frag_src};
+    uint64_t hash = Hash::combine(Hash::fnv1a64(vert), vert.size());
+    return Hash::combine(hash, Hash::combine(Hash::fnv1a64(frag), frag.size()));
+}
+
+std::string ProgramCache::path_for(uint64_t source_hash) const {
+    char name[32];
+    SDL_snprintf(name, sizeof(name), "%016llx.bin",
+            static_cast<unsigned long long>(source_hash));
+    return directory + name;
+}
+
+GLuint ProgramCache::load(uint64_t source_hash) {
+    if (!enabled) {
+        return 0;
+    }
+    std::string path = path_for(source_hash);
+    std::size_t file_size = 0;
+    void *file_data = SDL_LoadFile(path.c_str(), &file_size);
+    if (file_data == nullptr) {
+        ++stats.misses;
+        return 0;
+    }
+
+    FileHeader header;
+    bool valid = file_size >= sizeof(header);
+    if (valid) {
+        std::memcpy(&header, file_data, sizeof(header));
+        bool magic_matches =
+                std::memcmp(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0;
+        valid = magic_matches && header.version == FILE_VERSION &&
+                header.driver_hash == driver_hash &&
+                header.source_hash == source_hash &&
+                file_size - sizeof(header) == header.binary_size;
+    }
+
+    GLuint program = 0;
+    if (valid) {
+        program = glCreateProgram();
+        GlExtensions::program_binary(program, header.binary_format,
+                static_cast<const char *>(file_data) + sizeof(header),
+                static_cast<GLsizei>(header.binary_size));
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success == GL_FALSE) {
+            // the driver can reject binaries for reasons of its own
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    SDL_free(file_data);
+
+    if (program == 0) {
+        SDL_LogDebug(SDL_LOG_CATEGORY_RENDER,
+                "Discarding stale program binary \"%s\"", path.c_str());
+        ++stats.rejected;
+        ++stats.misses;
+        return 0;
+    }
+    ++stats.hits;
+    return program;
+}
+
+void ProgramCache::prepare(GLuint program) const {
+    if (enabled) {
+        GlExtensions::program_parameteri(
+                program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void ProgramCache::store(uint64_t source_hash, GLuint program) {
+    if (!enabled) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> data(
+            sizeof(FileHeader) + static_cast<std::size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    GlExtensions::get_program_binary(program, length, &written, &format,
+            data.data() + sizeof(FileHeader));
+    if (written <= 0) {
+        return;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    header.version = FILE_VERSION;
+    header.driver_hash = driver_hash;
+    header.source_hash = source_hash;
+    header.binary_format = format;
+    header.binary_size = static_cast<uint32_t>(written);
+    std::memcpy(data.data(), &header, sizeof(header));
+
+    // write then rename, so a crash never leaves a half-written entry behind
+    std::string path = path_for(source_hash);
+    std::string temp_path = path + ".tmp";
+    if (!SDL_SaveFile(temp_path.c_str(), data.data(),
+                sizeof(FileHeader) + static_cast<std::size_t>(written)) ||
+            !SDL_RenamePath(temp_path.c_str(), path.c_str())) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                "Unable to write program binary \"%s\": %s", path.c_str(),
+                SDL_GetError());
+        return;
+    }
+    ++stats.stored;
+}
+
+bool ProgramCache::is_enabled() const {
+    return enabled;
+}
+
+const ProgramCache::Stats &ProgramCache::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
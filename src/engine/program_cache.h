@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <string>
+
+namespace Charcoal {
+/**
+ * @class ProgramCache
+ * @brief Stores linked shader programs on disk with glGetProgramBinary, so
+ * later launches can skip compiling and linking GLSL.
+ *
+ * Each entry is keyed by a hash of the program's sources and tagged with the
+ * driver's vendor, renderer, and version strings. A driver update, a
+ * different GPU, or a binary the driver refuses all count as a miss, and the
+ * caller compiles from source as usual.
+ */
+class ProgramCache {
+public:
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        // entries found on disk that the current driver couldn't use
+        std::size_t rejected = 0;
+        std::size_t stored = 0;
+    };
+
+private:
+    std::string directory;
+    uint64_t driver_hash;
+    bool enabled;
+    Stats stats;
+
+    std::string path_for(uint64_t source_hash) const;
+
+public:
+    /**
+     * @brief Must be created with a current GL context, after
+     * GlExtensions::load(). Does nothing if the driver can't save program
+     * binaries.
+     *
+     * @param directory Directory the cache files are written to. Created if
+     * it doesn't exist.
+     */
+    explicit ProgramCache(std::string directory);
+
+    /**
+     * @brief Returns a key for a vertex and fragment shader pair.
+     */
+    static uint64_t source_hash(const char *vert_src, const char *frag_src);
+
+    /**
+     * @brief Creates a program from a cached binary.
+     *
+     * @param source_hash The key from source_hash()
+     * @return A linked program, or 0 if there's no usable binary
+     */
+    GLuint load(uint64_t source_hash);
+
+    /**
+     * @brief Asks the driver to keep the program's binary around. Call
+     * before glLinkProgram on programs that will be passed to store().
+     */
+    void prepare(GLuint program) const;
+
+    /**
+     * @brief Writes a linked program's binary to disk.
+     *
+     * @param source_hash The key from source_hash()
+     * @param program A successfully linked program
+     */
+    void store(uint64_t source_hash, GLuint program);
+
+    bool is_enabled() const;
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
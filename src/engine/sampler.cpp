@@ -0,0 +1,78 @@
+#include "sampler.h"
+#include "gl_extensions.h"
+#include "hash.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace Charcoal {
+
+Sampler::Sampler(const SamplerDesc &desc) : id{0} {
+    glGenSamplers(1, &id);
+    glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER,
+            static_cast<GLint>(desc.min_filter));
+    glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER,
+            static_cast<GLint>(desc.mag_filter));
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_S, static_cast<GLint>(desc.wrap_s));
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_T, static_cast<GLint>(desc.wrap_t));
+
+    const GlExtensions::Support &support = GlExtensions::get();
+    if (support.anisotropic_filtering && desc.max_anisotropy > 1.0f) {
+        glSamplerParameterf(id, GL_TEXTURE_MAX_ANISOTROPY,
+                std::min(desc.max_anisotropy, support.max_anisotropy));
+    }
+}
+
+Sampler::Sampler(Sampler &&other) noexcept : id{other.id} {
+    other.id = 0;
+}
+
+Sampler &Sampler::operator=(Sampler &&other) noexcept {
+    if (this != &other) {
+        if (id != 0) {
+            glDeleteSamplers(1, &id);
+        }
+        this->id = other.id;
+        other.id = 0;
+    }
+    return *this;
+}
+
+Sampler::~Sampler() noexcept {
+    if (id != 0) {
+        glDeleteSamplers(1, &id);
+    }
+}
+
+void Sampler::bind(GLuint unit) const {
+    glBindSampler(unit, id);
+}
+
+bool Sampler::is_valid() const {
+    return id != 0;
+}
+
+std::size_t SamplerCache::DescHash::operator()(const SamplerDesc &desc) const {
+    uint64_t hash = Hash::combine(desc.min_filter, desc.mag_filter);
+    hash = Hash::combine(hash, Hash::combine(desc.wrap_s, desc.wrap_t));
+    return static_cast<std::size_t>(Hash::combine(
+            hash, std::bit_cast<uint32_t>(desc.max_anisotropy)));
+}
+
+const Sampler &SamplerCache::get(const SamplerDesc &desc) {
+    auto it = samplers.find(desc);
+    if (it == samplers.end()) {
+        it = samplers.emplace(desc, Sampler{desc}).first;
+    }
+    return it->second;
+}
+
+void SamplerCache::bind(GLuint unit, const SamplerDesc &desc) {
+    get(desc).bind(unit);
+}
+
+std::size_t SamplerCache::get_count() const {
+    return samplers.size();
+}
+
+} // namespace Charcoal
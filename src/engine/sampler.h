@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+#include <unordered_map>
+
+namespace Charcoal {
+/**
+ * @class SamplerDesc
+ * @brief Describes how a texture is filtered and wrapped. Two equal
+ * descriptions always share the same sampler object.
+ */
+struct SamplerDesc {
+    GLenum min_filter = GL_LINEAR_MIPMAP_LINEAR;
+    GLenum mag_filter = GL_LINEAR;
+    GLenum wrap_s = GL_REPEAT;
+    GLenum wrap_t = GL_REPEAT;
+    // 1 disables anisotropic filtering. Clamped to what the driver supports.
+    float max_anisotropy = 1.0f;
+
+    bool operator==(const SamplerDesc &other) const = default;
+};
+
+/**
+ * @class Sampler
+ * @brief Owns a GL sampler object. Bound samplers override the filtering and
+ * wrapping state of whatever texture is bound to the same unit.
+ */
+class Sampler {
+    GLuint id;
+
+public:
+    explicit Sampler(const SamplerDesc &desc);
+
+    // move constructors
+    Sampler(Sampler &&other) noexcept;
+    Sampler &operator=(Sampler &&other) noexcept;
+
+    // don't allow copying
+    Sampler(const Sampler &other) = delete;
+    Sampler &operator=(const Sampler &other) = delete;
+
+    ~Sampler() noexcept;
+
+    /**
+     * @brief Binds the sampler to a texture unit.
+     * @param unit The unit index, 0 for GL_TEXTURE0
+     */
+    void bind(GLuint unit) const;
+
+    bool is_valid() const;
+};
+
+/**
+ * @class SamplerCache
+ * @brief Creates each distinct sampler once and hands it out to every
+ * material that asks for the same description.
+ */
+class SamplerCache {
+    struct DescHash {
+        std::size_t operator()(const SamplerDesc &desc) const;
+    };
+
+    std::unordered_map<SamplerDesc, Sampler, DescHash> samplers;
+
+public:
+    /**
+     * @brief Returns the sampler for a description, creating it on first use.
+     * Must be called with a current GL context.
+     */
+    const Sampler &get(const SamplerDesc &desc);
+
+    /**
+     * @brief Binds the sampler for a description to a texture unit.
+     * @param unit The unit index, 0 for GL_TEXTURE0
+     * @param desc Filter and wrap settings
+     */
+    void bind(GLuint unit, const SamplerDesc &desc);
+
+    std::size_t get_count() const;
+};
+} // namespace Charcoal
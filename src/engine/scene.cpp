@@ -1,32 +1,377 @@
 #include "scene.h"
+#include "mesh_file.h"
+#include "scene_file.h"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
 #include <glm/gtc/quaternion.hpp>
 
 namespace Charcoal {
+namespace {
+glm::mat4 to_matrix(const Transform &transform) {
+    return glm::translate(glm::mat4{1.0f}, transform.translation) *
+           glm::mat4_cast(transform.rotation) * glm::mat4{transform.scale};
+}
+
+void animate(World &world, ThreadPool *pool, float time) {
+    world.parallel_each<const Animation, Transform>(pool,
+            [time](Entity, const Animation &animation, Transform &transform) {
+                float t = time * animation.frequency + animation.phase;
+                transform.translation = animation.origin +
+                                        animation.axis * std::sin(t) *
+                                                animation.amplitude;
+                transform.rotation = glm::quat{glm::vec3{0.0f, 0.0f,
+                        time * animation.spin + animation.phase}};
+            });
+}
+
+void update_world_transforms(World &world, ThreadPool *pool) {
+    world.parallel_each<const Transform, WorldTransform>(pool,
+            [](Entity, const Transform &transform,
+                    WorldTransform &world_transform) {
+                world_transform.matrix = to_matrix(transform);
+            });
+}
+
+// only animated objects move on their own, set_transform() handles the rest
+void update_animated_transforms(World &world, ThreadPool *pool) {
+    world.parallel_each<const Animation, const Transform, WorldTransform>(
+            pool, [](Entity, const Animation &, const Transform &transform,
+                          WorldTransform &world_transform) {
+                world_transform.matrix = to_matrix(transform);
+            });
+}
+
+bool is_json_path(std::string_view path) {
+    return path.ends_with(".json");
+}
+} // namespace
+
 Scene::Scene() {
+    constexpr std::size_t VERTEX_COUNT = 4;
+    constexpr std::size_t INDEX_COUNT = 6;
+    geometry.reserve(VERTEX_COUNT * sizeof(Vertex) + INDEX_COUNT * sizeof(int) +
+                     alignof(int));
+
+    // xyz rgb uv
+    std::span<Vertex> verts = geometry.allocate<Vertex>(VERTEX_COUNT);
+    verts[0] = {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}};
+    verts[1] = {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}};
+    verts[2] = {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}};
+    verts[3] = {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}};
+    std::span<int> indices = geometry.allocate<int>(INDEX_COUNT);
+    std::ranges::copy(std::initializer_list<int>{0, 1, 2, 2, 1, 3},
+            indices.begin());
+
+    MeshView quad_mesh;
+    quad_mesh.verts = verts;
+    quad_mesh.indices = indices;
+    quad_mesh.bounds = Bounds::from_vertices(quad_mesh.verts);
+    meshes.push_back(quad_mesh);
+    mesh_names.push_back(std::string{BUILTIN_MESH_PREFIX} + "quad");
+
+    register_components(world);
+    add_systems();
+
+    quad = spawn(0, Transform{});
+    Animation animation;
+    animation.amplitude = 0.5f;
+    animation.spin = glm::pi<float>();
+    world.add(quad, animation);
 }
 
 Scene::~Scene() {
 }
 
-void Scene::update(const Time &time) {
-    // TODO
-    float time_value = time.ns_to_f32(time.get_total_time());
-    translation.x = std::sin(time_value) / 2.0f;
-    rotation = glm::qua(glm::vec3{0.0f, 0.0f, time_value * glm::pi<float>()});
-    t_dirty = true;
+void Scene::register_components(World &world) {
+    using Type = World::FieldType;
+    // glm stores quaternions as x, y, z, w
+    world.register_component<Transform>("transform",
+            {{"translation", Type::f32, 3, offsetof(Transform, translation)},
+                    {"rotation_xyzw", Type::f32, 4,
+                            offsetof(Transform, rotation)},
+                    {"scale", Type::f32, 1, offsetof(Transform, scale)}});
+    world.register_component<WorldTransform>("world_transform",
+            {{"matrix", Type::f32, 16, offsetof(WorldTransform, matrix)}});
+    // the proxy is rebuilt on load, so text files leave it out
+    world.register_component<MeshInstance>("mesh_instance",
+            {{"mesh", Type::u32, 1, offsetof(MeshInstance, mesh)}});
+    world.register_component<Animation>("animation",
+            {{"origin", Type::f32, 3, offsetof(Animation, origin)},
+                    {"axis", Type::f32, 3, offsetof(Animation, axis)},
+                    {"amplitude", Type::f32, 1,
+                            offsetof(Animation, amplitude)},
+                    {"frequency", Type::f32, 1,
+                            offsetof(Animation, frequency)},
+                    {"spin", Type::f32, 1, offsetof(Animation, spin)},
+                    {"phase", Type::f32, 1, offsetof(Animation, phase)}});
 }
 
-glm::mat4 Scene::get_local_transform_matrix() {
-    if (t_dirty) {
-        local_transform_matrix = glm::translate(glm::mat4{1.0f}, translation) *
-                                 glm::mat4_cast(rotation) * glm::mat4{scale};
-        t_dirty = false;
+void Scene::add_systems() {
+    systems.add("animate", component_mask<Animation>(),
+            component_mask<Transform>(),
+            [this](World &world, ThreadPool *pool) {
+                animate(world, pool, time_seconds);
+            });
+    systems.add("world_transforms", component_mask<Animation, Transform>(),
+            component_mask<WorldTransform>(), update_animated_transforms);
+    // the BVH isn't thread-safe, so this one stays on one thread. Static
+    // objects don't touch it, refit() only walks up from moved ones
+    systems.add("bvh_bounds",
+            component_mask<Animation, WorldTransform, MeshInstance>(), 0,
+            [this](World &world, ThreadPool *) {
+                world.each<const Animation, const WorldTransform,
+                        const MeshInstance>(
+                        [&](Entity, const Animation &,
+                                const WorldTransform &world_transform,
+                                const MeshInstance &instance) {
+                            const Bounds &bounds = meshes[instance.mesh].bounds;
+                            bvh.move(instance.proxy,
+                                    bounds.transformed(world_transform.matrix)
+                                            .box);
+                        });
+                bvh.refit();
+            });
+}
+
+void Scene::update(const Time &time, ThreadPool *pool) {
+    time_seconds = time.ns_to_f32(time.get_total_time());
+    systems.run(world, pool);
+}
+
+Entity Scene::spawn(uint32_t mesh, const Transform &transform) {
+    Entity entity = world.create(transform, WorldTransform{}, MeshInstance{});
+    WorldTransform &world_transform = *world.get<WorldTransform>(entity);
+    world_transform.matrix = to_matrix(transform);
+    MeshInstance &instance = *world.get<MeshInstance>(entity);
+    instance.mesh = mesh;
+    instance.proxy = bvh.insert(
+            meshes[mesh].bounds.transformed(world_transform.matrix).box,
+            entity.index);
+    return entity;
+}
+
+bool Scene::save(const char *path) const {
+    return is_json_path(path) ? SceneFile::write_json(path, world, mesh_names)
+                              : SceneFile::write(path, world, mesh_names);
+}
+
+bool Scene::load(const char *path, ThreadPool *pool) {
+    // loaded into a world of its own, so a bad file leaves this one alone
+    World loaded;
+    register_components(loaded);
+    std::vector<std::string> names;
+    SceneFile::Error error = is_json_path(path)
+                                     ? SceneFile::read_json(path, loaded, names)
+                                     : SceneFile::read(path, loaded, names);
+    if (error != SceneFile::Error::none) {
+        return false;
+    }
+    world = std::move(loaded);
+
+    std::vector<uint32_t> mesh_of_name;
+    mesh_of_name.reserve(names.size());
+    for (const std::string &name : names) {
+        mesh_of_name.push_back(find_mesh(name));
+    }
+    bool out_of_range = false;
+    world.each<MeshInstance>([&](Entity, MeshInstance &instance) {
+        if (instance.mesh < mesh_of_name.size()) {
+            instance.mesh = mesh_of_name[instance.mesh];
+        } else {
+            instance.mesh = 0;
+            out_of_range = true;
+        }
+    });
+    if (out_of_range) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" refers to meshes it doesn't name", path);
+    }
+
+    update_world_transforms(world, pool);
+    rebuild_bvh();
+    return true;
+}
+
+uint32_t Scene::find_mesh(const std::string &name) {
+    uint32_t index = get_mesh_index(name);
+    if (index != NO_MESH) {
+        return index;
+    }
+    MeshFile::Reader reader{name.c_str()};
+    if (!reader.is_valid()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to load mesh \"%s\", using %s instead", name.c_str(),
+                mesh_names[0].c_str());
+        return 0;
+    }
+    const MeshFile::View &view = reader.get_view();
+    if (!MeshFile::has_vertex_layout(view)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Mesh \"%s\" isn't in the engine's vertex layout, using %s "
+                "instead",
+                name.c_str(), mesh_names[0].c_str());
+        return 0;
+    }
+
+    // copied out of the mapping, since the file is closed after this
+    return add_mesh(name, geometry.store(view));
+}
+
+uint32_t Scene::add_mesh(std::string name, const MeshView &mesh) {
+    auto free = std::ranges::find(mesh_names, std::string{});
+    if (free != mesh_names.end()) {
+        auto index = static_cast<std::size_t>(free - mesh_names.begin());
+        meshes[index] = mesh;
+        *free = std::move(name);
+        return static_cast<uint32_t>(index);
     }
-    return local_transform_matrix;
+    meshes.push_back(mesh);
+    mesh_names.push_back(std::move(name));
+    return static_cast<uint32_t>(meshes.size() - 1);
 }
 
-const std::vector<Mesh> &Scene::get_meshes() const {
+void Scene::remove_mesh(uint32_t mesh) {
+    // mesh 0 is the fallback for missing meshes, so it never goes away
+    if (mesh == 0 || mesh >= meshes.size()) {
+        return;
+    }
+    meshes[mesh] = MeshView{};
+    mesh_names[mesh].clear();
+}
+
+uint32_t Scene::get_mesh_index(std::string_view name) const {
+    if (name.empty()) {
+        return NO_MESH;
+    }
+    auto it = std::ranges::find(mesh_names, name);
+    return it != mesh_names.end()
+                   ? static_cast<uint32_t>(it - mesh_names.begin())
+                   : NO_MESH;
+}
+
+void Scene::spawn_world(const World &source,
+        std::span<const uint32_t> mesh_of_source,
+        std::vector<Entity> &spawned) {
+    std::size_t first = spawned.size();
+    std::vector<World::ColumnSource> columns;
+    for (std::size_t a = 0; a < source.get_archetype_count(); ++a) {
+        ComponentMask mask = source.get_archetype_mask(a);
+        for (std::size_t c = 0; c < source.get_chunk_count(a); ++c) {
+            columns.clear();
+            for (ComponentId id = 0; id < MAX_COMPONENTS; ++id) {
+                if (mask & (ComponentMask{1} << id)) {
+                    columns.push_back(
+                            {id, source.get_chunk_column(a, c, id)});
+                }
+            }
+            world.create_many(mask, source.get_chunk_entities(a, c).size(),
+                    columns, {}, &spawned);
+        }
+    }
+
+    for (std::size_t i = first; i < spawned.size(); ++i) {
+        Entity entity = spawned[i];
+        const Transform *transform = world.get<Transform>(entity);
+        WorldTransform *world_transform = world.get<WorldTransform>(entity);
+        if (transform != nullptr && world_transform != nullptr) {
+            world_transform->matrix = to_matrix(*transform);
+        }
+        MeshInstance *instance = world.get<MeshInstance>(entity);
+        if (instance == nullptr) {
+            continue;
+        }
+        instance->mesh = instance->mesh < mesh_of_source.size()
+                                 ? mesh_of_source[instance->mesh]
+                                 : 0;
+        instance->proxy = Bvh::NONE;
+        if (world_transform != nullptr) {
+            // animated objects are kept up to date by the bvh_bounds system
+            const Bounds &bounds = meshes[instance->mesh].bounds;
+            instance->proxy = bvh.insert(
+                    bounds.transformed(world_transform->matrix).box,
+                    entity.index);
+        }
+    }
+}
+
+void Scene::set_transform(Entity entity, const Transform &transform) {
+    Transform *current = world.get<Transform>(entity);
+    WorldTransform *world_transform = world.get<WorldTransform>(entity);
+    if (current == nullptr || world_transform == nullptr) {
+        return;
+    }
+    *current = transform;
+    world_transform->matrix = to_matrix(transform);
+    const MeshInstance *instance = world.get<MeshInstance>(entity);
+    if (instance != nullptr && instance->proxy != Bvh::NONE) {
+        bvh.move(instance->proxy,
+                meshes[instance->mesh].bounds.transformed(
+                        world_transform->matrix).box);
+    }
+}
+
+void Scene::despawn(Entity entity) {
+    const MeshInstance *instance = world.get<MeshInstance>(entity);
+    if (instance != nullptr && instance->proxy != Bvh::NONE) {
+        bvh.remove(instance->proxy);
+    }
+    world.destroy(entity);
+}
+
+void Scene::rebuild_bvh() {
+    std::vector<Aabb> boxes;
+    std::vector<uint32_t> user_data;
+    boxes.reserve(world.get_stats().entity_count);
+    user_data.reserve(boxes.capacity());
+    world.each<const WorldTransform, MeshInstance>(
+            [&](Entity entity, const WorldTransform &world_transform,
+                    MeshInstance &instance) {
+                instance.proxy = static_cast<Bvh::ProxyId>(boxes.size());
+                boxes.push_back(meshes[instance.mesh]
+                                        .bounds
+                                        .transformed(world_transform.matrix)
+                                        .box);
+                user_data.push_back(entity.index);
+            });
+    bvh.build(boxes, user_data);
+}
+
+glm::mat4 Scene::get_local_transform_matrix() {
+    const WorldTransform *world_transform = world.get<WorldTransform>(quad);
+    return world_transform != nullptr ? world_transform->matrix
+                                      : glm::mat4{1.0f};
+}
+
+std::string_view Scene::get_mesh_name(uint32_t mesh) const {
+    return mesh < mesh_names.size() ? std::string_view{mesh_names[mesh]}
+                                    : std::string_view{};
+}
+
+const MeshView &Scene::get_object_mesh(uint32_t object) const {
+    return meshes[world.get<MeshInstance>(world.get_entity(object))->mesh];
+}
+
+uint32_t Scene::get_object_mesh_index(uint32_t object) const {
+    return world.get<MeshInstance>(world.get_entity(object))->mesh;
+}
+
+const glm::mat4 &Scene::get_object_transform(uint32_t object) const {
+    return world.get<WorldTransform>(world.get_entity(object))->matrix;
+}
+
+std::span<const MeshView> Scene::get_meshes() const {
     return meshes;
 }
+
+const Bvh &Scene::get_bvh() const {
+    return bvh;
+}
+
+World &Scene::get_world() {
+    return world;
+}
 } // namespace Charcoal
@@ -1,35 +1,186 @@
 #pragma once
 
+#include "bvh.h"
+#include "ecs.h"
+#include "geometry_arena.h"
 #include "time.h"
 #include "vertex.h"
 #include "mesh.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/ext/quaternion_float.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 namespace Charcoal {
-class Scene {
-    // xyz rgb uv
-    std::vector<Vertex> verts{
-            {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
-            {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
-            {{-0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-            {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}}};
-    std::vector<int> indices{0, 1, 2, 2, 1, 3};
-    std::vector<Mesh> meshes = {{verts, indices}};
-
-    // object transforms
-    glm::mat4 local_transform_matrix{1.0f};
-    glm::vec3 translation{0.0f, 0.0f, 0.0f};
-    glm::quat rotation{};
+// scene object components
+
+struct Transform {
+    glm::vec3 translation{0.0f};
+    glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
     float scale = 1.0f;
-    bool t_dirty = false;
+};
+
+// object to world matrix, computed from Transform when the object is
+// spawned or moved with Scene::set_transform(), and every update for
+// animated objects
+struct WorldTransform {
+    glm::mat4 matrix{1.0f};
+};
+
+struct MeshInstance {
+    // index into Scene::get_meshes()
+    uint32_t mesh = 0;
+    Bvh::ProxyId proxy = Bvh::NONE;
+};
+
+// bobs along an axis and spins around z. Only objects with one are updated
+// every frame
+struct Animation {
+    glm::vec3 origin{0.0f};
+    glm::vec3 axis{1.0f, 0.0f, 0.0f};
+    float amplitude = 0.0f;
+    // in radians per second
+    float frequency = 1.0f;
+    float spin = 0.0f;
+    float phase = 0.0f;
+};
+
+class Scene {
+public:
+    // names of meshes the scene makes itself start with this, others are
+    // mesh file paths
+    static constexpr std::string_view BUILTIN_MESH_PREFIX = "builtin/";
+    static constexpr uint32_t NO_MESH = UINT32_MAX;
+
+private:
+    // the vertices and indices of meshes the scene loads itself, in one block
+    // freed with the scene
+    GeometryArena geometry;
+    // an empty name marks a slot freed by remove_mesh()
+    std::vector<MeshView> meshes;
+    // what scene files call each of meshes
+    std::vector<std::string> mesh_names;
+
+    World world;
+    SystemScheduler systems;
+    // seconds since startup, for the systems
+    float time_seconds = 0.0f;
+    Entity quad;
+
+    // world-space bounds of every object, user data is the entity index
+    Bvh bvh;
+
+    void add_systems();
+    // index of the named mesh, loading it if it's a mesh file into the
+    // scene's own geometry. Falls back to mesh 0
+    uint32_t find_mesh(const std::string &name);
+    // rebuilds the BVH from scratch and sets every MeshInstance's proxy
+    void rebuild_bvh();
 
 public:
-    void update(const Time &time);
-    const std::vector<Mesh> &get_meshes() const;
+    /**
+     * @brief Runs the scene's systems: animation, then the transforms and
+     * BVH bounds of animated objects. Static objects cost nothing here.
+     *
+     * @param pool Spreads the systems' work across threads. May be null.
+     */
+    void update(const Time &time, ThreadPool *pool = nullptr);
+    std::span<const MeshView> get_meshes() const;
+    const Bvh &get_bvh() const;
+    World &get_world();
+
+    /**
+     * @brief Adds a mesh instance, with its bounds in the BVH.
+     *
+     * @param mesh Index into get_meshes()
+     */
+    Entity spawn(uint32_t mesh, const Transform &transform);
+
+    /**
+     * @brief Copies every entity of another world into the scene, such as
+     * one a scene file was read into on a worker thread.
+     *
+     * @param source A world with the scene's components registered
+     * @param mesh_of_source Scene mesh of each MeshInstance::mesh in source
+     * @param spawned The new handles are appended to it
+     */
+    void spawn_world(const World &source,
+            std::span<const uint32_t> mesh_of_source,
+            std::vector<Entity> &spawned);
+
+    /**
+     * @brief Moves an object without an Animation, updating its world
+     * transform and BVH bounds. Writing Transform directly has no effect on
+     * them. Animated objects are overwritten by the next update().
+     */
+    void set_transform(Entity entity, const Transform &transform);
+
+    /**
+     * @brief Destroys an object and takes it out of the BVH.
+     */
+    void despawn(Entity entity);
+
+    /**
+     * @brief Adds a mesh without copying it.
+     *
+     * @param name Unique name, stored in scene files
+     * @param mesh Has to stay alive until remove_mesh()
+     * @return The mesh's index, reusing removed ones
+     */
+    uint32_t add_mesh(std::string name, const MeshView &mesh);
+
+    /**
+     * @brief Frees a mesh's index for reuse. No object may use it anymore.
+     */
+    void remove_mesh(uint32_t mesh);
+
+    /**
+     * @brief Returns the index of the mesh with the given name, or NO_MESH.
+     */
+    uint32_t get_mesh_index(std::string_view name) const;
+
+    /**
+     * @brief Returns the name a mesh was added or loaded under, empty if
+     * its index was freed.
+     */
+    std::string_view get_mesh_name(uint32_t mesh) const;
+
+    // of an object returned by a BVH query
+    const MeshView &get_object_mesh(uint32_t object) const;
+    uint32_t get_object_mesh_index(uint32_t object) const;
+    const glm::mat4 &get_object_transform(uint32_t object) const;
+
+    /**
+     * @brief Saves every object to a scene file, as JSON if the path ends
+     * in .json.
+     *
+     * @return True on success. Failures are logged.
+     */
+    bool save(const char *path) const;
+
+    /**
+     * @brief Replaces every object with those of a scene file written by
+     * save(). Meshes it refers to are loaded from mesh files. Leaves the
+     * scene as it was if the file can't be read.
+     *
+     * @param pool Spreads computing transforms across threads. May be null.
+     * @return True on success. Failures are logged.
+     */
+    bool load(const char *path, ThreadPool *pool = nullptr);
+
+    /**
+     * @brief Names the scene's components in a world, with their fields, so
+     * scene files can store them.
+     */
+    static void register_components(World &world);
 
+    // of the quad every scene starts with, identity once a loaded scene
+    // removed it
     glm::mat4 get_local_transform_matrix();
 
     Scene();
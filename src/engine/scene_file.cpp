@@ -0,0 +1,747 @@
+#include "scene_file.h"
+#include "json.h"
+#include "mapped_file.h"
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace Charcoal::SceneFile {
+namespace {
+static_assert(std::is_trivially_copyable_v<Header>);
+static_assert(std::is_trivially_copyable_v<Entity>);
+static_assert(sizeof(Header) == 64 && sizeof(ComponentRecord) == 16 &&
+                      sizeof(MeshRecord) == 8 &&
+                      sizeof(ArchetypeRecord) == 24 && sizeof(Entity) == 8,
+        "changing these changes the file format, bump VERSION");
+static_assert(alignof(Header) <= ALIGNMENT &&
+              alignof(ArchetypeRecord) <= ALIGNMENT &&
+              alignof(Entity) <= ALIGNMENT);
+
+constexpr ComponentId NO_COMPONENT = MAX_COMPONENTS;
+// the JSON variant is written out whenever this much has been formatted
+constexpr std::size_t JSON_FLUSH_BYTES = 64 * 1024;
+
+uint64_t align_up(uint64_t offset) {
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// count elements of the given size at offset fit in the file, and start
+// where the reader can cast to them
+bool fits(uint64_t offset, uint64_t count, uint64_t element_size,
+        std::size_t file_size) {
+    if (offset % ALIGNMENT != 0 || offset > file_size) {
+        return false;
+    }
+    // counts come from the file, so divide rather than risk overflowing
+    return element_size == 0 || count <= (file_size - offset) / element_size;
+}
+
+bool write_bytes(SDL_IOStream *io, const void *data, std::size_t size) {
+    return size == 0 || SDL_WriteIO(io, data, size) == size;
+}
+
+// zeroes from the current position up to offset
+bool pad_to(SDL_IOStream *io, uint64_t offset) {
+    static constexpr std::array<std::byte, ALIGNMENT> ZEROES{};
+    Sint64 position = SDL_TellIO(io);
+    if (position < 0 || static_cast<uint64_t>(position) > offset) {
+        return false;
+    }
+    return write_bytes(io, ZEROES.data(),
+            static_cast<std::size_t>(offset - static_cast<uint64_t>(position)));
+}
+
+// opens path's temporary sibling, logging on failure
+SDL_IOStream *open_temp(const char *path, const std::string &temp_path) {
+    SDL_IOStream *io = SDL_IOFromFile(temp_path.c_str(), "wb");
+    if (io == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to write scene file \"%s\": %s", path, SDL_GetError());
+    }
+    return io;
+}
+
+// closes the temporary file and renames it over path
+bool finish_temp(const char *path, const std::string &temp_path,
+        SDL_IOStream *io, bool written) {
+    // closing flushes, which can fail too
+    written = SDL_CloseIO(io) && written;
+    if (!written || !SDL_RenamePath(temp_path.c_str(), path)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to write scene file \"%s\": %s", path, SDL_GetError());
+        SDL_RemovePath(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// which of the world's components get saved, in file order
+struct Saved {
+    std::vector<ComponentId> components;
+    // component id -> index into components, NO_COMPONENT if not saved
+    std::array<ComponentId, MAX_COMPONENTS> index_of;
+};
+
+Saved get_saved(const World &world) {
+    Saved saved;
+    saved.index_of.fill(NO_COMPONENT);
+    const std::vector<World::ComponentInfo> &infos = world.get_components();
+    for (ComponentId id = 0; id < infos.size(); ++id) {
+        if (!infos[id].name.empty()) {
+            saved.index_of[id] =
+                    static_cast<ComponentId>(saved.components.size());
+            saved.components.push_back(id);
+        }
+    }
+    return saved;
+}
+
+// size of an archetype's data: handles, then the columns in file order
+uint64_t get_data_size(uint64_t entity_count, const Saved &saved,
+        const std::vector<World::ComponentInfo> &infos, uint64_t mask) {
+    uint64_t size = entity_count * sizeof(Entity);
+    for (std::size_t i = 0; i < saved.components.size(); ++i) {
+        if (mask & (uint64_t{1} << i)) {
+            size = align_up(size) +
+                   entity_count * infos[saved.components[i]].size;
+        }
+    }
+    return size;
+}
+
+// the archetype's components as a mask over the file's component table
+uint64_t get_file_mask(ComponentMask mask, const Saved &saved) {
+    uint64_t file_mask = 0;
+    for (ComponentId id = 0; id < MAX_COMPONENTS; ++id) {
+        if ((mask & (ComponentMask{1} << id)) &&
+                saved.index_of[id] != NO_COMPONENT) {
+            file_mask |= uint64_t{1} << saved.index_of[id];
+        }
+    }
+    return file_mask;
+}
+
+bool write_archetype(SDL_IOStream *io, const World &world,
+        std::size_t archetype, const ArchetypeRecord &record,
+        const Saved &saved) {
+    if (!pad_to(io, record.data_offset)) {
+        return false;
+    }
+    std::size_t chunk_count = world.get_chunk_count(archetype);
+    for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        std::span<const Entity> entities =
+                world.get_chunk_entities(archetype, chunk);
+        if (!write_bytes(io, entities.data(), entities.size_bytes())) {
+            return false;
+        }
+    }
+    uint64_t offset = record.data_offset + record.entity_count * sizeof(Entity);
+    const std::vector<World::ComponentInfo> &infos = world.get_components();
+    for (std::size_t i = 0; i < saved.components.size(); ++i) {
+        if (!(record.components & (uint64_t{1} << i))) {
+            continue;
+        }
+        ComponentId id = saved.components[i];
+        std::size_t size = infos[id].size;
+        offset = align_up(offset);
+        if (!pad_to(io, offset)) {
+            return false;
+        }
+        for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            std::size_t count =
+                    world.get_chunk_entities(archetype, chunk).size();
+            if (!write_bytes(io,
+                        world.get_chunk_column(archetype, chunk, id),
+                        count * size)) {
+                return false;
+            }
+        }
+        offset += record.entity_count * size;
+    }
+    return true;
+}
+
+// -- JSON --
+
+void append_hex(std::string &out, const std::byte *data, std::size_t size) {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    out += '"';
+    for (std::size_t i = 0; i < size; ++i) {
+        auto value = static_cast<unsigned char>(data[i]);
+        out += DIGITS[value >> 4];
+        out += DIGITS[value & 0xF];
+    }
+    out += '"';
+}
+
+void append_field_value(
+        std::string &out, World::FieldType type, const std::byte *data) {
+    switch (type) {
+    case World::FieldType::f32: {
+        float value;
+        std::memcpy(&value, data, sizeof(value));
+        Json::append_number(out, value);
+        break;
+    }
+    case World::FieldType::u32: {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        out += std::to_string(value);
+        break;
+    }
+    case World::FieldType::i32: {
+        int32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        out += std::to_string(value);
+        break;
+    }
+    }
+}
+
+void append_component(std::string &out, const World::ComponentInfo &info,
+        const std::byte *data) {
+    if (info.fields.empty()) {
+        append_hex(out, data, info.size);
+        return;
+    }
+    out += '{';
+    for (std::size_t f = 0; f < info.fields.size(); ++f) {
+        const World::ComponentField &field = info.fields[f];
+        if (f > 0) {
+            out += ", ";
+        }
+        Json::append_string(out, field.name);
+        out += ": ";
+        if (field.count == 1) {
+            append_field_value(out, field.type, data + field.offset);
+            continue;
+        }
+        out += '[';
+        for (uint32_t i = 0; i < field.count; ++i) {
+            if (i > 0) {
+                out += ", ";
+            }
+            append_field_value(out, field.type,
+                    data + field.offset + i * sizeof(uint32_t));
+        }
+        out += ']';
+    }
+    out += '}';
+}
+
+bool read_hex(std::string_view text, std::byte *out, std::size_t size) {
+    if (text.size() != size * 2) {
+        return false;
+    }
+    auto digit = [](char c) -> int {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    };
+    for (std::size_t i = 0; i < size; ++i) {
+        int high = digit(text[i * 2]);
+        int low = digit(text[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        out[i] = static_cast<std::byte>(high << 4 | low);
+    }
+    return true;
+}
+
+void read_field_value(
+        const Json::Value &value, World::FieldType type, std::byte *out) {
+    switch (type) {
+    case World::FieldType::f32: {
+        auto number = static_cast<float>(value.as_number());
+        std::memcpy(out, &number, sizeof(number));
+        break;
+    }
+    case World::FieldType::u32: {
+        auto number = static_cast<uint32_t>(value.as_int());
+        std::memcpy(out, &number, sizeof(number));
+        break;
+    }
+    case World::FieldType::i32: {
+        auto number = static_cast<int32_t>(value.as_int());
+        std::memcpy(out, &number, sizeof(number));
+        break;
+    }
+    }
+}
+
+// fills a zeroed row from a component written by append_component().
+// Missing fields stay zero
+bool read_component(const Json::Value &value,
+        const World::ComponentInfo &info, std::byte *out) {
+    if (value.is_string()) {
+        return read_hex(value.as_string(), out, info.size);
+    }
+    if (!value.is_object() || info.fields.empty()) {
+        return false;
+    }
+    for (const World::ComponentField &field : info.fields) {
+        const Json::Value &member = value[field.name];
+        if (field.count == 1) {
+            read_field_value(member, field.type, out + field.offset);
+            continue;
+        }
+        for (uint32_t i = 0; i < field.count && i < member.size(); ++i) {
+            read_field_value(member[i], field.type,
+                    out + field.offset + i * sizeof(uint32_t));
+        }
+    }
+    return true;
+}
+
+// entities with the same components, gathered for World::create_many()
+struct Batch {
+    ComponentMask mask = 0;
+    std::vector<Entity> entities;
+    // one per component in mask, in ascending id order
+    std::vector<ComponentId> components;
+    std::vector<std::vector<std::byte>> columns;
+};
+} // namespace
+
+bool write(const char *path, const World &world,
+        std::span<const std::string> meshes) {
+    Saved saved = get_saved(world);
+    const std::vector<World::ComponentInfo> &infos = world.get_components();
+
+    std::string strings;
+    std::vector<ComponentRecord> component_records;
+    for (ComponentId id : saved.components) {
+        const World::ComponentInfo &info = infos[id];
+        component_records.push_back({static_cast<uint32_t>(strings.size()),
+                static_cast<uint32_t>(info.name.size()),
+                static_cast<uint32_t>(info.size),
+                static_cast<uint32_t>(info.alignment)});
+        strings += info.name;
+    }
+    std::vector<MeshRecord> mesh_records;
+    for (const std::string &mesh : meshes) {
+        mesh_records.push_back({static_cast<uint32_t>(strings.size()),
+                static_cast<uint32_t>(mesh.size())});
+        strings += mesh;
+    }
+    if (strings.size() > std::numeric_limits<uint32_t>::max() ||
+            meshes.size() > std::numeric_limits<uint32_t>::max()) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Too many meshes for a scene file \"%s\"", path);
+        return false;
+    }
+
+    // empty archetypes aren't stored
+    std::vector<std::size_t> archetypes;
+    for (std::size_t a = 0; a < world.get_archetype_count(); ++a) {
+        if (world.get_archetype_size(a) > 0) {
+            archetypes.push_back(a);
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.component_count = static_cast<uint32_t>(component_records.size());
+    header.mesh_count = static_cast<uint32_t>(mesh_records.size());
+    header.archetype_count = static_cast<uint32_t>(archetypes.size());
+    header.string_bytes = static_cast<uint32_t>(strings.size());
+    header.components_offset = align_up(sizeof(Header));
+    header.meshes_offset =
+            align_up(header.components_offset +
+                     component_records.size() * sizeof(ComponentRecord));
+    header.archetypes_offset = align_up(
+            header.meshes_offset + mesh_records.size() * sizeof(MeshRecord));
+    header.strings_offset =
+            align_up(header.archetypes_offset +
+                     archetypes.size() * sizeof(ArchetypeRecord));
+
+    std::vector<ArchetypeRecord> archetype_records;
+    uint64_t offset = header.strings_offset + strings.size();
+    for (std::size_t a : archetypes) {
+        ArchetypeRecord record{};
+        record.components =
+                get_file_mask(world.get_archetype_mask(a), saved);
+        record.entity_count = world.get_archetype_size(a);
+        record.data_offset = align_up(offset);
+        offset = record.data_offset + get_data_size(record.entity_count,
+                                              saved, infos, record.components);
+        header.entity_count += record.entity_count;
+        archetype_records.push_back(record);
+    }
+
+    // write then rename, so a crash never leaves a half-written file behind.
+    // Chunks are streamed, so nothing the size of the scene is allocated
+    std::string temp_path = std::string{path} + ".tmp";
+    SDL_IOStream *io = open_temp(path, temp_path);
+    if (io == nullptr) {
+        return false;
+    }
+    bool written =
+            write_bytes(io, &header, sizeof(header)) &&
+            pad_to(io, header.components_offset) &&
+            write_bytes(io, component_records.data(),
+                    component_records.size() * sizeof(ComponentRecord)) &&
+            pad_to(io, header.meshes_offset) &&
+            write_bytes(io, mesh_records.data(),
+                    mesh_records.size() * sizeof(MeshRecord)) &&
+            pad_to(io, header.archetypes_offset) &&
+            write_bytes(io, archetype_records.data(),
+                    archetype_records.size() * sizeof(ArchetypeRecord)) &&
+            pad_to(io, header.strings_offset) &&
+            write_bytes(io, strings.data(), strings.size());
+    for (std::size_t i = 0; written && i < archetypes.size(); ++i) {
+        written = write_archetype(
+                io, world, archetypes[i], archetype_records[i], saved);
+    }
+    return finish_temp(path, temp_path, io, written);
+}
+
+Error read(const char *path, World &world, std::vector<std::string> &meshes) {
+    MappedFile file{path};
+    if (!file.is_valid()) {
+        return Error::unreadable;
+    }
+    std::size_t file_size = file.get_size();
+    const std::byte *data = file.get_data();
+    if (file_size < sizeof(Header)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" is too small to be a scene", path);
+        return Error::invalid_header;
+    }
+    const Header &header = *reinterpret_cast<const Header *>(data);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "\"%s\" is not a scene file", path);
+        return Error::invalid_header;
+    }
+    if (header.version != VERSION) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" has version %u, expected %u", path,
+                header.version, VERSION);
+        return Error::unsupported_version;
+    }
+    if (header.component_count > MAX_COMPONENTS) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" has an invalid header", path);
+        return Error::invalid_header;
+    }
+    if (!fits(header.components_offset, header.component_count,
+                sizeof(ComponentRecord), file_size) ||
+            !fits(header.meshes_offset, header.mesh_count,
+                    sizeof(MeshRecord), file_size) ||
+            !fits(header.archetypes_offset, header.archetype_count,
+                    sizeof(ArchetypeRecord), file_size) ||
+            !fits(header.strings_offset, header.string_bytes, 1,
+                    file_size)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" is truncated", path);
+        return Error::truncated;
+    }
+
+    std::string_view strings{
+            reinterpret_cast<const char *>(data + header.strings_offset),
+            header.string_bytes};
+    auto get_name = [&](uint32_t offset, uint32_t size, std::string_view &out) {
+        if (offset > strings.size() || size > strings.size() - offset) {
+            return false;
+        }
+        out = strings.substr(offset, size);
+        return true;
+    };
+
+    // file component -> the world's, NO_COMPONENT to drop it
+    std::span<const ComponentRecord> components{
+            reinterpret_cast<const ComponentRecord *>(
+                    data + header.components_offset),
+            header.component_count};
+    std::array<ComponentId, MAX_COMPONENTS> world_component;
+    const std::vector<World::ComponentInfo> &infos = world.get_components();
+    for (std::size_t i = 0; i < components.size(); ++i) {
+        std::string_view name;
+        if (!get_name(components[i].name_offset, components[i].name_size,
+                    name)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Scene file \"%s\" has an invalid component table", path);
+            return Error::invalid_header;
+        }
+        ComponentId id = world.find_component(name);
+        world_component[i] = id;
+        if (id == NO_COMPONENT) {
+            SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Scene file \"%s\" has unknown component \"%.*s\", "
+                    "skipping it",
+                    path, static_cast<int>(name.size()), name.data());
+        } else if (infos[id].size != components[i].size) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Component \"%.*s\" in scene file \"%s\" is %u bytes, "
+                    "expected %zu",
+                    static_cast<int>(name.size()), name.data(), path,
+                    components[i].size, infos[id].size);
+            return Error::component_mismatch;
+        }
+    }
+
+    std::span<const MeshRecord> mesh_records{
+            reinterpret_cast<const MeshRecord *>(data + header.meshes_offset),
+            header.mesh_count};
+    std::vector<std::string> mesh_names;
+    mesh_names.reserve(mesh_records.size());
+    for (const MeshRecord &record : mesh_records) {
+        std::string_view name;
+        if (!get_name(record.name_offset, record.name_size, name)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Scene file \"%s\" has an invalid mesh table", path);
+            return Error::invalid_header;
+        }
+        mesh_names.emplace_back(name);
+    }
+
+    // check every archetype before creating anything, so a broken file
+    // doesn't leave half a scene behind
+    std::span<const ArchetypeRecord> archetypes{
+            reinterpret_cast<const ArchetypeRecord *>(
+                    data + header.archetypes_offset),
+            header.archetype_count};
+    // entity handles have 32-bit indices, and the header has to agree with
+    // the archetypes on how many there are
+    uint64_t entity_count = 0;
+    for (const ArchetypeRecord &record : archetypes) {
+        // clamped so the sum can't wrap around
+        entity_count += std::min<uint64_t>(record.entity_count, Entity::NONE);
+    }
+    if (entity_count != header.entity_count ||
+            entity_count >= Entity::NONE) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" has an invalid entity count", path);
+        return Error::invalid_header;
+    }
+    for (const ArchetypeRecord &record : archetypes) {
+        // no bits past the file's components. Shifting a 64-bit mask by 64
+        // is undefined, and with 64 components every bit is one
+        bool valid = (components.size() >= 64 ||
+                             record.components >> components.size() == 0) &&
+                     fits(record.data_offset, record.entity_count,
+                             sizeof(Entity), file_size);
+        uint64_t offset =
+                record.data_offset + record.entity_count * sizeof(Entity);
+        for (std::size_t i = 0; valid && i < components.size(); ++i) {
+            if (record.components & (uint64_t{1} << i)) {
+                offset = align_up(offset);
+                valid = fits(offset, record.entity_count, components[i].size,
+                        file_size);
+                offset += record.entity_count * components[i].size;
+            }
+        }
+        if (!valid) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                    "Scene file \"%s\" is truncated", path);
+            return Error::truncated;
+        }
+    }
+
+    std::vector<World::ColumnSource> columns;
+    for (const ArchetypeRecord &record : archetypes) {
+        if (record.entity_count == 0) {
+            continue;
+        }
+        const std::byte *entities = data + record.data_offset;
+        uint64_t offset =
+                record.data_offset + record.entity_count * sizeof(Entity);
+        ComponentMask mask = 0;
+        columns.clear();
+        for (std::size_t i = 0; i < components.size(); ++i) {
+            if (!(record.components & (uint64_t{1} << i))) {
+                continue;
+            }
+            offset = align_up(offset);
+            if (world_component[i] != NO_COMPONENT) {
+                mask |= ComponentMask{1} << world_component[i];
+                columns.push_back({world_component[i], data + offset});
+            }
+            offset += record.entity_count * components[i].size;
+        }
+        auto count = static_cast<std::size_t>(record.entity_count);
+        world.create_many(mask, count, columns,
+                {reinterpret_cast<const Entity *>(entities), count}, nullptr,
+                static_cast<std::size_t>(entity_count));
+    }
+    meshes = std::move(mesh_names);
+    return Error::none;
+}
+
+bool write_json(const char *path, const World &world,
+        std::span<const std::string> meshes) {
+    std::string temp_path = std::string{path} + ".tmp";
+    SDL_IOStream *io = open_temp(path, temp_path);
+    if (io == nullptr) {
+        return false;
+    }
+
+    std::string out = "{\n  \"format\": ";
+    Json::append_string(out, JSON_FORMAT);
+    out += ",\n  \"version\": " + std::to_string(VERSION) + ",\n";
+    out += "  \"meshes\": [";
+    for (std::size_t i = 0; i < meshes.size(); ++i) {
+        out += i > 0 ? ", " : "";
+        Json::append_string(out, meshes[i]);
+    }
+    out += "],\n  \"entities\": [";
+
+    // formatted a chunk at a time, so memory stays bounded
+    Saved saved = get_saved(world);
+    const std::vector<World::ComponentInfo> &infos = world.get_components();
+    bool written = true;
+    bool first = true;
+    for (std::size_t a = 0; written && a < world.get_archetype_count(); ++a) {
+        ComponentMask mask = world.get_archetype_mask(a);
+        for (std::size_t c = 0; written && c < world.get_chunk_count(a);
+                ++c) {
+            std::span<const Entity> entities = world.get_chunk_entities(a, c);
+            for (std::size_t row = 0; row < entities.size(); ++row) {
+                out += first ? "\n    {\"id\": [" : ",\n    {\"id\": [";
+                first = false;
+                out += std::to_string(entities[row].index) + ", " +
+                       std::to_string(entities[row].generation) + "]";
+                for (ComponentId id : saved.components) {
+                    if (!(mask & (ComponentMask{1} << id))) {
+                        continue;
+                    }
+                    const World::ComponentInfo &info = infos[id];
+                    out += ", ";
+                    Json::append_string(out, info.name);
+                    out += ": ";
+                    append_component(out,
+                            info, world.get_chunk_column(a, c, id) +
+                                          row * info.size);
+                }
+                out += '}';
+            }
+            if (out.size() >= JSON_FLUSH_BYTES) {
+                written = write_bytes(io, out.data(), out.size());
+                out.clear();
+            }
+        }
+    }
+    out += "\n  ]\n}\n";
+    written = written && write_bytes(io, out.data(), out.size());
+    return finish_temp(path, temp_path, io, written);
+}
+
+Error read_json(
+        const char *path, World &world, std::vector<std::string> &meshes) {
+    MappedFile file{path};
+    if (!file.is_valid()) {
+        return Error::unreadable;
+    }
+    Json::Value json;
+    std::string message;
+    if (!Json::parse({reinterpret_cast<const char *>(file.get_data()),
+                             file.get_size()},
+                json, &message)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Unable to parse scene file \"%s\": %s", path,
+                message.c_str());
+        return Error::invalid_header;
+    }
+    if (json["format"].as_string() != JSON_FORMAT) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "\"%s\" is not a scene file", path);
+        return Error::invalid_header;
+    }
+    if (json["version"].as_int() != VERSION) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                "Scene file \"%s\" has version %lld, expected %u", path,
+                static_cast<long long>(json["version"].as_int()), VERSION);
+        return Error::unsupported_version;
+    }
+
+    const std::vector<World::ComponentInfo> &infos = world.get_components();
+    std::vector<Batch> batches;
+    std::unordered_map<ComponentMask, std::size_t> batch_of_mask;
+    std::vector<std::string_view> unknown;
+    const Json::Value &entities = json["entities"];
+    for (std::size_t e = 0; e < entities.size(); ++e) {
+        const Json::Value &entity = entities[e];
+        ComponentMask mask = 0;
+        for (const auto &[name, value] : entity.get_members()) {
+            if (name == "id") {
+                continue;
+            }
+            ComponentId id = world.find_component(name);
+            if (id != NO_COMPONENT) {
+                mask |= ComponentMask{1} << id;
+            } else if (std::ranges::find(unknown, name) == unknown.end()) {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                        "Scene file \"%s\" has unknown component \"%s\", "
+                        "skipping it",
+                        path, name.c_str());
+                unknown.push_back(name);
+            }
+        }
+
+        auto [found, added] = batch_of_mask.try_emplace(mask, batches.size());
+        if (added) {
+            Batch &batch = batches.emplace_back();
+            batch.mask = mask;
+            for (ComponentId id = 0; id < MAX_COMPONENTS; ++id) {
+                if (mask & (ComponentMask{1} << id)) {
+                    batch.components.push_back(id);
+                }
+            }
+            batch.columns.resize(batch.components.size());
+        }
+        Batch &batch = batches[found->second];
+        const Json::Value &handle = entity["id"];
+        batch.entities.push_back(
+                {static_cast<uint32_t>(handle[0].as_int(Entity::NONE)),
+                        static_cast<uint32_t>(handle[1].as_int())});
+        for (std::size_t i = 0; i < batch.components.size(); ++i) {
+            const World::ComponentInfo &info = infos[batch.components[i]];
+            std::vector<std::byte> &column = batch.columns[i];
+            column.resize(column.size() + info.size);
+            if (!read_component(entity[info.name], info,
+                        column.data() + column.size() - info.size)) {
+                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                        "Component \"%s\" in scene file \"%s\" doesn't "
+                        "match its layout",
+                        info.name.c_str(), path);
+                return Error::component_mismatch;
+            }
+        }
+    }
+
+    std::vector<World::ColumnSource> columns;
+    for (const Batch &batch : batches) {
+        columns.clear();
+        for (std::size_t i = 0; i < batch.components.size(); ++i) {
+            columns.push_back(
+                    {batch.components[i], batch.columns[i].data()});
+        }
+        world.create_many(batch.mask, batch.entities.size(), columns,
+                batch.entities, nullptr, entities.size());
+    }
+
+    const Json::Value &mesh_names = json["meshes"];
+    meshes.clear();
+    for (std::size_t i = 0; i < mesh_names.size(); ++i) {
+        meshes.emplace_back(mesh_names[i].as_string());
+    }
+    return Error::none;
+}
+} // namespace Charcoal::SceneFile
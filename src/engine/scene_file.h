@@ -0,0 +1,120 @@
+#pragma once
+#include "ecs.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * The engine's scene container: every entity of a World with its named
+ * components, plus the assets they refer to. A binary file is a fixed
+ * header followed by tables and blobs:
+ *
+ *   Header | ComponentRecord[] | MeshRecord[] | ArchetypeRecord[] |
+ *   strings | archetype data...
+ *
+ * Each archetype's data is its entity handles, then one packed column per
+ * component, in the order of the component table. Loading copies columns
+ * straight from the mapped file into the world's chunks, so nothing is
+ * parsed or allocated per entity.
+ *
+ * Components are stored as raw bytes and matched by name, which makes the
+ * name their layout version: rename a component when its layout changes.
+ * Mesh references are indices into the file's mesh table, which holds names
+ * resolved by the caller. Every blob starts on an ALIGNMENT boundary, and
+ * values are in the machine's byte order, like MeshFile.
+ *
+ * The JSON variant holds the same data for diffing and hand editing, and is
+ * much slower to load.
+ */
+namespace SceneFile {
+constexpr uint32_t VERSION = 1;
+constexpr char MAGIC[4] = {'C', 'S', 'C', 'N'};
+constexpr std::size_t ALIGNMENT = 16;
+// names the JSON variant's "format" member
+constexpr const char *JSON_FORMAT = "charcoal-scene";
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t component_count;
+    uint32_t mesh_count;
+    uint32_t archetype_count;
+    // size of the string table
+    uint32_t string_bytes;
+    uint64_t entity_count;
+    // in bytes from the start of the file
+    uint64_t components_offset;
+    uint64_t meshes_offset;
+    uint64_t archetypes_offset;
+    uint64_t strings_offset;
+};
+
+// names are offsets into the string table, without a terminator
+struct ComponentRecord {
+    uint32_t name_offset;
+    uint32_t name_size;
+    uint32_t size;
+    uint32_t alignment;
+};
+
+struct MeshRecord {
+    uint32_t name_offset;
+    uint32_t name_size;
+};
+
+struct ArchetypeRecord {
+    // bit n set means entry n of the component table
+    uint64_t components;
+    uint64_t entity_count;
+    // Entity[entity_count], then the columns
+    uint64_t data_offset;
+};
+
+enum class Error {
+    none,
+    unreadable,
+    invalid_header,
+    unsupported_version,
+    truncated,
+    // a component has the same name as one in the world, but another size
+    component_mismatch
+};
+
+/**
+ * @brief Writes every entity's named components. Unnamed components aren't
+ * saved. Chunks are streamed to the file, and it's written next to the
+ * destination first, then renamed over it.
+ *
+ * @param path Destination file
+ * @param meshes Names of the meshes that components refer to by index
+ * @return True on success. Failures are logged.
+ */
+bool write(const char *path, const World &world,
+        std::span<const std::string> meshes);
+
+/**
+ * @brief Adds a file's entities to the world, keeping their handles where
+ * the index is free. Components the world doesn't know are dropped with a
+ * warning.
+ *
+ * @param meshes Set to the file's mesh names
+ */
+Error read(const char *path, World &world, std::vector<std::string> &meshes);
+
+/**
+ * @brief write(), but as JSON. Components registered with a field list are
+ * written field by field, others as a hex string of their bytes.
+ */
+bool write_json(const char *path, const World &world,
+        std::span<const std::string> meshes);
+
+/**
+ * @brief read() for files written by write_json().
+ */
+Error read_json(
+        const char *path, World &world, std::vector<std::string> &meshes);
+} // namespace SceneFile
+} // namespace Charcoal
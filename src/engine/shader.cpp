@@ -1,8 +1,13 @@
 #include "shader.h"
+#include "gl_extensions.h"
+#include "program_cache.h"
+#include "shader_preprocessor.h"
 #include <SDL3/SDL_log.h>
 #include <SDL3/SDL_iostream.h>
 #include <cassert>
 #include <glm/gtc/type_ptr.hpp>
+#include <utility>
+#include <vector>
 
 namespace Charcoal {
 
@@ -20,12 +25,16 @@ const char *ShaderLoader::type_string(GLenum type) {
     }
 }
 
-GLuint ShaderLoader::compile(GLenum type, const GLchar *src) {
+GLuint ShaderLoader::start_compile(GLenum type, const GLchar *src) {
     GLuint id = glCreateShader(type);
     glShaderSource(id, 1, &src,
             NULL); // returns a non-zero reference ID for the shader
+    // don't query anything yet, the driver may be compiling in the background
     glCompileShader(id);
+    return id;
+}
 
+bool ShaderLoader::check_compile(GLenum type, GLuint id) {
     // check if compilation had any errors
     GLint success;
     glGetShaderiv(id, GL_COMPILE_STATUS, &success);
@@ -37,108 +46,218 @@ GLuint ShaderLoader::compile(GLenum type, const GLchar *src) {
         glGetShaderInfoLog(id, msgLen, &msgLen, &msg[0]);
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to compile %s: %s",
                 type_string(type), &msg[0]);
+        return false;
+    }
+    return true;
+}
+
+bool ShaderLoader::check_link(GLuint program_id) {
+    // check if linking had errors
+    GLint success;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+    if (success == GL_FALSE) {
+        GLint msgLen;
+        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &msgLen);
+        std::vector<GLchar> msg(msgLen, 0);
 
-        // cleanup failed shader compile
-        glDeleteShader(id);
-        return 0;
+        glGetProgramInfoLog(program_id, msgLen, &msgLen, &msg[0]);
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                "Shader program linking failed: %s", &msg[0]);
+        return false;
+    }
+
+#ifdef DEBUG
+    // validation checks the program against the current draw state, which
+    // isn't set up yet at load time. It's a slow driver round trip, so only
+    // do it in debug builds.
+    glValidateProgram(program_id);
+
+    // check if validation had errors
+    glGetProgramiv(program_id, GL_VALIDATE_STATUS, &success);
+    if (success == GL_FALSE) {
+        GLint msgLen;
+        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &msgLen);
+        std::vector<GLchar> msg(msgLen, 0);
+
+        glGetProgramInfoLog(program_id, msgLen, &msgLen, &msg[0]);
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                "Shader program validation failed: %s", &msg[0]);
+        return false;
+    }
+#endif
+    return true;
+}
+
+Shader ShaderLoader::from_files(const char *vert_shader_path,
+        const char *frag_shader_path, ProgramCache *cache) {
+    ShaderBatch batch{cache};
+    return batch.take(batch.add_files(vert_shader_path, frag_shader_path));
+}
+
+Shader ShaderLoader::from_strings(const char *vert_shader_src,
+        const char *frag_shader_src, ProgramCache *cache) {
+    ShaderBatch batch{cache};
+    return batch.take(batch.add(vert_shader_src, frag_shader_src));
+}
+
+ShaderBatch::ShaderBatch(ProgramCache *cache) : cache{cache} {
+}
+
+ShaderBatch::~ShaderBatch() noexcept {
+    // clean up anything that was never taken
+    for (Build &build : builds) {
+        if (build.state == State::compiling) {
+            finish(build);
+        }
+        if (build.program != 0) {
+            glDeleteProgram(build.program);
+        }
     }
-    return id;
 }
 
-Shader ShaderLoader::from_files(
+ShaderBatch::Id ShaderBatch::add_files(
         const char *vert_shader_path, const char *frag_shader_path) {
-    char *vert_shader =
-            static_cast<char *>(SDL_LoadFile(vert_shader_path, nullptr));
-    char *frag_shader =
-            static_cast<char *>(SDL_LoadFile(frag_shader_path, nullptr));
-    Shader program = from_strings(vert_shader, frag_shader);
-    SDL_free(vert_shader);
-    SDL_free(frag_shader);
-    return program;
+    ShaderPreprocessor preprocessor;
+    ShaderPreprocessor::Result vert = preprocessor.process(vert_shader_path);
+    ShaderPreprocessor::Result frag = preprocessor.process(frag_shader_path);
+    // add() treats a null source as unreadable
+    return add(vert.ok ? vert.source.c_str() : nullptr,
+            frag.ok ? frag.source.c_str() : nullptr);
 }
 
-Shader ShaderLoader::from_strings(
+ShaderBatch::Id ShaderBatch::add(
         const char *vert_shader_src, const char *frag_shader_src) {
     static_assert(sizeof(char) == sizeof(GLchar));
+    Id id = builds.size();
+    if (free_ids.empty()) {
+        builds.emplace_back();
+    } else {
+        id = free_ids.back();
+        free_ids.pop_back();
+        builds[id] = Build{};
+    }
+    Build &build = builds[id];
 
     if (vert_shader_src == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Cannot compile shader program "
                                              "with null vertex shader source.");
-        return Shader{0};
+        return id;
     }
 
     if (frag_shader_src == nullptr) {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR,
                 "Cannot compile shader program with "
                 "null fragment shader source.");
-        return Shader{0};
+        return id;
     }
 
-    GLuint vs = compile(GL_VERTEX_SHADER, vert_shader_src);
-    if (vs == 0) {
-        SDL_LogError(
-                SDL_LOG_CATEGORY_ERROR, "Aborting shader program creation.");
-        return Shader{0};
+    // warm start, skip compiling entirely
+    if (cache != nullptr) {
+        build.source_hash =
+                ProgramCache::source_hash(vert_shader_src, frag_shader_src);
+        build.program = cache->load(build.source_hash);
+        if (build.program != 0) {
+            build.state = State::done;
+            return id;
+        }
     }
 
-    GLuint fs = compile(GL_FRAGMENT_SHADER, frag_shader_src);
-    if (fs == 0) {
-        SDL_LogError(
-                SDL_LOG_CATEGORY_ERROR, "Aborting shader program creation.");
-        return Shader{0};
-    }
-
-    GLuint program_id = glCreateProgram(); // non-zero id
-    if (program_id == 0) {
+    build.vs = ShaderLoader::start_compile(GL_VERTEX_SHADER, vert_shader_src);
+    build.fs =
+            ShaderLoader::start_compile(GL_FRAGMENT_SHADER, frag_shader_src);
+    build.program = glCreateProgram(); // non-zero id
+    if (build.program == 0) {
         SDL_LogError(
                 SDL_LOG_CATEGORY_ERROR, "Failed to create program object.");
-        return Shader{program_id};
+        glDeleteShader(build.vs);
+        glDeleteShader(build.fs);
+        return id;
+    }
+    glAttachShader(build.program, build.vs);
+    glAttachShader(build.program, build.fs);
+    if (cache != nullptr) {
+        cache->prepare(build.program);
     }
-    glAttachShader(program_id, vs);
-    glAttachShader(program_id, fs);
 
-    glLinkProgram(program_id);
+    // a link with a broken stage just fails, which finish() reports
+    glLinkProgram(build.program);
+    build.state = State::compiling;
+    return id;
+}
+
+void ShaderBatch::finish(Build &build) {
+    // these block until the driver is done with the program
+    bool vs_ok = ShaderLoader::check_compile(GL_VERTEX_SHADER, build.vs);
+    bool fs_ok = ShaderLoader::check_compile(GL_FRAGMENT_SHADER, build.fs);
+    bool linked = vs_ok && fs_ok && ShaderLoader::check_link(build.program);
 
     // linking done, detach shader intermediates
-    glDetachShader(program_id, vs);
-    glDetachShader(program_id, fs);
+    glDetachShader(build.program, build.vs);
+    glDetachShader(build.program, build.fs);
 
     // delete shader intermediates once detached
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-
-    // check if linking had errors
-    GLint success;
-    glGetProgramiv(program_id, GL_LINK_STATUS, &success);
-    if (success == GL_FALSE) {
-        GLint msgLen;
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &msgLen);
-        std::vector<GLchar> msg(msgLen, 0);
+    glDeleteShader(build.vs);
+    glDeleteShader(build.fs);
+    build.vs = 0;
+    build.fs = 0;
 
-        glGetProgramInfoLog(program_id, msgLen, &msgLen, &msg[0]);
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR,
-                "Shader program linking failed: %s", &msg[0]);
-
-        return Shader{0};
+    if (!linked) {
+        SDL_LogError(
+                SDL_LOG_CATEGORY_ERROR, "Aborting shader program creation.");
+        glDeleteProgram(build.program);
+        build.program = 0;
+    } else if (cache != nullptr) {
+        cache->store(build.source_hash, build.program);
     }
+    build.state = State::done;
+}
 
-    glValidateProgram(program_id);
+bool ShaderBatch::is_complete(const Build &build) const {
+    if (build.state != State::compiling) {
+        return true;
+    }
+    if (!GlExtensions::get().parallel_shader_compile) {
+        // no way to ask without blocking
+        return false;
+    }
+    GLint complete = GL_FALSE;
+    glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
 
-    // check if validation had errors
-    glGetProgramiv(program_id, GL_VALIDATE_STATUS, &success);
-    if (success == GL_FALSE) {
-        GLint msgLen;
-        glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &msgLen);
-        std::vector<GLchar> msg(msgLen, 0);
+std::size_t ShaderBatch::poll() {
+    std::size_t compiling = 0;
+    for (Build &build : builds) {
+        if (build.state != State::compiling) {
+            continue;
+        }
+        if (is_complete(build)) {
+            finish(build);
+        } else {
+            ++compiling;
+        }
+    }
+    return compiling;
+}
 
-        glGetProgramInfoLog(program_id, msgLen, &msgLen, &msg[0]);
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR,
-                "Shader program validation failed: %s", &msg[0]);
+bool ShaderBatch::is_ready(Id id) const {
+    return is_complete(builds[id]);
+}
 
-        return Shader{0};
+Shader ShaderBatch::take(Id id) {
+    Build &build = builds[id];
+    if (build.state == State::compiling) {
+        finish(build);
     }
+    GLuint program = build.program;
+    build.program = 0;
+    build.state = State::taken;
+    free_ids.push_back(id);
+    return Shader{program};
+}
 
-    return Shader{program_id};
+std::size_t ShaderBatch::get_count() const {
+    return builds.size() - free_ids.size();
 }
 
 Shader::Shader(GLuint id) : id{id} {
@@ -156,6 +275,9 @@ Shader::Shader(Shader &&other) noexcept : id{other.id} {
 
 Shader &Shader::operator=(Shader &&other) noexcept {
     if (this != &other) {
+        if (id != 0) {
+            glDeleteProgram(id);
+        }
         this->id = other.id;
         other.id = 0;
     }
@@ -203,6 +325,16 @@ void Shader::set_mat4(const char *uniform_name, const glm::mat4 &value) {
     }
 }
 
+void Shader::set_uniform_block(const char *block_name, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(id, block_name);
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(id, index, binding);
+    } else {
+        SDL_LogError(SDL_LOG_CATEGORY_INPUT,
+                "Unable to locate uniform block \"%s\"", block_name);
+    }
+}
+
 bool Shader::is_valid() const {
     return id != 0;
 }
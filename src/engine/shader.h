@@ -1,8 +1,13 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <glad/glad.h>
 #include <glm/mat4x4.hpp>
+#include <vector>
 
 namespace Charcoal {
+class ProgramCache;
+
 class Shader {
     GLuint id;
 public:
@@ -22,21 +27,125 @@ public:
     void set_float(const char* uniform_name, float value);
     void set_int(const char *uniform_name, int value);
     void set_mat4(const char *uniform_name, const glm::mat4 &value);
+    /**
+     * @brief Points a uniform block at a uniform buffer binding. GLSL 3.30
+     * can't set the binding in the shader, so this is needed once per
+     * program.
+     *
+     * @param block_name The block's name in GLSL
+     * @param binding The index later passed to glBindBufferBase
+     */
+    void set_uniform_block(const char *block_name, GLuint binding);
     bool is_valid() const;
 };
 
 class ShaderLoader {
+    friend class ShaderBatch;
+
     static const char *type_string(GLenum type);
-    static GLuint compile(GLenum type, const GLchar *source);
+    static GLuint start_compile(GLenum type, const GLchar *source);
+    static bool check_compile(GLenum type, GLuint id);
+    static bool check_link(GLuint program_id);
 
 public:
-    static Shader from_strings(
-            const char *vert_shader_src, const char *frag_shader_src);
-    static Shader from_files(
-            const char *vert_shader_path, const char *frag_shader_path);
+    /**
+     * @brief Compiles and links a program from GLSL source.
+     *
+     * @param vert_shader_src Vertex shader source
+     * @param frag_shader_src Fragment shader source
+     * @param cache When given, a cached binary of the same sources is used
+     * instead of compiling, and fresh compiles are added to the cache
+     */
+    static Shader from_strings(const char *vert_shader_src,
+            const char *frag_shader_src, ProgramCache *cache = nullptr);
+    static Shader from_files(const char *vert_shader_path,
+            const char *frag_shader_path, ProgramCache *cache = nullptr);
 
     static const char *DEFAULT_VERT_PATH;
     static const char *DEFAULT_FRAG_PATH;
 };
 
-}
+/**
+ * @class ShaderBatch
+ * @brief Compiles many shader programs at once. Everything is submitted to
+ * the driver up front and nothing waits for a result until a program is
+ * taken, so with KHR_parallel_shader_compile the driver can compile them all
+ * on its own threads while the engine keeps loading other assets.
+ */
+class ShaderBatch {
+public:
+    using Id = std::size_t;
+
+private:
+    enum class State {
+        // nothing to wait for, program may be 0 if it failed
+        done,
+        // submitted to the driver, result not checked yet
+        compiling,
+        // handed out by take()
+        taken
+    };
+
+    struct Build {
+        State state = State::done;
+        GLuint program = 0;
+        GLuint vs = 0;
+        GLuint fs = 0;
+        uint64_t source_hash = 0;
+    };
+
+    std::vector<Build> builds;
+    // taken slots that add() can reuse, so a long-lived batch doesn't grow
+    std::vector<Id> free_ids;
+    ProgramCache *cache;
+
+    void finish(Build &build);
+    bool is_complete(const Build &build) const;
+
+public:
+    /**
+     * @param cache Optional program binary cache, see ShaderLoader
+     */
+    explicit ShaderBatch(ProgramCache *cache = nullptr);
+    ~ShaderBatch() noexcept;
+
+    ShaderBatch(const ShaderBatch &other) = delete;
+    ShaderBatch &operator=(const ShaderBatch &other) = delete;
+
+    /**
+     * @brief Starts compiling and linking a program without waiting for it.
+     *
+     * @param vert_shader_src Vertex shader source
+     * @param frag_shader_src Fragment shader source
+     * @return An id for take()
+     */
+    Id add(const char *vert_shader_src, const char *frag_shader_src);
+    Id add_files(const char *vert_shader_path, const char *frag_shader_path);
+
+    /**
+     * @brief Checks errors on, and caches, every program the driver has
+     * finished with. Never blocks. Without KHR_parallel_shader_compile
+     * nothing can be checked without blocking, so this does nothing.
+     *
+     * @return The number of programs still compiling
+     */
+    std::size_t poll();
+
+    /**
+     * @brief Returns true if take() won't block for this program.
+     */
+    bool is_ready(Id id) const;
+
+    /**
+     * @brief Returns the finished program, waiting for the driver if it's
+     * still compiling. Each id can only be taken once, after which add()
+     * may hand it out again.
+     *
+     * @param id The id from add()
+     * @return The program, which is invalid if compiling or linking failed
+     */
+    Shader take(Id id);
+
+    std::size_t get_count() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,232 @@
+#include "shader_permutations.h"
+#include "gl_extensions.h"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Charcoal {
+namespace {
+struct FeatureDefine {
+    ShaderFeatures feature;
+    const char *define;
+};
+
+constexpr FeatureDefine FEATURE_DEFINES[] = {
+        {ShaderFeature::textured, "#define FEATURE_TEXTURED 1\n"},
+        {ShaderFeature::vertex_color, "#define FEATURE_VERTEX_COLOR 1\n"},
+        {ShaderFeature::alpha_test, "#define FEATURE_ALPHA_TEST 1\n"},
+        {ShaderFeature::instanced, "#define FEATURE_INSTANCED 1\n"},
+        {ShaderFeature::skinned, "#define FEATURE_SKINNED 1\n"},
+};
+} // namespace
+
+ShaderPermutations::ShaderPermutations(
+        const char *vert_path, const char *frag_path, ProgramCache *cache) :
+        vert_path{vert_path}, frag_path{frag_path}, cache{cache},
+        valid{false}, batch{cache} {
+    valid = load_sources(vert_src, frag_src);
+}
+
+bool ShaderPermutations::load_sources(
+        std::string &new_vert_src, std::string &new_frag_src) {
+    ShaderPreprocessor::Result vert = preprocessor.process(vert_path);
+    ShaderPreprocessor::Result frag = preprocessor.process(frag_path);
+
+    // even a failed load reports what it tried to read, so those files get
+    // watched and fixing them triggers another reload
+    dependencies = std::move(vert.dependencies);
+    for (std::string &path : frag.dependencies) {
+        if (!depends_on(path)) {
+            dependencies.push_back(std::move(path));
+        }
+    }
+    if (!vert.ok || !frag.ok) {
+        return false;
+    }
+    new_vert_src = std::move(vert.source);
+    new_frag_src = std::move(frag.source);
+    return true;
+}
+
+std::string ShaderPermutations::inject_defines(
+        const std::string &source, ShaderFeatures features) {
+    // #version has to stay the first line, so the defines go after it
+    std::size_t insert_at = 0;
+    std::string defines;
+    std::size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        std::size_t line_end = source.find('\n', version);
+        if (line_end == std::string::npos) {
+            insert_at = source.size();
+            defines += '\n';
+        } else {
+            insert_at = line_end + 1;
+        }
+    }
+
+    for (const FeatureDefine &entry : FEATURE_DEFINES) {
+        if ((features & entry.feature) != 0) {
+            defines += entry.define;
+        }
+    }
+    if (insert_at > 0) {
+        // keep compiler errors pointing at the right line in the file. GLSL
+        // 3.30 numbers the line after "#line N" as N + 1.
+        int version_line = 1;
+        for (std::size_t i = 0; i < version; ++i) {
+            version_line += source[i] == '\n' ? 1 : 0;
+        }
+        defines += "#line " + std::to_string(version_line) + "\n";
+    }
+
+    std::string result;
+    result.reserve(source.size() + defines.size());
+    result.append(source, 0, insert_at);
+    result.append(defines);
+    result.append(source, insert_at, std::string::npos);
+    return result;
+}
+
+void ShaderPermutations::set_on_link(std::function<void(Shader &shader)> fn) {
+    on_link = std::move(fn);
+    if (on_link == nullptr) {
+        return;
+    }
+    for (auto &[features, shader] : shaders) {
+        if (shader.is_valid()) {
+            on_link(shader);
+        }
+    }
+}
+
+void ShaderPermutations::request(ShaderFeatures features) {
+    if (!valid || shaders.contains(features) || pending.contains(features)) {
+        return;
+    }
+    std::string vert = inject_defines(vert_src, features);
+    std::string frag = inject_defines(frag_src, features);
+    pending.emplace(features, batch.add(vert.c_str(), frag.c_str()));
+}
+
+Shader &ShaderPermutations::get(ShaderFeatures features) {
+    auto it = shaders.find(features);
+    if (it != shaders.end()) {
+        return it->second;
+    }
+
+    request(features);
+    auto pending_it = pending.find(features);
+    Shader shader{0};
+    if (pending_it != pending.end()) {
+        shader = batch.take(pending_it->second);
+        pending.erase(pending_it);
+    }
+    if (!shader.is_valid()) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                "Failed to build \"%s\" + \"%s\" with features 0x%x",
+                vert_path.c_str(), frag_path.c_str(), features);
+    } else if (on_link != nullptr) {
+        on_link(shader);
+    }
+    // failures are cached too, so a broken variant is only reported once
+    return shaders.emplace(features, std::move(shader)).first->second;
+}
+
+bool ShaderPermutations::begin_reload() {
+    std::string new_vert_src;
+    std::string new_frag_src;
+    if (!load_sources(new_vert_src, new_frag_src)) {
+        // usually caught mid-save, the next change event will retry
+        return false;
+    }
+
+    // a newer edit replaces any reload still in flight
+    reload = std::make_unique<Reload>(cache);
+    for (const auto &[features, shader] : shaders) {
+        std::string vert = inject_defines(new_vert_src, features);
+        std::string frag = inject_defines(new_frag_src, features);
+        reload->builds.emplace(
+                features, reload->batch.add(vert.c_str(), frag.c_str()));
+    }
+    reload->vert_src = std::move(new_vert_src);
+    reload->frag_src = std::move(new_frag_src);
+    SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "Reloading \"%s\" + \"%s\"",
+            vert_path.c_str(), frag_path.c_str());
+    return true;
+}
+
+bool ShaderPermutations::update() {
+    if (reload == nullptr) {
+        return false;
+    }
+    // without KHR_parallel_shader_compile there's no way to check without
+    // blocking, so just wait
+    if (GlExtensions::get().parallel_shader_compile) {
+        for (const auto &[features, id] : reload->builds) {
+            if (!reload->batch.is_ready(id)) {
+                return false;
+            }
+        }
+    }
+
+    std::vector<std::pair<ShaderFeatures, Shader>> rebuilt;
+    rebuilt.reserve(reload->builds.size());
+    bool all_valid = true;
+    for (const auto &[features, id] : reload->builds) {
+        rebuilt.emplace_back(features, reload->batch.take(id));
+        all_valid = all_valid && rebuilt.back().second.is_valid();
+    }
+    std::unique_ptr<Reload> finished = std::move(reload);
+    if (!all_valid) {
+        SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                "Reload of \"%s\" + \"%s\" failed, keeping the previous "
+                "shaders",
+                vert_path.c_str(), frag_path.c_str());
+        return false;
+    }
+
+    // swap every variant at once, between frames. References from get()
+    // stay valid since the map entries themselves don't move.
+    for (auto &[features, shader] : rebuilt) {
+        if (on_link != nullptr) {
+            on_link(shader);
+        }
+        shaders.at(features) = std::move(shader);
+    }
+    vert_src = std::move(finished->vert_src);
+    frag_src = std::move(finished->frag_src);
+
+    // variants requested but not taken yet were built from the old sources
+    std::vector<ShaderFeatures> stale;
+    for (const auto &[features, id] : pending) {
+        batch.take(id);
+        stale.push_back(features);
+    }
+    pending.clear();
+    for (ShaderFeatures features : stale) {
+        request(features);
+    }
+    SDL_LogInfo(SDL_LOG_CATEGORY_RENDER, "Reloaded %zu shader variants",
+            rebuilt.size());
+    return true;
+}
+
+const std::vector<std::string> &ShaderPermutations::get_dependencies() const {
+    return dependencies;
+}
+
+bool ShaderPermutations::depends_on(const std::string &path) const {
+    return std::find(dependencies.begin(), dependencies.end(), path) !=
+           dependencies.end();
+}
+
+bool ShaderPermutations::is_valid() const {
+    return valid;
+}
+
+std::size_t ShaderPermutations::get_count() const {
+    return shaders.size();
+}
+} // namespace Charcoal
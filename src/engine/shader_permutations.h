@@ -0,0 +1,155 @@
+#pragma once
+#include "shader.h"
+#include "shader_preprocessor.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Charcoal {
+class ProgramCache;
+
+// Bitmask of optional shader features, see ShaderFeature
+using ShaderFeatures = uint32_t;
+
+namespace ShaderFeature {
+constexpr ShaderFeatures none = 0;
+// samples obj_texture, blended with glass_texture
+constexpr ShaderFeatures textured = 1u << 0;
+// multiplies by the per-vertex color
+constexpr ShaderFeatures vertex_color = 1u << 1;
+// discards fragments with alpha below the alpha_cutoff uniform
+constexpr ShaderFeatures alpha_test = 1u << 2;
+// reads a per-instance model matrix from attributes 3-6
+constexpr ShaderFeatures instanced = 1u << 3;
+// blends the bones uniform array by the weights in attributes 7 and 8
+constexpr ShaderFeatures skinned = 1u << 4;
+constexpr ShaderFeatures all =
+        textured | vertex_color | alpha_test | instanced | skinned;
+} // namespace ShaderFeature
+
+/**
+ * @class ShaderPermutations
+ * @brief Builds variants of one vertex/fragment shader pair by prepending
+ * #define lines for the requested features, so objects that don't need a
+ * feature don't pay for it. Only variants that are actually asked for get
+ * compiled, and each one is compiled once. #include directives in either
+ * file are expanded by a ShaderPreprocessor.
+ */
+class ShaderPermutations {
+    std::string vert_path;
+    std::string frag_path;
+    std::string vert_src;
+    std::string frag_src;
+    ProgramCache *cache;
+    bool valid;
+    ShaderPreprocessor preprocessor;
+    // both source files and everything they include
+    std::vector<std::string> dependencies;
+
+    std::unordered_map<ShaderFeatures, Shader> shaders;
+    // run on every variant once it links
+    std::function<void(Shader &shader)> on_link;
+    // requested but not needed yet
+    ShaderBatch batch;
+    std::unordered_map<ShaderFeatures, ShaderBatch::Id> pending;
+
+    // every built variant, recompiled from changed sources. Swapped in
+    // together once all of them link.
+    struct Reload {
+        ShaderBatch batch;
+        std::unordered_map<ShaderFeatures, ShaderBatch::Id> builds;
+        std::string vert_src;
+        std::string frag_src;
+
+        explicit Reload(ProgramCache *cache) : batch{cache} {
+        }
+    };
+    std::unique_ptr<Reload> reload;
+
+    bool load_sources(std::string &new_vert_src, std::string &new_frag_src);
+
+public:
+    /**
+     * @param vert_path Vertex shader file
+     * @param frag_path Fragment shader file
+     * @param cache Optional program binary cache, see ShaderLoader
+     */
+    ShaderPermutations(const char *vert_path, const char *frag_path,
+            ProgramCache *cache = nullptr);
+
+    ShaderPermutations(const ShaderPermutations &other) = delete;
+    ShaderPermutations &operator=(const ShaderPermutations &other) = delete;
+
+    /**
+     * @brief Sets up state that lives in the program object, like sampler
+     * units and uniform block bindings. Runs on every variant already built,
+     * then on each one as get() builds it or a reload relinks it.
+     *
+     * @param fn Called with the variant's program in use
+     */
+    void set_on_link(std::function<void(Shader &shader)> fn);
+
+    /**
+     * @brief Starts compiling a variant in the background, so a later get()
+     * doesn't have to wait as long. Does nothing if it's already built.
+     *
+     * @param features The feature bitmask
+     */
+    void request(ShaderFeatures features);
+
+    /**
+     * @brief Returns the variant for a set of features, compiling it first if
+     * needed. The returned reference stays valid for the lifetime of this
+     * object.
+     *
+     * @param features The feature bitmask
+     * @return The shader, which is invalid if the variant failed to compile
+     */
+    Shader &get(ShaderFeatures features);
+
+    /**
+     * @brief Re-reads both source files and starts recompiling every built
+     * variant in the background. The current variants stay in use until
+     * update() swaps in the new ones.
+     *
+     * @return false if the sources couldn't be read
+     */
+    bool begin_reload();
+
+    /**
+     * @brief Finishes a reload started by begin_reload(). Once every variant
+     * has compiled, they replace the old ones only if all of them linked;
+     * otherwise the old ones are kept. Call once per frame.
+     *
+     * @return true if new variants were swapped in this call. Uniforms
+     * other than the ones set_on_link() sets need setting again.
+     */
+    bool update();
+
+    /**
+     * @brief Returns both source files and every file they #include. Any of
+     * these changing means begin_reload() should be called. Can change after
+     * a reload.
+     */
+    const std::vector<std::string> &get_dependencies() const;
+    bool depends_on(const std::string &path) const;
+
+    /**
+     * @brief Inserts a #define for every feature in the mask right after the
+     * #version line of a GLSL source.
+     *
+     * @param source GLSL source, starting with a #version line
+     * @param features The feature bitmask
+     * @return The source with the defines added
+     */
+    static std::string inject_defines(
+            const std::string &source, ShaderFeatures features);
+
+    // false if either source file couldn't be read
+    bool is_valid() const;
+    std::size_t get_count() const;
+};
+} // namespace Charcoal
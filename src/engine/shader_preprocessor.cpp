@@ -0,0 +1,294 @@
+#include "shader_preprocessor.h"
+#include "hash.h"
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+namespace Charcoal {
+namespace {
+bool read_file(const std::string &path, std::string &out) {
+    std::size_t size = 0;
+    char *data = static_cast<char *>(SDL_LoadFile(path.c_str(), &size));
+    if (data == nullptr) {
+        return false;
+    }
+    out.assign(data, size);
+    SDL_free(data);
+    return true;
+}
+
+uint64_t content_hash(const std::string &path, const std::string &text) {
+    return Hash::fnv1a64(text, Hash::fnv1a64(path));
+}
+
+std::string directory_of(const std::string &path) {
+    std::size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) {
+        return "";
+    }
+    return path.substr(0, slash + 1);
+}
+
+// resolves "." and ".." and unifies separators, so one file always has one
+// name. Leading ".." that can't be resolved are kept
+std::string normalize_path(const std::string &path) {
+    std::string unified = path;
+    std::replace(unified.begin(), unified.end(), '\\', '/');
+    bool absolute = unified.starts_with('/');
+    std::vector<std::string_view> parts;
+    std::string_view rest{unified};
+    while (!rest.empty()) {
+        std::size_t slash = rest.find('/');
+        std::string_view part = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view{}
+                                               : rest.substr(slash + 1);
+        if (part.empty() || part == ".") {
+            continue;
+        }
+        if (part == ".." && !parts.empty() && parts.back() != "..") {
+            parts.pop_back();
+        } else if (part != ".." || !absolute) {
+            parts.push_back(part);
+        }
+    }
+    std::string result = absolute ? "/" : "";
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        result += i > 0 ? "/" : "";
+        result += parts[i];
+    }
+    return result;
+}
+
+std::string_view skip_spaces(std::string_view text) {
+    std::size_t first = text.find_first_not_of(" \t");
+    return first == std::string_view::npos ? std::string_view{}
+                                           : text.substr(first);
+}
+
+// The line with comments replaced by spaces. Block comments can span lines,
+// in_comment carries that from one line to the next
+std::string strip_comments(std::string_view line, bool &in_comment) {
+    std::string code;
+    std::size_t i = 0;
+    while (i < line.size()) {
+        if (in_comment) {
+            std::size_t close = line.find("*/", i);
+            if (close == std::string_view::npos) {
+                break;
+            }
+            in_comment = false;
+            i = close + 2;
+            code.push_back(' ');
+        } else if (line.substr(i).starts_with("//")) {
+            break;
+        } else if (line.substr(i).starts_with("/*")) {
+            in_comment = true;
+            i += 2;
+        } else {
+            code.push_back(line[i++]);
+        }
+    }
+    return code;
+}
+
+// Matches lines like `  #  name rest`. Sets name and the rest of the line.
+bool parse_directive(std::string_view line, std::string_view &name,
+        std::string_view &rest) {
+    line = skip_spaces(line);
+    if (line.empty() || line.front() != '#') {
+        return false;
+    }
+    line = skip_spaces(line.substr(1));
+    std::size_t end = line.find_first_of(" \t");
+    name = line.substr(0, end);
+    rest = end == std::string_view::npos ? std::string_view{}
+                                         : skip_spaces(line.substr(end));
+    return true;
+}
+
+// Matches `include "path"` directives. Sets target to the quoted path.
+bool parse_include(std::string_view name, std::string_view rest,
+        std::string &target) {
+    if (name != "include" || rest.empty() || rest.front() != '"') {
+        return false;
+    }
+    std::size_t close = rest.find('"', 1);
+    if (close == std::string_view::npos) {
+        return false;
+    }
+    target.assign(rest.substr(1, close - 1));
+    return true;
+}
+
+// Tracks #if blocks to skip includes in ones that are never compiled. Only
+// "#if 0" is known to be off; without the defines every other condition
+// might be true, so its includes are expanded.
+class Conditionals {
+    // per open block: whether it's skipped, and whether its parent is
+    std::vector<std::pair<bool, bool>> blocks;
+
+public:
+    bool is_skipping() const {
+        return !blocks.empty() && blocks.back().first;
+    }
+
+    void apply(std::string_view name, std::string_view rest) {
+        bool parent = is_skipping();
+        if (name == "if") {
+            bool off = rest.starts_with('0') &&
+                       skip_spaces(rest.substr(1)).empty();
+            blocks.emplace_back(parent || off, parent);
+        } else if (name == "ifdef" || name == "ifndef") {
+            blocks.emplace_back(parent, parent);
+        } else if ((name == "else" || name == "elif") && !blocks.empty()) {
+            blocks.back().first = blocks.back().second;
+        } else if (name == "endif" && !blocks.empty()) {
+            blocks.pop_back();
+        }
+    }
+};
+} // namespace
+
+bool ShaderPreprocessor::expand(const std::string &path,
+        const std::string &text, std::vector<std::string> &stack,
+        Expansion &out) {
+    std::size_t file_index = out.dependencies.size();
+    out.dependencies.emplace_back(path, content_hash(path, text));
+    stack.push_back(path);
+
+    std::string directory = directory_of(path);
+    std::size_t line_number = 0;
+    std::size_t line_start = 0;
+    bool in_comment = false;
+    Conditionals conditionals;
+    while (line_start < text.size()) {
+        std::size_t line_end = text.find('\n', line_start);
+        if (line_end == std::string::npos) {
+            line_end = text.size();
+        }
+        std::string_view line{text.data() + line_start, line_end - line_start};
+        line_start = line_end + 1;
+        ++line_number;
+
+        // the line is kept as written, but commented out or skipped
+        // includes aren't expanded
+        bool starts_in_comment = in_comment;
+        std::string code = strip_comments(line, in_comment);
+        std::string_view name;
+        std::string_view rest;
+        std::string target;
+        bool is_directive =
+                !starts_in_comment && parse_directive(code, name, rest);
+        if (is_directive) {
+            conditionals.apply(name, rest);
+        }
+        if (!is_directive || conditionals.is_skipping() ||
+                !parse_include(name, rest, target)) {
+            out.source.append(line);
+            out.source.push_back('\n');
+            continue;
+        }
+
+        std::string include_path = normalize_path(directory + target);
+        if (std::find(stack.begin(), stack.end(), include_path) !=
+                stack.end()) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                    "%s:%zu: \"%s\" includes itself", path.c_str(),
+                    line_number, include_path.c_str());
+            return false;
+        }
+        bool already_included = std::any_of(out.dependencies.begin(),
+                out.dependencies.end(), [&](const auto &dependency) {
+                    return dependency.first == include_path;
+                });
+        if (already_included) {
+            // keep the line count so later lines don't need a #line
+            out.source += "// already included: " + target + "\n";
+            continue;
+        }
+
+        std::string include_text;
+        if (!read_file(include_path, include_text)) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR,
+                    "%s:%zu: unable to include \"%s\": %s", path.c_str(),
+                    line_number, include_path.c_str(), SDL_GetError());
+            return false;
+        }
+        // GLSL 3.30 numbers the line after "#line N S" as N + 1, in source
+        // string S
+        out.source += "#line 0 " + std::to_string(out.dependencies.size()) +
+                      "\n";
+        if (!expand(include_path, include_text, stack, out)) {
+            return false;
+        }
+        out.source += "#line " + std::to_string(line_number) + " " +
+                      std::to_string(file_index) + "\n";
+    }
+
+    stack.pop_back();
+    return true;
+}
+
+bool ShaderPreprocessor::is_current(const Expansion &expansion) const {
+    // the root file was already checked by the memo lookup
+    for (std::size_t i = 1; i < expansion.dependencies.size(); ++i) {
+        const auto &[path, hash] = expansion.dependencies[i];
+        std::string text;
+        if (!read_file(path, text) || content_hash(path, text) != hash) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::process(
+        const std::string &path_as_given) {
+    std::string path = normalize_path(path_as_given);
+    Result result;
+    std::string text;
+    if (!read_file(path, text)) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Unable to load shader \"%s\": %s",
+                path.c_str(), SDL_GetError());
+        result.dependencies.push_back(path);
+        return result;
+    }
+
+    uint64_t key = content_hash(path, text);
+    auto it = memo.find(key);
+    if (it != memo.end() && is_current(it->second)) {
+        ++stats.memo_hits;
+    } else {
+        ++stats.memo_misses;
+        Expansion expansion;
+        std::vector<std::string> stack;
+        bool ok = expand(path, text, stack, expansion);
+        for (const auto &dependency : expansion.dependencies) {
+            result.dependencies.push_back(dependency.first);
+        }
+        if (!ok) {
+            return result;
+        }
+
+        // older versions of the same file are never coming back
+        std::erase_if(memo, [&](const auto &entry) {
+            return entry.second.dependencies.front().first == path;
+        });
+        it = memo.insert_or_assign(key, std::move(expansion)).first;
+        result.dependencies.clear();
+    }
+
+    result.ok = true;
+    result.source = it->second.source;
+    for (const auto &dependency : it->second.dependencies) {
+        result.dependencies.push_back(dependency.first);
+    }
+    return result;
+}
+
+const ShaderPreprocessor::Stats &ShaderPreprocessor::get_stats() const {
+    return stats;
+}
+} // namespace Charcoal
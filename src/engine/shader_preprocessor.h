@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class ShaderPreprocessor
+ * @brief Expands #include "file" directives in GLSL, which has no include
+ * support of its own.
+ *
+ * Paths are relative to the including file, and normalized, so "a/../b"
+ * and "b" are the same file. Each file is included at most once per
+ * expansion, so shared helpers don't need include guards, and include cycles
+ * are reported as errors. Includes in comments and in "#if 0" blocks are
+ * left alone. #line directives are emitted around every include so compiler
+ * errors point at the right file and line: the second number in a driver
+ * error is the index into the dependency list.
+ *
+ * Expansions are memoized by the content hash of every file involved, so
+ * reloading a shader only re-expands what actually changed.
+ */
+class ShaderPreprocessor {
+public:
+    struct Result {
+        bool ok = false;
+        std::string source;
+        // the file itself first, then everything it includes. Watch these
+        // to know when the result is out of date.
+        std::vector<std::string> dependencies;
+    };
+
+    struct Stats {
+        std::size_t memo_hits = 0;
+        std::size_t memo_misses = 0;
+    };
+
+private:
+    struct Expansion {
+        std::string source;
+        // dependency path -> content hash at the time of expansion
+        std::vector<std::pair<std::string, uint64_t>> dependencies;
+    };
+
+    // hash of (path, content) of the root file -> its expansion
+    std::unordered_map<uint64_t, Expansion> memo;
+    Stats stats;
+
+    bool expand(const std::string &path, const std::string &text,
+            std::vector<std::string> &stack, Expansion &out);
+    bool is_current(const Expansion &expansion) const;
+
+public:
+    /**
+     * @brief Loads a GLSL file and expands its includes.
+     *
+     * @param path Path to the file
+     * @return The expanded source and the files it depends on, with
+     * normalized paths. ok is false if any file couldn't be read or the
+     * includes form a cycle.
+     */
+    Result process(const std::string &path);
+
+    const Stats &get_stats() const;
+};
+} // namespace Charcoal
@@ -0,0 +1,31 @@
+#pragma once
+
+// Shared macros for the hand-vectorized kernels in the engine.
+//
+// x86 kernels are compiled per-function with CHARCOAL_TARGET so the rest of
+// the engine doesn't need -mssse3/-mavx. Callers must check the CPU at
+// runtime (SDL_HasSSSE3(), SDL_HasAVX(), ...) before calling them.
+// ARM64 always has NEON, so those kernels need no runtime check.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||             \
+        defined(_M_IX86)
+#define CHARCOAL_SIMD_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define CHARCOAL_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// SSE2 is part of the x86-64 baseline, so it needs no runtime check there
+#if defined(CHARCOAL_SIMD_X86) &&                                              \
+        (defined(__SSE2__) || defined(_M_X64) ||                               \
+                (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CHARCOAL_SIMD_SSE2 1
+#endif
+
+#if defined(CHARCOAL_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CHARCOAL_TARGET(isa) __attribute__((target(isa)))
+#else
+// MSVC lets any function use any intrinsic
+#define CHARCOAL_TARGET(isa)
+#endif
@@ -1,44 +1,68 @@
 #include "texture.h"
+#include <SDL3/SDL_iostream.h>
 #include <SDL3/SDL_log.h>
 #include "color.h"
+#include "memory_tracker.h"
+#include "pixel_convert.h"
+#include <utility>
 
 namespace Charcoal {
 
-Texture TextureLoader::load_from_png(const char *filepath) {
-    // load the texture data
-    SDL_Surface *initial_load = nullptr;
-    initial_load = SDL_LoadPNG(filepath);
-    if (initial_load != nullptr) {
-        if (initial_load->format != SDL_PIXELFORMAT_RGBA32) {
-            SDL_Surface *converted =
-                    SDL_ConvertSurface(initial_load, SDL_PIXELFORMAT_RGBA32);
-            SDL_DestroySurface(initial_load);
+Texture TextureLoader::from_surface(SDL_Surface *surface, const char *name) {
+    if (surface != nullptr) {
+        if (surface->format != SDL_PIXELFORMAT_RGBA32) {
+            // our own kernels cover the common PNG layouts, SDL handles the
+            // rest
+            SDL_Surface *converted = PixelConvert::convert_to_rgba32(surface);
+            if (converted == nullptr) {
+                converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+            }
+            SDL_DestroySurface(surface);
             return Texture(converted);
         } else {
-            return Texture(initial_load);
+            return Texture(surface);
         }
     } else {
         SDL_LogCritical(SDL_LOG_CATEGORY_CUSTOM, "Unable to load \"%s\": %s",
-                filepath, SDL_GetError());
+                name, SDL_GetError());
         return Texture();
     }
 }
 
-Texture::Texture() : surface{init_missing_texture()} {
+Texture TextureLoader::load_from_png(const char *filepath) {
+    // load the texture data
+    return from_surface(SDL_LoadPNG(filepath), filepath);
+}
+
+Texture TextureLoader::load_from_png_mem(
+        const void *data, std::size_t size, const char *name) {
+    SDL_IOStream *stream = SDL_IOFromConstMem(data, size);
+    if (stream == nullptr) {
+        return from_surface(nullptr, name);
+    }
+    // the stream is closed by SDL_LoadPNG_IO
+    return from_surface(SDL_LoadPNG_IO(stream, true), name);
+}
+
+Texture::Texture() : surface{init_missing_texture()}, missing{true} {
     
 }
 
 Texture::Texture(SDL_Surface *surface) :
-        surface{surface ? surface : init_missing_texture()} {
+        surface{surface ? surface : init_missing_texture()},
+        missing{surface == nullptr} {
 }
 
-Texture::Texture(const Texture &other) {
+Texture::Texture(const Texture &other) :
+        mips{other.mips}, missing{other.missing} {
     this->surface = SDL_DuplicateSurface(other.surface);
 }
 
 Texture &Texture::operator=(const Texture &other) {
     if (this != &other) {        
         this->surface = SDL_DuplicateSurface(other.surface);
+        this->mips = other.mips;
+        this->missing = other.missing;
     }
     return *this;
 }
@@ -83,33 +107,62 @@ int Texture::get_height() const {
     }
 }
 
-GpuTexture::GpuTexture() : id{0} {
+bool Texture::is_missing() const {
+    return missing;
+}
+
+void Texture::generate_mips(const Mipmap::Options &options, ThreadPool *pool) {
+    if (surface == nullptr) {
+        return;
+    }
+    mips = Mipmap::generate(static_cast<const uint8_t *>(surface->pixels),
+            surface->w, surface->h, surface->pitch, options, pool);
+}
+
+const std::vector<MipLevel> &Texture::get_mips() const {
+    return mips;
+}
+
+std::vector<MipLevel> Texture::take_mips() {
+    return std::move(mips);
+}
+
+GpuTexture::GpuTexture() : id{0}, size_bytes{0} {
+    // filtering and wrapping come from the sampler bound alongside the
+    // texture, see SamplerCache
     glGenTextures(1, &id);
-    // set default parameters (wrapping, filter)
-    glBindTexture(GL_TEXTURE_2D, id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_R, GL_REPEAT);
-    glTexParameteri(
-            GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 }
 
-GpuTexture::GpuTexture(GpuTexture &&other) noexcept : id{other.id} {
+GpuTexture::GpuTexture(GpuTexture &&other) noexcept :
+        id{other.id}, size_bytes{other.size_bytes},
+        level_bytes{std::move(other.level_bytes)} {
     other.id = 0;
+    other.size_bytes = 0;
 }
 
 GpuTexture &GpuTexture::operator=(GpuTexture &&other) noexcept {
     if (this != &other) {
+        release();
         this->id = other.id;
+        this->size_bytes = other.size_bytes;
+        this->level_bytes = std::move(other.level_bytes);
         other.id = 0;
+        other.size_bytes = 0;
     }
     return *this;
 }
 
 GpuTexture::~GpuTexture() noexcept {
+    release();
+}
+
+void GpuTexture::release() noexcept {
     if (id != 0) {
         glDeleteTextures(1, &id);
+        MemoryTracker::add_gpu_bytes(MemoryTracker::GpuCategory::textures,
+                -static_cast<std::ptrdiff_t>(size_bytes));
     }
+    size_bytes = 0;
 }
 
 void GpuTexture::upload(const Texture &texture) {
@@ -118,7 +171,58 @@ void GpuTexture::upload(const Texture &texture) {
             texture.get_width(), texture.get_height(),
             0, GL_RGBA, GL_UNSIGNED_BYTE,
             texture.get_pixels());
-    glGenerateMipmap(GL_TEXTURE_2D);
+    std::size_t base_size = static_cast<std::size_t>(texture.get_width()) *
+                            static_cast<std::size_t>(texture.get_height()) * 4;
+    for (std::size_t level = 0; level < level_bytes.size(); ++level) {
+        set_level_bytes(static_cast<int>(level), 0);
+    }
+    set_level_bytes(0, base_size);
+
+    const std::vector<MipLevel> &mips = texture.get_mips();
+    if (mips.empty()) {
+        set_level_range(0, 1000);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        // a full mip chain adds roughly a third on top of the base level
+        set_level_bytes(1, base_size / 3);
+        return;
+    }
+
+    // the levels were already filtered on the CPU, the driver just copies
+    for (std::size_t i = 0; i < mips.size(); ++i) {
+        upload_level(static_cast<int>(i + 1), mips[i]);
+    }
+    set_level_range(0, static_cast<int>(mips.size()));
+}
+
+void GpuTexture::upload_level(int level, const MipLevel &level_data) {
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, level_data.width,
+            level_data.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+            level_data.pixels.data());
+    set_level_bytes(level, level_data.pixels.size());
+}
+
+void GpuTexture::release_level(int level) {
+    // respecifying a level as 0x0 lets the driver free its storage
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, 0, 0, 0, GL_RGBA,
+            GL_UNSIGNED_BYTE, nullptr);
+    set_level_bytes(level, 0);
+}
+
+void GpuTexture::set_level_range(int base, int max) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, base);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max);
+}
+
+void GpuTexture::set_level_bytes(int level, std::size_t bytes) {
+    std::size_t index = static_cast<std::size_t>(level);
+    if (index >= level_bytes.size()) {
+        level_bytes.resize(index + 1, 0);
+    }
+    MemoryTracker::add_gpu_bytes(MemoryTracker::GpuCategory::textures,
+            static_cast<std::ptrdiff_t>(bytes) -
+                    static_cast<std::ptrdiff_t>(level_bytes[index]));
+    size_bytes = size_bytes - level_bytes[index] + bytes;
+    level_bytes[index] = bytes;
 }
 
 void GpuTexture::bind() {
@@ -129,4 +233,8 @@ bool GpuTexture::is_valid() const {
     return id != 0;
 }
 
+std::size_t GpuTexture::get_size_bytes() const {
+    return size_bytes;
+}
+
 } // namespace Charcoal
\ No newline at end of file
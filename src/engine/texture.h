@@ -1,10 +1,19 @@
 #pragma once
+#include "mipmap.h"
 #include <SDL3/SDL_surface.h>
+#include <cstddef>
 #include <glad/glad.h>
+#include <vector>
 
 namespace Charcoal {
+class ThreadPool;
+
 class Texture {
     SDL_Surface *surface;
+    // levels below the base level, empty until generate_mips() is called
+    std::vector<MipLevel> mips;
+    // holds the missing texture because nothing (or nothing valid) was given
+    bool missing;
     static SDL_Surface *init_missing_texture();
 
 public:
@@ -20,15 +29,62 @@ public:
     void *get_pixels() const;
     int get_width() const;
     int get_height() const;
+
+    /**
+     * @brief Returns true if this is the missing texture stand-in, e.g.
+     * because a file failed to decode.
+     */
+    bool is_missing() const;
+
+    /**
+     * @brief Builds the full mip chain on the CPU so GpuTexture::upload() can
+     * upload every level as-is instead of asking the driver to generate them.
+     *
+     * @param options Filter settings
+     * @param pool Worker threads to filter on. May be null.
+     */
+    void generate_mips(const Mipmap::Options &options, ThreadPool *pool);
+
+    /**
+     * @brief Returns the generated mip levels, largest first, not including
+     * the base level. Empty if generate_mips() hasn't been called.
+     */
+    const std::vector<MipLevel> &get_mips() const;
+
+    /**
+     * @brief Moves the generated mip levels out of the texture, leaving it
+     * without any.
+     */
+    std::vector<MipLevel> take_mips();
 };
 
 class TextureLoader {
+    static Texture from_surface(SDL_Surface *surface, const char *name);
+
 public:
     static Texture load_from_png(const char *filepath);
+
+    /**
+     * @brief Decodes a PNG that has already been read into memory.
+     *
+     * @param data The encoded PNG bytes
+     * @param size The number of bytes in data
+     * @param name Name used when logging errors, usually the source path
+     * @return The decoded texture, or the missing texture on failure
+     */
+    static Texture load_from_png_mem(
+            const void *data, std::size_t size, const char *name);
 };
 
 class GpuTexture {
     GLuint id;
+    std::size_t size_bytes;
+    // bytes currently allocated for each level
+    std::vector<std::size_t> level_bytes;
+
+    void set_level_bytes(int level, std::size_t bytes);
+    // deletes the texture and stops tracking its memory
+    void release() noexcept;
 
 public:
     explicit GpuTexture();
@@ -43,9 +99,49 @@ public:
 
     ~GpuTexture() noexcept;
     
+    /**
+     * @brief Uploads the texture and its mip chain. If the texture has no
+     * CPU-generated mips, glGenerateMipmap is used instead.
+     * @param texture The texture to upload
+     */
     void upload(const Texture &texture);
+
+    /**
+     * @brief Uploads a single mip level, replacing any existing data for it.
+     * The texture must already be bound.
+     *
+     * @param level The mip level, 0 being the largest
+     * @param level_data Tightly packed RGBA32 pixels for the level
+     */
+    void upload_level(int level, const MipLevel &level_data);
+
+    /**
+     * @brief Frees the storage of a single mip level. The level must be
+     * outside the range set by set_level_range(). The texture must already
+     * be bound.
+     *
+     * @param level The mip level to free
+     */
+    void release_level(int level);
+
+    /**
+     * @brief Restricts sampling to levels [base, max]. Levels outside the
+     * range don't need to be defined. The texture must already be bound.
+     *
+     * @param base Finest level that can be sampled
+     * @param max Coarsest level that can be sampled
+     */
+    void set_level_range(int base, int max);
+
     void bind();
 
     bool is_valid() const;
+
+    /**
+     * @brief Returns the approximate amount of video memory used by the
+     * texture, including its mip chain.
+     * @return The size in bytes, or 0 if nothing has been uploaded
+     */
+    std::size_t get_size_bytes() const;
 };
 }
\ No newline at end of file
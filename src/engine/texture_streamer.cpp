@@ -0,0 +1,406 @@
+#include "texture_streamer.h"
+#include "memory_tracker.h"
+#include "texture.h"
+#include "thread_pool.h"
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <glm/vec4.hpp>
+
+namespace Charcoal {
+namespace {
+// frames to wait before retrying a load that didn't fit in the budget
+constexpr int64_t RETRY_DELAY_FRAMES = 30;
+
+std::size_t level_size(int width, int height, int level) {
+    std::size_t w = static_cast<std::size_t>(std::max(width >> level, 1));
+    std::size_t h = static_cast<std::size_t>(std::max(height >> level, 1));
+    return w * h * 4;
+}
+} // namespace
+
+TextureStreamer::TextureStreamer(ThreadPool *pool, AssetManager *assets,
+        std::size_t upload_budget_bytes) :
+        pool{pool}, assets{assets}, upload_budget_bytes{upload_budget_bytes} {
+}
+
+TextureStreamer::~TextureStreamer() noexcept {
+    // don't leave workers decoding into results nobody will read
+    for (Entry &entry : entries) {
+        if (entry.pending.valid()) {
+            entry.pending.wait();
+        }
+    }
+    for (std::future<LoadResult> &load : abandoned) {
+        load.wait();
+    }
+    assets->release_bytes(stats.resident_bytes);
+}
+
+TextureStreamer::LoadResult TextureStreamer::load_levels(
+        std::string path, int first_level, ThreadPool *pool) {
+    LoadResult result;
+    std::size_t file_size = 0;
+    void *file_data = SDL_LoadFile(path.c_str(), &file_size);
+    if (file_data == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_CUSTOM, "Unable to stream \"%s\": %s",
+                path.c_str(), SDL_GetError());
+        return result;
+    }
+    Texture texture = TextureLoader::load_from_png_mem(
+            file_data, file_size, path.c_str());
+    SDL_free(file_data);
+    if (texture.is_missing()) {
+        // the decoder logged why. No levels means the load failed
+        return result;
+    }
+
+    texture.generate_mips(Mipmap::Options{}, pool);
+    result.width = texture.get_width();
+    result.height = texture.get_height();
+
+    // PNGs can't be partially decoded, so the whole chain was built. Only
+    // keep the levels that were asked for.
+    int level_count = Mipmap::level_count(result.width, result.height);
+    result.first_level = std::clamp(first_level, 0, level_count - 1);
+    std::vector<MipLevel> mips = texture.take_mips();
+    if (result.first_level == 0) {
+        MipLevel base;
+        base.width = result.width;
+        base.height = result.height;
+        const uint8_t *pixels = static_cast<const uint8_t *>(texture.get_pixels());
+        base.pixels.assign(pixels,
+                pixels + level_size(result.width, result.height, 0));
+        result.levels.push_back(std::move(base));
+    }
+    for (int level = std::max(result.first_level, 1); level < level_count;
+            ++level) {
+        result.levels.push_back(std::move(mips[level - 1]));
+    }
+    return result;
+}
+
+TextureStreamer::Id TextureStreamer::add(const char *path) {
+    for (Id id = 0; id < entries.size(); ++id) {
+        if (entries[id].references > 0 && entries[id].path == path) {
+            ++entries[id].references;
+            return id;
+        }
+    }
+
+    Entry entry;
+    entry.path = path;
+    entry.references = 1;
+    entry.gpu = std::make_shared<GpuTexture>();
+    // sample the missing texture until real data arrives
+    entry.gpu->upload(Texture());
+    entry.last_requested_frame = frame;
+    // nothing is known about the size yet, so decode everything and keep
+    // whatever is wanted by the time it arrives
+    Id id = entries.size();
+    if (!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+        entries[id] = std::move(entry);
+    } else {
+        entries.push_back(std::move(entry));
+    }
+    start_load(entries[id], 0);
+    ++stats.texture_count;
+    return id;
+}
+
+void TextureStreamer::remove(Id id) {
+    Entry &entry = entries[id];
+    if (--entry.references > 0) {
+        return;
+    }
+    if (entry.failed) {
+        --stats.failed_count;
+    }
+    if (entry.pending.valid()) {
+        // waiting would stall the frame on a decode
+        abandoned.push_back(std::move(entry.pending));
+        --stats.loads_in_flight;
+    }
+    for (int level = entry.resident_level; level < entry.level_count;
+            ++level) {
+        stats.resident_bytes -= entry.level_bytes[level];
+        assets->release_bytes(entry.level_bytes[level]);
+    }
+    // the texture is freed along with the last handle to it. An empty entry
+    // is skipped by everything until add() reuses it
+    entry = Entry{};
+    free_ids.push_back(id);
+    --stats.texture_count;
+}
+
+void TextureStreamer::start_load(Entry &entry, int first_level) {
+    entry.pending = pool->submit(
+            [path = entry.path, first_level, pool = pool] {
+                MemoryTracker::TagScope tag{MemoryTracker::Tag::texture};
+                return load_levels(path, first_level, pool);
+            });
+    ++stats.loads_in_flight;
+}
+
+void TextureStreamer::request(Id id, float screen_pixels) {
+    Entry &entry = entries[id];
+    entry.requested_pixels = std::max(entry.requested_pixels, screen_pixels);
+    entry.last_requested_frame = frame;
+}
+
+int TextureStreamer::level_for_size(
+        const Entry &entry, float screen_pixels) const {
+    if (screen_pixels <= 0.0f) {
+        return entry.tail_level;
+    }
+    // one texel per pixel along the longest side
+    float texels = static_cast<float>(std::max(entry.width, entry.height));
+    int level = static_cast<int>(std::floor(std::log2(texels / screen_pixels)));
+    return std::clamp(level, 0, entry.tail_level);
+}
+
+void TextureStreamer::receive_loads() {
+    for (Entry &entry : entries) {
+        if (!entry.pending.valid() ||
+                entry.pending.wait_for(std::chrono::seconds{0}) !=
+                        std::future_status::ready) {
+            continue;
+        }
+        LoadResult result = entry.pending.get();
+        --stats.loads_in_flight;
+        if (result.levels.empty()) {
+            // keep showing the missing texture, or the detail already
+            // resident if the file broke since
+            if (entry.level_count == 0) {
+                entry.failed = true;
+                ++stats.failed_count;
+            }
+            continue;
+        }
+
+        if (entry.level_count == 0) {
+            // first load, now the size is known
+            entry.width = result.width;
+            entry.height = result.height;
+            entry.level_count = Mipmap::level_count(entry.width, entry.height);
+            entry.tail_level = entry.level_count - 1;
+            while (entry.tail_level > 0 &&
+                    std::max(entry.width >> (entry.tail_level - 1), 1) <=
+                            MIP_TAIL_SIZE &&
+                    std::max(entry.height >> (entry.tail_level - 1), 1) <=
+                            MIP_TAIL_SIZE) {
+                --entry.tail_level;
+            }
+            entry.resident_level = entry.level_count;
+            entry.level_bytes.assign(entry.level_count, 0);
+            // requests made while loading can finally be resolved
+            entry.wanted_level = level_for_size(entry, entry.requested_pixels);
+
+            // the placeholder isn't counted against the budget
+            entry.gpu->bind();
+            entry.gpu->release_level(0);
+            entry.gpu->release_level(1);
+        }
+
+        // discard anything finer than what's wanted right now
+        int keep_from = std::min(entry.wanted_level, entry.tail_level);
+        int drop = std::max(keep_from - result.first_level, 0);
+        drop = std::min(drop, static_cast<int>(result.levels.size()));
+        result.levels.erase(result.levels.begin(), result.levels.begin() + drop);
+        result.first_level += drop;
+        entry.staged = std::move(result);
+    }
+}
+
+void TextureStreamer::upload_staged(Entry &entry, std::size_t &upload_budget) {
+    std::vector<MipLevel> &levels = entry.staged.levels;
+    if (levels.empty()) {
+        return;
+    }
+    entry.gpu->bind();
+
+    // upload coarsest first so the resident range stays contiguous
+    while (!levels.empty()) {
+        int level = entry.staged.first_level +
+                    static_cast<int>(levels.size()) - 1;
+        if (level >= entry.resident_level) {
+            // already resident
+            levels.pop_back();
+            continue;
+        }
+        if (level != entry.resident_level - 1) {
+            // would leave a hole
+            break;
+        }
+
+        std::size_t bytes = levels.back().pixels.size();
+        bool is_tail = level >= entry.tail_level;
+        if (!is_tail && bytes > upload_budget) {
+            // try again next frame
+            break;
+        }
+        // the tail is uploaded even over budget
+        if (!reserve(bytes, is_tail) && !is_tail) {
+            // can't make room, give up on this detail for a while
+            levels.clear();
+            entry.retry_frame = frame + RETRY_DELAY_FRAMES;
+            break;
+        }
+        if (!is_tail) {
+            upload_budget -= bytes;
+        }
+
+        entry.gpu->upload_level(level, levels.back());
+        entry.level_bytes[level] = bytes;
+        stats.resident_bytes += bytes;
+        stats.uploaded_bytes_this_frame += bytes;
+        levels.pop_back();
+
+        // every level from here down is defined, so the texture is complete
+        entry.resident_level = level;
+        entry.gpu->set_level_range(level, entry.level_count - 1);
+    }
+}
+
+void TextureStreamer::drop_to(Entry &entry, int level) {
+    level = std::min(level, entry.tail_level);
+    if (level <= entry.resident_level) {
+        return;
+    }
+    entry.gpu->bind();
+    // narrow the range before freeing so the texture stays complete
+    entry.gpu->set_level_range(level, entry.level_count - 1);
+    for (int l = entry.resident_level; l < level; ++l) {
+        entry.gpu->release_level(l);
+        stats.resident_bytes -= entry.level_bytes[l];
+        assets->release_bytes(entry.level_bytes[l]);
+        entry.level_bytes[l] = 0;
+        ++stats.dropped_levels;
+    }
+    entry.resident_level = level;
+}
+
+bool TextureStreamer::drop_unwanted_level() {
+    // from the texture that was requested longest ago
+    Entry *victim = nullptr;
+    for (Entry &entry : entries) {
+        if (entry.level_count == 0 ||
+                entry.resident_level >= entry.wanted_level) {
+            continue;
+        }
+        if (victim == nullptr ||
+                entry.last_requested_frame < victim->last_requested_frame) {
+            victim = &entry;
+        }
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+    drop_to(*victim, victim->resident_level + 1);
+    return true;
+}
+
+bool TextureStreamer::reserve(std::size_t bytes, bool required) {
+    // the asset manager evicts what nobody holds, then detail nobody wants
+    // goes
+    while (!assets->reserve_bytes(bytes)) {
+        if (!drop_unwanted_level()) {
+            return assets->reserve_bytes(bytes, required);
+        }
+    }
+    return true;
+}
+
+void TextureStreamer::update(int64_t frame_count) {
+    frame = frame_count;
+    stats.uploaded_bytes_this_frame = 0;
+    receive_loads();
+    std::erase_if(abandoned, [](const std::future<LoadResult> &load) {
+        return load.wait_for(std::chrono::seconds{0}) ==
+               std::future_status::ready;
+    });
+
+    for (Entry &entry : entries) {
+        if (entry.level_count == 0) {
+            continue;
+        }
+        entry.wanted_level = level_for_size(entry, entry.requested_pixels);
+        entry.requested_pixels = 0.0f;
+    }
+
+    // the budget may have shrunk, or requests moved on
+    const AssetManager::Stats &budget = assets->get_stats();
+    while (budget.budget_bytes != 0 &&
+            budget.resident_bytes > budget.budget_bytes &&
+            drop_unwanted_level()) {
+    }
+
+    // spend this frame's upload budget on the textures missing the most
+    // detail first
+    std::vector<Entry *> order;
+    order.reserve(entries.size());
+    for (Entry &entry : entries) {
+        order.push_back(&entry);
+    }
+    std::sort(order.begin(), order.end(), [](const Entry *a, const Entry *b) {
+        return a->resident_level - a->wanted_level >
+               b->resident_level - b->wanted_level;
+    });
+
+    std::size_t upload_budget = upload_budget_bytes;
+    for (Entry *entry : order) {
+        if (entry->level_count == 0) {
+            continue;
+        }
+        upload_staged(*entry, upload_budget);
+
+        bool needs_detail = entry->wanted_level < entry->resident_level;
+        bool idle = !entry->pending.valid() && entry->staged.levels.empty();
+        if (needs_detail && idle && frame >= entry->retry_frame) {
+            start_load(*entry, entry->wanted_level);
+        }
+    }
+}
+
+const TextureHandle &TextureStreamer::get_texture(Id id) const {
+    return entries[id].gpu;
+}
+
+const TextureStreamer::Stats &TextureStreamer::get_stats() const {
+    return stats;
+}
+
+float TextureStreamer::screen_extent(const glm::mat4 &mvp, const glm::vec3 &min,
+        const glm::vec3 &max, const glm::vec2 &viewport) {
+    float min_x = std::numeric_limits<float>::max();
+    float min_y = std::numeric_limits<float>::max();
+    float max_x = std::numeric_limits<float>::lowest();
+    float max_y = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < 8; ++i) {
+        glm::vec4 corner{(i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y,
+                (i & 4) ? max.z : min.z, 1.0f};
+        glm::vec4 clip = mvp * corner;
+        if (clip.w <= 0.0f) {
+            // crosses the camera plane, assume it fills the screen
+            return std::max(viewport.x, viewport.y);
+        }
+        float x = clip.x / clip.w;
+        float y = clip.y / clip.w;
+        min_x = std::min(min_x, x);
+        min_y = std::min(min_y, y);
+        max_x = std::max(max_x, x);
+        max_y = std::max(max_y, y);
+    }
+    // NDC spans 2 units across the viewport
+    float width = (max_x - min_x) * 0.5f * viewport.x;
+    float height = (max_y - min_y) * 0.5f * viewport.y;
+    return std::max(width, height);
+}
+} // namespace Charcoal
@@ -0,0 +1,175 @@
+#pragma once
+#include "asset_manager.h"
+#include "mipmap.h"
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+namespace Charcoal {
+class ThreadPool;
+
+/**
+ * @class TextureStreamer
+ * @brief Keeps only the mip levels that are actually visible resident on the
+ * GPU.
+ *
+ * Every frame, callers report how large each texture appears on screen with
+ * request(). update() turns that into a wanted mip level per texture, decodes
+ * missing levels on worker threads, and uploads them under a per-frame byte
+ * budget. The small mip tail of every texture always stays resident, so there
+ * is always something to sample.
+ *
+ * Resident levels count against the AssetManager's VRAM budget, alongside
+ * its own assets. When an upload doesn't fit, unreferenced assets are
+ * evicted first, then the least recently requested detail is dropped.
+ * Adding a path that's already streaming shares its texture.
+ */
+class TextureStreamer {
+public:
+    using Id = std::size_t;
+
+    struct Stats {
+        std::size_t resident_bytes = 0;
+        std::size_t texture_count = 0;
+        // textures whose file couldn't be read or decoded
+        std::size_t failed_count = 0;
+        std::size_t loads_in_flight = 0;
+        std::size_t uploaded_bytes_this_frame = 0;
+        std::size_t dropped_levels = 0;
+    };
+
+    // Levels no larger than this in either dimension make up the mip tail
+    static constexpr int MIP_TAIL_SIZE = 64;
+
+private:
+    // Levels decoded on a worker, starting at first_level
+    struct LoadResult {
+        int width = 0;
+        int height = 0;
+        int first_level = 0;
+        std::vector<MipLevel> levels;
+    };
+
+    struct Entry {
+        std::string path;
+        // add() calls not yet matched by remove()
+        uint32_t references = 0;
+        // the file couldn't be read or decoded, so it's never retried
+        bool failed = false;
+        TextureHandle gpu;
+        int width = 0;
+        int height = 0;
+        int level_count = 0;
+        // first level of the always-resident tail
+        int tail_level = 0;
+        // finest level currently on the GPU. level_count means nothing is
+        // resident yet
+        int resident_level = 0;
+        // finest level wanted this frame, from requested_pixels
+        int wanted_level = 0;
+        // largest on-screen size reported since the last update()
+        float requested_pixels = 0.0f;
+        int64_t last_requested_frame = 0;
+        // don't start another load before this frame
+        int64_t retry_frame = 0;
+        std::vector<std::size_t> level_bytes;
+        // decoded levels waiting for upload budget
+        LoadResult staged;
+        std::future<LoadResult> pending;
+    };
+
+    std::vector<Entry> entries;
+    // ids of removed entries, reused by add()
+    std::vector<Id> free_ids;
+    // loads of removed textures, dropped once they finish
+    std::vector<std::future<LoadResult>> abandoned;
+    ThreadPool *pool;
+    AssetManager *assets;
+    std::size_t upload_budget_bytes;
+    int64_t frame = 0;
+    Stats stats;
+
+    static LoadResult load_levels(
+            std::string path, int first_level, ThreadPool *pool);
+
+    void start_load(Entry &entry, int first_level);
+    void receive_loads();
+    void upload_staged(Entry &entry, std::size_t &upload_budget);
+    void drop_to(Entry &entry, int level);
+    // drops a level nobody asked for this frame, false if there is none
+    bool drop_unwanted_level();
+    bool reserve(std::size_t bytes, bool required);
+    int level_for_size(const Entry &entry, float screen_pixels) const;
+
+public:
+    /**
+     * @param pool Worker threads that decode and filter texture data
+     * @param assets Holds the VRAM budget that resident levels count against
+     * @param upload_budget_bytes Maximum bytes uploaded per frame
+     */
+    TextureStreamer(ThreadPool *pool, AssetManager *assets,
+            std::size_t upload_budget_bytes);
+    ~TextureStreamer() noexcept;
+
+    TextureStreamer(const TextureStreamer &other) = delete;
+    TextureStreamer &operator=(const TextureStreamer &other) = delete;
+
+    /**
+     * @brief Starts streaming a PNG texture. The returned handle can be bound
+     * right away; it samples the missing texture until the mip tail arrives,
+     * and for good if the file can't be loaded. A path that's already
+     * streaming returns the same id, which then needs a remove() per add().
+     *
+     * @param path Path to a PNG file
+     * @return An id for request() and get_texture()
+     */
+    Id add(const char *path);
+
+    /**
+     * @brief Stops streaming a texture once every add() of it is removed.
+     * Its memory is freed once nothing else holds its handle. The id may then
+     * be handed out again by add().
+     *
+     * @param id The texture id from add()
+     */
+    void remove(Id id);
+
+    /**
+     * @brief Reports that an object using the texture covers the given number
+     * of pixels on screen, along its longest axis, this frame.
+     *
+     * @param id The texture id from add()
+     * @param screen_pixels Projected size of the object, in pixels
+     */
+    void request(Id id, float screen_pixels);
+
+    /**
+     * @brief Uploads finished loads, starts new ones based on this frame's
+     * requests, and drops detail when over budget. Call once per frame on the
+     * render thread, after all request() calls.
+     *
+     * @param frame_count The current frame number
+     */
+    void update(int64_t frame_count);
+
+    const TextureHandle &get_texture(Id id) const;
+    const Stats &get_stats() const;
+
+    /**
+     * @brief Projects an axis-aligned box to the screen and returns the larger
+     * side of its bounding rectangle, in pixels. Useful for request().
+     *
+     * @param mvp Model-view-projection matrix
+     * @param min Minimum corner of the box in model space
+     * @param max Maximum corner of the box in model space
+     * @param viewport Viewport size in pixels
+     */
+    static float screen_extent(const glm::mat4 &mvp, const glm::vec3 &min,
+            const glm::vec3 &max, const glm::vec2 &viewport);
+};
+} // namespace Charcoal
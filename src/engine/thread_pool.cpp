@@ -0,0 +1,121 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <utility>
+
+namespace Charcoal {
+namespace {
+// Shared between the caller of parallel_for and its helper jobs. Helpers can
+// start after the caller has returned, so it's kept alive by shared_ptr.
+struct ParallelForState {
+    std::function<void(std::size_t, std::size_t)> fn;
+    std::size_t count;
+    std::size_t grain;
+    std::size_t chunk_count;
+    std::atomic<std::size_t> next_chunk{0};
+    std::atomic<std::size_t> done_chunks{0};
+
+    // returns false once every chunk has been claimed
+    bool run_one() {
+        std::size_t chunk = next_chunk.fetch_add(1);
+        if (chunk >= chunk_count) {
+            return false;
+        }
+        std::size_t begin = chunk * grain;
+        std::size_t end = std::min(begin + grain, count);
+        fn(begin, end);
+        if (done_chunks.fetch_add(1) + 1 == chunk_count) {
+            done_chunks.notify_all();
+        }
+        return true;
+    }
+};
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+    if (thread_count == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        thread_count = cores > 1 ? cores - 1 : 1;
+    }
+    workers.reserve(thread_count);
+    for (unsigned int i = 0; i < thread_count; ++i) {
+        workers.emplace_back([this](std::stop_token stop) {
+            worker_loop(stop);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    for (std::jthread &worker : workers) {
+        worker.request_stop();
+    }
+    // jthread joins on destruction
+    workers.clear();
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard lock{mutex};
+        queue.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::worker_loop(std::stop_token stop) {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock{mutex};
+            if (!wake.wait(lock, stop, [this] {
+                    return !queue.empty();
+                })) {
+                // stop was requested while idle
+                return;
+            }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t count, std::size_t grain,
+        const std::function<void(std::size_t, std::size_t)> &fn) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t chunk_count = (count + grain - 1) / grain;
+    if (chunk_count == 1 || workers.empty()) {
+        fn(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->fn = fn;
+    state->count = count;
+    state->grain = grain;
+    state->chunk_count = chunk_count;
+
+    // the calling thread takes chunks too, so it needs one fewer helper
+    std::size_t helpers = std::min(workers.size(), chunk_count - 1);
+    for (std::size_t i = 0; i < helpers; ++i) {
+        enqueue([state] {
+            while (state->run_one()) {
+            }
+        });
+    }
+    while (state->run_one()) {
+    }
+
+    // wait for chunks still running on workers
+    std::size_t done = state->done_chunks.load();
+    while (done != chunk_count) {
+        state->done_chunks.wait(done);
+        done = state->done_chunks.load();
+    }
+}
+
+std::size_t ThreadPool::get_thread_count() const {
+    return workers.size();
+}
+} // namespace Charcoal
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Charcoal {
+/**
+ * @class ThreadPool
+ * @brief A fixed set of worker threads that run queued jobs in FIFO order.
+ *
+ * Jobs must not touch OpenGL; only the render thread owns the context.
+ */
+class ThreadPool {
+    std::vector<std::jthread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable_any wake;
+
+    void enqueue(std::function<void()> job);
+    void worker_loop(std::stop_token stop);
+
+public:
+    /**
+     * @param thread_count Number of workers to start. 0 picks one less than
+     * the number of logical cores, so the render thread keeps a core.
+     */
+    explicit ThreadPool(unsigned int thread_count = 0);
+    ~ThreadPool() noexcept;
+
+    ThreadPool(const ThreadPool &other) = delete;
+    ThreadPool &operator=(const ThreadPool &other) = delete;
+
+    /**
+     * @brief Queues a job to run on a worker thread.
+     *
+     * @param fn The job. Its return value (or exception) is delivered
+     * through the returned future.
+     * @return A future for the job's result
+     */
+    template <typename F>
+    auto submit(F &&fn) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        // std::function needs a copyable target, so share the task
+        auto task =
+                std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+        std::future<R> result = task->get_future();
+        enqueue([task] {
+            (*task)();
+        });
+        return result;
+    }
+
+    /**
+     * @brief Splits [0, count) into chunks of at most grain items and runs
+     * fn(begin, end) on each, using the workers and the calling thread.
+     * Returns once every chunk has finished.
+     *
+     * Safe to call from inside a job: the caller keeps taking chunks itself,
+     * so it never waits on a worker that is stuck behind it in the queue.
+     *
+     * @param count Number of items
+     * @param grain Maximum number of items per chunk
+     * @param fn Called as fn(std::size_t begin, std::size_t end)
+     */
+    void parallel_for(std::size_t count, std::size_t grain,
+            const std::function<void(std::size_t, std::size_t)> &fn);
+
+    /**
+     * @brief Returns the number of worker threads.
+     */
+    std::size_t get_thread_count() const;
+};
+} // namespace Charcoal
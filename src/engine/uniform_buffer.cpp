@@ -0,0 +1,52 @@
+#include "uniform_buffer.h"
+
+namespace Charcoal {
+UniformBuffer::UniformBuffer(std::size_t size_bytes) :
+        id{0}, size_bytes{size_bytes} {
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(size_bytes),
+            nullptr, GL_DYNAMIC_DRAW);
+}
+
+UniformBuffer::UniformBuffer(UniformBuffer &&other) noexcept :
+        id{other.id}, size_bytes{other.size_bytes} {
+    other.id = 0;
+    other.size_bytes = 0;
+}
+
+UniformBuffer &UniformBuffer::operator=(UniformBuffer &&other) noexcept {
+    if (this != &other) {
+        if (id != 0) {
+            glDeleteBuffers(1, &id);
+        }
+        this->id = other.id;
+        this->size_bytes = other.size_bytes;
+        other.id = 0;
+        other.size_bytes = 0;
+    }
+    return *this;
+}
+
+UniformBuffer::~UniformBuffer() noexcept {
+    if (id != 0) {
+        glDeleteBuffers(1, &id);
+    }
+}
+
+void UniformBuffer::update(const void *data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, id);
+    glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(size_bytes),
+            nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0,
+            static_cast<GLsizeiptr>(size_bytes), data);
+}
+
+void UniformBuffer::bind(GLuint binding) const {
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+}
+
+bool UniformBuffer::is_valid() const {
+    return id != 0;
+}
+} // namespace Charcoal
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <glad/glad.h>
+
+namespace Charcoal {
+/**
+ * @class UniformBuffer
+ * @brief Owns a GL buffer holding a uniform block's data, shared by every
+ * program that binds the block to the same binding.
+ */
+class UniformBuffer {
+    GLuint id;
+    std::size_t size_bytes;
+
+public:
+    /**
+     * @brief Allocates the buffer. Needs a current GL context.
+     * @param size_bytes Size of the block, following std140 layout rules
+     */
+    explicit UniformBuffer(std::size_t size_bytes);
+
+    // move constructors
+    UniformBuffer(UniformBuffer &&other) noexcept;
+    UniformBuffer &operator=(UniformBuffer &&other) noexcept;
+
+    // don't allow copying
+    UniformBuffer(const UniformBuffer &other) = delete;
+    UniformBuffer &operator=(const UniformBuffer &other) = delete;
+
+    ~UniformBuffer() noexcept;
+
+    /**
+     * @brief Replaces the whole block. The old storage is orphaned first, so
+     * draws still reading last frame's data don't stall the upload.
+     *
+     * @param data The new contents, size_bytes long
+     */
+    void update(const void *data);
+
+    /**
+     * @brief Makes the buffer the source for a uniform buffer binding.
+     * @param binding Binding index, see Shader::set_uniform_block()
+     */
+    void bind(GLuint binding) const;
+
+    bool is_valid() const;
+};
+} // namespace Charcoal
@@ -1,8 +1,15 @@
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_error.h>
 #include <SDL3/SDL_events.h>
+#include <SDL3/SDL_filesystem.h>
 #include <SDL3/SDL_init.h>
 #include <SDL3/SDL_log.h>
 #include <SDL3/SDL_pixels.h>
@@ -19,12 +26,24 @@
 #include <imgui_impl_sdl3.h>
 
 #include "engine/app_state.h"
+#include "engine/camera.h"
 #include "engine/config.h"
+#include "engine/frame_graph.h"
+#include "engine/frustum.h"
+#include "engine/gl_extensions.h"
 #include "engine/gui/debug_gui.h"
+#include "engine/level_streamer.h"
 //#include "engine/renderer.h"
 #include "engine/shader.h"
+#include "engine/shader_permutations.h"
 #include "engine/texture.h"
 #include "engine/mesh.h"
+#include "engine/hash.h"
+#include "engine/mesh_file.h"
+#include "engine/memory_tracker.h"
+#include "engine/mesh_optimize.h"
+#include "engine/mesh_simplify.h"
+#include "engine/occlusion_culler.h"
 #include "engine/time.h"
 #include "engine/window_utils.h"
 #include "engine/scene.h"
@@ -34,6 +53,29 @@
 static SDL_Window *window;
 static SDL_GLContext gl_context;
 
+// the GPU copy of a scene mesh, or null if it isn't uploaded
+static Charcoal::GpuMesh *find_gpu_mesh(
+        const Charcoal::AppState &app_state, uint32_t scene_mesh) {
+    Charcoal::GpuMesh *mesh = nullptr;
+    if (scene_mesh == 0) {
+        mesh = app_state.gpu_mesh.get();
+    } else if (scene_mesh < app_state.scene_gpu_meshes.size() &&
+               app_state.scene_gpu_meshes[scene_mesh] != nullptr) {
+        mesh = app_state.scene_gpu_meshes[scene_mesh].get();
+    } else {
+        mesh = app_state.level_streamer->get_gpu_mesh(scene_mesh);
+    }
+    return mesh != nullptr && mesh->is_valid() ? mesh : nullptr;
+}
+
+// sampler uniforms and block bindings only need setting once per program
+static void set_program_bindings(Charcoal::Shader &shader) {
+    shader.use();
+    shader.set_int("obj_texture", 0);
+    shader.set_int("glass_texture", 1);
+    shader.set_uniform_block("Camera", Charcoal::Camera::UNIFORM_BINDING);
+}
+
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
     SDL_SetAppMetadata(APP_FULL_NAME, APP_VERSION, APP_PACKAGE);
     SDL_SetLogPriority(SDL_LOG_CATEGORY_VIDEO, SDL_LOG_PRIORITY_WARN);
@@ -72,6 +114,12 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
         app_state->config.dpi_scaling = main_scale;
     }
 
+    // the default of 16 bits isn't enough for large scenes
+    if (!SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24)) {
+        SDL_LogError(SDL_LOG_CATEGORY_VIDEO,
+                "Failed to request a 24-bit depth buffer: %s", SDL_GetError());
+    }
+
     window = SDL_CreateWindow(APP_WINDOW_TITLE,
             static_cast<int>(
                     static_cast<float>(app_state->config.resolution.x) *
@@ -136,6 +184,7 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
         SDL_LogCritical(SDL_LOG_CATEGORY_VIDEO, "Failed to initialize GLAD");
         return SDL_APP_FAILURE;
     }
+    Charcoal::GlExtensions::load();
 
     // Configure render pipeline
     // face must be front and back. mode can be fill or wireframe
@@ -145,6 +194,24 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
 
+    // Enable depth testing. With clip control, depth is reversed so the
+    // depth buffer's precision isn't all spent right in front of the camera
+    glEnable(GL_DEPTH_TEST);
+    bool reverse_z = Charcoal::GlExtensions::get().clip_control;
+    if (reverse_z) {
+        Charcoal::GlExtensions::clip_control(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+        glDepthFunc(GL_GREATER);
+    } else {
+        glDepthFunc(GL_LESS);
+    }
+
+    // Init camera
+    app_state->camera.set_reverse_z(reverse_z);
+    app_state->camera.set_position(glm::vec3{0.0f, 0.0f, 1.5f});
+    app_state->camera.look_at(glm::vec3{0.0f, 0.0f, 0.0f});
+    app_state->camera_buffer = std::make_unique<Charcoal::UniformBuffer>(
+            sizeof(Charcoal::Camera::Uniforms));
+
     // Init Dear ImGUI
     IMGUI_CHECKVERSION();
     if (ImGui::CreateContext() == nullptr) {
@@ -182,43 +249,214 @@ SDL_AppResult SDL_AppInit(void **appstate, int argc, char **argv) {
     ImGui_ImplOpenGL3_Init(
             "#version 330 core"); // glad was configured to use 3.3 core
 
-    // Init default shader
-    app_state->shader = std::make_unique<Charcoal::Shader>(
-            Charcoal::ShaderLoader::from_files(
-                    Charcoal::ShaderLoader::DEFAULT_VERT_PATH,
-                    Charcoal::ShaderLoader::DEFAULT_FRAG_PATH));
-    if (!app_state->shader->is_valid()) {
-        SDL_LogCritical(SDL_LOG_CATEGORY_VIDEO,
-                "Failed to create default shader program");
+    // Init shader binary cache
+    if (app_state->config.shader_cache_enabled) {
+        char *pref_path = SDL_GetPrefPath("", APP_PACKAGE);
+        if (pref_path == nullptr) {
+            SDL_LogError(SDL_LOG_CATEGORY_RENDER,
+                    "Unable to find a place for the shader cache: %s",
+                    SDL_GetError());
+        } else {
+            app_state->program_cache =
+                    std::make_unique<Charcoal::ProgramCache>(
+                            std::string{pref_path} + "shader_cache");
+            SDL_free(pref_path);
+        }
+    }
+
+    // Submit shaders. They compile in the background while the rest of the
+    // scene loads, and are only waited on right before first use
+    {
+        Charcoal::MemoryTracker::TagScope tag{
+                Charcoal::MemoryTracker::Tag::shader};
+        // with hot reload on, shaders are read from the source tree when
+        // it's there. The copies next to the executable only change on a
+        // build, so edits to the originals would never be seen
+        std::string vert_path = Charcoal::ShaderLoader::DEFAULT_VERT_PATH;
+        std::string frag_path = Charcoal::ShaderLoader::DEFAULT_FRAG_PATH;
+#ifdef CHARCOAL_SOURCE_DIR
+        std::string source_vert = std::string{CHARCOAL_SOURCE_DIR "/"} +
+                                  Charcoal::ShaderLoader::DEFAULT_VERT_PATH;
+        SDL_PathInfo info;
+        if (app_state->config.shader_hot_reload &&
+                SDL_GetPathInfo(source_vert.c_str(), &info)) {
+            vert_path = std::move(source_vert);
+            frag_path = std::string{CHARCOAL_SOURCE_DIR "/"} +
+                        Charcoal::ShaderLoader::DEFAULT_FRAG_PATH;
+        }
+#endif
+        app_state->basic_shader =
+                std::make_unique<Charcoal::ShaderPermutations>(
+                        vert_path.c_str(), frag_path.c_str(),
+                        app_state->program_cache.get());
+    }
+    if (!app_state->basic_shader->is_valid()) {
         return SDL_APP_FAILURE;
     }
+    // every variant, including ones relinked by a reload
+    app_state->basic_shader->set_on_link(set_program_bindings);
+    app_state->material.shader_features = Charcoal::ShaderFeature::textured;
+    app_state->basic_shader->request(app_state->material.shader_features);
+    if (app_state->config.shader_hot_reload) {
+        for (const std::string &path :
+                app_state->basic_shader->get_dependencies()) {
+            app_state->file_watcher.watch(path);
+        }
+    }
 
     // Init scene
-    app_state->scene = std::make_unique<Charcoal::Scene>();
+    {
+        Charcoal::MemoryTracker::TagScope tag{
+                Charcoal::MemoryTracker::Tag::scene};
+        app_state->scene = std::make_unique<Charcoal::Scene>();
+        // a scene file or level can be passed on the command line. If it
+        // doesn't load, the default scene is kept. Levels are opened once
+        // the texture streamer exists
+        if (argc > 1 && !std::string_view{argv[1]}.ends_with(".level")) {
+            app_state->scene->load(argv[1], &app_state->jobs);
+        }
+    }
 
-    // Init CPU to GPU bridge
-    app_state->gpu_mesh = std::make_unique<Charcoal::GpuMesh>();
+    // Init asset cache
+    app_state->assets.set_vram_budget(
+            static_cast<std::size_t>(app_state->config.vram_budget_mb) * 1024 *
+            1024);
 
     // Upload mesh
     assert(app_state->scene->get_meshes().size() > 0);
     // todo: support merging meshes into a single big buffer
-    app_state->gpu_mesh->upload(app_state->scene->get_meshes()[0]);
+    app_state->gpu_mesh = app_state->assets.load_mesh(
+            "scene/quad", app_state->scene->get_meshes()[0]);
     if (!app_state->gpu_mesh->is_valid()) {
         return SDL_APP_FAILURE;    
     }
+    // and the meshes a scene file loaded. Level chunks that name them draw
+    // them from here too
+    std::span<const Charcoal::MeshView> scene_meshes =
+            app_state->scene->get_meshes();
+    app_state->scene_gpu_meshes.resize(scene_meshes.size());
+    for (uint32_t i = 1; i < scene_meshes.size(); ++i) {
+        std::string name{app_state->scene->get_mesh_name(i)};
+        if (!name.empty()) {
+            app_state->scene_gpu_meshes[i] =
+                    app_state->assets.load_mesh(name.c_str(), scene_meshes[i]);
+        }
+    }
 
-    // Init textures
-    Charcoal::Texture crate_texture = Charcoal::TextureLoader::load_from_png(
-            "./resources/textures/crate.png");
-    Charcoal::Texture glass_texture = Charcoal::TextureLoader::load_from_png(
-            "./resources/textures/glass.png");
-    app_state->gpu_texture.emplace_back(Charcoal::GpuTexture());
-    app_state->gpu_texture.emplace_back(Charcoal::GpuTexture());
-    app_state->gpu_texture[0].upload(crate_texture);
-    app_state->gpu_texture[1].upload(glass_texture);
-    app_state->shader->use();
-    app_state->shader->set_int("obj_texture", 0);
-    app_state->shader->set_int("glass_texture", 1);
+    // simplify the mesh into LODs and reorder it for the vertex cache in the
+    // background. The full mesh is drawn until it's ready. The result is
+    // kept in a mesh file, and mapped straight into GPU buffers on later
+    // runs until the scene mesh changes
+    const Charcoal::MeshView &scene_mesh = app_state->scene->get_meshes()[0];
+    Charcoal::MeshSimplify::Options lod_options;
+    // the cache is stale once the mesh, the file format or anything that
+    // processes the mesh changes
+    uint64_t scene_mesh_hash = scene_mesh.compute_hash();
+    for (uint64_t part : {uint64_t{Charcoal::MeshFile::VERSION},
+                 uint64_t{Charcoal::MeshSimplify::VERSION},
+                 uint64_t{Charcoal::MeshOptimize::VERSION},
+                 uint64_t{Charcoal::MeshOptimize::DEFAULT_CACHE_SIZE},
+                 uint64_t{lod_options.max_levels},
+                 uint64_t{lod_options.min_triangles}}) {
+        scene_mesh_hash = Charcoal::Hash::combine(scene_mesh_hash, part);
+    }
+    for (float part : {lod_options.reduction, lod_options.max_error}) {
+        scene_mesh_hash =
+                Charcoal::Hash::fnv1a64(&part, sizeof(part), scene_mesh_hash);
+    }
+    std::string mesh_cache_path;
+    if (char *pref_path = SDL_GetPrefPath("", APP_PACKAGE)) {
+        std::string directory = std::string{pref_path} + "mesh_cache/";
+        SDL_free(pref_path);
+        if (SDL_CreateDirectory(directory.c_str())) {
+            mesh_cache_path = directory + "scene_quad.cmsh";
+        }
+    }
+    Charcoal::MeshHandle cached_mesh;
+    if (!mesh_cache_path.empty() &&
+            SDL_GetPathInfo(mesh_cache_path.c_str(), nullptr)) {
+        Charcoal::MeshFile::Reader reader{mesh_cache_path.c_str()};
+        if (reader.is_valid() &&
+                reader.get_view().source_hash == scene_mesh_hash) {
+            cached_mesh = app_state->assets.load_mesh(
+                    "scene/quad_lods", reader.get_view());
+        }
+    }
+    if (cached_mesh && cached_mesh->is_valid()) {
+        app_state->gpu_mesh = std::move(cached_mesh);
+    } else {
+        app_state->lod_job = app_state->jobs.submit(
+                [mesh = Charcoal::Mesh{scene_mesh}, pool = &app_state->jobs,
+                        path = std::move(mesh_cache_path),
+                        scene_mesh_hash, lod_options]() mutable {
+                    Charcoal::MemoryTracker::TagScope tag{
+                            Charcoal::MemoryTracker::Tag::mesh};
+                    Charcoal::MeshSimplify::build_lods(
+                            mesh, lod_options, pool);
+                    Charcoal::MeshOptimize::Report report =
+                            Charcoal::MeshOptimize::optimize(mesh);
+                    SDL_Log("scene/quad: %zu LODs, ACMR %.3f -> %.3f, ATVR "
+                            "%.3f -> %.3f",
+                            mesh.lods.size(), report.before.acmr,
+                            report.after.acmr, report.before.atvr,
+                            report.after.atvr);
+                    if (!path.empty()) {
+                        Charcoal::MeshFile::write(
+                                path.c_str(), mesh, scene_mesh_hash);
+                    }
+                    return mesh;
+                });
+    }
+
+    // Init textures. These stream in over the first few frames, starting
+    // with the missing texture, under the asset cache's VRAM budget
+    app_state->texture_streamer = std::make_unique<Charcoal::TextureStreamer>(
+            &app_state->jobs, &app_state->assets,
+            static_cast<std::size_t>(
+                    app_state->config.texture_upload_kb_per_frame) *
+                    1024);
+    for (const char *path :
+            {"./resources/textures/crate.png", "./resources/textures/glass.png"}) {
+        Charcoal::TextureStreamer::Id id =
+                app_state->texture_streamer->add(path);
+        app_state->streamed_texture.push_back(id);
+    }
+
+    // Init level streaming. Chunks load around the camera from the first
+    // frame on
+    Charcoal::LevelStreamer::Config level_config;
+    level_config.load_radius = app_state->config.level_load_radius;
+    level_config.unload_radius = app_state->config.level_unload_radius;
+    level_config.upload_budget_ms =
+            app_state->config.level_upload_ms_per_frame;
+    app_state->level_streamer = std::make_unique<Charcoal::LevelStreamer>(
+            &app_state->jobs, app_state->scene.get(), &app_state->assets,
+            level_config);
+    if (argc > 1 && std::string_view{argv[1]}.ends_with(".level")) {
+        app_state->level_streamer->open(argv[1]);
+    }
+
+    // crate keeps its crisp, pixelated look up close, glass is smooth
+    Charcoal::SamplerDesc crate_sampler;
+    crate_sampler.mag_filter = GL_NEAREST;
+    crate_sampler.max_anisotropy = app_state->config.texture_anisotropy;
+    Charcoal::SamplerDesc glass_sampler;
+    glass_sampler.max_anisotropy = app_state->config.texture_anisotropy;
+    app_state->material.textures = {
+            {app_state->texture_streamer->get_texture(
+                     app_state->streamed_texture[0]),
+                    crate_sampler},
+            {app_state->texture_streamer->get_texture(
+                     app_state->streamed_texture[1]),
+                    glass_sampler}};
+    // Init default shader
+    Charcoal::Shader &shader =
+            app_state->basic_shader->get(app_state->material.shader_features);
+    if (!shader.is_valid()) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_VIDEO,
+                "Failed to create default shader program");
+        return SDL_APP_FAILURE;
+    }
 
     return SDL_APP_CONTINUE;
 }
@@ -227,6 +465,11 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
     Charcoal::AppState *app_state =
             reinterpret_cast<Charcoal::AppState *>(appstate);
 
+    // release the scratch memory of the frame before last. Last frame's is
+    // still in use until the frame graph is rebuilt
+    app_state->frame_arena.begin_frame();
+    Charcoal::MemoryTracker::begin_frame();
+
     // compute previous frame time
     app_state->time.update(SDL_GetTicksNS(), true);
 
@@ -244,38 +487,167 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
     }
 
     // update the scene
-    app_state->scene->update(app_state->time);
+    app_state->scene->update(app_state->time, &app_state->jobs);
 
-    // clear the buffer
-    glClearColor(app_state->config.clear_color.r,
-            app_state->config.clear_color.g, app_state->config.clear_color.b,
-            app_state->config.clear_color.a);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // release unused assets if we're over the VRAM budget
+    app_state->assets.update(app_state->time.get_frame_count());
 
     // compute per-frame values for uniforms later
     float time_value =
             app_state->time.ns_to_f32(app_state->time.get_total_time());
-    glm::mat4 transform = app_state->scene->get_local_transform_matrix();
     float blend_amount = 0.5f + (std::sin(time_value * 2.0f) / 2.0);
 
-    // bind shader + set uniforms
-    app_state->shader->use();
-    app_state->shader->set_mat4("transform", transform);
-    app_state->shader->set_float("blend", blend_amount);
-
-    // bind textures
-    glActiveTexture(GL_TEXTURE0);
-    app_state->gpu_texture[0].bind();
-    glActiveTexture(GL_TEXTURE1);
-    app_state->gpu_texture[1].bind();
+    // update the camera for this frame's window size
+    int pixel_width = 0;
+    int pixel_height = 0;
+    SDL_GetWindowSizeInPixels(window, &pixel_width, &pixel_height);
+    if (pixel_height > 0) {
+        app_state->camera.set_aspect(static_cast<float>(pixel_width) /
+                                     static_cast<float>(pixel_height));
+    }
+    Charcoal::Camera::Uniforms camera = app_state->camera.get_uniforms();
+    app_state->camera_buffer->update(&camera);
+    app_state->camera_buffer->bind(Charcoal::Camera::UNIFORM_BINDING);
+
+    // stream level chunks in around the camera and out behind it. This
+    // spawns and despawns objects, so it goes before culling
+    app_state->level_streamer->update(app_state->camera.get_position());
+    glm::vec2 viewport{
+            static_cast<float>(app_state->config.resolution.x) *
+                    app_state->config.dpi_scaling,
+            static_cast<float>(app_state->config.resolution.y) *
+                    app_state->config.dpi_scaling};
+
+    // cull meshes outside the view
+    Charcoal::Frustum frustum = app_state->camera.get_frustum();
+    app_state->visible_meshes.clear();
+    app_state->scene->get_bvh().query_frustum(
+            frustum, app_state->visible_meshes);
+
+    // then skip the ones hidden behind others. Every visible mesh occludes,
+    // which is cheap while meshes are simple.
+    const Charcoal::Scene &scene = *app_state->scene;
+    Charcoal::OcclusionCuller &occlusion = app_state->occlusion;
+    occlusion.begin(
+            camera.view_projection, app_state->frame_arena.get_resource());
+    for (uint32_t object : app_state->visible_meshes) {
+        const Charcoal::MeshView &mesh = scene.get_object_mesh(object);
+        occlusion.add_occluder(mesh.verts, mesh.indices,
+                scene.get_object_transform(object));
+    }
+    occlusion.build_pyramid();
+    std::erase_if(app_state->visible_meshes, [&](uint32_t object) {
+        return !occlusion.test(scene.get_object_mesh(object)
+                        .bounds.transformed(scene.get_object_transform(object))
+                        .box);
+    });
+    // swap in the mesh with LODs once they're built
+    if (app_state->lod_job.valid() &&
+            app_state->lod_job.wait_for(std::chrono::seconds{0}) ==
+                    std::future_status::ready) {
+        Charcoal::MeshHandle lod_mesh = app_state->assets.load_mesh(
+                "scene/quad_lods", app_state->lod_job.get());
+        if (lod_mesh->is_valid()) {
+            app_state->gpu_mesh = std::move(lod_mesh);
+        }
+    }
 
-    // bind VAO and draw
-    app_state->gpu_mesh->bind_vao();
-    glDrawElements(GL_TRIANGLES, app_state->gpu_mesh->get_element_count(),
-            GL_UNSIGNED_INT, 0);
+    // draw each visible object with its own transform, at the level that
+    // looks the same at its size. Ones whose mesh is still uploading are
+    // skipped
+    struct Draw {
+        Charcoal::GpuMesh *mesh;
+        Charcoal::MeshLod lod;
+        glm::mat4 transform;
+    };
+    std::pmr::vector<Draw> draws{app_state->frame_arena.get_resource()};
+    draws.reserve(app_state->visible_meshes.size());
+    // the biggest object on screen sets the texture detail
+    float max_pixels = 0.0f;
+    for (uint32_t object : app_state->visible_meshes) {
+        Charcoal::GpuMesh *mesh =
+                find_gpu_mesh(*app_state, scene.get_object_mesh_index(object));
+        if (mesh == nullptr) {
+            continue;
+        }
+        const Charcoal::Aabb &box = scene.get_object_mesh(object).bounds.box;
+        const glm::mat4 &object_transform = scene.get_object_transform(object);
+        float pixels = Charcoal::TextureStreamer::screen_extent(
+                camera.view_projection * object_transform, box.min, box.max,
+                viewport);
+        max_pixels = std::max(max_pixels, pixels);
+        draws.push_back({mesh,
+                mesh->get_lod(mesh->select_lod(
+                        pixels, app_state->config.lod_error_pixels)),
+                object_transform});
+    }
 
-    // draw the GUI
-    app_state->debug_gui.draw(app_state);
+    for (Charcoal::TextureStreamer::Id id : app_state->streamed_texture) {
+        app_state->texture_streamer->request(id, max_pixels);
+    }
+    app_state->texture_streamer->update(app_state->time.get_frame_count());
+
+    // pick up shader edits. The old programs stay in use until the new ones
+    // have compiled and linked
+    if (app_state->config.shader_hot_reload) {
+        for (const std::string &path : app_state->file_watcher.poll()) {
+            if (app_state->basic_shader->depends_on(path)) {
+                app_state->basic_shader->begin_reload();
+                // the edit may have added includes
+                for (const std::string &dependency :
+                        app_state->basic_shader->get_dependencies()) {
+                    app_state->file_watcher.watch(dependency);
+                }
+                break;
+            }
+        }
+    }
+    app_state->basic_shader->update();
+
+    Charcoal::Shader &shader =
+            app_state->basic_shader->get(app_state->material.shader_features);
+
+    // describe the frame. Passes whose output never reaches the backbuffer
+    // are culled, and transient textures share memory where they can
+    Charcoal::FrameGraph &graph = app_state->frame_graph;
+    graph.reset(app_state->frame_arena.get_resource());
+    Charcoal::FrameGraph::ResourceId backbuffer =
+            graph.import_backbuffer(pixel_width, pixel_height);
+
+    Charcoal::FrameGraph::PassId scene_pass = graph.add_pass(
+            "scene", [&](const Charcoal::FrameGraph &) {
+                // bind shader + set uniforms
+                shader.use();
+                shader.set_float("blend", blend_amount);
+
+                // bind textures and their samplers
+                app_state->material.bind(app_state->samplers);
+
+                for (const Draw &draw : draws) {
+                    shader.set_mat4("transform", draw.transform);
+                    draw.mesh->bind_vao();
+                    glDrawElements(GL_TRIANGLES, draw.lod.index_count,
+                            draw.mesh->get_index_type(),
+                            reinterpret_cast<const GLvoid *>(
+                                    draw.lod.index_offset *
+                                    draw.mesh->get_index_size()));
+                }
+            });
+    Charcoal::FrameGraph::Attachment clear;
+    clear.load = Charcoal::FrameGraph::LoadOp::clear;
+    clear.clear_color = app_state->config.clear_color;
+    clear.clear_depth = app_state->camera.get_far_depth();
+    graph.write(scene_pass, backbuffer, clear);
+
+    Charcoal::FrameGraph::PassId gui_pass = graph.add_pass("debug_gui",
+            [&](const Charcoal::FrameGraph &) {
+                app_state->debug_gui.draw(app_state);
+            });
+    graph.write(gui_pass, backbuffer);
+
+    if (graph.compile()) {
+        graph.execute();
+    }
 
     // display the render
     SDL_GL_SwapWindow(window);
@@ -318,4 +690,5 @@ void SDL_AppQuit(void *appstate, SDL_AppResult result) {
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
     SDL_DestroyWindow(window);
+    Charcoal::MemoryTracker::report_leaks();
 }
@@ -0,0 +1,95 @@
+#include "engine/mesh_file.h"
+#include "engine/mesh_import.h"
+#include "engine/mesh_optimize.h"
+#include "engine/mesh_simplify.h"
+#include "engine/thread_pool.h"
+#include <SDL3/SDL_init.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+double elapsed_ms(uint64_t start) {
+    return static_cast<double>(SDL_GetTicksNS() - start) / 1e6;
+}
+
+int usage() {
+    SDL_Log("Usage: CharcoalMeshImport [--no-lods] [--threads N] <input> "
+            "<output>");
+    SDL_Log("  input   .obj, .gltf or .glb");
+    SDL_Log("  output  engine mesh file (.cmsh)");
+    return 1;
+}
+} // namespace
+
+// Converts an OBJ or glTF file into the engine's binary mesh format, with
+// LODs and vertex cache ordering done ahead of time.
+int main(int argc, char **argv) {
+    bool build_lods = true;
+    unsigned int thread_count = 0;
+    const char *input = nullptr;
+    const char *output = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-lods") == 0) {
+            build_lods = false;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = static_cast<unsigned int>(
+                    std::strtoul(argv[++i], nullptr, 10));
+        } else if (input == nullptr) {
+            input = argv[i];
+        } else if (output == nullptr) {
+            output = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (input == nullptr || output == nullptr) {
+        return usage();
+    }
+    if (!SDL_Init(0)) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_ASSERT, "SDL failed to init: %s",
+                SDL_GetError());
+        return 1;
+    }
+
+    int status = 1;
+    {
+        Charcoal::ThreadPool pool{thread_count};
+        uint64_t start = SDL_GetTicksNS();
+        Charcoal::MeshImport::Result result =
+                Charcoal::MeshImport::import_file(input, &pool);
+        if (result.is_valid()) {
+            Charcoal::Mesh &mesh = result.mesh;
+            SDL_Log("Imported %zu vertices, %zu triangles in %.1f ms",
+                    mesh.verts.size(), mesh.indices.size() / 3,
+                    elapsed_ms(start));
+            // lets caches built from the mesh notice when it's re-imported
+            // with different contents
+            uint64_t source_hash = mesh.compute_hash();
+
+            if (build_lods) {
+                start = SDL_GetTicksNS();
+                Charcoal::MeshSimplify::build_lods(mesh, {}, &pool);
+                SDL_Log("Built %zu LODs in %.1f ms", mesh.lods.size(),
+                        elapsed_ms(start));
+            }
+            start = SDL_GetTicksNS();
+            Charcoal::MeshOptimize::Report report =
+                    Charcoal::MeshOptimize::optimize(mesh);
+            SDL_Log("Optimized in %.1f ms: ACMR %.3f -> %.3f, ATVR %.3f -> "
+                    "%.3f",
+                    elapsed_ms(start), report.before.acmr, report.after.acmr,
+                    report.before.atvr, report.after.atvr);
+
+            start = SDL_GetTicksNS();
+            if (Charcoal::MeshFile::write(output, mesh, source_hash)) {
+                SDL_Log("Wrote \"%s\" in %.1f ms", output, elapsed_ms(start));
+                status = 0;
+            }
+        }
+    }
+
+    SDL_Quit();
+    return status;
+}